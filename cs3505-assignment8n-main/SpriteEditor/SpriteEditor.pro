@@ -1,4 +1,4 @@
-QT       += core gui
+QT       += core gui concurrent network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,24 +8,79 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# The filter pipeline and frame bounds use SSE2 on x86, and they and the frame transforms use AVX2 when built for it.
+# Uncomment the following line to build for processors that have AVX2, the program will not start on ones that do not.
+#QMAKE_CXXFLAGS += -mavx2
+
 SOURCES += \
+    animationexporter.cpp \
+    bufferpool.cpp \
     canvas.cpp \
+    collabrelay.cpp \
+    collabsession.cpp \
+    editjournal.cpp \
     editor.cpp \
+    filterdialog.cpp \
+    filterpipeline.cpp \
     frame.cpp \
+    framebounds.cpp \
+    framecodec.cpp \
+    framehandle.cpp \
+    frameoperation.cpp \
+    frametransform.cpp \
+    frametween.cpp \
     main.cpp \
     mainwindow.cpp \
+    memorybudget.cpp \
+    oplog.cpp \
+    palette.cpp \
     preview.cpp \
+    quantizer.cpp \
+    selectionmask.cpp \
     sprite.cpp \
-    tool.cpp
+    spritearchive.cpp \
+    spriteimporter.cpp \
+    startuptimer.cpp \
+    strokebatch.cpp \
+    tool.cpp \
+    undostack.cpp \
+    workspace.cpp
 
 HEADERS += \
+    animationexporter.h \
+    bufferpool.h \
+    byteorder.h \
     canvas.h \
+    collabrelay.h \
+    collabsession.h \
+    editjournal.h \
     editor.h \
+    filterdialog.h \
+    filterpipeline.h \
     frame.h \
+    framebounds.h \
+    framecodec.h \
+    framehandle.h \
+    frameoperation.h \
+    frametransform.h \
+    frametween.h \
     mainwindow.h \
+    memorybudget.h \
+    oplog.h \
+    palette.h \
+    pixelformat.h \
     preview.h \
+    quantizer.h \
+    selectionmask.h \
     sprite.h \
-    tool.h
+    spritearchive.h \
+    spriteimporter.h \
+    spritesnapshot.h \
+    startuptimer.h \
+    strokebatch.h \
+    tool.h \
+    undostack.h \
+    workspace.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,481 @@
+#include "animationexporter.h"
+#include "quantizer.h"
+#include <QFile>
+#include <QtConcurrent>
+#include <memory>
+#include <numeric>
+
+namespace {
+
+const int kMaxGifColors = 255; // the last of the 256 GIF palette slots is kept for transparency
+const int kMaxLzwCode = 4095;  // GIF codes are at most 12 bits wide
+
+struct GifChange {
+    QRect changed;             // the pixels that differ from the previous frame
+    bool clearsPixels = false; // true if a drawn pixel became transparent
+};
+
+void appendLittleEndian16(QByteArray &out, int value) {
+    out.append(char(value & 0xFF));
+    out.append(char((value >> 8) & 0xFF));
+}
+
+void appendBigEndian16(QByteArray &out, int value) {
+    out.append(char((value >> 8) & 0xFF));
+    out.append(char(value & 0xFF));
+}
+
+void appendBigEndian32(QByteArray &out, quint32 value) {
+    out.append(char((value >> 24) & 0xFF));
+    out.append(char((value >> 16) & 0xFF));
+    out.append(char((value >> 8) & 0xFF));
+    out.append(char(value & 0xFF));
+}
+
+/// the value a pixel is compared and quantized by once its alpha is reduced to drawn or not drawn
+QRgb gifKey(QRgb color) {
+    return ColorQuantizer::isOpaque(color) ? (color | 0xFF000000) : 0;
+}
+
+/// finds the bounding box of the pixels whose keys differ between two frames
+template <typename KeyFunction>
+QRect changedRect(const QImage &previous, const QImage &current, KeyFunction key, bool *clearsPixels) {
+    int left = current.width(), top = current.height(), right = -1, bottom = -1;
+    for (int y = 0; y < current.height(); y++) {
+        const QRgb *previousRow = reinterpret_cast<const QRgb*>(previous.constScanLine(y));
+        const QRgb *currentRow = reinterpret_cast<const QRgb*>(current.constScanLine(y));
+        for (int x = 0; x < current.width(); x++) {
+            QRgb before = key(previousRow[x]);
+            QRgb after = key(currentRow[x]);
+            if (before == after)
+                continue;
+            left = std::min(left, x);
+            right = std::max(right, x);
+            top = std::min(top, y);
+            bottom = y;
+            if (clearsPixels && before != 0 && after == 0)
+                *clearsPixels = true;
+        }
+    }
+    if (right < 0)
+        return QRect();
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+/// the number of bits needed to index a color table holding entries colors
+int colorTableBits(int entries) {
+    int bits = 1;
+    while ((1 << bits) < entries)
+        bits++;
+    return bits;
+}
+
+void appendColorTable(QByteArray &out, const std::vector<QRgb> &palette, int tableBits) {
+    for (int index = 0; index < (1 << tableBits); index++) {
+        QRgb color = index < (int)palette.size() ? palette[index] : 0;
+        out.append(char(qRed(color)));
+        out.append(char(qGreen(color)));
+        out.append(char(qBlue(color)));
+    }
+}
+
+/// compresses palette indices with GIF flavoured LZW and splits the result into data sub-blocks
+QByteArray lzwCompress(const std::vector<uchar> &indices, int minCodeSize) {
+    const int clearCode = 1 << minCodeSize;
+    const int endCode = clearCode + 1;
+    const int tableSize = 5003; // prime, a bit larger than the 4096 codes the table can hold
+
+    std::vector<int> tableKeys(tableSize);
+    std::vector<int> tableCodes(tableSize);
+    int codeSize = 0;
+    int maxCode = 0;
+
+    QByteArray packed;
+    quint32 bitBuffer = 0;
+    int bitCount = 0;
+    auto writeCode = [&](int code) {
+        bitBuffer |= quint32(code) << bitCount;
+        bitCount += codeSize;
+        while (bitCount >= 8) {
+            packed.append(char(bitBuffer & 0xFF));
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    };
+    auto resetTable = [&]() {
+        std::fill(tableKeys.begin(), tableKeys.end(), -1);
+        codeSize = minCodeSize + 1;
+        maxCode = endCode;
+    };
+
+    resetTable();
+    writeCode(clearCode);
+
+    bool firstSinceClear = true;
+    int prefix = indices.empty() ? 0 : indices[0];
+    for (size_t position = 1; position < indices.size(); position++) {
+        int suffix = indices[position];
+        int key = (prefix << 8) | suffix;
+        int slot = ((suffix << 12) ^ prefix) % tableSize;
+        while (tableKeys[slot] != -1 && tableKeys[slot] != key)
+            slot = (slot + 1) % tableSize;
+
+        if (tableKeys[slot] == key) {
+            prefix = tableCodes[slot];
+            continue;
+        }
+
+        writeCode(prefix);
+        firstSinceClear = false;
+        tableKeys[slot] = key;
+        tableCodes[slot] = ++maxCode;
+        if (maxCode >= (1 << codeSize))
+            codeSize++;
+        if (maxCode == kMaxLzwCode) {
+            writeCode(clearCode);
+            resetTable();
+            firstSinceClear = true;
+        }
+        prefix = suffix;
+    }
+
+    if (!indices.empty()) {
+        writeCode(prefix);
+        // the decoder adds a table entry for this last code too, which can widen the end code
+        if (!firstSinceClear && maxCode + 1 >= (1 << codeSize) && codeSize < 12)
+            codeSize++;
+    }
+    writeCode(endCode);
+    if (bitCount > 0)
+        packed.append(char(bitBuffer & 0xFF));
+
+    QByteArray blocks;
+    blocks.reserve(packed.size() + packed.size() / 255 + 2);
+    for (qsizetype start = 0; start < packed.size(); start += 255) {
+        qsizetype length = std::min<qsizetype>(255, packed.size() - start);
+        blocks.append(char(length));
+        blocks.append(packed.constData() + start, length);
+    }
+    blocks.append(char(0));
+    return blocks;
+}
+
+/// builds the control extension, descriptor, optional local palette and image data for one GIF frame
+QByteArray encodeGifFrame(const QImage &image, const QImage *previous, const QRect &rect, bool skipUnchanged,
+                          const ColorQuantizer *sharedQuantizer, int disposal, int delay) {
+    std::unique_ptr<ColorQuantizer> localQuantizer;
+    const ColorQuantizer *quantizer = sharedQuantizer;
+    if (!quantizer) {
+        QHash<QRgb, quint32> histogram;
+        ColorQuantizer::accumulateHistogram(image, rect, histogram);
+        localQuantizer = std::make_unique<ColorQuantizer>(histogram, kMaxGifColors);
+        quantizer = localQuantizer.get();
+    }
+
+    const std::vector<QRgb> &palette = quantizer->getPalette();
+    int transparentIndex = palette.size();
+    int tableBits = colorTableBits(palette.size() + 1);
+
+    std::vector<uchar> indices;
+    indices.reserve(rect.width() * rect.height());
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        const QRgb *previousRow = previous ? reinterpret_cast<const QRgb*>(previous->constScanLine(y)) : nullptr;
+        for (int x = rect.left(); x <= rect.right(); x++) {
+            QRgb key = gifKey(row[x]);
+            // pixels that are already showing from the previous frame are left see-through
+            if (key == 0 || (skipUnchanged && key == gifKey(previousRow[x])))
+                indices.push_back(transparentIndex);
+            else
+                indices.push_back(quantizer->indexOf(key));
+        }
+    }
+
+    QByteArray block;
+    const char controlExtension[] = {'\x21', '\xF9', '\x04'};
+    block.append(controlExtension, sizeof(controlExtension));
+    block.append(char((disposal << 2) | 0x01)); // the transparent index is always in use
+    appendLittleEndian16(block, delay);
+    block.append(char(transparentIndex));
+    block.append(char(0));
+
+    block.append(char(0x2C));
+    appendLittleEndian16(block, rect.left());
+    appendLittleEndian16(block, rect.top());
+    appendLittleEndian16(block, rect.width());
+    appendLittleEndian16(block, rect.height());
+    if (sharedQuantizer)
+        block.append(char(0));
+    else {
+        block.append(char(0x80 | (tableBits - 1)));
+        appendColorTable(block, palette, tableBits);
+    }
+
+    int minCodeSize = std::max(2, tableBits);
+    block.append(char(minCodeSize));
+    block.append(lzwCompress(indices, minCodeSize));
+    return block;
+}
+
+quint32 crc32(const QByteArray &data) {
+    static const std::vector<quint32> table = [] {
+        std::vector<quint32> values(256);
+        for (quint32 index = 0; index < 256; index++) {
+            quint32 value = index;
+            for (int bit = 0; bit < 8; bit++)
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            values[index] = value;
+        }
+        return values;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data)
+        crc = table[(crc ^ uchar(byte)) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void appendPngChunk(QByteArray &out, const char *type, const QByteArray &data) {
+    QByteArray typedData(type, 4);
+    typedData.append(data);
+    appendBigEndian32(out, data.size());
+    out.append(typedData);
+    appendBigEndian32(out, crc32(typedData));
+}
+
+/// filters each row of the rectangle with whichever of none, sub or up packs best, then deflates it
+QByteArray encodePngRows(const QImage &image, const QRect &rect) {
+    const int bytesPerPixel = 4;
+    const int rowBytes = rect.width() * bytesPerPixel;
+
+    std::vector<uchar> previousRow(rowBytes, 0);
+    std::vector<uchar> currentRow(rowBytes);
+    std::vector<uchar> candidate(rowBytes);
+    std::vector<uchar> best(rowBytes);
+
+    QByteArray filtered;
+    filtered.reserve(qsizetype(rowBytes + 1) * rect.height());
+    for (int y = rect.top(); y <= rect.bottom(); y++) {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y)) + rect.left();
+        for (int x = 0; x < rect.width(); x++) {
+            currentRow[x * 4] = qRed(row[x]);
+            currentRow[x * 4 + 1] = qGreen(row[x]);
+            currentRow[x * 4 + 2] = qBlue(row[x]);
+            currentRow[x * 4 + 3] = qAlpha(row[x]);
+        }
+
+        // the smallest sum of the bytes read as signed values is the usual guess for what deflates best
+        auto score = [rowBytes](const std::vector<uchar> &bytes) {
+            long total = 0;
+            for (int index = 0; index < rowBytes; index++)
+                total += std::abs(int(static_cast<signed char>(bytes[index])));
+            return total;
+        };
+
+        int bestFilter = 0;
+        best = currentRow;
+        long bestScore = score(currentRow);
+
+        for (int index = 0; index < rowBytes; index++)
+            candidate[index] = currentRow[index] - (index >= bytesPerPixel ? currentRow[index - bytesPerPixel] : 0);
+        long candidateScore = score(candidate);
+        if (candidateScore < bestScore) {
+            bestFilter = 1;
+            bestScore = candidateScore;
+            std::swap(best, candidate);
+        }
+
+        for (int index = 0; index < rowBytes; index++)
+            candidate[index] = currentRow[index] - previousRow[index];
+        if (score(candidate) < bestScore) {
+            bestFilter = 2;
+            std::swap(best, candidate);
+        }
+
+        filtered.append(char(bestFilter));
+        filtered.append(reinterpret_cast<const char*>(best.data()), rowBytes);
+        std::swap(previousRow, currentRow);
+    }
+
+    // qCompress puts the uncompressed length in front of the zlib stream, PNG only wants the stream
+    return qCompress(filtered, 9).mid(4);
+}
+
+std::vector<QImage> toArgb32(const std::vector<QImage> &frames) {
+    std::vector<QImage> images;
+    images.reserve(frames.size());
+    for (const QImage &frame : frames)
+        images.push_back(frame.convertToFormat(QImage::Format_ARGB32));
+    return images;
+}
+
+bool writeFile(const QString &filepath, const QByteArray &header, const QList<QByteArray> &blocks, const QByteArray &trailer) {
+    QFile file(filepath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(header);
+    for (const QByteArray &block : blocks)
+        file.write(block);
+    file.write(trailer);
+    file.close();
+    return true;
+}
+
+}
+
+bool AnimationExporter::exportGif(const std::vector<QImage> &frames, int frameRate, const QString &filepath,
+                                  PaletteMode paletteMode) {
+    if (frames.empty())
+        return false;
+
+    std::vector<QImage> images = toArgb32(frames);
+    const int width = images[0].width();
+    const int height = images[0].height();
+    const int delay = std::max(1, qRound(100.0 / std::max(1, frameRate))); // GIF delays are in hundredths of a second
+
+    std::vector<int> frameIndices(images.size());
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+
+    QList<GifChange> changes = QtConcurrent::blockingMapped<QList<GifChange>>(frameIndices, [&images](int index) {
+        GifChange change;
+        if (index == 0)
+            change.changed = images[0].rect();
+        else
+            change.changed = changedRect(images[index - 1], images[index], gifKey, &change.clearsPixels);
+        return change;
+    });
+
+    // a frame that makes pixels transparent needs the frame before it cleared away. Clearing only
+    // reaches the rectangle of that frame, so it grows to cover the change, and the new frame then
+    // has to redraw everything in it
+    std::vector<QRect> rects(images.size());
+    std::vector<int> disposals(images.size(), 1); // 1 leaves the frame in place, 2 clears it
+    std::vector<bool> skipUnchanged(images.size(), false);
+    rects[0] = images[0].rect();
+    for (size_t index = 1; index < images.size(); index++) {
+        QRect rect = changes[index].changed;
+        if (changes[index].clearsPixels) {
+            rects[index - 1] = rects[index - 1].united(rect);
+            rect = rects[index - 1];
+            disposals[index - 1] = 2;
+        }
+        else
+            skipUnchanged[index] = true;
+        rects[index] = rect.isEmpty() ? QRect(0, 0, 1, 1) : rect;
+    }
+    // start every loop from a clear canvas. Clearing only reaches the last frame's rectangle, so the last frame
+    // covers the whole canvas and redraws all of it, otherwise frame 0 would show through onto stale pixels
+    rects.back() = images.back().rect();
+    disposals.back() = 2;
+    skipUnchanged.back() = false;
+
+    std::unique_ptr<ColorQuantizer> sharedQuantizer;
+    if (paletteMode == PaletteMode::Shared) {
+        QHash<QRgb, quint32> histogram = QtConcurrent::blockingMappedReduced<QHash<QRgb, quint32>>(frameIndices,
+            [&images, &rects](int index) {
+                QHash<QRgb, quint32> frameHistogram;
+                ColorQuantizer::accumulateHistogram(images[index], rects[index], frameHistogram);
+                return frameHistogram;
+            },
+            [](QHash<QRgb, quint32> &total, const QHash<QRgb, quint32> &frameHistogram) {
+                for (auto it = frameHistogram.constBegin(); it != frameHistogram.constEnd(); ++it)
+                    total[it.key()] += it.value();
+            });
+        sharedQuantizer = std::make_unique<ColorQuantizer>(histogram, kMaxGifColors);
+    }
+
+    const ColorQuantizer *quantizer = sharedQuantizer.get();
+    QList<QByteArray> blocks = QtConcurrent::blockingMapped<QList<QByteArray>>(frameIndices, [&](int index) {
+        return encodeGifFrame(images[index], index > 0 ? &images[index - 1] : nullptr, rects[index],
+                              skipUnchanged[index], quantizer, disposals[index], delay);
+    });
+
+    QByteArray header("GIF89a");
+    appendLittleEndian16(header, width);
+    appendLittleEndian16(header, height);
+    if (quantizer) {
+        int tableBits = colorTableBits(quantizer->getPalette().size() + 1);
+        header.append(char(0x80 | 0x70 | (tableBits - 1))); // global table with 8 bit color resolution
+        header.append(char(0));                             // background color index
+        header.append(char(0));                             // pixel aspect ratio
+        appendColorTable(header, quantizer->getPalette(), tableBits);
+    }
+    else {
+        header.append(char(0x70));
+        header.append(char(0));
+        header.append(char(0));
+    }
+
+    // the netscape extension makes the animation loop forever
+    const char loopExtension[] = {'\x21', '\xFF', '\x0B', 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0',
+                                  '\x03', '\x01', '\x00', '\x00', '\x00'};
+    header.append(loopExtension, sizeof(loopExtension));
+
+    return writeFile(filepath, header, blocks, QByteArray(1, '\x3B'));
+}
+
+bool AnimationExporter::exportApng(const std::vector<QImage> &frames, int frameRate, const QString &filepath) {
+    if (frames.empty())
+        return false;
+
+    std::vector<QImage> images = toArgb32(frames);
+    std::vector<int> frameIndices(images.size());
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+
+    QList<QRect> rects = QtConcurrent::blockingMapped<QList<QRect>>(frameIndices, [&images](int index) {
+        if (index == 0)
+            return images[0].rect();
+        QRect rect = changedRect(images[index - 1], images[index], [](QRgb color) { return color; }, nullptr);
+        return rect.isEmpty() ? QRect(0, 0, 1, 1) : rect;
+    });
+
+    QList<QByteArray> compressed = QtConcurrent::blockingMapped<QList<QByteArray>>(frameIndices, [&](int index) {
+        return encodePngRows(images[index], rects[index]);
+    });
+
+    QByteArray header("\x89PNG\r\n\x1A\n", 8);
+
+    QByteArray imageHeader;
+    appendBigEndian32(imageHeader, images[0].width());
+    appendBigEndian32(imageHeader, images[0].height());
+    const char imageFormat[] = {8, 6, 0, 0, 0}; // 8 bit RGBA, deflate, no interlacing
+    imageHeader.append(imageFormat, sizeof(imageFormat));
+    appendPngChunk(header, "IHDR", imageHeader);
+
+    QByteArray animationControl;
+    appendBigEndian32(animationControl, images.size());
+    appendBigEndian32(animationControl, 0); // loop forever
+    appendPngChunk(header, "acTL", animationControl);
+
+    // every frame is drawn over the last one in place, replacing only its own rectangle
+    QList<QByteArray> chunks;
+    quint32 sequence = 0;
+    for (size_t index = 0; index < images.size(); index++) {
+        QByteArray chunk;
+        QByteArray frameControl;
+        appendBigEndian32(frameControl, sequence++);
+        appendBigEndian32(frameControl, rects[index].width());
+        appendBigEndian32(frameControl, rects[index].height());
+        appendBigEndian32(frameControl, rects[index].left());
+        appendBigEndian32(frameControl, rects[index].top());
+        appendBigEndian16(frameControl, 1);
+        appendBigEndian16(frameControl, std::max(1, frameRate));
+        frameControl.append(char(0)); // leave the frame in place when the next one is drawn
+        frameControl.append(char(0)); // replace the rectangle instead of blending over it
+        appendPngChunk(chunk, "fcTL", frameControl);
+
+        if (index == 0)
+            appendPngChunk(chunk, "IDAT", compressed[index]);
+        else {
+            QByteArray frameData;
+            appendBigEndian32(frameData, sequence++);
+            frameData.append(compressed[index]);
+            appendPngChunk(chunk, "fdAT", frameData);
+        }
+        chunks.append(chunk);
+    }
+
+    QByteArray trailer;
+    appendPngChunk(trailer, "IEND", QByteArray());
+    return writeFile(filepath, header, chunks, trailer);
+}
@@ -0,0 +1,39 @@
+#ifndef ANIMATIONEXPORTER_H
+#define ANIMATIONEXPORTER_H
+
+#include <QImage>
+#include <QString>
+#include <vector>
+/*
+ * the animation exporter writes the frames of a sprite out as an animated GIF or an animated PNG.
+ * only the rectangle that changed since the previous frame is stored for each frame, and the
+ * per frame work (quantizing, filtering and compressing) is spread across the global thread pool.
+ */
+class AnimationExporter
+{
+public:
+    /// Where the GIF palette comes from
+    enum class PaletteMode {
+        Shared = 0,  // one global palette built from every frame
+        PerFrame = 1 // a local palette built from each frame's changed rectangle
+    };
+
+    /// @brief writes the frames as a looping animated GIF.
+    /// pixels with less than half alpha become transparent since GIFs only have one transparent index
+    /// @param frames the frames of the sprite in order, they must all be the same size
+    /// @param frameRate the number of frames displayed each second
+    /// @param filepath the path of the file to write
+    /// @param paletteMode whether the frames share one palette or each get their own
+    /// @return true if the file was written
+    static bool exportGif(const std::vector<QImage> &frames, int frameRate, const QString &filepath,
+                          PaletteMode paletteMode = PaletteMode::Shared);
+
+    /// @brief writes the frames as a looping, lossless animated PNG
+    /// @param frames the frames of the sprite in order, they must all be the same size
+    /// @param frameRate the number of frames displayed each second
+    /// @param filepath the path of the file to write
+    /// @return true if the file was written
+    static bool exportApng(const std::vector<QImage> &frames, int frameRate, const QString &filepath);
+};
+
+#endif // ANIMATIONEXPORTER_H
@@ -0,0 +1,80 @@
+#include "bufferpool.h"
+
+BufferPool& BufferPool::instance() {
+    // never destroyed, frames held in statics may still give their pixels back while the program exits
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+int BufferPool::classOf(size_t bytes) {
+    if (bytes <= (size_t(1) << kSmallestShift))
+        return 0;
+    int shift = kSmallestShift;
+    while (shift <= kLargestShift && (size_t(1) << (shift + 1)) < bytes)
+        shift++;
+    if (shift > kLargestShift)
+        return -1;
+    // bytes is past 2^shift and at most 2^(shift + 1), round it up to the next quarter step
+    size_t base = size_t(1) << shift;
+    size_t quarter = base / 4;
+    int step = int((bytes - base + quarter - 1) / quarter);
+    int sizeClass = (shift - kSmallestShift) * 4 + step;
+    return sizeClass < kClassCount ? sizeClass : -1;
+}
+
+size_t BufferPool::classBytes(int sizeClass) {
+    int shift = kSmallestShift + sizeClass / 4;
+    return (size_t(4 + sizeClass % 4) << shift) / 4;
+}
+
+void* BufferPool::allocate(size_t bytes) {
+    int sizeClass = classOf(bytes);
+    if (sizeClass < 0) {
+        systemAllocations++;
+        return ::operator new(bytes);
+    }
+    SizeClass& pool = classes[sizeClass];
+    {
+        std::lock_guard<std::mutex> guard(pool.lock);
+        if (FreeBlock* block = pool.freeBlocks) {
+            pool.freeBlocks = block->next;
+            retainedBytes -= classBytes(sizeClass);
+            return block;
+        }
+    }
+    systemAllocations++;
+    return ::operator new(classBytes(sizeClass));
+}
+
+void BufferPool::deallocate(void* block, size_t bytes) {
+    if (!block)
+        return;
+    int sizeClass = classOf(bytes);
+    if (sizeClass < 0 || retainedBytes + qint64(classBytes(sizeClass)) > retainLimit) {
+        ::operator delete(block);
+        return;
+    }
+    SizeClass& pool = classes[sizeClass];
+    std::lock_guard<std::mutex> guard(pool.lock);
+    pool.freeBlocks = new (block) FreeBlock{pool.freeBlocks};
+    retainedBytes += classBytes(sizeClass);
+}
+
+void BufferPool::setRetainLimit(qint64 bytes) {
+    retainLimit = bytes;
+    trim(bytes);
+}
+
+void BufferPool::trim(qint64 limit) {
+    // the largest blocks go first, they are the least likely to be asked for again
+    for (int sizeClass = kClassCount - 1; sizeClass >= 0 && retainedBytes > limit; sizeClass--) {
+        SizeClass& pool = classes[sizeClass];
+        std::lock_guard<std::mutex> guard(pool.lock);
+        while (pool.freeBlocks && retainedBytes > limit) {
+            FreeBlock* block = pool.freeBlocks;
+            pool.freeBlocks = block->next;
+            retainedBytes -= classBytes(sizeClass);
+            ::operator delete(block);
+        }
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <QtGlobal>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+
+/*
+ * the buffer pool hands out the memory frames keep their pixels in. blocks are sorted into size classes a
+ * quarter of a power of two apart, and a freed block is kept on its class's free list for the next frame of
+ * about the same size instead of going back to the system. editing mostly makes, copies and drops frames of
+ * the sprite's own size, so once a few of them have come and gone it stops asking the system for memory.
+ * frames are made on worker threads too, so every class has its own lock.
+ */
+class BufferPool
+{
+public:
+    /// Freed blocks kept for reuse by default, past this they go back to the system
+    static constexpr qint64 kDefaultRetainLimit = 64 * 1024 * 1024;
+
+    /// @brief gets the pool every frame shares
+    static BufferPool& instance();
+
+    /// @brief gets a block of at least a number of bytes, reusing a freed one of its size class if there is one
+    void* allocate(size_t bytes);
+
+    /// @brief gives a block back to the pool
+    /// @param block the block, from allocate
+    /// @param bytes the number of bytes it was allocated with
+    void deallocate(void* block, size_t bytes);
+
+    /// @brief sets how much memory freed blocks may hold on to, dropping blocks if they already hold more
+    void setRetainLimit(qint64 bytes);
+
+    /// @brief gets how much memory the freed blocks waiting to be reused take up
+    qint64 getRetainedBytes() const { return retainedBytes; }
+
+    /// @brief gets how many times the pool has had to ask the system for a block
+    qint64 getSystemAllocations() const { return systemAllocations; }
+private:
+    static constexpr int kSmallestShift = 6;  // the smallest block is 64 bytes, room for a free list link
+    static constexpr int kLargestShift = 28;  // blocks over 256 MB come straight from the system
+    static constexpr int kClassCount = (kLargestShift - kSmallestShift + 1) * 4;
+
+    /// a freed block, linked to the next free block of its class through its own first bytes
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct SizeClass {
+        std::mutex lock;
+        FreeBlock* freeBlocks = nullptr;
+    };
+
+    SizeClass classes[kClassCount];
+    std::atomic<qint64> retainLimit{kDefaultRetainLimit};
+    std::atomic<qint64> retainedBytes{0};
+    std::atomic<qint64> systemAllocations{0};
+
+    BufferPool() = default;
+
+    /// @brief finds the size class of a request, or -1 if it is too large to pool
+    static int classOf(size_t bytes);
+
+    /// @brief gets the size of the blocks in a class
+    static size_t classBytes(int sizeClass);
+
+    /// @brief hands the freed blocks of every class back to the system until only limit bytes are retained
+    void trim(qint64 limit);
+};
+
+/// An allocator for standard containers that takes its memory from the buffer pool
+template<typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() = default;
+    template<typename Other>
+    PoolAllocator(const PoolAllocator<Other>&) {}
+
+    T* allocate(size_t count) { return static_cast<T*>(BufferPool::instance().allocate(count * sizeof(T))); }
+    void deallocate(T* block, size_t count) { BufferPool::instance().deallocate(block, count * sizeof(T)); }
+
+    template<typename Other>
+    bool operator==(const PoolAllocator<Other>&) const { return true; }
+    template<typename Other>
+    bool operator!=(const PoolAllocator<Other>&) const { return false; }
+};
+
+/// Destroys an object made by makePooled and gives its memory back to the pool
+template<typename T>
+struct PoolDeleter {
+    void operator()(T* object) const {
+        object->~T();
+        BufferPool::instance().deallocate(object, sizeof(T));
+    }
+};
+
+/// An owning handle to an object that lives in pool memory
+template<typename T>
+using PooledPtr = std::unique_ptr<T, PoolDeleter<T>>;
+
+/// @brief makes an object in pool memory
+template<typename T, typename... Args>
+PooledPtr<T> makePooled(Args&&... args) {
+    static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "pool blocks only have the default alignment");
+    void* block = BufferPool::instance().allocate(sizeof(T));
+    try {
+        return PooledPtr<T>(new (block) T(std::forward<Args>(args)...));
+    } catch (...) {
+        BufferPool::instance().deallocate(block, sizeof(T));
+        throw;
+    }
+}
+
+#endif // BUFFERPOOL_H
@@ -0,0 +1,37 @@
+#ifndef BYTEORDER_H
+#define BYTEORDER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+/*
+ * the archive, the crash journal and the collaboration ops all write their numbers little endian a byte at a
+ * time, so the files and messages read the same on any machine. reading does not check the bounds, the
+ * callers check a record fits before reading its fields.
+ */
+
+/// @brief appends a 32 bit number, lowest byte first
+inline void appendLittleEndian32(QByteArray &out, quint32 value) {
+    for (int shift = 0; shift < 32; shift += 8)
+        out.append(char((value >> shift) & 0xFF));
+}
+
+/// @brief appends a 64 bit number, lowest byte first
+inline void appendLittleEndian64(QByteArray &out, quint64 value) {
+    for (int shift = 0; shift < 64; shift += 8)
+        out.append(char((value >> shift) & 0xFF));
+}
+
+/// @brief reads a 32 bit number written by appendLittleEndian32
+inline quint32 readLittleEndian32(const QByteArray &data, qsizetype position) {
+    quint32 value = 0;
+    for (int byte = 0; byte < 4; byte++)
+        value |= quint32(uchar(data[position + byte])) << (8 * byte);
+    return value;
+}
+
+/// @brief reads a 64 bit number written by appendLittleEndian64
+inline quint64 readLittleEndian64(const QByteArray &data, qsizetype position) {
+    return quint64(readLittleEndian32(data, position)) | (quint64(readLittleEndian32(data, position + 4)) << 32);
+}
+
+#endif // BYTEORDER_H
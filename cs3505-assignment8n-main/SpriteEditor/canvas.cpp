@@ -1,5 +1,6 @@
 #include "canvas.h"
 #include <QMouseEvent>
+#include <QPainter>
 /// @reviewed by kevin
 Canvas::Canvas(QWidget *parent) : QLabel(parent) {
     setPalette(QColorConstants::White);
@@ -8,14 +9,14 @@ Canvas::Canvas(QWidget *parent) : QLabel(parent) {
 }
 
 void Canvas::mousePressEvent(QMouseEvent *event) {
-    emit mouseAction(event->position(), size(), true);
+    emit mouseAction(event->position() - frameArea().topLeft(), frameArea().size(), true);
 }
 void Canvas::mouseMoveEvent(QMouseEvent *event) {
     if (rect().contains(event->position().toPoint()))
-        emit mouseAction(event->position(), size(), true);
+        emit mouseAction(event->position() - frameArea().topLeft(), frameArea().size(), true);
 }
 void Canvas::mouseReleaseEvent(QMouseEvent *event) {
-    emit mouseAction(event->position(), size(), false);
+    emit mouseAction(event->position() - frameArea().topLeft(), frameArea().size(), false);
 }
 
 void Canvas::resizeEvent(QResizeEvent *event) {
@@ -37,8 +38,105 @@ void Canvas::resizeEvent(QResizeEvent *event) {
     setImage(image);
 }
 
-void Canvas::setImage(QImage &image) {
-    if (image.size() != size())
-        Canvas::image = image.scaled(size(), Qt::KeepAspectRatio);
-    setPixmap(QPixmap::fromImage(Canvas::image));
+void Canvas::setImage(const QImage &image) {
+    spriteSize = image.size();
+    Canvas::image = image;
+    // when tiled the frame is scaled into one tile, and painting repeats that one pixmap rather than the frame nine times
+    QSize scaledSize = tiled ? frameArea().size() : size();
+    Qt::AspectRatioMode aspect = tiled ? Qt::IgnoreAspectRatio : Qt::KeepAspectRatio;
+    scaled = QPixmap::fromImage(image.size() != scaledSize ? image.scaled(scaledSize, aspect) : image);
+    reportMemoryUse();
+    update();
+}
+
+void Canvas::updatePixels(const QImage &image, const QRect &pixels) {
+    // the pixels are mapped the way toCanvas maps them, which only matches the scaled frame if it fills the area
+    if (image.size() != spriteSize || scaled.size() != frameArea().size()) {
+        setImage(image);
+        return;
+    }
+    Canvas::image = image;
+    QRect changed = pixels & image.rect();
+    QRect target = toCanvas(changed);
+    {
+        QPainter painter(&scaled);
+        painter.setCompositionMode(QPainter::CompositionMode_Source); // transparent pixels replace what was there
+        painter.drawImage(target.translated(-frameArea().topLeft()), image.copy(changed));
+    }
+    if (!tiled) {
+        update(target);
+        return;
+    }
+    QRegion dirty;
+    for (int row = -1; row <= 1; row++)
+        for (int column = -1; column <= 1; column++)
+            dirty += target.translated(column * scaled.width(), row * scaled.height());
+    update(dirty);
+}
+
+void Canvas::reportMemoryUse() {
+    auto pixmapBytes = [](const QPixmap &pixmap) { return qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8; };
+    qint64 bytes = image.sizeInBytes() + overlay.sizeInBytes() + pixmapBytes(scaled);
+    memoryReport.set(bytes);
+}
+
+void Canvas::setTiled(bool enabled) {
+    if (enabled == tiled)
+        return;
+    tiled = enabled;
+    setImage(image);
+}
+
+QRect Canvas::frameArea() const {
+    if (!tiled)
+        return rect();
+    return QRect(width() / 3, height() / 3, width() / 3, height() / 3);
+}
+
+void Canvas::setOverlay(const QImage &overlay, QPoint position, const QRect &selection) {
+    if (overlay.cacheKey() == Canvas::overlay.cacheKey() && position == overlayPosition && selection == selectionBounds)
+        return;
+    QRegion dirty = overlayRegion();
+    Canvas::overlay = overlay;
+    overlayPosition = position;
+    selectionBounds = selection;
+    reportMemoryUse();
+    update(dirty + overlayRegion());
+}
+
+QRect Canvas::toCanvas(const QRect &pixels) const {
+    if (spriteSize.isEmpty())
+        return QRect();
+    // rounding both corners the same way keeps neighbouring pixels from overlapping or leaving gaps
+    QRect area = frameArea();
+    int left = pixels.left() * area.width() / spriteSize.width();
+    int top = pixels.top() * area.height() / spriteSize.height();
+    int right = (pixels.right() + 1) * area.width() / spriteSize.width();
+    int bottom = (pixels.bottom() + 1) * area.height() / spriteSize.height();
+    return QRect(QPoint(left, top), QPoint(right - 1, bottom - 1)).translated(area.topLeft());
+}
+
+QRegion Canvas::overlayRegion() const {
+    QRegion region;
+    if (!overlay.isNull())
+        region += toCanvas(QRect(overlayPosition, overlay.size()));
+    if (!selectionBounds.isEmpty())
+        region += toCanvas(selectionBounds).adjusted(-1, -1, 1, 1); // the outline is drawn just outside
+    return region;
+}
+
+void Canvas::paintEvent(QPaintEvent *event) {
+    QLabel::paintEvent(event);
+    QPainter painter(this);
+    painter.setClipRegion(event->region());
+    if (tiled)
+        painter.drawTiledPixmap(QRect(0, 0, scaled.width() * 3, scaled.height() * 3), scaled);
+    else
+        painter.drawPixmap(0, (height() - scaled.height()) / 2, scaled); // where the label would put it
+    if (!overlay.isNull())
+        painter.drawImage(toCanvas(QRect(overlayPosition, overlay.size())), overlay); // unsmoothed, so pixels stay sharp
+    if (!selectionBounds.isEmpty()) {
+        painter.setPen(QPen(Qt::black, 1, Qt::DashLine));
+        painter.drawRect(toCanvas(selectionBounds));
+    }
 }
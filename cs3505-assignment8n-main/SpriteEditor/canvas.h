@@ -2,8 +2,10 @@
 #define CANVAS_H
 
 #include <QLabel>
+#include <QPixmap>
 #include <QObject>
 #include <QWidget>
+#include "memorybudget.h"
 /*
  * the canvas class is responsible for tracking the mouse events
  * and sending them to the editor for individual frame adjustments.
@@ -20,9 +22,47 @@ class Canvas : public QLabel
         /// @param parent is the parent widget for 'this' Canvas
         Canvas(QWidget *parent = nullptr);
     private:
-        /// Represents the image that the user is currently editing
+        /// Represents the image that the user is currently editing, before it is scaled to the canvas
         QImage image;
 
+        /// The size of the frame in pixels, before it was scaled to fit the canvas
+        QSize spriteSize;
+
+        /// Pixels drawn over the frame that are not part of it yet, like a floating selection
+        QImage overlay;
+
+        /// Where the overlay's top left corner sits on the frame, in frame pixels
+        QPoint overlayPosition;
+
+        /// The outline drawn around the selection in frame pixels, empty when nothing is selected
+        QRect selectionBounds;
+
+        /// True if the frame is drawn three by three so the edges of a tile can be seen meeting
+        bool tiled = false;
+
+        /// The frame scaled to the canvas, or to one tile that is repeated to draw the tiled view
+        QPixmap scaled;
+
+        /// The memory the canvas holds, as the memory budget sees it
+        MemoryReport memoryReport{MemoryUse::Canvas};
+
+        /// @brief Gets the part of the canvas showing the frame being edited, the middle tile when tiled
+        QRect frameArea() const;
+
+        /// @brief Maps a rectangle of frame pixels to the part of the canvas showing it, the same way
+        /// the editor maps mouse positions back to pixels
+        QRect toCanvas(const QRect &pixels) const;
+
+        /// @brief Gets the part of the canvas the overlay and selection outline cover
+        QRegion overlayRegion() const;
+
+        /// @brief Tells the memory budget how much the frame, overlay and pixmaps being shown take
+        void reportMemoryUse();
+
+        /// @brief paintEvent Draws the frame, then the overlay and selection outline over it
+        /// @param event The paint event, only its region is redrawn
+        void paintEvent(QPaintEvent *event) override;
+
         /// @brief mouseMoveEvent Keeps track of the mouse moving
         /// @param event The mouse event
         void mouseMoveEvent(QMouseEvent *event) override;
@@ -48,7 +88,26 @@ class Canvas : public QLabel
     public slots:
         /// \brief setImage Sets the image that the canvas is currently holding
         /// \param iamge The image that the canvas will hold
-        void setImage(QImage &iamge);
+        void setImage(const QImage &iamge);
+
+        /// \brief updatePixels Shows a new image of the same frame, redrawing only the pixels that changed
+        /// rather than scaling the whole frame again, so a stroke or an edit from another site stays cheap on
+        /// large sprites
+        /// \param image The frame's new image
+        /// \param pixels The pixels that differ from the image shown now
+        void updatePixels(const QImage &image, const QRect &pixels);
+
+        /// \brief setOverlay Sets what is drawn over the frame. Only the parts of the canvas the old and new
+        /// overlay cover are redrawn, so dragging a floating selection does not repaint the whole frame
+        /// \param overlay The pixels to draw over the frame, or a null image for none
+        /// \param position Where the overlay's top left corner sits on the frame
+        /// \param selection The outline to draw around the selection, or an empty rectangle for none
+        void setOverlay(const QImage &overlay, QPoint position, const QRect &selection);
+
+        /// \brief setTiled Shows the frame tiled three by three around itself, for drawing tiles that wrap around.
+        /// Mouse positions and the overlay are for the middle tile
+        /// \param enabled True to tile the frame, false to show it once
+        void setTiled(bool enabled);
 };
 
 #endif // CANVAS_H
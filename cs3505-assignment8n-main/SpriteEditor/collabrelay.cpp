@@ -0,0 +1,155 @@
+#include "collabrelay.h"
+#include "oplog.h"
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <algorithm>
+
+CollabRelay::CollabRelay(QObject *parent) : QObject(parent) {}
+
+CollabRelay::~CollabRelay() {
+    if (localServer)
+        localServer->close();
+    if (tcpServer)
+        tcpServer->close();
+}
+
+bool CollabRelay::listen(const QString &address) {
+    if (OpLog::isTcpAddress(address)) {
+        QHostAddress hostAddress;
+        quint16 port = 0;
+        if (!OpLog::readTcpAddress(address, hostAddress, port))
+            return false; // a session is for the artists on one machine, nothing off it is let in
+        tcpServer = new QTcpServer(this);
+        if (!tcpServer->listen(hostAddress, port))
+            return false;
+        connect(tcpServer, &QTcpServer::newConnection, this, [this]() {
+            while (QTcpSocket *socket = tcpServer->nextPendingConnection()) {
+                // edits go out the moment they are made, rather than waiting to be batched with the next one
+                socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { removeSite(socket); });
+                addSite(socket);
+            }
+        });
+        return true;
+    }
+
+    localServer = new QLocalServer(this);
+    if (!localServer->listen(address)) {
+        // a relay that crashed leaves its socket file behind, which is only taken over if nothing answers on it
+        QLocalSocket probe;
+        probe.connectToServer(address);
+        if (probe.waitForConnected(100))
+            return false;
+        QLocalServer::removeServer(address);
+        if (!localServer->listen(address))
+            return false;
+    }
+    connect(localServer, &QLocalServer::newConnection, this, [this]() {
+        while (QLocalSocket *socket = localServer->nextPendingConnection()) {
+            connect(socket, &QLocalSocket::disconnected, this, [this, socket]() { removeSite(socket); });
+            addSite(socket);
+        }
+    });
+    return true;
+}
+
+void CollabRelay::addSite(QIODevice *socket) {
+    Site site;
+    site.id = nextSite++;
+    sites.insert(socket, site);
+    connect(socket, &QIODevice::readyRead, this, [this, socket]() { readSite(socket); });
+
+    OpLog::Op welcome;
+    welcome.kind = OpLog::Kind::Welcome;
+    welcome.sequence = sequence;
+    welcome.site = site.id;
+    welcome.emptyLog = log.empty();
+    socket->write(OpLog::encode(welcome));
+    for (const QByteArray &message : log)
+        socket->write(message);
+    send(socket, QByteArray());
+}
+
+void CollabRelay::removeSite(QIODevice *socket) {
+    if (!sites.remove(socket))
+        return;
+    if (socket == checkpointSite)
+        checkpointSite = nullptr; // the next edit asks someone else
+    socket->deleteLater();
+}
+
+void CollabRelay::readSite(QIODevice *socket) {
+    auto found = sites.find(socket);
+    if (found == sites.end())
+        return;
+    // the buffer is held here while the messages are passed on, in case a site drops out partway through
+    QByteArray buffer = found->buffer + socket->readAll();
+    found->buffer.clear();
+    quint32 siteId = found->id;
+
+    QByteArray message;
+    while (OpLog::takeMessage(buffer, message)) {
+        if (message.isEmpty()) {
+            socket->close(); // the site sent garbage, and nothing it sends after can be lined up again
+            return;
+        }
+        OpLog::Kind kind = OpLog::kindOf(message);
+        if (kind == OpLog::Kind::Checkpoint) {
+            if (socket == checkpointSite)
+                checkpointSite = nullptr;
+            quint64 base = OpLog::checkpointBase(message);
+            // a snapshot after the checkpoint, or a newer checkpoint, already covers everything it does
+            bool outdated = std::any_of(log.begin(), log.end(), [base](const QByteArray &logged) {
+                OpLog::Kind loggedKind = OpLog::kindOf(logged);
+                bool replaces = loggedKind == OpLog::Kind::Snapshot || loggedKind == OpLog::Kind::Checkpoint;
+                return replaces && OpLog::sequenceOf(logged) >= base;
+            });
+            if (outdated || base > sequence)
+                continue;
+            OpLog::stamp(message, base, siteId);
+            std::vector<QByteArray> kept{message};
+            for (QByteArray &logged : log)
+                if (OpLog::sequenceOf(logged) > base)
+                    kept.push_back(std::move(logged));
+            log = std::move(kept);
+            editsSinceCheckpoint = log.size() - 1;
+            continue;
+        }
+        if (kind == OpLog::Kind::Welcome || kind == OpLog::Kind::CheckpointWanted)
+            continue; // only the relay sends these
+
+        OpLog::stamp(message, ++sequence, siteId);
+        if (kind == OpLog::Kind::Snapshot) {
+            log.clear(); // nothing before a snapshot matters to a site that joins after it
+            editsSinceCheckpoint = 0;
+        }
+        else
+            editsSinceCheckpoint++;
+        log.push_back(message);
+        for (auto site = sites.begin(); site != sites.end(); ++site)
+            send(site.key(), message);
+
+        if (editsSinceCheckpoint >= kEditsPerCheckpoint && !checkpointSite) {
+            // the site that just sent an edit is certainly still there to answer
+            checkpointSite = socket;
+            OpLog::Op wanted;
+            wanted.kind = OpLog::Kind::CheckpointWanted;
+            send(socket, OpLog::encode(wanted));
+        }
+    }
+    found = sites.find(socket);
+    if (found != sites.end())
+        found->buffer = buffer;
+}
+
+void CollabRelay::send(QIODevice *socket, const QByteArray &message) {
+    if (!message.isEmpty())
+        socket->write(message);
+    if (QLocalSocket *local = qobject_cast<QLocalSocket*>(socket))
+        local->flush();
+    else if (QTcpSocket *tcp = qobject_cast<QTcpSocket*>(socket))
+        tcp->flush();
+}
@@ -0,0 +1,65 @@
+#ifndef COLLABRELAY_H
+#define COLLABRELAY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <vector>
+
+class QIODevice;
+class QLocalServer;
+class QTcpServer;
+/*
+ * the collaboration relay puts the edits of every site in one order. a site sends each edit as soon as it
+ * makes it, the relay stamps it with the next sequence number and passes it straight on to every site,
+ * the one that made it included, so all of them apply the same edits in the same order. it keeps the log
+ * since the last snapshot or checkpoint to bring sites that join later up to date, and once that log grows
+ * long it asks a site for a checkpoint so the log can start over from it. the relay never decodes the
+ * edits themselves. it listens on a local socket, or on a TCP port on the loopback address, and runs on a
+ * thread of its own, or as a process of its own with --relay.
+ */
+class CollabRelay : public QObject
+{
+    Q_OBJECT
+public:
+    /// How many edits are logged after a checkpoint before the relay asks for the next one
+    static constexpr int kEditsPerCheckpoint = 2000;
+
+    explicit CollabRelay(QObject *parent = nullptr);
+    ~CollabRelay();
+
+    /// @brief starts taking sites
+    /// @param address a local socket name, or host:port for a TCP port on the loopback address
+    /// @return false if the address is taken or not a loopback one
+    bool listen(const QString &address);
+private:
+    /// A site connected to the relay
+    struct Site {
+        quint32 id = 0;
+        QByteArray buffer; // read from the site but not a whole message yet
+    };
+
+    QLocalServer *localServer = nullptr;
+    QTcpServer *tcpServer = nullptr;
+    QHash<QIODevice*, Site> sites;
+    quint32 nextSite = 1;
+    quint64 sequence = 0;            // the last sequence number stamped
+    std::vector<QByteArray> log;     // the last snapshot or checkpoint and every edit after it
+    int editsSinceCheckpoint = 0;
+    QIODevice *checkpointSite = nullptr; // the site asked for a checkpoint that has not sent it yet
+
+    /// @brief welcomes a site that just connected and replays the log to it
+    void addSite(QIODevice *socket);
+
+    /// @brief forgets a site that went away
+    void removeSite(QIODevice *socket);
+
+    /// @brief stamps and passes on every whole message a site has sent
+    void readSite(QIODevice *socket);
+
+    /// @brief sends a message to a site right away, rather than once the event loop comes back around
+    static void send(QIODevice *socket, const QByteArray &message);
+};
+
+#endif // COLLABRELAY_H
@@ -0,0 +1,411 @@
+#include "collabsession.h"
+#include "framecodec.h"
+#include "sprite.h"
+#include <QHostAddress>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <algorithm>
+
+CollabSession::CollabSession(QObject *parent) : QObject(parent) {}
+
+bool CollabSession::join(const QString &address) {
+    if (OpLog::isTcpAddress(address)) {
+        QHostAddress host;
+        quint16 port = 0;
+        if (!OpLog::readTcpAddress(address, host, port))
+            return false;
+        QTcpSocket *tcp = new QTcpSocket(this);
+        tcp->connectToHost(host, port);
+        if (!tcp->waitForConnected(kConnectTimeoutMs)) {
+            delete tcp;
+            return false;
+        }
+        // each edit goes out the moment it is made, rather than waiting to be batched with the next one
+        tcp->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        connect(tcp, &QTcpSocket::disconnected, this, [this]() { emit left("The session's relay closed"); });
+        socket = tcp;
+    }
+    else {
+        QLocalSocket *local = new QLocalSocket(this);
+        local->connectToServer(address);
+        if (!local->waitForConnected(kConnectTimeoutMs)) {
+            delete local;
+            return false;
+        }
+        connect(local, &QLocalSocket::disconnected, this, [this]() { emit left("The session's relay closed"); });
+        socket = local;
+    }
+    connect(socket, &QIODevice::readyRead, this, &CollabSession::readSocket);
+    return true;
+}
+
+void CollabSession::frameChanged(int index, const QRect &area, const Frame &after) {
+    int position = positionOfIndex(index);
+    if (!canSend() || area.isEmpty() || position < 0)
+        return;
+    // only the pixels inside the area travel, so a stroke sends a few bytes rather than the frame
+    Frame patch(area.width(), area.height());
+    patch.blit(after, area, QPoint(0, 0));
+    OpLog::Op op;
+    op.kind = OpLog::Kind::FrameChanged;
+    op.frame = order[position].id;
+    op.area = area;
+    op.pixels = FrameCodec::encode(patch, nullptr);
+    send(std::move(op), std::move(patch));
+}
+
+void CollabSession::frameInserted(int index, const Frame &frame) {
+    int previous = index > 0 ? positionOfIndex(index - 1) : -1;
+    if (!canSend() || (index > 0 && previous < 0))
+        return;
+    OpLog::Op op;
+    op.kind = OpLog::Kind::FrameInserted;
+    op.frame = newFrameId();
+    op.after = index > 0 ? order[previous].id : 0;
+    op.pixels = FrameCodec::encode(frame, nullptr);
+    // placed the same way every other site will place it, which is also where the editor put it
+    order.insert(order.begin() + placeAfter(op.after), FrameEntry{op.frame, true, false});
+    send(std::move(op), frame);
+}
+
+void CollabSession::frameErased(int index, const Frame &frame) {
+    int position = positionOfIndex(index);
+    if (!canSend() || position < 0)
+        return;
+    order[position].alive = false;
+    OpLog::Op op;
+    op.kind = OpLog::Kind::FrameErased;
+    op.frame = order[position].id;
+    send(std::move(op), frame);
+}
+
+void CollabSession::spriteReplaced(Sprite &sprite) {
+    if (canSend())
+        shareSprite(sprite, false);
+}
+
+void CollabSession::shareSprite(Sprite &sprite, bool checkpoint) {
+    if (!socket || site == 0)
+        return;
+    if (checkpoint && (!synced || liveFrames() != sprite.getFrameCount()))
+        return;
+    OpLog::Op op;
+    op.kind = checkpoint ? OpLog::Kind::Checkpoint : OpLog::Kind::Snapshot;
+    op.base = lastSequence;
+    op.size = QSize(sprite.getWidth(), sprite.getHeight());
+    if (!checkpoint) {
+        // the frames all get new ids, so edits still in flight for the old sprite find nothing to land on
+        order.clear();
+        for (int index = 0; index < sprite.getFrameCount(); index++)
+            order.push_back(FrameEntry{newFrameId(), true});
+    }
+
+    // the frames are stored like a saved archive, deltas of the frame before them with a keyframe now and then
+    std::optional<Frame> previous;
+    int index = 0;
+    for (const FrameEntry &entry : order) {
+        op.frameIds.push_back(entry.id);
+        if (!entry.alive) {
+            op.frames.push_back(QByteArray());
+            continue;
+        }
+        Frame frame = sprite.getFrame(index);
+        bool keyframe = index % Sprite::kDefaultKeyframeInterval == 0;
+        op.frames.push_back(FrameCodec::encode(frame, keyframe ? nullptr : &*previous));
+        previous = std::move(frame);
+        index++;
+    }
+    spriteSize = op.size;
+    synced = true;
+
+    if (checkpoint) {
+        write(OpLog::encode(op)); // only the relay keeps it, so it never comes back
+        return;
+    }
+    send(std::move(op), std::nullopt);
+}
+
+void CollabSession::readSocket() {
+    buffer.append(socket->readAll());
+    spriteChanged = false;
+    bool damaged = false;
+
+    applying = true;
+    QByteArray message;
+    while (OpLog::takeMessage(buffer, message)) {
+        OpLog::Op op;
+        if (message.isEmpty() || !OpLog::decode(message, op)) {
+            damaged = true;
+            break;
+        }
+        handle(op);
+    }
+    applying = false;
+
+    // a whole batch of edits is shown at once, so a burst of strokes from another site repaints once per read
+    if (spriteChanged)
+        emit remoteEditsApplied();
+    if (damaged) {
+        emit left("The session sent something that could not be read");
+        return;
+    }
+    // a checkpoint has to match the relay's order exactly, which it only does with nothing pending
+    if (checkpointWanted && pending.empty()) {
+        checkpointWanted = false;
+        emit spriteWanted(true);
+    }
+}
+
+void CollabSession::handle(const OpLog::Op &op) {
+    switch (op.kind) {
+    case OpLog::Kind::Welcome:
+        site = op.site;
+        lastSequence = op.sequence;
+        // the first site to join shares its sprite, the others get the sprite from the log that follows
+        if (op.emptyLog)
+            emit spriteWanted(false);
+        return;
+    case OpLog::Kind::CheckpointWanted:
+        checkpointWanted = true;
+        return;
+    default:
+        break;
+    }
+    lastSequence = op.sequence;
+    if (op.site != site) {
+        applyRemote(op);
+        return;
+    }
+
+    // one of this site's own edits came back stamped, and the relay sends them back in the order they went out
+    if (pending.empty() || pending.front().op.localId != op.localId)
+        return;
+    PendingEdit edit = std::move(pending.front());
+    pending.pop_front();
+    if (op.kind == OpLog::Kind::FrameInserted) {
+        // frames other sites added behind the same frame since have gone in ahead of it, so it moves to
+        // where they all put it
+        int position = positionOf(op.frame);
+        if (position < 0)
+            return;
+        FrameEntry entry = order[position];
+        int from = indexAt(position);
+        order.erase(order.begin() + position);
+        int target = placeAfter(op.after);
+        entry.committed = true;
+        order.insert(order.begin() + target, entry);
+        if (entry.alive && indexAt(target) != from) {
+            spriteChanged = true;
+            emit remoteFrameMoved(from, indexAt(target));
+        }
+    }
+    else if (op.kind == OpLog::Kind::FrameErased)
+        settleErase(edit);
+    else if (op.kind == OpLog::Kind::Snapshot && edit.remoteEditsAtSend != remoteEdits) {
+        // the edits that came in after it was sent were stamped before it, so every other site has the
+        // snapshot over them
+        spriteChanged = true;
+        apply(edit.op, std::nullopt);
+        for (const PendingEdit &later : pending)
+            apply(later.op, later.pixels);
+    }
+}
+
+void CollabSession::applyRemote(const OpLog::Op &op) {
+    remoteEdits++;
+    spriteChanged = true;
+    std::optional<Frame> pixels;
+    bool ok = true;
+    if (op.kind == OpLog::Kind::FrameChanged)
+        pixels = FrameCodec::decode(op.pixels, op.area.width(), op.area.height(), nullptr, &ok);
+    else if (op.kind == OpLog::Kind::FrameInserted)
+        pixels = FrameCodec::decode(op.pixels, spriteSize.width(), spriteSize.height(), nullptr, &ok);
+    if (!ok)
+        return;
+    apply(op, pixels);
+
+    // this site's pending edits were stamped after it, so the ones it touched go back over it
+    bool replacesSprite = op.kind == OpLog::Kind::Snapshot || op.kind == OpLog::Kind::Checkpoint;
+    for (const PendingEdit &edit : pending) {
+        bool sameFrame = op.kind == OpLog::Kind::FrameChanged && edit.op.kind == OpLog::Kind::FrameChanged &&
+                         edit.op.frame == op.frame;
+        if (replacesSprite || sameFrame)
+            apply(edit.op, edit.pixels);
+    }
+}
+
+void CollabSession::apply(const OpLog::Op &op, const std::optional<Frame> &pixels) {
+    switch (op.kind) {
+    case OpLog::Kind::FrameChanged: {
+        int position = positionOf(op.frame);
+        if (position < 0 || !pixels)
+            return; // the frame was erased first, so the edit has nothing to land on anywhere
+        if (!order[position].alive) {
+            // this site erased it, but every other site still has it, so the edit goes on the pixels kept
+            // in case it has to be put back
+            if (!order[position].committed)
+                return;
+            for (PendingEdit &edit : pending)
+                if (edit.op.kind == OpLog::Kind::FrameErased && edit.op.frame == op.frame && edit.pixels)
+                    edit.pixels->blit(*pixels, QRect(QPoint(0, 0), op.area.size()), op.area.topLeft());
+            return;
+        }
+        emit remoteFrameChanged(indexAt(position), op.area, *pixels);
+        break;
+    }
+    case OpLog::Kind::FrameInserted: {
+        if (positionOf(op.frame) >= 0 || !pixels)
+            return;
+        int position = placeAfter(op.after);
+        // one of this site's own is only in the relay's order once it comes back stamped
+        order.insert(order.begin() + position, FrameEntry{op.frame, true, op.site != site});
+        emit remoteFrameInserted(indexAt(position), *pixels);
+        break;
+    }
+    case OpLog::Kind::FrameErased: {
+        int position = positionOf(op.frame);
+        if (position < 0)
+            return;
+        if (op.site == site) {
+            // one of this site's pending erases going back over a replaced sprite, settled once it is stamped
+            if (!order[position].alive || liveFrames() <= 1)
+                return;
+            order[position].alive = false;
+            emit remoteFrameErased(indexAt(position));
+            return;
+        }
+        // the sprite always keeps one frame, counted in the relay's order so every site skips the same erase
+        if (!order[position].committed || committedFrames() <= 1)
+            return;
+        order[position].committed = false;
+        if (!order[position].alive)
+            return; // this site erased it too
+        keepOneFrame(position);
+        order[position].alive = false;
+        emit remoteFrameErased(indexAt(position));
+        break;
+    }
+    case OpLog::Kind::Snapshot:
+    case OpLog::Kind::Checkpoint:
+        applySnapshot(op);
+        break;
+    default:
+        break;
+    }
+}
+
+void CollabSession::settleErase(const PendingEdit &edit) {
+    int position = positionOf(edit.op.frame);
+    if (position < 0 || !order[position].committed)
+        return; // another site erased it first
+    if (committedFrames() > 1) {
+        order[position].committed = false;
+        if (!order[position].alive)
+            return;
+        // it was brought back to keep the sprite from emptying, and now its erase has gone through
+        keepOneFrame(position);
+        order[position].alive = false;
+        spriteChanged = true;
+        emit remoteFrameErased(indexAt(position));
+        return;
+    }
+    // it was the last frame left when the relay put the erase in order, so every other site kept it
+    if (order[position].alive || !edit.pixels)
+        return;
+    order[position].alive = true;
+    spriteChanged = true;
+    emit remoteFrameInserted(indexAt(position), *edit.pixels);
+}
+
+void CollabSession::keepOneFrame(int erasing) {
+    if (liveFrames() > 1)
+        return;
+    // the relay's order still has a frame past this one, and the only frames it has that this site does not
+    // show are ones this site erased, so the latest of those comes back
+    for (auto edit = pending.rbegin(); edit != pending.rend(); ++edit) {
+        int position = edit->op.kind == OpLog::Kind::FrameErased ? positionOf(edit->op.frame) : -1;
+        if (position < 0 || position == erasing || !order[position].committed || order[position].alive || !edit->pixels)
+            continue;
+        order[position].alive = true;
+        spriteChanged = true;
+        emit remoteFrameInserted(indexAt(position), *edit->pixels);
+        return;
+    }
+}
+
+void CollabSession::applySnapshot(const OpLog::Op &op) {
+    std::vector<FrameEntry> entries;
+    std::vector<Frame> frames;
+    frames.reserve(op.frames.size()); // each frame is decoded against the one before, which must not move
+    for (size_t position = 0; position < op.frames.size(); position++) {
+        if (op.frames[position].isEmpty()) {
+            entries.push_back(FrameEntry{op.frameIds[position], false, false});
+            continue;
+        }
+        bool ok = true;
+        Frame frame = FrameCodec::decode(op.frames[position], op.size.width(), op.size.height(),
+                                         frames.empty() ? nullptr : &frames.back(), &ok);
+        if (!ok)
+            return;
+        frames.push_back(std::move(frame));
+        entries.push_back(FrameEntry{op.frameIds[position], true});
+    }
+    if (frames.empty())
+        return;
+    order = std::move(entries);
+    spriteSize = op.size;
+    synced = true;
+    emit remoteSpriteReplaced(new Sprite(op.size.width(), op.size.height(), std::move(frames)));
+}
+
+void CollabSession::send(OpLog::Op op, std::optional<Frame> pixels) {
+    op.site = site;
+    op.localId = ++lastLocalId;
+    write(OpLog::encode(op));
+    pending.push_back(PendingEdit{std::move(op), std::move(pixels), remoteEdits});
+}
+
+void CollabSession::write(const QByteArray &message) {
+    socket->write(message);
+    // pushed out now rather than once the editor's event loop comes back around, which a long stroke delays
+    if (QLocalSocket *local = qobject_cast<QLocalSocket*>(socket))
+        local->flush();
+    else if (QTcpSocket *tcp = qobject_cast<QTcpSocket*>(socket))
+        tcp->flush();
+}
+
+int CollabSession::positionOf(quint64 id) const {
+    for (int position = 0; position < (int)order.size(); position++)
+        if (order[position].id == id)
+            return position;
+    return -1;
+}
+
+int CollabSession::positionOfIndex(int index) const {
+    for (int position = 0; position < (int)order.size(); position++)
+        if (order[position].alive && index-- == 0)
+            return position;
+    return -1;
+}
+
+int CollabSession::indexAt(int position) const {
+    int index = 0;
+    for (int before = 0; before < position; before++)
+        index += order[before].alive;
+    return index;
+}
+
+int CollabSession::liveFrames() const {
+    return indexAt(order.size());
+}
+
+int CollabSession::committedFrames() const {
+    return std::count_if(order.begin(), order.end(), [](const FrameEntry &entry) { return entry.committed; });
+}
+
+int CollabSession::placeAfter(quint64 after) const {
+    if (after == 0)
+        return 0;
+    int position = positionOf(after);
+    return position < 0 ? order.size() : position + 1;
+}
@@ -0,0 +1,183 @@
+#ifndef COLLABSESSION_H
+#define COLLABSESSION_H
+
+#include "frame.h"
+#include "oplog.h"
+#include <QObject>
+#include <QRect>
+#include <QSize>
+#include <deque>
+#include <optional>
+#include <vector>
+
+class QIODevice;
+class Sprite;
+/*
+ * a collaboration session shares one document's sprite with the other sites connected to the same relay.
+ * the editor tells it about every change it makes, and it sends each one out as an op at once. edits from
+ * other sites come back as signals for the editor to apply, all of them in the relay's order.
+ * every site applies its own edits right away instead of waiting for the relay, so until an edit comes back
+ * stamped it is pending. a pixel edit from another site that lands on a frame with pending edits is applied
+ * and then the pending edits are drawn over it again, since the relay put them after it. an added frame goes
+ * right after the frame it was added behind, once it comes back stamped. with every site following those two
+ * rules in the relay's order, they all end up with the same sprite, the last edit to a pixel winning.
+ * erased frames are kept as ids in the frame order, so a frame added behind one that was erased at the same
+ * time still finds its place. an erase that would leave the sprite with no frames is skipped, judged by the
+ * frames left in the relay's order rather than by what a site shows, so every site skips the same one. a site
+ * whose own erase turns out to be skipped puts the frame back.
+ */
+class CollabSession : public QObject
+{
+    Q_OBJECT
+public:
+    /// How long joining waits for the relay to answer
+    static constexpr int kConnectTimeoutMs = 1000;
+
+    explicit CollabSession(QObject *parent = nullptr);
+
+    /// @brief connects to a relay. The sprite is only shared once the relay welcomes the site
+    /// @param address a local socket name, or host:port for a TCP port on the loopback address
+    /// @return false if nothing answers at the address
+    bool join(const QString &address);
+
+    /// @brief records that the pixels of a frame changed and sends the change. Ignored while an edit from
+    /// another site is being applied, so it is never sent back out
+    /// @param index the frame that changed
+    /// @param area the pixels that changed, nothing is sent if it is empty
+    /// @param after the frame after the change
+    void frameChanged(int index, const QRect &area, const Frame &after);
+
+    /// @brief records that a frame was added and sends it
+    /// @param index where the frame was added
+    /// @param frame the new frame
+    void frameInserted(int index, const Frame &frame);
+
+    /// @brief records that a frame is being removed and sends it. Call before the sprite removes it
+    /// @param index the frame being removed
+    /// @param frame its pixels, kept to put it back if every other site keeps it
+    void frameErased(int index, const Frame &frame);
+
+    /// @brief sends the whole sprite after a change the frame ops cannot describe, like a resize or a
+    /// different sprite being opened. It replaces the sprite at every site
+    void spriteReplaced(Sprite &sprite);
+
+    /// @brief sends the whole sprite, answering spriteWanted
+    /// @param sprite the sprite
+    /// @param checkpoint true to send it as a checkpoint only the relay keeps, false to replace every site's sprite
+    void shareSprite(Sprite &sprite, bool checkpoint);
+signals:
+    /// @brief another site replaced a rectangle of a frame's pixels
+    void remoteFrameChanged(int index, QRect area, Frame pixels);
+
+    /// @brief another site added a frame
+    void remoteFrameInserted(int index, Frame frame);
+
+    /// @brief another site removed a frame
+    void remoteFrameErased(int index);
+
+    /// @brief a frame this site added was put in its place in the relay's order
+    void remoteFrameMoved(int from, int to);
+
+    /// @brief another site replaced the whole sprite, or the sprite was read in on joining
+    /// @param sprite the new sprite, owned by whoever takes it
+    void remoteSpriteReplaced(Sprite *sprite);
+
+    /// @brief every edit that had arrived has been applied, so the result can be shown
+    void remoteEditsApplied();
+
+    /// @brief the relay needs this site's whole sprite, call shareSprite with it
+    /// @param checkpoint true if it is for a checkpoint
+    void spriteWanted(bool checkpoint);
+
+    /// @brief the relay went away or sent something that could not be read, the session is over
+    /// @param reason why, for the status bar
+    void left(QString reason);
+private:
+    /// A frame's place in the order every site agrees on
+    struct FrameEntry {
+        quint64 id = 0;
+        bool alive = true; // false once erased, it stays for frames added behind it to find their place
+        bool committed = true; // alive in the relay's order, leaving out this site's pending edits
+    };
+
+    /// An edit of this site's the relay has not stamped yet
+    struct PendingEdit {
+        OpLog::Op op;
+        std::optional<Frame> pixels; // the decoded pixels of a change or insert to apply again, or of an erased
+                                     // frame to put back
+        quint64 remoteEditsAtSend = 0; // for a snapshot, how many remote edits had been applied when it was sent
+    };
+
+    QIODevice *socket = nullptr;
+    QByteArray buffer;              // read from the relay but not a whole message yet
+    quint32 site = 0;               // the id the relay gave this site, 0 until it is welcomed
+    quint32 lastLocalId = 0;        // counts this site's messages
+    quint32 lastFrameCounter = 0;   // counts the frames this site has named
+    quint64 lastSequence = 0;       // the last sequence number applied
+    quint64 remoteEdits = 0;        // counts the edits from other sites applied
+    bool synced = false;            // true once the frame order matches the sprite
+    bool applying = false;          // true while edits from the relay are being handed to the editor
+    bool checkpointWanted = false;  // true if the relay asked for a checkpoint that is not sent yet
+    bool spriteChanged = false;     // true if the messages being read have changed the sprite
+    QSize spriteSize;
+    std::vector<FrameEntry> order;
+    std::deque<PendingEdit> pending;
+
+    /// @brief reads and applies every whole message the relay has sent
+    void readSocket();
+
+    /// @brief applies one message from the relay
+    void handle(const OpLog::Op &op);
+
+    /// @brief applies an edit from another site, then draws this site's pending edits it affects over it again
+    void applyRemote(const OpLog::Op &op);
+
+    /// @brief applies one edit the way it is applied at every site
+    /// @param pixels the edit's pixels, already decoded
+    void apply(const OpLog::Op &op, const std::optional<Frame> &pixels);
+
+    /// @brief settles one of this site's erases once the relay has put it in order, putting the frame back if
+    /// it would have left the sprite with no frames
+    void settleErase(const PendingEdit &edit);
+
+    /// @brief brings back a frame this site erased that the relay's order still has, if erasing another
+    /// frame would leave the sprite showing none. It is erased again if its own erase goes through
+    /// @param erasing the place in the order of the frame about to be erased
+    void keepOneFrame(int erasing);
+
+    /// @brief replaces the sprite and frame order with the ones in a snapshot or checkpoint
+    void applySnapshot(const OpLog::Op &op);
+
+    /// @brief stamps an edit as this site's, sends it and keeps it pending until it comes back
+    void send(OpLog::Op op, std::optional<Frame> pixels);
+
+    /// @brief writes a message to the relay right away
+    void write(const QByteArray &message);
+
+    /// @brief tells if local edits should be sent now
+    bool canSend() const { return socket && synced && !applying; }
+
+    /// @brief gives a new frame an id no other site will ever use
+    quint64 newFrameId() { return (quint64(site) << 32) | ++lastFrameCounter; }
+
+    /// @brief finds a frame in the order, erased or not, -1 if it is not there
+    int positionOf(quint64 id) const;
+
+    /// @brief finds where the frame at an index of the sprite is in the order, -1 if there is none
+    int positionOfIndex(int index) const;
+
+    /// @brief counts the frames that are not erased before a place in the order, its index in the sprite
+    int indexAt(int position) const;
+
+    /// @brief counts the frames that are not erased
+    int liveFrames() const;
+
+    /// @brief counts the frames that are not erased in the relay's order
+    int committedFrames() const;
+
+    /// @brief finds the place a frame added behind another one goes
+    /// @param after the frame it goes behind, 0 for the front. A frame missing from the order puts it at the end
+    int placeAfter(quint64 after) const;
+};
+
+#endif // COLLABSESSION_H
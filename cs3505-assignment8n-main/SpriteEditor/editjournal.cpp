@@ -0,0 +1,302 @@
+#include "editjournal.h"
+#include "byteorder.h"
+#include "framecodec.h"
+#include "spritearchive.h"
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+
+const char kJournalMagic[] = "SSJ1";
+const int kJournalHeaderSize = 12; // magic, generation
+const int kRecordHeaderSize = 12;  // payload size, payload checksum
+const int kRecordPayloadHeaderSize = 5; // kind, frame index
+
+}
+
+EditJournal::EditJournal(const QString &directory)
+    : directory(directory), lock(QDir(directory).filePath("journal.lock")) {
+    if (!QDir().mkpath(directory) || !lock.tryLock(0))
+        return; // another editor is journaling here, so this one runs without a journal
+
+    // keep counting from the crashed session so its files are never overwritten before they are replaced
+    for (quint64 onDisk : generationsOnDisk(directory, "snapshot-"))
+        generation = std::max(generation, onDisk);
+    for (quint64 onDisk : generationsOnDisk(directory, "journal-"))
+        generation = std::max(generation, onDisk);
+
+    writer = QThread::create([this]() { writeQueuedOperations(); });
+    writer->setObjectName("journal");
+    writer->start(QThread::LowPriority);
+}
+
+EditJournal::~EditJournal() {
+    if (!writer)
+        return;
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+    }
+    queued.wakeAll();
+    writer->wait();
+    delete writer;
+    discard(directory);
+    lock.unlock();
+    QDir().rmdir(directory);
+}
+
+QString EditJournal::defaultDirectory() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath("autosave");
+}
+
+std::vector<QString> EditJournal::documentDirectories(const QString &directory) {
+    std::vector<QString> directories;
+    QDir folder(directory);
+    for (const QString &name : folder.entryList(QStringList("document-*"), QDir::Dirs | QDir::NoDotAndDotDot))
+        directories.push_back(folder.filePath(name));
+    return directories;
+}
+
+std::unique_ptr<EditJournal> EditJournal::forNewDocument(const QString &directory) {
+    // a folder left by a crash keeps its work until it is recovered or discarded, so only unused names are taken
+    QDir folder(directory);
+    int number = 1;
+    while (folder.exists(QString("document-%1").arg(number)))
+        number++;
+    auto journal = std::make_unique<EditJournal>(folder.filePath(QString("document-%1").arg(number)));
+    if (!journal->isEnabled())
+        return nullptr;
+    return journal;
+}
+
+QString EditJournal::snapshotPath(const QString &directory, quint64 generation) {
+    return QDir(directory).filePath(QString("snapshot-%1.ssb").arg(generation));
+}
+
+QString EditJournal::journalPath(const QString &directory, quint64 generation) {
+    return QDir(directory).filePath(QString("journal-%1.log").arg(generation));
+}
+
+std::vector<quint64> EditJournal::generationsOnDisk(const QString &directory, const QString &prefix) {
+    std::vector<quint64> generations;
+    for (const QString &name : QDir(directory).entryList(QStringList(prefix + "*"), QDir::Files)) {
+        bool ok = false;
+        quint64 generation = name.mid(prefix.size()).section('.', 0, 0).toULongLong(&ok);
+        if (ok)
+            generations.push_back(generation);
+    }
+    std::sort(generations.begin(), generations.end());
+    return generations;
+}
+
+bool EditJournal::hasRecoverableWork(const QString &directory) {
+    return !generationsOnDisk(directory, "snapshot-").empty();
+}
+
+void EditJournal::discard(const QString &directory) {
+    QDir folder(directory);
+    for (quint64 generation : generationsOnDisk(directory, "snapshot-"))
+        folder.remove(snapshotPath(directory, generation));
+    for (quint64 generation : generationsOnDisk(directory, "journal-"))
+        folder.remove(journalPath(directory, generation));
+}
+
+Sprite* EditJournal::recover(const QString &directory) {
+    // a snapshot is only renamed into place once it is complete, but try older ones in case it is damaged
+    std::vector<quint64> snapshots = generationsOnDisk(directory, "snapshot-");
+    for (auto generation = snapshots.rbegin(); generation != snapshots.rend(); ++generation) {
+        std::shared_ptr<SpriteArchive> archive = SpriteArchive::open(snapshotPath(directory, *generation));
+        if (!archive)
+            continue;
+
+        // read every frame in now, the snapshot file is deleted as soon as the recovered sprite is journaled
+        std::vector<Frame> frames;
+        for (int index = 0; index < archive->getFrameCount(); index++)
+            frames.push_back(archive->readFrame(index));
+        Sprite* sprite = new Sprite(archive->getWidth(), archive->getHeight(), std::move(frames));
+        replayJournal(journalPath(directory, *generation), *generation, *sprite);
+        return sprite;
+    }
+    return nullptr;
+}
+
+void EditJournal::replayJournal(const QString &filepath, quint64 generation, Sprite &sprite) {
+    QFile file(filepath);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    QByteArray data = file.readAll();
+    if (data.size() < kJournalHeaderSize || !data.startsWith(kJournalMagic) || readLittleEndian64(data, 4) != generation)
+        return;
+
+    qsizetype position = kJournalHeaderSize;
+    while (position + kRecordHeaderSize <= data.size()) {
+        quint32 size = readLittleEndian32(data, position);
+        if (size < quint32(kRecordPayloadHeaderSize) || qint64(size) > data.size() - position - kRecordHeaderSize)
+            return; // the crash happened partway through writing this record
+        QByteArray payload = data.mid(position + kRecordHeaderSize, size);
+        if (SpriteArchive::checksum(payload) != readLittleEndian64(data, position + 4))
+            return;
+        position += kRecordHeaderSize + size;
+
+        OperationKind kind = OperationKind(payload[0]);
+        int index = qint32(readLittleEndian32(payload, 1));
+        QByteArray encoded = payload.mid(kRecordPayloadHeaderSize);
+        bool ok = true;
+        switch (kind) {
+        case OperationKind::FrameChanged: {
+            if (index < 0 || index >= sprite.getFrameCount())
+                return;
+            Frame changed = FrameCodec::decode(encoded, sprite.getWidth(), sprite.getHeight(), &sprite.getFrame(index), &ok);
+            if (!ok)
+                return;
+            sprite.getFrame(index) = changed;
+            break;
+        }
+        case OperationKind::FrameInserted: {
+            if (index < 0 || index > sprite.getFrameCount())
+                return;
+            Frame inserted = FrameCodec::decode(encoded, sprite.getWidth(), sprite.getHeight(), nullptr, &ok);
+            if (!ok)
+                return;
+            sprite.insertFrame(inserted, index);
+            break;
+        }
+        case OperationKind::FrameErased:
+            if (index < 0 || index >= sprite.getFrameCount() || sprite.getFrameCount() <= 1)
+                return;
+            sprite.eraseFrame(index);
+            break;
+        default:
+            return;
+        }
+    }
+}
+
+void EditJournal::startGeneration(const Sprite &sprite) {
+    if (!writer)
+        return;
+    Operation operation;
+    operation.kind = OperationKind::NewGeneration;
+    operation.sprite = std::make_shared<Sprite>(sprite); // frames share pixels, so this copies no pixel data
+    operation.generation = ++generation;
+    recordsSinceSnapshot = 0;
+    enqueue(std::move(operation));
+}
+
+void EditJournal::recordFrameChange(int index, const QImage &before, const QImage &after) {
+    // the images share pixels with the editor's, the writer thread does the encoding
+    Operation operation;
+    operation.kind = OperationKind::FrameChanged;
+    operation.index = index;
+    operation.before = before;
+    operation.after = after;
+    enqueue(std::move(operation));
+}
+
+void EditJournal::recordFrameInserted(int index, const QImage &image) {
+    Operation operation;
+    operation.kind = OperationKind::FrameInserted;
+    operation.index = index;
+    operation.after = image;
+    enqueue(std::move(operation));
+}
+
+void EditJournal::recordFrameErased(int index) {
+    Operation operation;
+    operation.kind = OperationKind::FrameErased;
+    operation.index = index;
+    enqueue(std::move(operation));
+}
+
+void EditJournal::enqueue(Operation operation) {
+    if (!writer)
+        return;
+    if (operation.kind != OperationKind::NewGeneration)
+        recordsSinceSnapshot++;
+    {
+        QMutexLocker locker(&mutex);
+        queue.push_back(std::move(operation));
+    }
+    queued.wakeOne();
+}
+
+void EditJournal::writeQueuedOperations() {
+    std::unique_ptr<QFile> journal;
+
+    while (true) {
+        std::deque<Operation> batch;
+        {
+            QMutexLocker locker(&mutex);
+            while (queue.empty() && !stopping)
+                queued.wait(&mutex);
+            if (queue.empty())
+                break; // stopping, and everything has been written
+            batch.swap(queue);
+        }
+
+        for (Operation &operation : batch) {
+            if (operation.kind == OperationKind::NewGeneration) {
+                // the snapshot is complete on disk and its journal open before the old journal is closed, so
+                // if either fails the edits keep going to the older generation, which is still whole
+                QString snapshot = snapshotPath(directory, operation.generation);
+                bool written = SpriteArchive::write(snapshot, *operation.sprite, Sprite::kDefaultKeyframeInterval);
+                operation.sprite.reset();
+                if (!written)
+                    continue;
+
+                auto next = std::make_unique<QFile>(journalPath(directory, operation.generation));
+                if (!next->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                    QFile::remove(snapshot); // recovery would pick it over the generation still being written
+                    continue;
+                }
+                QByteArray header(kJournalMagic);
+                appendLittleEndian64(header, operation.generation);
+                next->write(header);
+                SpriteArchive::syncToDisk(*next);
+
+                if (journal)
+                    SpriteArchive::syncToDisk(*journal);
+                journal = std::move(next);
+
+                QDir folder(directory);
+                for (quint64 older : generationsOnDisk(directory, "snapshot-"))
+                    if (older < operation.generation)
+                        folder.remove(snapshotPath(directory, older));
+                for (quint64 older : generationsOnDisk(directory, "journal-"))
+                    if (older < operation.generation)
+                        folder.remove(journalPath(directory, older));
+                continue;
+            }
+
+            if (!journal)
+                continue; // nothing to replay onto until the first snapshot is written
+
+            QByteArray payload;
+            payload.append(char(operation.kind));
+            appendLittleEndian32(payload, quint32(operation.index));
+            if (operation.kind == OperationKind::FrameChanged) {
+                Frame before(operation.before);
+                payload.append(FrameCodec::encode(Frame(operation.after), &before));
+            }
+            else if (operation.kind == OperationKind::FrameInserted)
+                payload.append(FrameCodec::encode(Frame(operation.after), nullptr));
+
+            QByteArray record;
+            appendLittleEndian32(record, payload.size());
+            appendLittleEndian64(record, SpriteArchive::checksum(payload));
+            record.append(payload);
+            journal->write(record);
+        }
+
+        // one sync covers the whole batch, then wait a little so the next burst of edits shares a sync too
+        if (journal)
+            SpriteArchive::syncToDisk(*journal);
+        QThread::msleep(kSyncIntervalMs);
+    }
+
+    if (journal)
+        SpriteArchive::syncToDisk(*journal);
+}
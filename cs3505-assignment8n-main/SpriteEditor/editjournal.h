@@ -0,0 +1,135 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include "sprite.h"
+#include <QImage>
+#include <QLockFile>
+#include <QMutex>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+#include <deque>
+#include <memory>
+#include <vector>
+/*
+ * the edit journal keeps unsaved work safe from crashes. every change to the sprite is appended to a
+ * journal file, and every so often the whole sprite is written out as a snapshot archive so the journal
+ * can start over. after a crash the latest snapshot plus the journals written since it rebuild the sprite.
+ * the editor only queues changes, a background thread encodes them, writes them in batches and syncs
+ * the file to disk once per batch, so recording a change costs the editor next to nothing.
+ * every open document journals into a folder of its own under one autosave folder, so each document's work
+ * is kept and recovered apart from the others.
+ * on a clean exit the journal deletes its files, so anything left behind means the last session crashed.
+ */
+class EditJournal
+{
+public:
+    /// @brief starts journaling into a folder. If another copy of the editor is already journaling
+    /// there, this journal stays disabled and records nothing.
+    /// @param directory the folder to keep the snapshots and journals in
+    EditJournal(const QString &directory);
+
+    /// @brief writes out everything queued, then deletes the journal files and their folder since the exit
+    /// was clean
+    ~EditJournal();
+
+    /// @brief gets the folder the documents' journal folders are kept in by default, in the user's app data
+    static QString defaultDirectory();
+
+    /// @brief lists the journal folders of documents under a folder, whether or not anything is using them
+    /// @param directory the folder the documents' journal folders are kept in
+    static std::vector<QString> documentDirectories(const QString &directory);
+
+    /// @brief starts journaling a new document into a folder of its own that nothing else has used yet
+    /// @param directory the folder the documents' journal folders are kept in
+    /// @return the journal, or nullptr if none could be started there
+    static std::unique_ptr<EditJournal> forNewDocument(const QString &directory);
+
+    /// @brief checks if a crashed session left work behind that recover can rebuild
+    static bool hasRecoverableWork(const QString &directory);
+
+    /// @brief rebuilds the sprite a crashed session was working on
+    /// @param directory the folder the crashed session journaled into
+    /// @return the rebuilt sprite, owned by the caller, or nullptr if there was nothing usable
+    static Sprite* recover(const QString &directory);
+
+    /// @brief deletes the work a crashed session left behind
+    static void discard(const QString &directory);
+
+    /// @brief tells if this journal is recording
+    bool isEnabled() const { return writer != nullptr; }
+
+    /// @brief starts a new journal on top of a snapshot of the sprite, used when a different sprite is
+    /// opened and whenever the journal has grown long enough to be worth compacting
+    /// @param sprite the sprite as it is now, it is copied so the editor can keep changing it
+    void startGeneration(const Sprite &sprite);
+
+    /// @brief checks if enough changes have been recorded that a new snapshot should be started
+    bool needsCompaction() const { return recordsSinceSnapshot >= kRecordsPerSnapshot; }
+
+    /// @brief records that the pixels of a frame changed
+    /// @param index the frame that changed
+    /// @param before the frame before the change
+    /// @param after the frame after the change
+    void recordFrameChange(int index, const QImage &before, const QImage &after);
+
+    /// @brief records that a frame was inserted
+    /// @param index where the frame was inserted
+    /// @param image the new frame
+    void recordFrameInserted(int index, const QImage &image);
+
+    /// @brief records that a frame was removed
+    /// @param index the frame that was removed
+    void recordFrameErased(int index);
+private:
+    /// How many changes are recorded before the sprite is snapshotted again
+    static constexpr int kRecordsPerSnapshot = 2000;
+    /// How long the writer waits between batches, so bursts of edits share one sync
+    static constexpr int kSyncIntervalMs = 100;
+
+    /// What an entry in the queue asks the writer to do
+    enum class OperationKind : char {
+        FrameChanged = 'F',
+        FrameInserted = 'I',
+        FrameErased = 'E',
+        NewGeneration = 'G'
+    };
+
+    /// A change waiting for the writer thread
+    struct Operation {
+        OperationKind kind;
+        int index = 0;
+        QImage before;
+        QImage after;
+        std::shared_ptr<Sprite> sprite; // the sprite to snapshot for a new generation
+        quint64 generation = 0;
+    };
+
+    QString directory;
+    QLockFile lock;              // stops two copies of the editor from journaling into the same folder
+    QThread *writer = nullptr;   // encodes and writes the queued operations
+    QMutex mutex;                // guards the queue and the stopping flag
+    QWaitCondition queued;
+    std::deque<Operation> queue;
+    bool stopping = false;
+    quint64 generation = 0;      // the generation new records belong to, counted up from the newest on disk
+    int recordsSinceSnapshot = 0;
+
+    /// @brief hands an operation to the writer thread
+    void enqueue(Operation operation);
+
+    /// @brief the writer thread, runs until the journal is destroyed
+    void writeQueuedOperations();
+
+    static QString snapshotPath(const QString &directory, quint64 generation);
+    static QString journalPath(const QString &directory, quint64 generation);
+
+    /// @brief lists the generations that have a file with a prefix in the folder, oldest first
+    static std::vector<quint64> generationsOnDisk(const QString &directory, const QString &prefix);
+
+    /// @brief applies the records of a journal file to the snapshot it was started from, stopping at the
+    /// first record that was torn or damaged by the crash
+    static void replayJournal(const QString &filepath, quint64 generation, Sprite &sprite);
+};
+
+#endif // EDITJOURNAL_H
@@ -3,16 +3,221 @@
 #include "sprite.h"
 #include "frame.h"
 #include "tool.h"
+#include "animationexporter.h"
+#include "spriteimporter.h"
+#include "spritearchive.h"
+#include "editjournal.h"
+#include "collabsession.h"
+#include "memorybudget.h"
 #include <QFile>
 #include <QTextStream>
 #include <QFileInfo>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonDocument>
+#include <QThread>
 #include <QTimer>
+#include <QtConcurrent>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+/// The tint drawn over the selected pixels
+const QRgb kSelectionTint = qRgba(64, 128, 255, 96);
+
+/// names a tool for the undo history
+QString toolName(ToolType tool) {
+    switch (tool) {
+    case ToolType::Pen:
+        return "Pen";
+    case ToolType::Eraser:
+        return "Eraser";
+    case ToolType::Fill:
+        return "Fill";
+    case ToolType::EyeDropper:
+        return "Eye Dropper";
+    case ToolType::RectangleSelect:
+        return "Select";
+    case ToolType::LassoSelect:
+        return "Lasso";
+    case ToolType::MagicWand:
+        return "Magic Wand";
+    case ToolType::Move:
+        return "Move Selection";
+    case ToolType::Line:
+        return "Line";
+    case ToolType::Rectangle:
+        return "Rectangle";
+    case ToolType::FilledRectangle:
+        return "Filled Rectangle";
+    case ToolType::Ellipse:
+        return "Ellipse";
+    }
+    return QString();
+}
+
+}
 /// @reviewed by tj hess
 Editor::Editor(int width, int height) {
     sprite = new Sprite(width, height);
+    applyMemoryBudget();
+    refreshFrameHandles();
+    publishSnapshot();
+}
+
+std::shared_ptr<const SpriteSnapshot> Editor::currentSnapshot() const {
+    return std::atomic_load(&snapshot);
+}
+
+void Editor::publishSnapshot() {
+    if (!active)
+        return; // a document behind another has no frame handles, and nothing is showing it
+    auto next = std::make_shared<SpriteSnapshot>();
+    next->version = ++snapshotVersion;
+    next->width = sprite->getWidth();
+    next->height = sprite->getHeight();
+    next->currentFrame = currentFrameIndex;
+    next->indexed = sprite->isIndexed();
+    next->frames = frameHandles; // the table shares its blocks, so this only copies a pointer to each
+    next->currentImage = currentFrameImage(); // the canvas always has the current frame to show
+    if (floating) {
+        next->canvasBase = floating->underImage;
+        next->overlay = floating->image;
+        next->overlayPosition = floating->cutout.position;
+        next->selectionBounds = QRect(floating->cutout.position, floating->image.size());
+    }
+    else if (!shapePreview.isNull()) {
+        next->overlay = shapePreview;
+        next->overlayPosition = shapePreviewPosition;
+        next->selectionBounds = selectionBounds;
+    }
+    else if (!selection.isEmpty()) {
+        next->overlay = selectionImage;
+        next->overlayPosition = selectionBounds.topLeft();
+        next->selectionBounds = selectionBounds;
+    }
+    // the canvas only redraws the pixels that changed if it is still showing the image they changed from
+    if (!floating && !changedPixels.isEmpty() && currentImage.cacheKey() == changedTo) {
+        next->changedPixels = changedPixels;
+        next->changedFrom = changedFrom;
+    }
+    changedPixels = QRect();
+    std::atomic_store(&snapshot, std::shared_ptr<const SpriteSnapshot>(std::move(next)));
+    reportMemoryUse();
+    emit snapshotPublished();
+}
+
+void Editor::refreshFrameHandles() {
+    frameHandles = FrameTable();
+    if (!active)
+        return; // handed out once the document comes to the front
+    std::vector<FrameHandle> handles;
+    handles.reserve(sprite->getFrameCount());
+    for (int index = 0; index < sprite->getFrameCount(); index++)
+        handles.push_back(sprite->frameHandle(index));
+    frameHandles = FrameTable(std::move(handles));
+}
+
+const QImage& Editor::currentFrameImage() {
+    // a frame that still has the same key has the same pixels, whatever handle it was made from
+    quint64 key = frameHandles[currentFrameIndex].key();
+    if (!currentImage.isNull() && key == currentImageKey)
+        return currentImage;
+    QImage previous = std::exchange(currentImage, QImage());
+    if (std::unique_ptr<QImage> kept{recentImages.take(key)})
+        currentImage = *kept;
+    else
+        currentImage = sprite->frameImage(currentFrameIndex);
+    // an image whose frame was edited since is never asked for again, and ages out with the rest
+    if (!previous.isNull())
+        recentImages.insert(currentImageKey, new QImage(previous), previous.sizeInBytes());
+    currentImageKey = key;
+    return currentImage;
+}
+
+QImage Editor::frameImage(int index) {
+    if (index == currentFrameIndex)
+        return currentFrameImage();
+    if (const QImage* kept = recentImages.object(frameHandles[index].key()))
+        return *kept;
+    return sprite->frameImage(index);
+}
+
+void Editor::setJournal(EditJournal* newJournal) {
+    journal = newJournal;
+    if (journal)
+        journal->startGeneration(*sprite);
+}
+
+void Editor::compactJournalIfNeeded() {
+    if (journal && journal->needsCompaction())
+        journal->startGeneration(*sprite);
+}
+
+void Editor::recordSpriteReplaced() {
+    if (journal)
+        journal->startGeneration(*sprite);
+    if (session)
+        session->spriteReplaced(*sprite);
+}
+
+void Editor::markPixelsChanged(const QImage& before, const QImage& after, const QRect& area) {
+    // changes since the last snapshot add up, as long as each one starts from the image the last one left
+    if (changedPixels.isEmpty() || before.cacheKey() != changedTo) {
+        changedPixels = area;
+        changedFrom = before.cacheKey();
+    }
+    else
+        changedPixels |= area;
+    changedTo = after.cacheKey();
+}
+
+void Editor::setActive(bool active, int backgroundDocuments) {
+    bool wasActive = Editor::active;
+    Editor::active = active;
+    Editor::backgroundDocuments = backgroundDocuments;
+    applyMemoryBudget();
+    if (active && !wasActive) {
+        refreshFrameHandles();
+        publishSnapshot();
+    }
+    else if (!active && wasActive) {
+        // the frames and undo history are all a document behind another keeps, the rest is rebuilt from them
+        frameHandles = FrameTable();
+        currentImage = QImage();
+        recentImages.clear();
+        shapePreview = QImage();
+        std::atomic_store(&snapshot, std::shared_ptr<const SpriteSnapshot>());
+        sprite->internFrames();
+    }
+    reportMemoryUse();
+}
+
+void Editor::applyMemoryBudget() {
+    const MemoryBudget& budget = MemoryBudget::instance();
+    sprite->setMemoryBudget(budgetPortion(budget.share(MemoryUse::SpriteFrames)));
+    undoStack.setMemoryLimit(budgetPortion(budget.share(MemoryUse::UndoHistory)));
+    recentImages.setMaxCost(budgetPortion(budget.share(MemoryUse::FrameImages)));
+    BufferPool::instance().setRetainLimit(budget.share(MemoryUse::BufferPool));
+}
+
+qint64 Editor::budgetPortion(qint64 share) const {
+    if (backgroundDocuments == 0)
+        return share;
+    return active ? share / 4 * 3 : share / 4 / backgroundDocuments;
+}
+
+void Editor::reportMemoryUse() {
+    // the handles share what the sprite already reports, only the images are copies of frames' pixels
+    qint64 imageBytes = currentImage.sizeInBytes() + recentImages.totalCost();
+    framesReport.set(sprite->getResidentBytes());
+    indexedReport.set(sprite->getIndexedBytes());
+    undoReport.set(undoStack.getBytesHeld());
+    imagesReport.set(imageBytes);
 }
 
 Editor::~Editor() {
@@ -21,36 +226,458 @@ Editor::~Editor() {
 
 void Editor::addEmptyFrame() {
     Frame f(sprite->getWidth(), sprite->getHeight());
-    sprite->pushFrame(f);
+    addFrame(f);
 }
 
 void Editor::addFrame(Frame& frame) {
-    sprite->pushFrame(frame);
+    dropFloating();
+    UndoStack::Transaction transaction = startTransaction("Add Frame");
+    int index = sprite->getFrameCount();
+    insertFrameAt(index, frame);
+    transaction.changes.push_back({UndoStack::FrameChange::Kind::Inserted, index, std::nullopt, frame});
+    currentFrameIndex = index;
+    commitTransaction(std::move(transaction));
 }
 
 void Editor::duplicateFrame() {
-    // Duplicate the current frame
-
+    // Duplicate the current frame and select the copy
+    dropFloating();
+    UndoStack::Transaction transaction = startTransaction("Duplicate Frame");
     Frame currentFrame = sprite->getFrame(currentFrameIndex);
-    sprite->insertFrame(currentFrame, currentFrameIndex + 1);
-    QImage image = currentFrame.toImage();
-    emit sendFrameButtonImage(image, currentFrameIndex + 1);
-    emit addClonedImageToPreview(image, currentFrameIndex + 1);
+    insertFrameAt(currentFrameIndex + 1, currentFrame);
+    currentFrameIndex++;
+    transaction.changes.push_back({UndoStack::FrameChange::Kind::Inserted, currentFrameIndex, std::nullopt, currentFrame});
+    commitTransaction(std::move(transaction));
+}
+
+void Editor::setFrameAt(int index, Frame frame) {
+    // only the session and the canvas need to know which pixels changed, so it is only worked out for them
+    QRect area;
+    if (session || (active && index == currentFrameIndex)) {
+        const Frame& previous = sprite->getFrame(index);
+        area = previous.changedArea(frame);
+        boundsCache.frameEdited(previous, frame, area);
+    }
+    // the journal diffs the images before and after, and the canvas redraws from the one before
+    bool needsImages = active && (journal || index == currentFrameIndex);
+    QImage before = needsImages ? frameImage(index) : QImage();
+    sprite->replaceFrame(frame, index);
+    if (session)
+        session->frameChanged(index, area, frame);
+    if (!active)
+        return;
+    frameHandles.set(index, sprite->frameHandle(index));
+    if (!needsImages)
+        return;
+    QImage image = frame.toImage();
+    if (index == currentFrameIndex) {
+        currentImage = image;
+        currentImageKey = frameHandles[index].key();
+        markPixelsChanged(before, image, area);
+    }
+    if (journal)
+        journal->recordFrameChange(index, before, image);
+}
+
+void Editor::insertFrameAt(int index, Frame frame) {
+    sprite->insertFrame(frame, index);
+    if (session)
+        session->frameInserted(index, frame);
+    if (!active)
+        return;
+    frameHandles.insert(index, sprite->frameHandle(index));
+    if (journal)
+        journal->recordFrameInserted(index, frame.toImage());
+}
+
+void Editor::eraseFrameAt(int index) {
+    // the session keeps the frame's pixels, to put it back if the other sites all keep it
+    if (session)
+        session->frameErased(index, sprite->getFrame(index));
+    sprite->eraseFrame(index);
+    if (!active)
+        return;
+    frameHandles.erase(index);
+    if (journal)
+        journal->recordFrameErased(index);
+}
+
+UndoStack::Transaction Editor::startTransaction(const QString& name) const {
+    UndoStack::Transaction transaction;
+    transaction.name = name;
+    transaction.selectedBefore = currentFrameIndex;
+    return transaction;
+}
+
+void Editor::commitTransaction(UndoStack::Transaction transaction, bool mergeStroke) {
+    transaction.selectedAfter = currentFrameIndex;
+    undoStack.push(std::move(transaction), mergeStroke);
+    compactJournalIfNeeded();
+    publishSnapshot();
+}
+
+std::vector<Frame> Editor::copyFrames(const std::vector<int>& frameIndices) {
+    std::vector<Frame> frames;
+    frames.reserve(frameIndices.size());
+    for (int position = 0; position < (int)frameIndices.size(); position++) {
+        if (position % kPrefetchFrames == 0 && position + kPrefetchFrames < (int)frameIndices.size())
+            sprite->prefetchFrames(frameIndices[position + kPrefetchFrames], kPrefetchFrames);
+        frames.push_back(sprite->getFrame(frameIndices[position]));
+    }
+    return frames;
+}
+
+std::vector<FrameBounds> Editor::measureFrames() {
+    // the cache is looked up by revision, so frames whose bounds are known are never read
+    int frameCount = sprite->getFrameCount();
+    std::vector<FrameBounds> bounds(frameCount);
+    std::vector<quint64> revisions(frameCount);
+    std::vector<int> unmeasured;
+    for (int index = 0; index < frameCount; index++) {
+        revisions[index] = sprite->getFrameRevision(index);
+        if (std::optional<FrameBounds> cached = boundsCache.find(revisions[index]))
+            bounds[index] = *cached;
+        else
+            unmeasured.push_back(index);
+    }
+
+    // the rest are copied out and measured a batch at a time, so the sprite can drop each batch before the next
+    for (size_t first = 0; first < unmeasured.size(); first += kPrefetchFrames) {
+        std::vector<int> batch(unmeasured.begin() + first,
+                               unmeasured.begin() + std::min(first + kPrefetchFrames, unmeasured.size()));
+        std::vector<Frame> frames = copyFrames(batch);
+        if (first + kPrefetchFrames < unmeasured.size())
+            sprite->prefetchFrames(unmeasured[first + kPrefetchFrames], kPrefetchFrames); // decode ahead while this batch is measured
+        std::vector<int> positions(batch.size());
+        std::iota(positions.begin(), positions.end(), 0);
+        QtConcurrent::blockingMap(positions, [&](int position) {
+            bounds[batch[position]] = FrameBounds::measure(frames[position]);
+        });
+        // a frame read in takes a new revision, which is the one it goes by from now on
+        for (int position = 0; position < (int)batch.size(); position++) {
+            boundsCache.insert(revisions[batch[position]], bounds[batch[position]]);
+            boundsCache.insert(frames[position].getRevision(), bounds[batch[position]]);
+        }
+    }
+    return bounds;
+}
+
+void Editor::resizeSpriteTo(QSize size, std::vector<Frame> frames) {
+    sprite->resize(size.width(), size.height(), std::move(frames));
+    refreshFrameHandles();
+    setSelection(SelectionMask()); // the selection was for the old size
+    recordSpriteReplaced();
+}
+
+void Editor::applyFrameOperation(FrameOperation operation, std::vector<int> frameIndices) {
+    dropFloating();
+    if (frameIndices.empty()) {
+        frameIndices.resize(sprite->getFrameCount());
+        std::iota(frameIndices.begin(), frameIndices.end(), 0);
+    }
+    std::sort(frameIndices.begin(), frameIndices.end());
+    frameIndices.erase(std::unique(frameIndices.begin(), frameIndices.end()), frameIndices.end());
+    frameIndices.erase(std::remove_if(frameIndices.begin(), frameIndices.end(),
+                                      [this](int index) { return index < 0 || index >= sprite->getFrameCount(); }),
+                       frameIndices.end());
+
+    // the sprite is only touched on this thread, so the frames are copied out before the workers start
+    std::vector<Frame> before = copyFrames(frameIndices);
+
+    // every frame is changed on its own, so they spread across all the cores
+    std::vector<Frame> after = before;
+    std::vector<char> changed(before.size());
+    std::vector<int> positions(before.size());
+    std::iota(positions.begin(), positions.end(), 0);
+    QtConcurrent::blockingMap(positions, [&](int position) {
+        after[position] = operation.apply(before[position]);
+        changed[position] = !after[position].hasSamePixels(before[position]);
+    });
+
+    UndoStack::Transaction transaction = startTransaction(operation.name());
+    for (int position = 0; position < (int)positions.size(); position++) {
+        if (!changed[position])
+            continue; // the operation left this frame as it was
+        setFrameAt(frameIndices[position], after[position]);
+        transaction.changes.push_back({UndoStack::FrameChange::Kind::Replaced, frameIndices[position],
+                                       before[position], after[position]});
+    }
+    if (transaction.changes.empty())
+        return;
+    commitTransaction(std::move(transaction));
+}
+
+void Editor::tweenFrames(int firstFrame, int lastFrame, int count, FrameTween tween) {
+    int frameCount = sprite->getFrameCount();
+    if (firstFrame == lastFrame || count <= 0 || std::min(firstFrame, lastFrame) < 0 ||
+        std::max(firstFrame, lastFrame) >= frameCount)
+        return;
+    if (firstFrame > lastFrame)
+        std::swap(firstFrame, lastFrame);
+    dropFloating();
+    if (tween.kind == FrameTween::Kind::Motion && tween.selection.isEmpty())
+        tween.selection = selection;
+
+    // the key frames are copied out so the workers never touch the sprite
+    Frame first = sprite->getFrame(firstFrame);
+    Frame last = sprite->getFrame(lastFrame);
+    std::vector<Frame> frames(count, Frame(0, 0));
+    std::vector<int> steps(count);
+    std::iota(steps.begin(), steps.end(), 0);
+    QtConcurrent::blockingMap(steps, [&](int step) { frames[step] = tween.apply(first, last, double(step + 1) / (count + 1)); });
+
+    // the frames between the key frames are replaced, so the tween always ends up between the frames it came from
+    UndoStack::Transaction transaction = startTransaction(tween.name());
+    int replaced = lastFrame - firstFrame - 1;
+    for (int index = lastFrame - 1; index > firstFrame; index--) {
+        transaction.changes.push_back({UndoStack::FrameChange::Kind::Erased, index, sprite->getFrame(index), std::nullopt});
+        eraseFrameAt(index);
+    }
+    for (int step = 0; step < count; step++) {
+        int index = firstFrame + 1 + step;
+        insertFrameAt(index, frames[step]);
+        transaction.changes.push_back({UndoStack::FrameChange::Kind::Inserted, index, std::nullopt, frames[step]});
+    }
+    if (currentFrameIndex >= lastFrame)
+        currentFrameIndex += count - replaced; // keep the same frame selected
+    else if (currentFrameIndex > firstFrame)
+        currentFrameIndex = firstFrame; // it was replaced, so the key frame before it is selected
+    commitTransaction(std::move(transaction));
+    emit sendStatusMessage(QString("Added %1 frames between frames %2 and %3").arg(count).arg(firstFrame + 1)
+                               .arg(lastFrame + 1));
+}
+
+void Editor::resizeSprite(FrameTransform transform) {
+    if (transform.getSourceWidth() != sprite->getWidth() || transform.getSourceHeight() != sprite->getHeight())
+        return; // made for a sprite that has since been replaced or resized
+    dropFloating();
+
+    std::vector<int> frameIndices(sprite->getFrameCount());
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+    std::vector<Frame> before = copyFrames(frameIndices);
+    std::vector<Frame> after = before;
+    QtConcurrent::blockingMap(frameIndices, [&](int index) { after[index] = transform.apply(before[index]); });
+
+    UndoStack::Transaction transaction = startTransaction(transform.name());
+    transaction.sizeBefore = QSize(sprite->getWidth(), sprite->getHeight());
+    transaction.sizeAfter = QSize(transform.getWidth(), transform.getHeight());
+    for (int index : frameIndices)
+        transaction.changes.push_back({UndoStack::FrameChange::Kind::Replaced, index, before[index], after[index]});
+    resizeSpriteTo(transaction.sizeAfter, std::move(after));
+    commitTransaction(std::move(transaction));
+}
+
+void Editor::autoCrop() {
+    QRect box = FrameBounds::unite(measureFrames());
+    if (box.isEmpty()) {
+        emit sendStatusMessage("Every frame is empty, there is nothing to crop to");
+        return;
+    }
+    if (box == QRect(0, 0, sprite->getWidth(), sprite->getHeight())) {
+        emit sendStatusMessage("The frames already reach every edge of the canvas");
+        return;
+    }
+    resizeSprite(FrameTransform::resizeCanvas(sprite->getWidth(), sprite->getHeight(), box.width(), box.height(),
+                                              -box.x(), -box.y()));
+    emit sendStatusMessage(QString("Cropped to %1 x %2").arg(box.width()).arg(box.height()));
+}
+
+void Editor::reduceColors(int colorCount, bool dither) {
+    std::vector<int> frameIndices(sprite->getFrameCount());
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+    std::vector<Frame> frames = copyFrames(frameIndices);
+
+    // each worker counts a run of frames into a table of its own, so they never share one until the merge
+    int chunkCount = std::max(1, std::min<int>(frames.size(), QThread::idealThreadCount()));
+    std::vector<int> chunks(chunkCount);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    ColorHistogram histogram = QtConcurrent::blockingMappedReduced<ColorHistogram>(chunks,
+        [&frames, chunkCount](int chunk) {
+            ColorHistogram chunkHistogram;
+            for (size_t index = chunk * frames.size() / chunkCount; index < (chunk + 1) * frames.size() / chunkCount; index++)
+                chunkHistogram.add(frames[index]);
+            return chunkHistogram;
+        },
+        [](ColorHistogram &total, const ColorHistogram &chunkHistogram) { total.add(chunkHistogram); });
+
+    // an indexed sprite keeps its first palette entry for transparent
+    if (sprite->isIndexed())
+        colorCount = std::min(colorCount, Palette::kMaxColors - 1);
+    auto quantizer = std::make_shared<const ColorQuantizer>(histogram.colors(), colorCount);
+    applyFrameOperation(FrameOperation::quantize(quantizer, dither), frameIndices);
+
+    // drop the old colors from the palette, or they would crowd out the reduced ones
+    if (sprite->isIndexed()) {
+        sprite->convertToFullColor();
+        sprite->convertToIndexed();
+        refreshFrameHandles();
+        publishSnapshot();
+    }
+    emit sendStatusMessage(QString("Reduced the sprite to %1 colors").arg(quantizer->getPalette().size()));
+}
+
+void Editor::setIndexedColor(bool indexed) {
+    if (indexed == sprite->isIndexed())
+        return;
+    if (indexed && !sprite->convertToIndexed())
+        emit sendStatusMessage(QString("The sprite uses more than %1 colors, reduce its colors to index it")
+                                   .arg(Palette::kMaxColors));
+    else if (!indexed)
+        sprite->convertToFullColor();
+    else {
+        emit sendStatusMessage(QString("Indexed with %1 palette colors").arg(sprite->getPalette()->size()));
+        // indexing clears the color of transparent pixels, which there is no frame change for
+        recordSpriteReplaced();
+    }
+    refreshFrameHandles();
+    publishSnapshot(); // republished even when indexing fails, so the view unchecks the mode again
+}
+
+void Editor::replacePaletteColor(QRgb from, QRgb to) {
+    const Palette* palette = sprite->getPalette();
+    int index = palette ? palette->indexOf(from) : -1;
+    if (index <= 0) {
+        emit sendStatusMessage("The paint color is not in the palette");
+        return;
+    }
+    sprite->setPaletteColor(index, to);
+    refreshFrameHandles();
+    recordSpriteReplaced();
+    setColor(QColor::fromRgba(to));
+    publishSnapshot();
+}
+
+void Editor::undo() {
+    dropFloating();
+    if (!undoStack.canUndo())
+        return;
+    UndoStack::Transaction transaction = undoStack.takeUndo();
+    if (transaction.sizeBefore != transaction.sizeAfter) {
+        std::vector<Frame> frames;
+        for (const UndoStack::FrameChange& change : transaction.changes)
+            frames.push_back(*change.before);
+        resizeSpriteTo(transaction.sizeBefore, std::move(frames));
+        transaction.changes.clear(); // already undone
+    }
+    // later changes can depend on earlier ones, like an insert moving the frames after it, so go backwards
+    for (auto change = transaction.changes.rbegin(); change != transaction.changes.rend(); ++change) {
+        switch (change->kind) {
+        case UndoStack::FrameChange::Kind::Replaced:
+            setFrameAt(change->index, *change->before);
+            break;
+        case UndoStack::FrameChange::Kind::Inserted:
+            eraseFrameAt(change->index);
+            break;
+        case UndoStack::FrameChange::Kind::Erased:
+            insertFrameAt(change->index, *change->before);
+            break;
+        }
+    }
+    currentFrameIndex = std::clamp(transaction.selectedBefore, 0, sprite->getFrameCount() - 1);
+    compactJournalIfNeeded();
+    publishSnapshot();
+    emit sendStatusMessage(QString("Undid %1").arg(transaction.name));
+}
+
+void Editor::redo() {
+    dropFloating();
+    if (!undoStack.canRedo())
+        return;
+    UndoStack::Transaction transaction = undoStack.takeRedo();
+    if (transaction.sizeBefore != transaction.sizeAfter) {
+        std::vector<Frame> frames;
+        for (const UndoStack::FrameChange& change : transaction.changes)
+            frames.push_back(*change.after);
+        resizeSpriteTo(transaction.sizeAfter, std::move(frames));
+        transaction.changes.clear(); // already redone
+    }
+    for (const UndoStack::FrameChange& change : transaction.changes) {
+        switch (change.kind) {
+        case UndoStack::FrameChange::Kind::Replaced:
+            setFrameAt(change.index, *change.after);
+            break;
+        case UndoStack::FrameChange::Kind::Inserted:
+            insertFrameAt(change.index, *change.after);
+            break;
+        case UndoStack::FrameChange::Kind::Erased:
+            eraseFrameAt(change.index);
+            break;
+        }
+    }
+    currentFrameIndex = std::clamp(transaction.selectedAfter, 0, sprite->getFrameCount() - 1);
+    compactJournalIfNeeded();
+    publishSnapshot();
+    emit sendStatusMessage(QString("Redid %1").arg(transaction.name));
 }
 
 void Editor::saveSlot(QString filename) {
+    dropFloating();
+    if (QFileInfo(filename).suffix().toLower() == "ssb") {
+        sprite->internFrames();
+        std::shared_ptr<SpriteArchive> archive = sprite->getArchive();
+        std::shared_ptr<SpriteArchive> saved;
+        bool sameSize = archive && archive->getWidth() == sprite->getWidth() && archive->getHeight() == sprite->getHeight();
+        if (sameSize && QFileInfo(archive->getFilePath()) == QFileInfo(filename))
+            saved = archive->append(*sprite, Sprite::kDefaultKeyframeInterval);
+        else if (SpriteArchive::write(filename, *sprite, Sprite::kDefaultKeyframeInterval))
+            saved = SpriteArchive::open(filename);
+        // the frames are now safe in the file, so the next save only has to write what is edited after this.
+        // the snapshots point at them there from now on, which leaves the sprite free to drop them
+        if (saved) {
+            sprite->attachArchive(saved);
+            refreshFrameHandles();
+            publishSnapshot();
+        }
+        reportFrameSharing();
+        return;
+    }
+
     QFile file(filename + ".ssp");
     if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
         return;
     }
 
+    sprite->internFrames();
     QTextStream out(&file);
-    QJsonDocument doc = QJsonDocument::fromJson(sprite->toJson().toUtf8());
+    QJsonDocument doc = QJsonDocument::fromJson(sprite->toJson(compressSavedFrames).toUtf8());
     out << doc.toJson(QJsonDocument::Indented);
     file.close();
+
+    // the collision boxes go in a file of their own, so games can read them without parsing every pixel
+    QFile collisionFile(filename + ".collision.json");
+    if (collisionFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        QJsonObject boxes = FrameBounds::collisionBoxes(measureFrames(), QSize(sprite->getWidth(), sprite->getHeight()));
+        collisionFile.write(QJsonDocument(boxes).toJson(QJsonDocument::Indented));
+    }
+    reportFrameSharing();
+}
+
+void Editor::compactArchiveSlot() {
+    std::shared_ptr<SpriteArchive> archive = sprite->getArchive();
+    if (!archive)
+        return;
+    QString filepath = archive->getFilePath();
+    sprite->internFrames();
+    if (SpriteArchive::write(filepath, *sprite, Sprite::kDefaultKeyframeInterval)) {
+        std::shared_ptr<SpriteArchive> compacted = SpriteArchive::open(filepath);
+        if (compacted) {
+            sprite->attachArchive(compacted);
+            refreshFrameHandles();
+            publishSnapshot();
+        }
+    }
+    reportFrameSharing();
 }
 
 void Editor::loadSlot(QString filepath) {
+    // archives are opened in place and their frames are read as they are needed
+    if (QFileInfo(filepath).suffix().toLower() == "ssb") {
+        std::shared_ptr<SpriteArchive> archive = SpriteArchive::open(filepath);
+        if (archive)
+            replaceSprite(new Sprite(archive));
+        return;
+    }
+
     QFile file(filepath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text) ) {
         return;
@@ -65,17 +692,76 @@ void Editor::loadSlot(QString filepath) {
     }
 
     QJsonObject spriteObj = doc.object();
+    replaceSprite(new Sprite(spriteObj));
+}
+
+void Editor::importImageSequenceSlot(QString folderPath) {
+    Sprite* imported = SpriteImporter::importImageSequence(SpriteImporter::listImageSequence(folderPath));
+    if (imported)
+        replaceSprite(imported);
+}
+
+void Editor::importSpriteSheetSlot(QString filepath, int cellWidth, int cellHeight) {
+    Sprite* imported = SpriteImporter::importSpriteSheet(filepath, cellWidth, cellHeight);
+    if (imported)
+        replaceSprite(imported);
+}
+
+void Editor::replaceSprite(Sprite* newSprite) {
     delete sprite;
+    sprite = newSprite;
+    applyMemoryBudget();
+    currentFrameIndex = 0;
+    undoStack.clear();
+    recentImages.clear(); // none of the old sprite's frames will be shown again
+    floating.reset();
+    setSelection(SelectionMask());
+    refreshFrameHandles();
+    recordSpriteReplaced();
+    publishSnapshot();
+    reportFrameSharing();
+}
+
+void Editor::reportFrameSharing() {
+    Sprite::FrameSharing sharing = sprite->getFrameSharing();
+    double ratio = sharing.bytesUsed > 0 ? double(sharing.bytesUnshared) / sharing.bytesUsed : 1.0;
+    emit sendStatusMessage(QString("%1 frames (%2 in memory), %3 unique, %4 pixel buffers (%5x smaller)")
+                               .arg(sharing.frameCount)
+                               .arg(sharing.residentFrames)
+                               .arg(sharing.uniqueFrames)
+                               .arg(sharing.pixelBuffers)
+                               .arg(ratio, 0, 'f', 1)
+                           + (sprite->isIndexed() ? QString(", %1 KB as palette indices").arg(sharing.bytesIndexed / 1024)
+                                                  : QString()));
+}
 
+void Editor::exportSlot(QString filepath, int frameRate, bool perFramePalette) {
+    dropFloating();
     std::vector<QImage> images;
-    sprite = new Sprite(spriteObj);
-    for(int i = 0; i < sprite->getFrameCount(); i++){
-        emit insertFrameButton(i);
-        QImage image = sprite->getFrame(i).toImage();
-        images.push_back(image);
-        emit sendFrameButtonImage(image, i);
+    images.reserve(sprite->getFrameCount());
+    for (int index = 0; index < sprite->getFrameCount(); index++) {
+        if (index % kPrefetchFrames == 0)
+            sprite->prefetchFrames(index + kPrefetchFrames, kPrefetchFrames); // decode ahead while these are converted
+        images.push_back(frameImage(index));
+    }
+    if (trimExports) {
+        // every frame of an animation is the same size, so they are all cut to the one box holding them all
+        QRect box = FrameBounds::unite(measureFrames());
+        if (!box.isEmpty() && box != QRect(0, 0, sprite->getWidth(), sprite->getHeight())) {
+            for (QImage &image : images)
+                image = image.copy(box);
+        }
     }
-    emit sendFrames(images);
+    bool exported;
+    if (QFileInfo(filepath).suffix().toLower() == "gif") {
+        AnimationExporter::PaletteMode paletteMode = perFramePalette ? AnimationExporter::PaletteMode::PerFrame
+                                                                     : AnimationExporter::PaletteMode::Shared;
+        exported = AnimationExporter::exportGif(images, frameRate, filepath, paletteMode);
+    }
+    else
+        exported = AnimationExporter::exportApng(images, frameRate, filepath);
+    if (!exported)
+        emit sendStatusMessage("Could not export the animation to " + filepath);
 }
 
 QPoint Editor::convertMouseToPixel(QPointF mouseCoords, QSize canvasSize) {
@@ -84,8 +770,16 @@ QPoint Editor::convertMouseToPixel(QPointF mouseCoords, QSize canvasSize) {
     int height = sprite->getHeight();
 
     // Convert mouse coordinates to "virtual" pixel coordinates
-    int pixelX = (mouseCoords.x() * width) / canvasSize.width();
-    int pixelY = (mouseCoords.y() * height) / canvasSize.height();
+    QPoint pointer = pointerToPixel(mouseCoords, canvasSize);
+    int pixelX = pointer.x();
+    int pixelY = pointer.y();
+
+    if (wrapAround) {
+        // the canvas shows the frame tiled, so a pixel past one edge is the same as one in from the other
+        pixelX = (pixelX % width + width) % width;
+        pixelY = (pixelY % height + height) % height;
+        return QPoint(pixelX, pixelY);
+    }
 
     // Clamp the pixel coordinates to ensure they're within the sprite's bounds
     pixelX = std::max(0, pixelX) % width;
@@ -93,30 +787,66 @@ QPoint Editor::convertMouseToPixel(QPointF mouseCoords, QSize canvasSize) {
     return QPoint(pixelX, pixelY);;
 }
 
+QPoint Editor::pointerToPixel(QPointF mouseCoords, QSize canvasSize) {
+    // rounding down rather than toward zero keeps the pixels just past the top and left edges from
+    // collapsing onto the first row and column
+    int pixelX = std::floor(mouseCoords.x() * sprite->getWidth() / canvasSize.width());
+    int pixelY = std::floor(mouseCoords.y() * sprite->getHeight() / canvasSize.height());
+    return QPoint(pixelX, pixelY);
+}
+
 
 void Editor::setColor(const QColor &newColor) {
     currentColor = newColor;
     emit colorChanged(currentColor);
 }
 void Editor::createNewSpriteSlot(int Width,int height){
-    delete sprite;
-
-    sprite = new Sprite(Width, height);
-    QImage blankSlate;
-    blankSlate.fill(Qt::white);
-    emit frameUpdated(blankSlate); // update the canvas to hold nothing so that the old sprite appears gone
+    replaceSprite(new Sprite(Width, height));
 }
 void Editor::editFrame(const QPointF &mouseCoords, const QSize &canvasSize, bool dragTool) {
 
     QPoint pixelCords = convertMouseToPixel(mouseCoords, canvasSize);
+    // strokes and shapes may run past the edges to wrap around them, every other tool stays on the frame
+    bool drawsStrokes = activeTool == ToolType::Pen || activeTool == ToolType::Eraser || activeTool == ToolType::Line ||
+                        activeTool == ToolType::Rectangle || activeTool == ToolType::FilledRectangle ||
+                        activeTool == ToolType::Ellipse;
+    QPoint pointer = drawsStrokes && wrapAround ? pointerToPixel(mouseCoords, canvasSize) : pixelCords;
+
+    // a drag begins with the first event while the mouse is held down, and ends when it is released
+    bool wasDragging = dragStart.has_value();
+    bool dragBegins = dragTool && !wasDragging;
+    if (dragBegins) {
+        dragStart = dragLast = pointer;
+        dragCommitted = false;
+    }
+    QPoint start = dragStart.value_or(pointer);
+    QPoint segmentStart = wasDragging ? dragLast : pointer;
+    if (!dragTool)
+        dragStart.reset();
+    if (activeTool == ToolType::RectangleSelect || activeTool == ToolType::LassoSelect ||
+        activeTool == ToolType::MagicWand || activeTool == ToolType::Move) {
+        editSelection(start, pixelCords, dragBegins, dragTool);
+        return;
+    }
+    dragLast = pointer;
+    dropFloating();
+    bool previewEnded = false;
+
+    Frame before = sprite->getFrame(currentFrameIndex); // shares pixels until the tool writes to the frame
+    QImage beforeImage = currentFrameImage();
     // the active tool will tell use what oporation to preform on the canvas
     switch (activeTool) {
     case ToolType::Pen:
-        Tool::pen(pixelCords, currentColor, sprite->getFrame(currentFrameIndex));
-        break;
-    case ToolType::Eraser:
-        Tool::eraser(pixelCords, sprite->getFrame(currentFrameIndex));
+    case ToolType::Eraser: {
+        // the mouse skips pixels when moved quickly, so each event draws the segment from where it last was,
+        // copies and all, in one batch
+        StrokeBatch stroke = newStroke();
+        Tool::line(segmentStart, pointer, stroke);
+        stroke.finish();
+        stroke.apply(sprite->getFrame(currentFrameIndex),
+                     activeTool == ToolType::Pen ? currentColor.rgba() : QColor(Qt::transparent).rgba());
         break;
+    }
     case ToolType::Fill:
         if (dragTool) return;
         else Tool::fill(pixelCords, currentColor, sprite->getFrame(currentFrameIndex));
@@ -125,36 +855,368 @@ void Editor::editFrame(const QPointF &mouseCoords, const QSize &canvasSize, bool
         if (dragTool) return;
         else setColor(Tool::eyeDropper(pixelCords, sprite->getFrame(currentFrameIndex)));
         break;
+    case ToolType::Line:
+    case ToolType::Rectangle:
+    case ToolType::FilledRectangle:
+    case ToolType::Ellipse:
+        if (dragTool) {
+            previewShape(start, pointer);
+            return;
+        }
+        previewEnded = !shapePreview.isNull();
+        shapePreview = QImage();
+        {
+            StrokeBatch stroke = newStroke();
+            addShape(start, pointer, stroke);
+            stroke.finish();
+            stroke.apply(sprite->getFrame(currentFrameIndex), currentColor.rgba());
+        }
+        break;
+    default:
+        break;
+    }
+
+    // only publish when the tool actually changed a pixel, or a preview needs taking down
+    Frame& currentFrame = sprite->getFrame(currentFrameIndex);
+    if (currentFrame.getContentHash() == before.getContentHash()) {
+        if (previewEnded)
+            publishSnapshot();
+        return;
+    }
+    currentImage = currentFrame.toImage();
+    frameHandles.set(currentFrameIndex, FrameHandle(currentFrame)); // the frame being drawn on stays in full color
+    currentImageKey = currentFrame.getRevision();
+    QRect area = currentFrame.changedArea(before);
+    markPixelsChanged(beforeImage, currentImage, area);
+    boundsCache.frameEdited(before, currentFrame, area);
+    if (session)
+        session->frameChanged(currentFrameIndex, area, currentFrame);
+    if (journal) {
+        // the journal only queues the two images, it diffs and writes them on its own thread
+        journal->recordFrameChange(currentFrameIndex, beforeImage, currentImage);
     }
-    Frame currentFrame = sprite->getFrame(currentFrameIndex);
-    QImage imageToDisplay = currentFrame.toImage();
 
-    emit frameUpdated(imageToDisplay);
-    emit sendFrameButtonImage(imageToDisplay, currentFrameIndex);
+    // dragging continues the stroke the click started, so the whole stroke undoes at once. A new click always
+    // starts a stroke of its own, even on the same frame with the same tool as the one before
+    UndoStack::Transaction transaction = startTransaction(toolName(activeTool));
+    transaction.changes.push_back({UndoStack::FrameChange::Kind::Replaced, currentFrameIndex, before, currentFrame});
+    commitTransaction(std::move(transaction), wasDragging && dragCommitted);
+    dragCommitted = dragTool;
+}
+
+StrokeBatch Editor::newStroke() const {
+    return StrokeBatch(sprite->getWidth(), sprite->getHeight(), symmetry, wrapAround);
+}
+
+void Editor::addShape(QPoint from, QPoint to, StrokeBatch &stroke) {
+    switch (activeTool) {
+    case ToolType::Line:
+        Tool::line(from, to, stroke);
+        break;
+    case ToolType::Rectangle:
+    case ToolType::FilledRectangle:
+        Tool::rectangle(from, to, activeTool == ToolType::FilledRectangle, stroke);
+        break;
+    case ToolType::Ellipse:
+        Tool::ellipse(from, to, stroke);
+        break;
+    default:
+        break;
+    }
+}
+
+void Editor::previewShape(QPoint from, QPoint to) {
+    StrokeBatch stroke = newStroke();
+    addShape(from, to, stroke);
+    QRect bounds = stroke.finish();
+    if (bounds.isEmpty())
+        shapePreview = QImage();
+    else {
+        // the layer only covers what the shape and its copies touch, not the whole frame
+        Frame layer(bounds.width(), bounds.height());
+        stroke.apply(layer, currentColor.rgba(), -bounds.topLeft());
+        shapePreview = layer.toImage();
+        shapePreviewPosition = bounds.topLeft();
+    }
+    publishSnapshot();
+}
+
+void Editor::editSelection(QPoint start, QPoint pixel, bool dragBegins, bool dragging) {
+    const int width = sprite->getWidth();
+    const int height = sprite->getHeight();
+    switch (activeTool) {
+    case ToolType::RectangleSelect:
+        if (dragBegins)
+            dropFloating();
+        setSelection(SelectionMask::rectangle(width, height, QRect(start, pixel)));
+        break;
+    case ToolType::LassoSelect:
+        if (dragBegins) {
+            dropFloating();
+            lassoOutline.clear();
+        }
+        if (lassoOutline.isEmpty() || lassoOutline.last() != pixel)
+            lassoOutline.append(pixel);
+        // a click without a drag leaves too few corners to select anything, which clears the selection
+        setSelection(SelectionMask::lasso(width, height, lassoOutline));
+        break;
+    case ToolType::MagicWand:
+        if (dragging)
+            return; // picks the area when the mouse is released, like the fill tool
+        dropFloating();
+        setSelection(SelectionMask::magicWand(sprite->getFrame(currentFrameIndex), pixel));
+        break;
+    case ToolType::Move:
+        if (dragBegins && !floating)
+            liftSelection();
+        if (!floating)
+            return;
+        floating->cutout.position += pixel - dragLast;
+        break;
+    default:
+        return;
+    }
+    dragLast = pixel;
+    publishSnapshot();
+}
+
+void Editor::setSelection(SelectionMask mask) {
+    selection = std::move(mask);
+    selectionBounds = selection.bounds();
+    selectionImage = selection.isEmpty() ? QImage() : selection.toImage(kSelectionTint);
+}
+
+void Editor::liftSelection() {
+    if (selection.isEmpty())
+        return;
+    Frame frame = sprite->getFrame(currentFrameIndex);
+    FloatingLayer layer{{selection.copyPixels(frame), selection.cropped(selectionBounds), selectionBounds.topLeft()},
+                        frame, QImage(), QImage(), "Move Selection"};
+    selection.clearPixels(layer.under);
+    layer.image = layer.cutout.pixels.toImage();
+    layer.underImage = layer.under.toImage();
+    floating = std::move(layer);
+    setSelection(SelectionMask());
+}
+
+void Editor::dropFloating() {
+    if (!floating)
+        return;
+    FloatingLayer layer = std::move(*floating);
+    floating.reset();
+
+    Frame after = layer.under;
+    layer.cutout.mask.pastePixels(layer.cutout.pixels, layer.cutout.position, after);
+    setSelection(layer.cutout.mask.placed(layer.cutout.position, sprite->getWidth(), sprite->getHeight()));
+    if (after.hasSamePixels(sprite->getFrame(currentFrameIndex)))
+        publishSnapshot(); // put back where it was lifted from
+    else
+        replaceCurrentFrame(after, layer.name);
+}
+
+void Editor::replaceCurrentFrame(Frame frame, const QString& name) {
+    Frame before = sprite->getFrame(currentFrameIndex);
+    if (frame.hasSamePixels(before))
+        return;
+    UndoStack::Transaction transaction = startTransaction(name);
+    setFrameAt(currentFrameIndex, frame);
+    transaction.changes.push_back({UndoStack::FrameChange::Kind::Replaced, currentFrameIndex, before, frame});
+    commitTransaction(std::move(transaction));
+}
+
+void Editor::copySelection() {
+    if (floating)
+        clipboard->cutout = floating->cutout;
+    else if (!selection.isEmpty())
+        clipboard->cutout = Cutout{selection.copyPixels(sprite->getFrame(currentFrameIndex)),
+                                   selection.cropped(selectionBounds), selectionBounds.topLeft()};
+}
+
+void Editor::cutSelection() {
+    copySelection();
+    deleteSelection();
+}
+
+void Editor::pasteSelection() {
+    if (!clipboard->cutout)
+        return;
+    dropFloating();
+    Frame frame = sprite->getFrame(currentFrameIndex);
+    Cutout cutout = *clipboard->cutout; // a copy shares its pixels, and the clipboard stays as it is for other documents
+    floating = FloatingLayer{cutout, frame, cutout.pixels.toImage(), currentFrameImage(), "Paste"};
+    setSelection(SelectionMask());
+    publishSnapshot();
+}
+
+void Editor::copyFrame() {
+    clipboard->frame = sprite->getFrame(currentFrameIndex);
+}
+
+void Editor::pasteFrame() {
+    if (!clipboard->frame)
+        return;
+    Frame frame = *clipboard->frame;
+    if (frame.getWidth() != sprite->getWidth() || frame.getHeight() != sprite->getHeight()) {
+        emit sendStatusMessage(QString("The copied frame is %1x%2, it only pastes into %1x%2 sprites")
+                                   .arg(frame.getWidth()).arg(frame.getHeight()));
+        return;
+    }
+    dropFloating();
+    UndoStack::Transaction transaction = startTransaction("Paste Frame");
+    insertFrameAt(currentFrameIndex + 1, frame);
+    currentFrameIndex++;
+    transaction.changes.push_back({UndoStack::FrameChange::Kind::Inserted, currentFrameIndex, std::nullopt, frame});
+    commitTransaction(std::move(transaction));
+}
+
+void Editor::deleteSelection() {
+    if (floating) {
+        // the lifted pixels are thrown away, leaving the hole they came out of
+        Frame under = floating->under;
+        floating.reset();
+        replaceCurrentFrame(under, "Delete Selection");
+        publishSnapshot();
+        return;
+    }
+    if (selection.isEmpty())
+        return;
+    Frame frame = sprite->getFrame(currentFrameIndex);
+    selection.clearPixels(frame);
+    replaceCurrentFrame(frame, "Delete Selection");
+}
+
+void Editor::selectAll() {
+    dropFloating();
+    setSelection(SelectionMask::rectangle(sprite->getWidth(), sprite->getHeight(),
+                                          QRect(0, 0, sprite->getWidth(), sprite->getHeight())));
+    publishSnapshot();
+}
+
+void Editor::deselect() {
+    dropFloating();
+    setSelection(SelectionMask());
+    publishSnapshot();
 }
 
 void Editor::updateCurrentFrame(int frameIndex) {
-    if (frameIndex < 0 || frameIndex >= sprite->getFrameCount())
+    if (frameIndex < 0 || frameIndex >= sprite->getFrameCount() || frameIndex == currentFrameIndex)
         return;
+    dropFloating();
+    // strokes keep the frame they draw on in full color, the sprite's own storage takes it back from here
+    if (active)
+        frameHandles.set(currentFrameIndex, sprite->frameHandle(currentFrameIndex));
     currentFrameIndex = frameIndex;
-    Frame frame = sprite->getFrame(frameIndex);
-    QImage image = frame.toImage();
-    emit frameUpdated(image);
-    emit sendFrameButtonImage(image, currentFrameIndex);
+    publishSnapshot();
 }
 
 void Editor::removeFrameSlot(int frameIndex) {
-    if (frameIndex < 0 || frameIndex >= sprite->getFrameCount())
+    // the sprite always keeps at least one frame
+    if (frameIndex < 0 || frameIndex >= sprite->getFrameCount() || sprite->getFrameCount() <= 1)
         return;
+    dropFloating();
 
-    if (currentFrameIndex == frameIndex) // if the current frame was deleted, change the current frame
+    UndoStack::Transaction transaction = startTransaction("Delete Frame");
+    transaction.changes.push_back({UndoStack::FrameChange::Kind::Erased, frameIndex, sprite->getFrame(frameIndex), std::nullopt});
+    eraseFrameAt(frameIndex);
+    if (currentFrameIndex > frameIndex || currentFrameIndex >= sprite->getFrameCount()) // keep the same frame selected
         currentFrameIndex--;
-    sprite->eraseFrame(frameIndex);
+    commitTransaction(std::move(transaction));
 }
 
-void Editor::getFrames() {
-    std::vector<QImage> images;
-    for(int i = 0; i < sprite->getFrameCount(); i++)
-        images.push_back(sprite->getFrame(i).toImage());
-    emit sendFrames(images);
+void Editor::joinSession(QString address) {
+    leaveSession();
+    session = new CollabSession(this);
+    if (!session->join(address)) {
+        emit sendStatusMessage(QString("No session is running at %1").arg(address));
+        delete session;
+        session = nullptr;
+        return;
+    }
+    // the session lives on the editor thread too, so these all run as its messages are read
+    connect(session, &CollabSession::remoteFrameChanged, this, &Editor::applyRemoteChange);
+    connect(session, &CollabSession::remoteFrameInserted, this, &Editor::applyRemoteInsert);
+    connect(session, &CollabSession::remoteFrameErased, this, &Editor::applyRemoteErase);
+    connect(session, &CollabSession::remoteFrameMoved, this, &Editor::applyRemoteMove);
+    connect(session, &CollabSession::remoteSpriteReplaced, this, &Editor::applyRemoteSprite);
+    connect(session, &CollabSession::remoteEditsApplied, this, &Editor::finishRemoteEdits);
+    connect(session, &CollabSession::spriteWanted, this,
+            [this](bool checkpoint) { session->shareSprite(*sprite, checkpoint); });
+    connect(session, &CollabSession::left, this, &Editor::endSession);
+    emit sendStatusMessage(QString("Joined the session at %1").arg(address));
+}
+
+void Editor::leaveSession() {
+    if (!session)
+        return;
+    // it may be the session's own signal that ended it, so it is deleted once that has returned
+    session->disconnect(this);
+    session->deleteLater();
+    session = nullptr;
+}
+
+void Editor::applyRemoteChange(int index, QRect area, Frame pixels) {
+    if (index < 0 || index >= sprite->getFrameCount() || area.size() != QSize(pixels.getWidth(), pixels.getHeight()) ||
+        !QRect(0, 0, sprite->getWidth(), sprite->getHeight()).contains(area))
+        return;
+    QRect source(QPoint(0, 0), area.size());
+    Frame frame = sprite->getFrame(index);
+    frame.blit(pixels, source, area.topLeft());
+    if (floating && index == currentFrameIndex) {
+        // the pixels land under the ones being moved, which keep floating over them
+        floating->under.blit(pixels, source, area.topLeft());
+        floating->underImage = floating->under.toImage();
+    }
+    setFrameAt(index, frame);
+}
+
+void Editor::applyRemoteInsert(int index, Frame frame) {
+    if (index < 0 || index > sprite->getFrameCount() || frame.getWidth() != sprite->getWidth() ||
+        frame.getHeight() != sprite->getHeight())
+        return;
+    insertFrameAt(index, frame);
+    if (index <= currentFrameIndex)
+        currentFrameIndex++; // keep the same frame selected
+    undoStack.clear(); // the history's frame indices no longer line up with the sprite's
+}
+
+void Editor::applyRemoteErase(int index) {
+    if (index < 0 || index >= sprite->getFrameCount() || sprite->getFrameCount() <= 1)
+        return;
+    if (floating && index == currentFrameIndex)
+        floating.reset(); // the frame they were lifted from is gone
+    eraseFrameAt(index);
+    if (currentFrameIndex > index || currentFrameIndex >= sprite->getFrameCount())
+        currentFrameIndex--;
+    undoStack.clear();
+}
+
+void Editor::applyRemoteMove(int from, int to) {
+    if (from < 0 || from >= sprite->getFrameCount() || to < 0 || to >= sprite->getFrameCount())
+        return;
+    Frame frame = sprite->getFrame(from);
+    eraseFrameAt(from);
+    insertFrameAt(to, frame);
+    if (currentFrameIndex == from)
+        currentFrameIndex = to;
+    else if (from < currentFrameIndex && currentFrameIndex <= to)
+        currentFrameIndex--;
+    else if (to <= currentFrameIndex && currentFrameIndex < from)
+        currentFrameIndex++;
+    undoStack.clear();
+}
+
+void Editor::applyRemoteSprite(Sprite* newSprite) {
+    int selected = currentFrameIndex;
+    replaceSprite(newSprite);
+    currentFrameIndex = std::clamp(selected, 0, sprite->getFrameCount() - 1);
+}
+
+void Editor::finishRemoteEdits() {
+    compactJournalIfNeeded();
+    publishSnapshot();
+}
+
+void Editor::endSession(QString reason) {
+    emit sendStatusMessage(reason);
+    leaveSession();
 }
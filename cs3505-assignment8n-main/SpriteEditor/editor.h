@@ -2,12 +2,34 @@
 #define EDITOR_H
 
 #include <QObject>
+#include <QCache>
 #include <QColor>
 #include "QtCore/qpoint.h"
 #include "sprite.h"
+#include "spritesnapshot.h"
+#include "frameoperation.h"
+#include "frametween.h"
+#include "framebounds.h"
+#include "undostack.h"
+#include "selectionmask.h"
+#include "strokebatch.h"
+#include "memorybudget.h"
+#include <QPolygon>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class CollabSession;
+class EditJournal;
 /*
  * Editor class to manage editing actions within a sprite editing application.
  * Handles tool selection, color changes, canvas interactions, and file operations.
+ * The editor runs on its own thread and is only driven through its slots, which queue up as commands.
+ * After every change it publishes a new SpriteSnapshot, which is all the view ever reads.
+ * Every open document is its own editor. Only the one in front keeps handles on its frames and publishes
+ * snapshots, the ones behind it hold just their frames and undo history until they are brought forward.
+ * A document can join a collaboration session, which sends every change to its sprite to the other sites
+ * and hands their changes back to be applied here.
  * @authors: Noah Campbell, Will Black, Tanner Bergstrom, Tj Hess and Kevin Christiansen
  * @ version 3/31/2024
  * @reviewed by tj hess
@@ -18,12 +40,34 @@ enum class ToolType {
     Pen = 0,
     Eraser = 1,
     Fill = 2,
-    EyeDropper = 3
+    EyeDropper = 3,
+    RectangleSelect = 4,
+    LassoSelect = 5,
+    MagicWand = 6,
+    Move = 7,
+    Line = 8,
+    Rectangle = 9,
+    FilledRectangle = 10,
+    Ellipse = 11
 };
 
 class Editor : public QObject {
     Q_OBJECT
 public:
+    /// Pixels cut or copied out of a frame, with the mask of which of them were selected
+    struct Cutout {
+        Frame pixels;        // the pixels, the size of the selection's bounds
+        SelectionMask mask;  // which of the pixels were selected, the same size
+        QPoint position;     // where the top left corner was on the frame
+    };
+
+    /// What copy and paste hold. Every open document shares one, so what is copied in one can be pasted in
+    /// another, and the documents all run on one thread so it needs no locking.
+    struct Clipboard {
+        std::optional<Cutout> cutout; // the pixels last cut or copied out of a selection
+        std::optional<Frame> frame;   // the whole frame last copied, sharing its pixels until either copy is edited
+    };
+
     // Constructor and destructor
     Editor(int width, int height);
     ~Editor();
@@ -34,24 +78,206 @@ public:
     /// @return A QPointF containing the converted x and y pixel coordinates.
     QPoint convertMouseToPixel(QPointF mouseCoords, QSize canvasSize);
 
-    /// @brief Adds an empty frame to the sprite.
+    /// @brief Converts mouse coordinates to the pixel under them without keeping it on the frame, so a mouse
+    /// past an edge gives a pixel off the frame. Strokes that wrap around the edges are drawn from these.
+    QPoint pointerToPixel(QPointF mouseCoords, QSize canvasSize);
+
+    /// @brief Adds an empty frame to the end of the sprite and selects it.
     void addEmptyFrame();
 
     /// @brief Adds a frame with specific pixel data to the sprite.
     /// @param frame The frame to add.
     void addFrame(Frame& frame);
+
+    /// @brief Gets the latest published snapshot of the sprite. Safe to call from any thread.
+    std::shared_ptr<const SpriteSnapshot> currentSnapshot() const;
+
+    /// @brief Starts recording every change to the sprite in a crash journal, or stops if it is nullptr.
+    /// Call on the editor's thread, or before the editor is moved to one.
+    /// @param journal The journal to record into, it must outlive the editor or be replaced first.
+    void setJournal(EditJournal* journal);
+
+    /// @brief Shares a clipboard with other documents. Call before the editor is moved to its thread.
+    void shareClipboard(std::shared_ptr<Clipboard> shared) { clipboard = shared; }
+
+    /// @brief Swaps in a new sprite and publishes its frames to the view.
+    /// @param newSprite The sprite to edit from now on, the editor takes ownership of it.
+    void replaceSprite(Sprite* newSprite);
 private:
     ToolType activeTool = ToolType::Pen; /// Currently selected tool.
     QColor currentColor = QColorConstants::Black; /// Currently selected color.
+    SymmetryMode symmetry = SymmetryMode::None; /// The copies the drawing tools make of what they draw
+    bool wrapAround = false; /// True if drawing past an edge of the frame carries on from the opposite edge
     Sprite* sprite; /// Pointer to the current sprite
     int currentFrameIndex = 0; /// Index of the current frame being displayed
     int currentPreviewFrame;
     bool showPreviewActualSize;
+    bool compressSavedFrames = false; /// Whether saves store frames as deltas against the frame before them
+    bool trimExports = false; /// Whether exports leave out the transparent border every frame has
+    bool active = true; /// True while this document is the one in front
+    int backgroundDocuments = 0; /// How many other documents share the memory budget with this one
+
+    /// How many frames ahead to read from an archive while walking through every frame
+    static constexpr int kPrefetchFrames = 32;
+
+    FrameTable frameHandles; /// A handle on every frame, kept in step with the sprite for the snapshots
+    QImage currentImage; /// Image of the current frame, the only frame the editor keeps an image of
+    quint64 currentImageKey = 0; /// Key of the handle currentImage was made from, see currentFrameImage
+    QCache<quint64, QImage> recentImages; /// Images of the frames that were current before, by the key of their
+                                          /// handle and costed in bytes, for going back to them
+    std::shared_ptr<const SpriteSnapshot> snapshot; /// The latest snapshot, only accessed atomically
+    quint64 snapshotVersion = 0; /// Version of the latest snapshot
+    EditJournal* journal = nullptr; /// Crash journal every change is recorded in, if any
+    CollabSession* session = nullptr; /// The collaboration session every change is sent to, if any
+    UndoStack undoStack; /// Changes that can be undone and redone
+    MemoryReport framesReport{MemoryUse::SpriteFrames}; /// Memory the sprite's full color frames take
+    MemoryReport indexedReport{MemoryUse::IndexedFrames}; /// Memory the sprite's palette indices take
+    MemoryReport undoReport{MemoryUse::UndoHistory}; /// Memory only the undo history holds
+    MemoryReport imagesReport{MemoryUse::FrameImages}; /// Memory currentImage and recentImages take
+    FrameBoundsCache boundsCache; /// The opaque bounds of the frames measured lately, kept up to date by edits
+
+    /// A cutout floating over the current frame while it is moved or pasted. It is only written into the
+    /// frame when it is dropped, so dragging it around never touches the frame.
+    struct FloatingLayer {
+        Cutout cutout;       // the floating pixels and where they are now
+        Frame under;         // the frame under the layer, with the hole the pixels were lifted out of
+        QImage image;        // the floating pixels as an image for the overlay
+        QImage underImage;   // the frame under the layer as an image for the canvas
+        QString name;        // what dropping the layer is called in the undo history
+    };
+
+    SelectionMask selection; /// The selected pixels of the current frame, nothing selected when empty
+    QImage selectionImage; /// The selection tinted for the overlay, kept in step with selection
+    QRect selectionBounds; /// The bounds of the selection, kept in step with selection
+    std::optional<FloatingLayer> floating; /// Pixels being moved or pasted, if any
+    std::shared_ptr<Clipboard> clipboard = std::make_shared<Clipboard>(); /// What was last copied, in any document
+    std::optional<QPoint> dragStart; /// Where the mouse was pressed, while it is held down
+    QPoint dragLast; /// Where the mouse was the last time it moved while held down
+    bool dragCommitted = false; /// True once the drag in progress has put its stroke in the undo history
+    QPolygon lassoOutline; /// The outline drawn so far with the lasso
+    QImage shapePreview; /// The shape being dragged out, drawn over the frame until the mouse is released
+    QPoint shapePreviewPosition; /// Where the shape preview's top left corner sits on the frame
+    QRect changedPixels; /// The pixels of the current frame changed since the last snapshot
+    qint64 changedFrom = 0; /// Cache key of the current frame's image in the last snapshot
+    qint64 changedTo = 0; /// Cache key of the current frame's image after the last change in changedPixels
+
+    /// @brief Publishes the frame handles, the current frame's image and the selection as a new snapshot and
+    /// tells the view.
+    void publishSnapshot();
+
+    /// @brief Hands out a new handle on every frame, used when a whole new sprite is swapped in or the way
+    /// the sprite stores its frames changes. Only the current frame's image is made, when it is next published.
+    void refreshFrameHandles();
+
+    /// @brief Gets the image of the current frame, making it again if the frame changed since it was made. The
+    /// image it replaces goes into recentImages, and one kept there is taken back out rather than made again.
+    const QImage& currentFrameImage();
+
+    /// @brief Makes the image of a frame, reusing the current frame's image or one in recentImages.
+    QImage frameImage(int index);
+
+    /// @brief Starts a fresh journal on a snapshot of the sprite once the current one has grown long.
+    void compactJournalIfNeeded();
+
+    /// @brief Tells the journal and the session the whole sprite changed in a way frame changes cannot describe.
+    void recordSpriteReplaced();
+
+    /// @brief Notes which pixels of the current frame's image changed, so the next snapshot lets the view
+    /// redraw just those.
+    /// @param before The frame's image before the change.
+    /// @param after The frame's image after it.
+    /// @param area The pixels that differ between them.
+    void markPixelsChanged(const QImage& before, const QImage& after, const QRect& area);
+
+    /// @brief Replaces a frame, keeping the frame handles and the journal in step. Does not publish.
+    /// @param index The frame to replace.
+    /// @param frame The new pixels.
+    void setFrameAt(int index, Frame frame);
+
+    /// @brief Inserts a frame, keeping the frame handles and the journal in step. Does not publish.
+    void insertFrameAt(int index, Frame frame);
+
+    /// @brief Removes a frame, keeping the frame handles and the journal in step. Does not publish.
+    void eraseFrameAt(int index);
+
+    /// @brief Copies frames out of the sprite so worker threads can read them, reading ahead from the archive.
+    /// @param frameIndices The frames to copy, in the order they are wanted.
+    std::vector<Frame> copyFrames(const std::vector<int>& frameIndices);
+
+    /// @brief Gets the opaque bounds of every frame, measuring the frames not in the cache across every core.
+    /// The cache is checked by revision before any frame is read, and the rest are read and measured a batch
+    /// of kPrefetchFrames at a time, so only one batch is held at once.
+    std::vector<FrameBounds> measureFrames();
+
+    /// @brief Changes the size of the sprite and replaces every frame, keeping the frame handles in step.
+    /// The journal cannot record a size change frame by frame, so it starts over from the resized sprite.
+    /// Does not publish.
+    /// @param size The new size of the sprite.
+    /// @param frames The new frames, one for each frame of the sprite in order.
+    void resizeSpriteTo(QSize size, std::vector<Frame> frames);
+
+    /// @brief Begins recording a change for the undo history.
+    /// @param name What the user did, shown when it is undone.
+    UndoStack::Transaction startTransaction(const QString& name) const;
+
+    /// @brief Adds a finished change to the undo history and publishes the result.
+    /// @param transaction The changes that were made.
+    /// @param mergeStroke True to fold it into the last change if that was the same tool on the same frame.
+    void commitTransaction(UndoStack::Transaction transaction, bool mergeStroke = false);
+
+    /// @brief Reports how many frames are repeats and how much memory sharing their pixels saves.
+    void reportFrameSharing();
+
+    /// @brief Gives the sprite, undo history, recent frame images and buffer pool their shares of the memory budget.
+    void applyMemoryBudget();
+
+    /// @brief Gets this document's part of a cache's share of the memory budget. The document in front
+    /// gets three quarters of it and the ones behind it split the last quarter.
+    qint64 budgetPortion(qint64 share) const;
+
+    /// @brief Tells the memory budget how much the sprite, undo history and frame images hold.
+    void reportMemoryUse();
+
+    /// @brief Runs the selection and move tools, which change the selection instead of the frame.
+    /// @param start The pixel the drag began on.
+    /// @param pixel The pixel under the mouse.
+    /// @param dragBegins True if the mouse was just pressed.
+    /// @param dragging True while the mouse is held down, false once it is released.
+    void editSelection(QPoint start, QPoint pixel, bool dragBegins, bool dragging);
+
+    /// @brief Makes an empty stroke batch with the current symmetry and wrapping.
+    StrokeBatch newStroke() const;
+
+    /// @brief Adds the active shape tool's shape between two points to a stroke.
+    void addShape(QPoint from, QPoint to, StrokeBatch &stroke);
+
+    /// @brief Draws the shape being dragged out into the preview overlay and publishes it. The frame is
+    /// left alone until the mouse is released, so only the shape's bounds are drawn while dragging.
+    void previewShape(QPoint from, QPoint to);
+
+    /// @brief Replaces the selection and rebuilds its tinted image. Does not publish.
+    void setSelection(SelectionMask mask);
+
+    /// @brief Lifts the selected pixels off the current frame into a floating layer. Does not publish.
+    void liftSelection();
+
+    /// @brief Writes the floating layer into the current frame as one undoable step and selects where it
+    /// landed. Called before anything else changes the frames or the frame being edited.
+    void dropFloating();
+
+    /// @brief Replaces the current frame as one undoable step, does nothing if the pixels are the same.
+    void replaceCurrentFrame(Frame frame, const QString& name);
 public slots:
     /// @brief Sets the active editing tool.
     /// @param tool The tool to be activated.
     void setActiveTool(ToolType tool) { activeTool = tool; }
 
+    /// @brief Sets the copies the drawing tools make of what they draw.
+    void setSymmetry(SymmetryMode mode) { symmetry = mode; }
+
+    /// @brief Turns wrapping strokes around the edges of the frame on or off, for drawing tiles.
+    void setWrapAround(bool enabled) { wrapAround = enabled; }
+
     /// @brief Sets the editor's color.
     /// @param color The color to be set.
     void setColor(const QColor &color);
@@ -68,12 +294,50 @@ public slots:
     void createNewSpriteSlot(int width, int height);
 
     /// @brief Saves the current sprite to a file.
-    /// @param filename The name of the file to save to.
+    /// @param filename The name of the file to save to. A name ending in .ssb is saved as an archive,
+    /// anything else is saved as a .ssp file, with the collision box of every frame written next to it in a
+    /// .collision.json file. Saving back to the archive the sprite came from only appends the frames edited
+    /// since the last save.
     void saveSlot(QString filename);
 
+    /// @brief Rewrites the archive the sprite was opened from or last saved to, dropping the frame data
+    /// that saves only appending changes have left unused in it. Any unsaved edits are saved as well.
+    void compactArchiveSlot();
+
+    /// @brief Turns delta compression of saved frames on or off.
+    /// @param enabled True to store each frame as the tiles that changed since the previous frame.
+    void setSaveCompression(bool enabled) { compressSavedFrames = enabled; }
+
+    /// @brief Turns trimming of exported animations on or off.
+    /// @param enabled True to crop every exported frame to the smallest rectangle holding what any frame draws.
+    void setExportTrim(bool enabled) { trimExports = enabled; }
+
+    /// @brief Brings the document to the front or sends it behind another one, and fits it into its part of
+    /// the memory budget again, dropping what no longer fits. A document sent behind drops the handles on its
+    /// frames and shares the pixels of its identical frames, and it hands out new ones once it is in front.
+    /// @param active True if this is the document in front now.
+    /// @param backgroundDocuments How many other documents are open.
+    void setActive(bool active, int backgroundDocuments);
+
     /// @brief Loads a sprite from a file.
-    /// @param filepath The path of the file to load from.
+    /// @param filepath The path of the file to load from, a .ssp file or a .ssb archive.
     void loadSlot(QString filepath);
+
+    /// @brief Exports the sprite as an animated GIF or animated PNG, picked by the file extension.
+    /// @param filepath The path of the file to write, ending in .gif, .png or .apng.
+    /// @param frameRate The frames per second the animation plays at.
+    /// @param perFramePalette True to give each GIF frame its own palette instead of one shared palette.
+    void exportSlot(QString filepath, int frameRate, bool perFramePalette);
+
+    /// @brief Replaces the sprite with one built from the png images in a folder, one frame per image.
+    /// @param folderPath The folder holding the images.
+    void importImageSequenceSlot(QString folderPath);
+
+    /// @brief Replaces the sprite with the frames cut out of a sprite sheet.
+    /// @param filepath The sprite sheet image.
+    /// @param cellWidth The width of each frame on the sheet.
+    /// @param cellHeight The height of each frame on the sheet.
+    void importSpriteSheetSlot(QString filepath, int cellWidth, int cellHeight);
     /// @brief Gets the frame that was selected and sends it as an image back to the view
     /// @param frameIndex The index of the frame that was selected
     void updateCurrentFrame(int frameIndex);
@@ -82,11 +346,108 @@ public slots:
     /// @param frameIndex The index of the frame to remove
     void removeFrameSlot(int frameIndex);
 
-     /// @brief Duplicates a specific frame in the sprite.
+     /// @brief Duplicates the current frame and selects the copy.
     void duplicateFrame();
 
-    /// @brief sends the updated frame images of the sprite to the preview
-    void getFrames();
+    /// @brief Applies an operation to many frames at once, spread across every core. All the frames it
+    /// changes undo together as one step.
+    /// @param operation The change to make to each frame.
+    /// @param frameIndices The frames to change, or empty for every frame.
+    void applyFrameOperation(FrameOperation operation, std::vector<int> frameIndices);
+
+    /// @brief Builds in-between frames from one key frame to another and puts them between the two, in place
+    /// of any frames that were between them. They are built across every core, and the whole change undoes
+    /// as one step.
+    /// @param firstFrame One key frame.
+    /// @param lastFrame The other key frame, the tween runs from whichever comes first to the other.
+    /// @param count How many frames to put in between.
+    /// @param tween How to build them. A motion tween with no pixels of its own moves the selected ones, or
+    /// the whole frame when nothing is selected.
+    void tweenFrames(int firstFrame, int lastFrame, int count, FrameTween tween);
+
+    /// @brief Scales the sprite or resizes its canvas, changing every frame at once as one undoable step.
+    /// @param transform The transform to apply, made for the sprite's current size.
+    void resizeSprite(FrameTransform transform);
+
+    /// @brief Crops the canvas to the smallest rectangle holding every pixel any frame draws, as one
+    /// undoable step. Tells the status bar when there is nothing to crop.
+    void autoCrop();
+
+    /// @brief Reduces the whole sprite to a palette of a few colors picked from every frame, redrawing every
+    /// frame with them as one undoable step.
+    /// @param colorCount The most colors to keep, not counting transparent.
+    /// @param dither True to mix palette colors in an ordered pattern for the colors in between.
+    void reduceColors(int colorCount, bool dither);
+
+    /// @brief Switches the sprite between storing its frames as 8 bit palette indices and in full color.
+    /// @param indexed True for indexed color, which fails if the sprite uses more than 256 colors.
+    void setIndexedColor(bool indexed);
+
+    /// @brief Changes a color of an indexed sprite's palette, recoloring every frame that uses it at once.
+    /// @param from The color to change, it must be in the palette.
+    /// @param to The color to change it to.
+    void replacePaletteColor(QRgb from, QRgb to);
+
+    /// @brief Copies the selected pixels, or the floating ones, so they can be pasted onto any frame.
+    void copySelection();
+
+    /// @brief Copies the selected pixels and makes them transparent on the frame.
+    void cutSelection();
+
+    /// @brief Floats the copied pixels over the current frame where they were copied from, to be moved
+    /// with the move tool and dropped onto the frame.
+    void pasteSelection();
+
+    /// @brief Makes the selected pixels transparent, or throws away the floating ones.
+    void deleteSelection();
+
+    /// @brief Selects the whole frame.
+    void selectAll();
+
+    /// @brief Drops any floating pixels onto the frame and clears the selection.
+    void deselect();
+
+    /// @brief Copies the current frame so it can be pasted into any document, sharing its pixels.
+    void copyFrame();
+
+    /// @brief Inserts the copied frame after the current frame and selects it. The frame shares its pixels
+    /// with the one it was copied from until either is edited.
+    void pasteFrame();
+
+    /// @brief Reverses the last change.
+    void undo();
+
+    /// @brief Makes the last undone change again.
+    void redo();
+
+    /// @brief Joins the collaboration session a relay is running, sharing this document's sprite with every
+    /// other site in it. The first site to join shares its sprite, the others take it over.
+    /// @param address The relay's local socket name, or host:port for a TCP port on the loopback address.
+    void joinSession(QString address);
+
+    /// @brief Leaves the collaboration session, keeping the sprite as it is.
+    void leaveSession();
+private slots:
+    /// @brief Replaces pixels of a frame with the ones another site of the session drew.
+    void applyRemoteChange(int index, QRect area, Frame pixels);
+
+    /// @brief Adds a frame another site of the session added.
+    void applyRemoteInsert(int index, Frame frame);
+
+    /// @brief Removes a frame another site of the session removed.
+    void applyRemoteErase(int index);
+
+    /// @brief Moves a frame this site added to where the session put it.
+    void applyRemoteMove(int from, int to);
+
+    /// @brief Takes over the sprite the session sent.
+    void applyRemoteSprite(Sprite* newSprite);
+
+    /// @brief Shows every change from the session that has been applied.
+    void finishRemoteEdits();
+
+    /// @brief Leaves the session when it ends, saying why.
+    void endSession(QString reason);
 signals:
     /// @brief signal to send QImage frame from editor to the view
     /// @param frame to dispaly
@@ -99,23 +460,12 @@ signals:
     /// @param color to send
     void colorChanged(const QColor &newColor);
 
-    /// @brief signal to display the image on the appropriate fram button
-    /// @param image to display on button
-    /// @param index of button/frame number
-    void sendFrameButtonImage(QImage frame, int index);
-
-    /// @brief Emites a signal to the canvas when a frame is updated
-    /// @param image to send to canvas
-    void frameUpdated(QImage &frameDisplayed);
-
-    /// @brief signal for when editor is loading a new sprite the view will insert the button
-    /// this is exicuted as many frames as there are in the sprite
-    /// @param the corisponding frame number
-    void insertFrameButton(int frameNum);
-
-    void addClonedImageToPreview(QImage image, int clonedImageIndex);
+    /// @brief tells the view a new snapshot is ready to be read with currentSnapshot
+    void snapshotPublished();
 
-    void sendFrames(std::vector<QImage> &images);
+    /// @brief sends a short message for the view to show in its status bar
+    /// @param message the text to show
+    void sendStatusMessage(QString message);
 };
 
 #endif // EDITOR_H
@@ -0,0 +1,97 @@
+#include "filterdialog.h"
+#include <QColorDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+
+FilterDialog::FilterDialog(QColor outlineColor, QWidget *parent)
+    : QDialog(parent)
+    , outlineColor(outlineColor)
+    , shadowColor(QColor(0, 0, 0, 128)) {
+    setWindowTitle("Filters");
+    QFormLayout *layout = new QFormLayout(this);
+
+    // the color sliders are in degrees and percentages, each starts where it leaves the colors alone
+    hue = createSlider(-180, 180, 0);
+    saturation = createSlider(0, 200, 100);
+    value = createSlider(0, 200, 100);
+    brightness = createSlider(-255, 255, 0);
+    contrast = createSlider(0, 200, 100);
+    layout->addRow("Hue", hue);
+    layout->addRow("Saturation", saturation);
+    layout->addRow("Value", value);
+    layout->addRow("Brightness", brightness);
+    layout->addRow("Contrast", contrast);
+
+    outlineEnabled = new QCheckBox("Outline", this);
+    outlineColorButton = createColorButton(&this->outlineColor);
+    layout->addRow(outlineEnabled, outlineColorButton);
+
+    shadowEnabled = new QCheckBox("Drop Shadow", this);
+    shadowX = new QSpinBox(this);
+    shadowY = new QSpinBox(this);
+    for (QSpinBox *offset : {shadowX, shadowY}) {
+        offset->setRange(-64, 64);
+        offset->setValue(1);
+        connect(offset, &QSpinBox::valueChanged, this, [this]() { emit pipelineChanged(pipeline()); });
+    }
+    shadowColorButton = createColorButton(&shadowColor);
+    QHBoxLayout *shadowLayout = new QHBoxLayout;
+    shadowLayout->addWidget(shadowX);
+    shadowLayout->addWidget(shadowY);
+    shadowLayout->addWidget(shadowColorButton);
+    layout->addRow(shadowEnabled, shadowLayout);
+
+    for (QCheckBox *enabled : {outlineEnabled, shadowEnabled})
+        connect(enabled, &QCheckBox::toggled, this, [this]() { emit pipelineChanged(pipeline()); });
+
+    allFrames = new QCheckBox("Apply to all frames", this);
+    layout->addRow(allFrames);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addRow(buttons);
+}
+
+FilterPipeline FilterDialog::pipeline() const {
+    FilterPipeline filters;
+    if (hue->value() != 0 || saturation->value() != 100 || value->value() != 100)
+        filters.adjustHsv(hue->value(), saturation->value() / 100.0, value->value() / 100.0);
+    if (brightness->value() != 0 || contrast->value() != 100)
+        filters.adjustBrightnessContrast(brightness->value(), contrast->value() / 100.0);
+    // the shadow goes first so the outline wraps the sprite and not its shadow
+    if (shadowEnabled->isChecked())
+        filters.dropShadow(shadowX->value(), shadowY->value(), shadowColor.rgba());
+    if (outlineEnabled->isChecked())
+        filters.outline(outlineColor.rgba());
+    return filters;
+}
+
+QSlider* FilterDialog::createSlider(int minimum, int maximum, int initial) {
+    QSlider *slider = new QSlider(Qt::Horizontal, this);
+    slider->setRange(minimum, maximum);
+    slider->setValue(initial);
+    slider->setMinimumWidth(200);
+    connect(slider, &QSlider::valueChanged, this, [this]() { emit pipelineChanged(pipeline()); });
+    return slider;
+}
+
+QPushButton* FilterDialog::createColorButton(QColor *color) {
+    QPushButton *button = new QPushButton(this);
+    button->setFixedSize(40, 20);
+    showColor(button, *color);
+    connect(button, &QPushButton::clicked, this, [this, button, color]() {
+        QColor picked = QColorDialog::getColor(*color, this, QString(), QColorDialog::ShowAlphaChannel);
+        if (!picked.isValid())
+            return;
+        *color = picked;
+        showColor(button, picked);
+        emit pipelineChanged(pipeline());
+    });
+    return button;
+}
+
+void FilterDialog::showColor(QPushButton *button, const QColor &color) {
+    button->setStyleSheet(QString("QPushButton {background-color: %1;}").arg(color.name(QColor::HexArgb)));
+}
@@ -0,0 +1,59 @@
+#ifndef FILTERDIALOG_H
+#define FILTERDIALOG_H
+
+#include <QCheckBox>
+#include <QDialog>
+#include <QPushButton>
+#include <QSlider>
+#include <QSpinBox>
+#include "filterpipeline.h"
+/*
+ * the filter dialog lets the user set up the color adjustments, outline and drop shadow to run over the
+ * sprite. every change to a setting sends out the pipeline it describes, so the canvas can preview the
+ * filters on the current frame while the dialog is open. nothing is changed until the dialog is accepted.
+ */
+class FilterDialog : public QDialog
+{
+    Q_OBJECT
+    public:
+        /// @brief builds the dialog with every setting at the value that leaves the frame unchanged
+        /// @param outlineColor the color the outline and shadow start as, usually the paint color
+        /// @param parent the window the dialog sits over
+        FilterDialog(QColor outlineColor, QWidget *parent = nullptr);
+
+        /// @brief builds the pipeline the settings describe, the filters that are left unchanged are skipped
+        FilterPipeline pipeline() const;
+
+        /// @brief tells if the filters should run over every frame or only the current one
+        bool appliesToAllFrames() const { return allFrames->isChecked(); }
+    signals:
+        /// @brief sent whenever a setting changes, with the pipeline to preview
+        void pipelineChanged(const FilterPipeline &pipeline);
+    private:
+        QSlider *hue;
+        QSlider *saturation;
+        QSlider *value;
+        QSlider *brightness;
+        QSlider *contrast;
+        QCheckBox *outlineEnabled;
+        QPushButton *outlineColorButton;
+        QColor outlineColor;
+        QCheckBox *shadowEnabled;
+        QSpinBox *shadowX;
+        QSpinBox *shadowY;
+        QPushButton *shadowColorButton;
+        QColor shadowColor;
+        QCheckBox *allFrames;
+
+        /// @brief makes a slider that sends out the pipeline when it moves
+        QSlider* createSlider(int minimum, int maximum, int initial);
+
+        /// @brief makes a button that shows a color and lets the user pick a new one
+        /// @param color the color to show and change
+        QPushButton* createColorButton(QColor *color);
+
+        /// @brief paints a color button with its color
+        static void showColor(QPushButton *button, const QColor &color);
+};
+
+#endif // FILTERDIALOG_H
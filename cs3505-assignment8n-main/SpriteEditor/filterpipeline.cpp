@@ -0,0 +1,400 @@
+#include "filterpipeline.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FILTER_PIPELINE_SSE2
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+bool isTransparent(QRgb color) {
+    return qAlpha(color) == 0;
+}
+
+// ---------------------------------------------- color matrix ---------------------------------------------- //
+
+QRgb colorMatrixPixel(QRgb color, const float *matrix) {
+    if (isTransparent(color))
+        return color;
+    float red = qRed(color);
+    float green = qGreen(color);
+    float blue = qBlue(color);
+    int channels[3];
+    for (int row = 0; row < 3; row++) {
+        const float *weights = matrix + row * 4;
+        float value = weights[0] * red + weights[1] * green + weights[2] * blue + weights[3];
+        channels[row] = (int)std::lrint(std::clamp(value, 0.0f, 255.0f));
+    }
+    return qRgba(channels[0], channels[1], channels[2], qAlpha(color));
+}
+
+void colorMatrixRow(QRgb *row, int width, const float *matrix) {
+    int x = 0;
+#if defined(__AVX2__)
+    const __m256i channelMask = _mm256_set1_epi32(0xff);
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000);
+    const __m256 low = _mm256_setzero_ps();
+    const __m256 high = _mm256_set1_ps(255.0f);
+    __m256 weights[12];
+    for (int i = 0; i < 12; i++)
+        weights[i] = _mm256_set1_ps(matrix[i]);
+
+    for (; x + 8 <= width; x += 8) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(row + x));
+        __m256 red = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), channelMask));
+        __m256 green = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), channelMask));
+        __m256 blue = _mm256_cvtepi32_ps(_mm256_and_si256(pixels, channelMask));
+        __m256i result = _mm256_and_si256(pixels, alphaMask);
+        for (int channel = 0; channel < 3; channel++) {
+            const __m256 *w = weights + channel * 4;
+            __m256 value = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(w[0], red), _mm256_mul_ps(w[1], green)),
+                                                       _mm256_mul_ps(w[2], blue)), w[3]);
+            value = _mm256_min_ps(_mm256_max_ps(value, low), high);
+            result = _mm256_or_si256(result, _mm256_slli_epi32(_mm256_cvtps_epi32(value), 16 - channel * 8));
+        }
+        // fully transparent pixels keep whatever color they had
+        __m256i transparent = _mm256_cmpeq_epi32(_mm256_srli_epi32(pixels, 24), _mm256_setzero_si256());
+        result = _mm256_blendv_epi8(result, pixels, transparent);
+        _mm256_storeu_si256((__m256i*)(row + x), result);
+    }
+#elif defined(FILTER_PIPELINE_SSE2)
+    const __m128i channelMask = _mm_set1_epi32(0xff);
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    const __m128 low = _mm_setzero_ps();
+    const __m128 high = _mm_set1_ps(255.0f);
+    __m128 weights[12];
+    for (int i = 0; i < 12; i++)
+        weights[i] = _mm_set1_ps(matrix[i]);
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128 red = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), channelMask));
+        __m128 green = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), channelMask));
+        __m128 blue = _mm_cvtepi32_ps(_mm_and_si128(pixels, channelMask));
+        __m128i result = _mm_and_si128(pixels, alphaMask);
+        for (int channel = 0; channel < 3; channel++) {
+            const __m128 *w = weights + channel * 4;
+            __m128 value = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(w[0], red), _mm_mul_ps(w[1], green)),
+                                                 _mm_mul_ps(w[2], blue)), w[3]);
+            value = _mm_min_ps(_mm_max_ps(value, low), high);
+            result = _mm_or_si128(result, _mm_slli_epi32(_mm_cvtps_epi32(value), 16 - channel * 8));
+        }
+        // fully transparent pixels keep whatever color they had
+        __m128i transparent = _mm_cmpeq_epi32(_mm_srli_epi32(pixels, 24), _mm_setzero_si128());
+        result = _mm_or_si128(_mm_and_si128(transparent, pixels), _mm_andnot_si128(transparent, result));
+        _mm_storeu_si128((__m128i*)(row + x), result);
+    }
+#endif
+    for (; x < width; x++)
+        row[x] = colorMatrixPixel(row[x], matrix);
+}
+
+// ---------------------------------------------- palette remap ---------------------------------------------- //
+
+quint32 paletteSlot(QRgb color, quint32 mask) {
+    return (color * 2654435761u) >> 7 & mask;
+}
+
+// ------------------------------------------ outline and drop shadow ------------------------------------------ //
+
+/// @brief writes one row of an outline, above and below are the rows next to it or a row of transparent pixels
+void outlineRow(const QRgb *above, const QRgb *row, const QRgb *below, QRgb *output, int width, QRgb color) {
+    auto outlinePixel = [&](int x) {
+        quint32 neighbours = above[x] | below[x] | (x > 0 ? row[x - 1] : 0) | (x + 1 < width ? row[x + 1] : 0);
+        output[x] = isTransparent(row[x]) && !isTransparent(neighbours) ? color : row[x];
+    };
+
+    // the first and last pixels are missing a neighbour, so only the ones between them are done in bulk
+    int x = 0;
+    if (width > 0)
+        outlinePixel(x++);
+#if defined(__AVX2__)
+    const __m256i colors = _mm256_set1_epi32((int)color);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; x + 8 < width; x += 8) {
+        __m256i center = _mm256_loadu_si256((const __m256i*)(row + x));
+        __m256i neighbours = _mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256((const __m256i*)(above + x)),
+                                                             _mm256_loadu_si256((const __m256i*)(below + x))),
+                                             _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(row + x - 1)),
+                                                             _mm256_loadu_si256((const __m256i*)(row + x + 1))));
+        __m256i centerTransparent = _mm256_cmpeq_epi32(_mm256_srli_epi32(center, 24), zero);
+        __m256i neighboursTransparent = _mm256_cmpeq_epi32(_mm256_srli_epi32(neighbours, 24), zero);
+        __m256i outlined = _mm256_andnot_si256(neighboursTransparent, centerTransparent);
+        _mm256_storeu_si256((__m256i*)(output + x), _mm256_blendv_epi8(center, colors, outlined));
+    }
+#elif defined(FILTER_PIPELINE_SSE2)
+    const __m128i colors = _mm_set1_epi32((int)color);
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 < width; x += 4) {
+        __m128i center = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i neighbours = _mm_or_si128(_mm_or_si128(_mm_loadu_si128((const __m128i*)(above + x)),
+                                                       _mm_loadu_si128((const __m128i*)(below + x))),
+                                          _mm_or_si128(_mm_loadu_si128((const __m128i*)(row + x - 1)),
+                                                       _mm_loadu_si128((const __m128i*)(row + x + 1))));
+        __m128i centerTransparent = _mm_cmpeq_epi32(_mm_srli_epi32(center, 24), zero);
+        __m128i neighboursTransparent = _mm_cmpeq_epi32(_mm_srli_epi32(neighbours, 24), zero);
+        __m128i outlined = _mm_andnot_si128(neighboursTransparent, centerTransparent);
+        _mm_storeu_si128((__m128i*)(output + x), _mm_or_si128(_mm_and_si128(outlined, colors),
+                                                              _mm_andnot_si128(outlined, center)));
+    }
+#endif
+    for (; x < width; x++)
+        outlinePixel(x);
+}
+
+/// @brief writes one row of a drop shadow, caster is the row the shadow falls from or null if that is off the frame
+void dropShadowRow(const QRgb *row, const QRgb *caster, QRgb *output, int width, int offsetX, QRgb color) {
+    // only the pixels whose caster is inside the frame can be shadowed
+    int begin = caster ? std::clamp(offsetX, 0, width) : width;
+    int end = caster ? std::clamp(width + offsetX, begin, width) : width;
+    std::copy(row, row + begin, output);
+    std::copy(row + end, row + width, output + end);
+
+    int x = begin;
+#if defined(__AVX2__)
+    const __m256i colors = _mm256_set1_epi32((int)color);
+    const __m256i zero = _mm256_setzero_si256();
+    for (; x + 8 <= end; x += 8) {
+        __m256i center = _mm256_loadu_si256((const __m256i*)(row + x));
+        __m256i casting = _mm256_loadu_si256((const __m256i*)(caster + x - offsetX));
+        __m256i centerTransparent = _mm256_cmpeq_epi32(_mm256_srli_epi32(center, 24), zero);
+        __m256i casterTransparent = _mm256_cmpeq_epi32(_mm256_srli_epi32(casting, 24), zero);
+        __m256i shadowed = _mm256_andnot_si256(casterTransparent, centerTransparent);
+        _mm256_storeu_si256((__m256i*)(output + x), _mm256_blendv_epi8(center, colors, shadowed));
+    }
+#elif defined(FILTER_PIPELINE_SSE2)
+    const __m128i colors = _mm_set1_epi32((int)color);
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= end; x += 4) {
+        __m128i center = _mm_loadu_si128((const __m128i*)(row + x));
+        __m128i casting = _mm_loadu_si128((const __m128i*)(caster + x - offsetX));
+        __m128i centerTransparent = _mm_cmpeq_epi32(_mm_srli_epi32(center, 24), zero);
+        __m128i casterTransparent = _mm_cmpeq_epi32(_mm_srli_epi32(casting, 24), zero);
+        __m128i shadowed = _mm_andnot_si128(casterTransparent, centerTransparent);
+        _mm_storeu_si128((__m128i*)(output + x), _mm_or_si128(_mm_and_si128(shadowed, colors),
+                                                              _mm_andnot_si128(shadowed, center)));
+    }
+#endif
+    for (; x < end; x++)
+        output[x] = isTransparent(row[x]) && !isTransparent(caster[x - offsetX]) ? color : row[x];
+}
+
+}
+
+FilterPipeline& FilterPipeline::adjustHsv(int hueDegrees, double saturation, double value) {
+    // the hue and saturation matrices turn and scale colors about the grey axis, weighted by how bright
+    // each channel looks, the same as the hue-rotate and saturate filters of CSS
+    const double angle = hueDegrees * kPi / 180.0;
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    const double hue[9] = {
+        0.213 + c * 0.787 - s * 0.213, 0.715 - c * 0.715 - s * 0.715, 0.072 - c * 0.072 + s * 0.928,
+        0.213 - c * 0.213 + s * 0.143, 0.715 + c * 0.285 + s * 0.140, 0.072 - c * 0.072 - s * 0.283,
+        0.213 - c * 0.213 - s * 0.787, 0.715 - c * 0.715 + s * 0.715, 0.072 + c * 0.928 + s * 0.072
+    };
+    const double saturate[9] = {
+        0.213 + 0.787 * saturation, 0.715 - 0.715 * saturation, 0.072 - 0.072 * saturation,
+        0.213 - 0.213 * saturation, 0.715 + 0.285 * saturation, 0.072 - 0.072 * saturation,
+        0.213 - 0.213 * saturation, 0.715 - 0.715 * saturation, 0.072 + 0.928 * saturation
+    };
+
+    float matrix[12] = {};
+    for (int row = 0; row < 3; row++)
+        for (int column = 0; column < 3; column++) {
+            double sum = 0;
+            for (int k = 0; k < 3; k++)
+                sum += saturate[row * 3 + k] * hue[k * 3 + column];
+            matrix[row * 4 + column] = float(sum * value);
+        }
+    addColorMatrix(matrix, "Hue/Saturation");
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::adjustBrightnessContrast(int brightness, double contrast) {
+    const float scale = float(contrast);
+    const float offset = float(128.0 * (1.0 - contrast) + brightness);
+    const float matrix[12] = {
+        scale, 0, 0, offset,
+        0, scale, 0, offset,
+        0, 0, scale, offset
+    };
+    addColorMatrix(matrix, "Brightness/Contrast");
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::remapPalette(const QHash<QRgb, QRgb> &palette) {
+    auto table = std::make_shared<PaletteTable>();
+    quint32 capacity = 16;
+    while (capacity < quint32(palette.size()) * 2)
+        capacity *= 2;
+    table->from.resize(capacity);
+    table->to.resize(capacity);
+    table->used.resize(capacity, false);
+    table->mask = capacity - 1;
+    for (auto color = palette.constBegin(); color != palette.constEnd(); ++color) {
+        quint32 slot = paletteSlot(color.key(), table->mask);
+        while (table->used[slot])
+            slot = (slot + 1) & table->mask;
+        table->used[slot] = true;
+        table->from[slot] = color.key();
+        table->to[slot] = color.value();
+    }
+
+    Stage stage;
+    stage.kind = StageKind::RemapPalette;
+    stage.palette = table;
+    stages.push_back(stage);
+    names.append(palette.size() == 1 ? "Replace Color" : "Remap Palette");
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::outline(QRgb color) {
+    Stage stage;
+    stage.kind = StageKind::Outline;
+    stage.color = color;
+    stages.push_back(stage);
+    names.append("Outline");
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::dropShadow(int offsetX, int offsetY, QRgb color) {
+    Stage stage;
+    stage.kind = StageKind::DropShadow;
+    stage.offsetX = offsetX;
+    stage.offsetY = offsetY;
+    stage.color = color;
+    stages.push_back(stage);
+    names.append("Drop Shadow");
+    return *this;
+}
+
+void FilterPipeline::addColorMatrix(const float (&matrix)[12], const QString &name) {
+    names.append(name);
+    if (stages.empty() || stages.back().kind != StageKind::ColorMatrix) {
+        Stage stage;
+        stage.kind = StageKind::ColorMatrix;
+        std::copy(matrix, matrix + 12, stage.matrix);
+        stages.push_back(stage);
+        return;
+    }
+
+    // running the last matrix and then this one is the same as running their product
+    const float *first = stages.back().matrix;
+    float product[12];
+    for (int row = 0; row < 3; row++)
+        for (int column = 0; column < 4; column++) {
+            float sum = column == 3 ? matrix[row * 4 + 3] : 0.0f;
+            for (int k = 0; k < 3; k++)
+                sum += matrix[row * 4 + k] * first[k * 4 + column];
+            product[row * 4 + column] = sum;
+        }
+    std::copy(product, product + 12, stages.back().matrix);
+}
+
+Frame FilterPipeline::apply(const Frame &frame) const {
+    const int width = frame.getWidth();
+    const int height = frame.getHeight();
+    if (isEmpty() || width <= 0 || height <= 0)
+        return frame;
+
+    Frame::Buffer pixels(width * height);
+    run(frame.constPixels(), pixels.data(), width, height);
+    return Frame(width, height, std::move(pixels));
+}
+
+QImage FilterPipeline::apply(const QImage &image) const {
+    if (isEmpty() || image.isNull())
+        return image;
+
+    // ARGB32 rows are whole pixels with no padding, so the images can be walked as one buffer
+    QImage source = image.convertToFormat(QImage::Format_ARGB32);
+    QImage result(source.size(), QImage::Format_ARGB32);
+    run(reinterpret_cast<const QRgb*>(source.constBits()), reinterpret_cast<QRgb*>(result.bits()),
+        source.width(), source.height());
+    return result;
+}
+
+QString FilterPipeline::name() const {
+    return names.size() == 1 ? names.first() : QString("Filters");
+}
+
+void FilterPipeline::run(const QRgb *source, QRgb *destination, int width, int height) const {
+    // a pass is a stage that reads neighbouring pixels, or the start of the pipeline, followed by every stage
+    // up to the next one that does. a pass reads the whole output of the pass before it, so passes alternate
+    // between two scratch buffers and the last one writes to the destination
+    std::vector<size_t> passStarts;
+    for (size_t i = 0; i < stages.size(); i++)
+        if (i == 0 || stages[i].readsNeighbours())
+            passStarts.push_back(i);
+
+    std::vector<QRgb> scratch[2];
+    std::vector<QRgb> transparentRow(width, qRgba(0, 0, 0, 0));
+    const QRgb *input = source;
+
+    for (size_t pass = 0; pass < passStarts.size(); pass++) {
+        const bool lastPass = pass + 1 == passStarts.size();
+        QRgb *output = destination;
+        if (!lastPass) {
+            scratch[pass % 2].resize(width * height);
+            output = scratch[pass % 2].data();
+        }
+        const size_t first = passStarts[pass];
+        const size_t end = lastPass ? stages.size() : passStarts[pass + 1];
+
+        for (int y = 0; y < height; y++) {
+            const QRgb *inputRow = input + y * width;
+            QRgb *outputRow = output + y * width;
+
+            size_t i = first;
+            const Stage &leading = stages[i];
+            if (leading.kind == StageKind::Outline) {
+                const QRgb *above = y > 0 ? inputRow - width : transparentRow.data();
+                const QRgb *below = y + 1 < height ? inputRow + width : transparentRow.data();
+                outlineRow(above, inputRow, below, outputRow, width, leading.color);
+                i++;
+            } else if (leading.kind == StageKind::DropShadow) {
+                const int casterY = y - leading.offsetY;
+                const QRgb *caster = 0 <= casterY && casterY < height ? input + casterY * width : nullptr;
+                dropShadowRow(inputRow, caster, outputRow, width, leading.offsetX, leading.color);
+                i++;
+            } else {
+                std::memcpy(outputRow, inputRow, width * sizeof(QRgb));
+            }
+
+            // the rest of the pass only looks at one pixel at a time, so it runs on the row while it is cached
+            for (; i < end; i++) {
+                const Stage &stage = stages[i];
+                if (stage.kind == StageKind::ColorMatrix) {
+                    colorMatrixRow(outputRow, width, stage.matrix);
+                } else if (stage.kind == StageKind::RemapPalette) {
+                    const PaletteTable &table = *stage.palette;
+                    QRgb lastColor = 0;
+                    QRgb lastMapped = 0;
+                    bool hasLast = false;
+                    for (int x = 0; x < width; x++) {
+                        // sprites are drawn in runs of the same color, so the last lookup is usually the answer
+                        QRgb color = outputRow[x];
+                        if (!hasLast || color != lastColor) {
+                            lastColor = color;
+                            lastMapped = color;
+                            hasLast = true;
+                            for (quint32 slot = paletteSlot(color, table.mask); table.used[slot]; slot = (slot + 1) & table.mask)
+                                if (table.from[slot] == color) {
+                                    lastMapped = table.to[slot];
+                                    break;
+                                }
+                        }
+                        outputRow[x] = lastMapped;
+                    }
+                }
+            }
+        }
+        input = output;
+    }
+}
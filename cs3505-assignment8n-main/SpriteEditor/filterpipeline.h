@@ -0,0 +1,101 @@
+#ifndef FILTERPIPELINE_H
+#define FILTERPIPELINE_H
+
+#include "frame.h"
+#include <QHash>
+#include <QImage>
+#include <QStringList>
+#include <memory>
+#include <vector>
+/*
+ * a filter pipeline is a list of pixel filters, like a hue shift or an outline, that run one after another
+ * over a frame. the filters are not run one whole frame at a time: each row goes through every filter while
+ * it is still in the cache, and color adjustments that follow each other are folded into a single color
+ * matrix as they are added. the outline and drop shadow look at neighbouring pixels, so each of them starts
+ * a new pass over the frame. the color matrix, outline and drop shadow use SSE2, or AVX2 when the program is
+ * built for it, with a plain loop for other processors and for the pixels left over at the end of a row.
+ * a pipeline is read only once built, so any thread can apply it.
+ */
+class FilterPipeline
+{
+public:
+    /// @brief adds a hue, saturation and value adjustment. the hue turns about the grey axis, keeping the
+    /// brightness of each color close to the same
+    /// @param hueDegrees how far to turn the hue, from -180 to 180
+    /// @param saturation how much to scale the saturation by, 0 makes the colors grey
+    /// @param value how much to scale the brightness by
+    FilterPipeline& adjustHsv(int hueDegrees, double saturation, double value);
+
+    /// @brief adds a brightness and contrast adjustment
+    /// @param brightness how much to add to every channel, from -255 to 255
+    /// @param contrast how much to scale the channels away from middle grey by, 1 leaves them as they are
+    FilterPipeline& adjustBrightnessContrast(int brightness, double contrast);
+
+    /// @brief adds a filter that swaps each color in a palette for the color it maps to, other colors are kept
+    FilterPipeline& remapPalette(const QHash<QRgb, QRgb> &palette);
+
+    /// @brief adds a filter that draws a one pixel outline in the transparent pixels next to drawn ones
+    FilterPipeline& outline(QRgb color);
+
+    /// @brief adds a filter that draws a hard shadow of the sprite in the transparent pixels behind it
+    /// @param offsetX how far right of the sprite the shadow falls
+    /// @param offsetY how far below the sprite the shadow falls
+    /// @param color the color of the shadow
+    FilterPipeline& dropShadow(int offsetX, int offsetY, QRgb color);
+
+    bool isEmpty() const { return stages.empty(); }
+
+    /// @brief runs every filter over a frame
+    /// @param frame the frame to filter, it is left as it is
+    /// @return the filtered frame
+    Frame apply(const Frame &frame) const;
+
+    /// @brief runs every filter over an image, used to preview the filters without changing the sprite
+    /// @param image the image to filter, it is converted to ARGB32 if needed
+    /// @return the filtered image
+    QImage apply(const QImage &image) const;
+
+    /// @brief gets a short name for the filters, used to label them in the undo history
+    QString name() const;
+private:
+    /// What a stage of the pipeline does
+    enum class StageKind {
+        ColorMatrix,   // each color becomes a matrix times the color, fully transparent pixels are kept
+        RemapPalette,  // each listed color is swapped for another
+        Outline,       // transparent pixels next to drawn ones are colored
+        DropShadow     // transparent pixels an offset away from drawn ones are colored
+    };
+
+    /// A palette as an open addressed hash table, so looking a color up is a multiply and a probe or two
+    struct PaletteTable {
+        std::vector<QRgb> from;
+        std::vector<QRgb> to;
+        std::vector<char> used;
+        quint32 mask = 0;
+    };
+
+    /// One filter, or several color adjustments folded into one
+    struct Stage {
+        StageKind kind = StageKind::ColorMatrix;
+        float matrix[12] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0}; // for ColorMatrix, rows of red, green, blue
+        std::shared_ptr<const PaletteTable> palette;           // for RemapPalette
+        QRgb color = 0;                                         // for Outline and DropShadow
+        int offsetX = 0;                                        // for DropShadow
+        int offsetY = 0;                                        // for DropShadow
+
+        /// @brief tells if the stage reads pixels other than the one it writes, so it needs its own pass
+        bool readsNeighbours() const { return kind == StageKind::Outline || kind == StageKind::DropShadow; }
+    };
+
+    std::vector<Stage> stages;
+    QStringList names; // the name of every filter added, in order
+
+    /// @brief adds a color matrix, folding it into the last stage when that is a color matrix too
+    /// @param matrix three rows of red, green, blue and a constant, in 0 to 255 units
+    void addColorMatrix(const float (&matrix)[12], const QString &name);
+
+    /// @brief runs every stage from one pixel buffer into another of the same size
+    void run(const QRgb *source, QRgb *destination, int width, int height) const;
+};
+
+#endif // FILTERPIPELINE_H
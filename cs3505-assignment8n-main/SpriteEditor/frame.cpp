@@ -2,71 +2,224 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
-/// @reviewed by noah
-Frame::Frame(int width, int height) : width(width), height(height) {
-    pixels = new QColor*[height];
-    for (int row = 0; row < height; row++) {
-        pixels[row] = new QColor[width];
-        for (int col = 0; col < width; col++)
-            pixels[row][col] = Qt::GlobalColor::transparent;
-    }
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// mixes a pixel with its position into 64 well spread bits (the splitmix64 finalizer). The frame hash is the
+/// sum of these, so one pixel changing only needs its old term taken out and its new term added in
+quint64 pixelHash(int index, quint32 pixel) {
+    quint64 mixed = ((quint64(index) << 32) | pixel) + 0x9E3779B97F4A7C15ULL;
+    mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBULL;
+    return mixed ^ (mixed >> 31);
 }
 
-Frame::Frame(const Frame& other) : width(other.width), height(other.height) {
-    pixels = new QColor*[height];
-    for (int row = 0; row < height; ++row) {
-        pixels[row] = new QColor[width];
-        for (int col = 0; col < width; ++col)
-            pixels[row][col] = other.pixels[row][col];
-    }
+/// hands out frame revisions, frames are made on worker threads too so it is atomic
+std::atomic<quint64> lastRevision{0};
+
 }
 
-Frame::~Frame() {
-    for (int row = 0; row < height; ++row)
-        delete[] pixels[row];
-    delete[] pixels;
+/// @reviewed by noah
+template<typename Format>
+BasicFrame<Format>::BasicFrame(int width, int height) : width(width), height(height) {
+    pixels = makeBuffer(width * height, Format::kTransparent);
+    rehash();
+}
+
+template<typename Format>
+BasicFrame<Format>::BasicFrame(const BasicFrame& other)
+    : pixels(other.pixels), width(other.width), height(other.height), contentHash(other.contentHash), revision(other.revision) {}
+
+template<typename Format>
+BasicFrame<Format>::BasicFrame(BasicFrame&& other) noexcept
+    : pixels(std::move(other.pixels)), width(other.width), height(other.height), contentHash(other.contentHash),
+      revision(other.revision) {
+    other.width = 0;
+    other.height = 0;
+    other.contentHash = 0;
 }
 
-Frame& Frame::operator=(Frame other) {
-    // deallocatePixels();
+template<typename Format>
+BasicFrame<Format>::~BasicFrame() {}
 
+template<typename Format>
+BasicFrame<Format>& BasicFrame<Format>::operator=(BasicFrame other) {
     std::swap(width, other.width);
     std::swap(height, other.height);
-    for (int row = 0; row < height; ++row) {
-        pixels[row] = new QColor[width];
-        for (int col = 0; col < width; ++col)
-            std::swap(pixels[row][col], other.pixels[row][col]);
-    }
+    std::swap(pixels, other.pixels);
+    std::swap(contentHash, other.contentHash);
+    std::swap(revision, other.revision);
 
     return *this;
 }
 
-QColor Frame::getPixelColor(int x, int y) const {
+template<typename Format>
+typename BasicFrame<Format>::Pixel BasicFrame<Format>::getPixel(int x, int y) const {
     if ((0 <= x && x < width) && (0 <= y && y < height))
-        return pixels[y][x];
+        return (*pixels)[y * width + x];
     throw std::out_of_range("Index is out of range");
 }
 
-void Frame::setPixelColor(int x, int y, QColor color) {
+template<typename Format>
+void BasicFrame<Format>::setPixel(int x, int y, Pixel value) {
     if ((x < 0 || width <= x) || (y < 0 || height <= y))
         throw std::out_of_range("Index is out of range");
-    pixels[y][x] = color;
+    detach();
+    Pixel& pixel = (*pixels)[y * width + x];
+    contentHash += pixelHash(y * width + x, value) - pixelHash(y * width + x, pixel);
+    pixel = value;
+    revision = ++lastRevision;
 }
 
-QString Frame::toJson() const {
-    QColor *color;
+template<typename Format>
+void BasicFrame<Format>::fillSpan(int y, int firstX, int lastX, Pixel value) {
+    if (firstX > lastX)
+        return;
+    Q_ASSERT(0 <= y && y < height && 0 <= firstX && lastX < width);
+    detach();
+    // a run is usually much shorter than its row, so only its own pixels are rehashed
+    Pixel* row = pixels->data() + y * width;
+    for (int x = firstX; x <= lastX; x++) {
+        contentHash += pixelHash(y * width + x, value) - pixelHash(y * width + x, row[x]);
+        row[x] = value;
+    }
+    takeRevision();
+}
 
+template<typename Format>
+void BasicFrame<Format>::copySpan(int y, int firstX, const Pixel* source, int count) {
+    if (count <= 0)
+        return;
+    Q_ASSERT(0 <= y && y < height && 0 <= firstX && firstX + count <= width);
+    detach();
+    Pixel* row = pixels->data() + y * width + firstX;
+    for (int index = 0; index < count; index++) {
+        contentHash += pixelHash(y * width + firstX + index, source[index]) - pixelHash(y * width + firstX + index, row[index]);
+        row[index] = source[index];
+    }
+    takeRevision();
+}
+
+template<typename Format>
+void BasicFrame<Format>::blit(const BasicFrame& source, const QRect& sourceArea, QPoint position) {
+    // clip the area to the source, then to where it lands on this frame, moving the landing spot along with it
+    QRect area = sourceArea.intersected(QRect(0, 0, source.width, source.height));
+    QPoint offset = position - sourceArea.topLeft();
+    area = area.intersected(QRect(0, 0, width, height).translated(-offset));
+    if (area.isEmpty())
+        return;
+    // holding on to the source pixels makes a frame blitting onto itself detach, so it reads from the old copy
+    // and the areas may even overlap
+    std::shared_ptr<const Buffer> sourcePixels = source.pixels;
+    editRows(area.top() + offset.y(), area.bottom() + offset.y(), [&](int y, PixelSpan<Pixel> row) {
+        const Pixel* sourceRow = sourcePixels->data() + (y - offset.y()) * source.width;
+        std::copy(sourceRow + area.left(), sourceRow + area.right() + 1, row.begin() + area.left() + offset.x());
+    });
+}
+
+template<>
+QColor Frame::getPixelColor(int x, int y) const {
+    return QColor::fromRgba(getPixel(x, y));
+}
+
+template<>
+void Frame::setPixelColor(int x, int y, QColor color) {
+    setPixel(x, y, color.rgba());
+}
+
+template<typename Format>
+void BasicFrame<Format>::rehash() {
+    revision = newRevision();
+    contentHash = 0;
+    for (int index = 0; index < width * height; index++)
+        contentHash += pixelHash(index, (*pixels)[index]);
+}
+
+template<typename Format>
+quint64 BasicFrame<Format>::rowHash(int y) const {
+    quint64 hash = 0;
+    const Pixel* row = pixels->data() + y * width;
+    for (int x = 0; x < width; x++)
+        hash += pixelHash(y * width + x, row[x]);
+    return hash;
+}
+
+template<typename Format>
+void BasicFrame<Format>::takeRevision() {
+    revision = newRevision();
+}
+
+template<typename Format>
+quint64 BasicFrame<Format>::newRevision() {
+    return ++lastRevision;
+}
+
+template<typename Format>
+void BasicFrame<Format>::detach() {
+    // another frame is still reading these pixels, so take a private copy before writing
+    if (pixels.use_count() > 1)
+        pixels = makeBuffer(*pixels);
+}
+
+template<typename Format>
+bool BasicFrame<Format>::hasSamePixels(const BasicFrame& other) const {
+    if (width != other.width || height != other.height || contentHash != other.contentHash)
+        return false;
+    return pixels == other.pixels || *pixels == *other.pixels;
+}
+
+template<typename Format>
+QRect BasicFrame<Format>::changedArea(const BasicFrame& other) const {
+    if (width != other.width || height != other.height)
+        return QRect(0, 0, std::max(width, other.width), std::max(height, other.height));
+    if (pixels == other.pixels || revision == other.revision)
+        return QRect();
+    int top = -1;
+    int bottom = -1;
+    int left = width;
+    int right = -1;
+    for (int y = 0; y < height; y++) {
+        PixelSpan<const Pixel> mine = row(y);
+        PixelSpan<const Pixel> theirs = other.row(y);
+        if (std::equal(mine.begin(), mine.end(), theirs.begin()))
+            continue;
+        if (top < 0)
+            top = y;
+        bottom = y;
+        // only the ends of the row that are not already inside the rectangle need looking at
+        int first = 0;
+        while (first < left && mine[first] == theirs[first])
+            first++;
+        int last = width - 1;
+        while (last > right && mine[last] == theirs[last])
+            last--;
+        left = std::min(left, first);
+        right = std::max(right, last);
+    }
+    return top < 0 ? QRect() : QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+template<typename Format>
+void BasicFrame<Format>::sharePixelsWith(const BasicFrame& other) {
+    if (hasSamePixels(other))
+        pixels = other.pixels;
+}
+
+template<>
+QString Frame::toJson() const {
     QJsonArray rows;
-    for (int row = 0; row < height; ++row) {
+    for (int y = 0; y < height; ++y) {
         QJsonArray cols;
-        for (int col = 0; col < width; ++col) {
-            color = &pixels[row][col];
+        for (QRgb color : row(y)) {
             // Convert each pixel's color to an RGB string or object
             QJsonObject colorObj;
-            colorObj["r"] = color->red();
-            colorObj["g"] = color->green();
-            colorObj["b"] = color->blue();
-            colorObj["a"] = color->alpha();
+            colorObj["r"] = qRed(color);
+            colorObj["g"] = qGreen(color);
+            colorObj["b"] = qBlue(color);
+            colorObj["a"] = qAlpha(color);
             cols.append(colorObj);
         }
         rows.append(cols);
@@ -79,29 +232,48 @@ QString Frame::toJson() const {
     return doc.toJson(QJsonDocument::Compact);
 }
 
-Frame::Frame(int width, int height, QJsonObject& frameObj) : width(width), height(height) {
+template<>
+Frame::BasicFrame(int width, int height, QJsonObject& frameObj) : width(width), height(height) {
     QJsonArray pixelsArray = frameObj["pixels"].toArray();
 
-    pixels = new QColor*[height];
+    pixels = makeBuffer(width * height);
     for (int row = 0; row < height; row++) {
-        pixels[row] = new QColor[width];
         QJsonArray rowObj = pixelsArray[row].toArray();
         for (int col = 0; col < width; col++) {
             QJsonObject colorObj = rowObj[col].toObject();
-            QColor color(colorObj["r"].toInt(), colorObj["g"].toInt(), colorObj["b"].toInt(), colorObj["a"].toInt());
-            pixels[row][col] = color;
+            (*pixels)[row * width + col] = qRgba(colorObj["r"].toInt(), colorObj["g"].toInt(), colorObj["b"].toInt(), colorObj["a"].toInt());
         }
     }
+    rehash();
 }
 
-QImage Frame::toImage() {
+template<>
+Frame::BasicFrame(const QImage& image) : width(image.width()), height(image.height()) {
+    QImage argbImage = image.convertToFormat(QImage::Format_ARGB32);
+
+    pixels = makeBuffer(width * height);
+    for (int row = 0; row < height; row++)
+        std::memcpy(pixels->data() + row * width, argbImage.constScanLine(row), width * sizeof(QRgb));
+    rehash();
+}
+
+template<typename Format>
+BasicFrame<Format>::BasicFrame(int width, int height, Buffer pixelData) : width(width), height(height) {
+    pixelData.resize(width * height);
+    pixels = makeBuffer(std::move(pixelData));
+    rehash();
+}
+
+template<>
+QImage Frame::toImage() const {
     QImage image(width, height, QImage::Format_ARGB32);
 
     for (int y = 0; y < height; y++)
-        for (int x = 0; x < width; x++) {
-            QColor color = getPixelColor(x, y);
-            image.setPixelColor(x, y, color);
-        }
+        std::memcpy(image.scanLine(y), row(y).data(), width * sizeof(QRgb));
 
     return image;
 }
+
+// the methods every format shares are built here once for each format, the full color ones are above
+template class BasicFrame<Rgba32Format>;
+template class BasicFrame<Indexed8Format>;
@@ -5,27 +5,131 @@
 #include <QColor>
 #include <QImage>
 #include <QJsonObject>
+#include <QPoint>
+#include <QRect>
+#include "pixelformat.h"
+#include "bufferpool.h"
+#include <memory>
+#include <vector>
+
+/// A view of a run of pixels inside a frame, standing in for C++20's std::span. It is only a pointer and a
+/// length, so it is passed by value, and indexing it is only checked in debug builds.
+template<typename Pixel>
+class PixelSpan {
+public:
+    PixelSpan(Pixel* first, int count) : first(first), count(count) {}
+
+    Pixel* data() const { return first; }
+    int size() const { return count; }
+    Pixel* begin() const { return first; }
+    Pixel* end() const { return first + count; }
+
+    Pixel& operator[](int index) const {
+        Q_ASSERT(0 <= index && index < count);
+        return first[index];
+    }
+
+    /// @brief Gets part of the run, starting offset pixels in and length pixels long.
+    PixelSpan subspan(int offset, int length) const {
+        Q_ASSERT(0 <= offset && 0 <= length && offset + length <= count);
+        return PixelSpan(first + offset, length);
+    }
+private:
+    Pixel* first;
+    int count;
+};
 
 /*
  * Frame class represents a single frame in a sprite, managing pixel data and providing
  * functionalities for pixel manipulation and JSON serialization.
+ * The pixel format is a template parameter: Frame holds full ARGB colors and IndexedFrame holds 8 bit
+ * palette indices. The color, JSON and QImage methods are only there for full color frames, an indexed
+ * frame goes through its sprite's Palette for those.
+ * The pixel methods check their coordinates and throw for callers outside the frame code. Loops over many
+ * pixels go through the row spans and the span and blit methods instead, which are checked once per run and
+ * only in debug builds.
  * @authors: Noah Campbell, Will Black, Tanner Bergstrom, Tj Hess and Kevin Christiansen
  * version 3/31/2024
  * @ reviewed by Noah Campbell
  */
 
-class Frame {
+template<typename Format>
+class BasicFrame {
 public:
+    using Pixel = typename Format::Pixel;
+
+    /// Row major pixels, kept in memory from the buffer pool so making and dropping frames reuses it
+    using Buffer = std::vector<Pixel, PoolAllocator<Pixel>>;
+
     // Constructors and destructors
-    Frame(int width, int height);
-    Frame(const Frame& other);
-    ~Frame();
-    Frame& operator=(Frame other);
+    BasicFrame(int width, int height);
+    BasicFrame(const BasicFrame& other);
+
+    /// @brief Takes over another frame's pixels without touching them. The other frame is left empty,
+    /// zero by zero, and may only be assigned to or destroyed.
+    BasicFrame(BasicFrame&& other) noexcept;
+    ~BasicFrame();
+    BasicFrame& operator=(BasicFrame other);
 
     /// @brief Serializes the frame data to JSON format.
     /// @return A QString containing the JSON representation of the frame.
     QString toJson() const;
-    Frame(int width, int height, QJsonObject& frameObj);
+    BasicFrame(int width, int height, QJsonObject& frameObj);
+
+    /// @brief Builds a frame straight from the pixels of an image.
+    /// @param image The image to copy, it is converted to ARGB32 if needed.
+    BasicFrame(const QImage& image);
+
+    /// @brief Builds a frame that takes over an already filled pixel buffer.
+    /// @param pixelData Row major pixels, width * height of them.
+    BasicFrame(int width, int height, Buffer pixelData);
+
+    /// @brief Gets a pixel in the frame's own format.
+    /// @param pixelX The x-coordinate of the pixel.
+    /// @param pixelY The y-coordinate of the pixel.
+    Pixel getPixel(int pixelX, int pixelY) const;
+
+    /// @brief Sets a pixel in the frame's own format.
+    /// @param pixelX The x-coordinate of the pixel to be set.
+    /// @param pixelY The y-coordinate of the pixel to be set.
+    /// @param pixel The value to set the pixel to.
+    void setPixel(int pixelX, int pixelY, Pixel pixel);
+
+    /// @brief Gets one row of pixels to read. The row is only checked in debug builds.
+    /// @param pixelY The row to get, it must be on the frame.
+    PixelSpan<const Pixel> row(int pixelY) const {
+        Q_ASSERT(0 <= pixelY && pixelY < height);
+        return PixelSpan<const Pixel>(pixels->data() + pixelY * width, width);
+    }
+
+    /// @brief Edits rows of pixels in place. The pixels are detached once, and the content hash is updated
+    /// for each row as a whole after it is edited. The rows are only checked in debug builds.
+    /// @param firstY The first row to edit.
+    /// @param lastY The last row to edit, inclusive.
+    /// @param edit Called with each row's y-coordinate and a span of its pixels to change.
+    template<typename Edit>
+    void editRows(int firstY, int lastY, Edit edit);
+
+    /// @brief Sets a run of pixels on one row to the same value. The run is only checked in debug builds.
+    /// @param pixelY The row of the run.
+    /// @param firstX The x-coordinate of the first pixel of the run.
+    /// @param lastX The x-coordinate of the last pixel of the run, inclusive.
+    /// @param pixel The value to set the pixels to.
+    void fillSpan(int pixelY, int firstX, int lastX, Pixel pixel);
+
+    /// @brief Copies a run of pixels onto one row. The run is only checked in debug builds.
+    /// @param pixelY The row of the run.
+    /// @param firstX The x-coordinate of the first pixel to write.
+    /// @param source The pixels to copy, which must not be this frame's own.
+    /// @param count How many pixels to copy.
+    void copySpan(int pixelY, int firstX, const Pixel* source, int count);
+
+    /// @brief Copies a rectangle of another frame onto this one. The rectangle is clipped to both frames
+    /// once, and then copied a row at a time.
+    /// @param source The frame to copy from, it may be this frame.
+    /// @param sourceArea The part of the source to copy.
+    /// @param position Where the top left corner of the area lands on this frame.
+    void blit(const BasicFrame& source, const QRect& sourceArea, QPoint position);
 
     /// @brief Gets the color of a specific pixel.
     /// @param pixelX The x-coordinate of the pixel.
@@ -45,13 +149,100 @@ public:
     /// @brief toImage Use this method to turn a frame into a QImage.
     /// This QImage can be sent to the view for it to be displayed.
     /// @return QImage that represents the frame pixels
-    QImage toImage();
+    QImage toImage() const;
     ///@brief duplicates frame
-    Frame duplicateFrame();
+    BasicFrame duplicateFrame();
+
+    /// @brief Checks if this frame holds exactly the same pixels as another frame.
+    /// @param other The frame to compare with.
+    /// @return True if the sizes and every pixel match.
+    bool hasSamePixels(const BasicFrame& other) const;
+
+    /// @brief Finds the smallest rectangle holding every pixel that differs from another frame of the same size.
+    /// @param other The frame to compare with.
+    /// @return The rectangle, empty if the pixels all match, or the whole of the larger frame if the sizes differ.
+    QRect changedArea(const BasicFrame& other) const;
+
+    /// @brief Makes this frame use the pixel buffer of another frame with identical pixels,
+    /// so duplicate frames only take up memory once. Either frame copies the buffer when edited.
+    /// @param other The frame to share pixels with.
+    void sharePixelsWith(const BasicFrame& other);
+
+    /// @brief Checks if this frame and another frame are using the same pixel buffer.
+    bool sharesPixelsWith(const BasicFrame& other) const { return pixels == other.pixels; }
+
+    /// @brief Gets a hash of the frame's pixels. Frames with different hashes never match, frames with
+    /// the same hash almost always do. It is kept up to date on every edit, so reading it is free.
+    quint64 getContentHash() const { return contentHash; }
+
+    /// @brief Gets a stamp for this version of the frame's pixels. Every new frame and every edit gets a new
+    /// stamp, and copies keep it, so a frame whose revision is unchanged is certain to have the same pixels.
+    quint64 getRevision() const { return revision; }
+
+    /// @brief Gives the frame a new revision without touching its pixels, for when what they stand for changes,
+    /// like indices whose palette entry was recolored.
+    void takeRevision();
+
+    /// @brief Hands out a revision no frame has, for things that stand in for frames that are not made yet.
+    static quint64 newRevision();
+
+    /// @brief Gets read only access to the row major pixels, for code that walks the whole frame.
+    const Pixel* constPixels() const { return pixels->data(); }
 private:
-    QColor** pixels; // 2D array for storing pixel colors
+    std::shared_ptr<Buffer> pixels; // Row major pixels, shared by copies until one is edited
     int width;       // Width of the frame
     int height;      // Height of the frame
+    quint64 contentHash = 0; // Sum of the hashes of every pixel and its position
+    quint64 revision = 0;    // Stamp of the current pixels, unique across every frame ever made
+
+    /// @brief Recomputes the content hash from every pixel and takes a new revision, used after the pixels are
+    /// replaced wholesale.
+    void rehash();
+
+    /// @brief Gives this frame its own copy of the pixels before they are changed.
+    void detach();
+
+    /// @brief Makes a pixel buffer, the buffer and the count shared_ptr keeps of it both from the pool.
+    template<typename... Args>
+    static std::shared_ptr<Buffer> makeBuffer(Args&&... args) {
+        return std::allocate_shared<Buffer>(PoolAllocator<Buffer>(), std::forward<Args>(args)...);
+    }
+
+    /// @brief Sums the hashes of the pixels on one row, the part of the content hash that row adds.
+    quint64 rowHash(int pixelY) const;
 };
 
+template<typename Format>
+template<typename Edit>
+void BasicFrame<Format>::editRows(int firstY, int lastY, Edit edit) {
+    Q_ASSERT(0 <= firstY && lastY < height);
+    if (firstY > lastY)
+        return;
+    detach();
+    for (int y = firstY; y <= lastY; y++) {
+        contentHash -= rowHash(y);
+        edit(y, PixelSpan<Pixel>(pixels->data() + y * width, width));
+        contentHash += rowHash(y);
+    }
+    takeRevision();
+}
+
+// the full color only methods, defined for Frame alone
+template<> QString BasicFrame<Rgba32Format>::toJson() const;
+template<> BasicFrame<Rgba32Format>::BasicFrame(int width, int height, QJsonObject& frameObj);
+template<> BasicFrame<Rgba32Format>::BasicFrame(const QImage& image);
+template<> QColor BasicFrame<Rgba32Format>::getPixelColor(int pixelX, int pixelY) const;
+template<> void BasicFrame<Rgba32Format>::setPixelColor(int pixelX, int pixelY, QColor color);
+template<> QImage BasicFrame<Rgba32Format>::toImage() const;
+
+// both formats are built once in frame.cpp
+extern template class BasicFrame<Rgba32Format>;
+extern template class BasicFrame<Indexed8Format>;
+
+/// A frame of full ARGB colors, the format the tools draw in
+using Frame = BasicFrame<Rgba32Format>;
+
+/// A frame of 8 bit indices into its sprite's palette, a quarter of the size of a full color frame
+using IndexedFrame = BasicFrame<Indexed8Format>;
+
 #endif // FRAME_H
@@ -0,0 +1,168 @@
+#include "framebounds.h"
+#include <QJsonArray>
+#include <QtAlgorithms>
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRAME_BOUNDS_SSE2
+#endif
+
+namespace {
+
+/// @brief counts the pixels of a run that are not fully transparent and finds the first and last of them
+/// @param first set to the first one's offset if it is still -1
+/// @param last set to the last one's offset
+/// @return how many there are, first and last are left as they were if there are none
+int scanRun(const QRgb *pixels, int count, int &first, int &last) {
+    int covered = 0;
+    int x = 0;
+#if defined(__AVX2__)
+    const __m256i zero = _mm256_setzero_si256();
+    for (; x + 8 <= count; x += 8) {
+        __m256i alpha = _mm256_srli_epi32(_mm256_loadu_si256((const __m256i*)(pixels + x)), 24);
+        // one bit for each pixel, set where its alpha is not zero
+        quint32 opaque = ~quint32(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(alpha, zero)))) & 0xff;
+        if (opaque == 0)
+            continue;
+        covered += qPopulationCount(opaque);
+        if (first < 0)
+            first = x + qCountTrailingZeroBits(opaque);
+        last = x + 31 - qCountLeadingZeroBits(opaque);
+    }
+#elif defined(FRAME_BOUNDS_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 4 <= count; x += 4) {
+        __m128i alpha = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(pixels + x)), 24);
+        quint32 opaque = ~quint32(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(alpha, zero)))) & 0xf;
+        if (opaque == 0)
+            continue;
+        covered += qPopulationCount(opaque);
+        if (first < 0)
+            first = x + qCountTrailingZeroBits(opaque);
+        last = x + 31 - qCountLeadingZeroBits(opaque);
+    }
+#endif
+    for (; x < count; x++) {
+        if (qAlpha(pixels[x]) == 0)
+            continue;
+        covered++;
+        if (first < 0)
+            first = x;
+        last = x;
+    }
+    return covered;
+}
+
+QJsonObject rectToJson(const QRect &rect) {
+    QJsonObject object;
+    object["x"] = rect.x();
+    object["y"] = rect.y();
+    object["width"] = rect.width();
+    object["height"] = rect.height();
+    return object;
+}
+
+} // namespace
+
+FrameBounds FrameBounds::measure(const Frame &frame) {
+    return measure(frame, QRect(0, 0, frame.getWidth(), frame.getHeight()));
+}
+
+FrameBounds FrameBounds::measure(const Frame &frame, const QRect &area) {
+    QRect clipped = area & QRect(0, 0, frame.getWidth(), frame.getHeight());
+    FrameBounds bounds;
+    if (clipped.isEmpty())
+        return bounds;
+    int top = -1;
+    int bottom = -1;
+    int left = clipped.width();
+    int right = -1;
+    for (int y = clipped.top(); y <= clipped.bottom(); y++) {
+        int first = -1;
+        int last = -1;
+        int covered = scanRun(frame.row(y).data() + clipped.left(), clipped.width(), first, last);
+        if (covered == 0)
+            continue;
+        bounds.coveredPixels += covered;
+        if (top < 0)
+            top = y;
+        bottom = y;
+        left = std::min(left, first);
+        right = std::max(right, last);
+    }
+    if (top >= 0)
+        bounds.opaque = QRect(QPoint(clipped.left() + left, top), QPoint(clipped.left() + right, bottom));
+    return bounds;
+}
+
+FrameBounds FrameBounds::updated(const Frame &before, const Frame &after, const QRect &area) const {
+    if (before.getWidth() != after.getWidth() || before.getHeight() != after.getHeight())
+        return measure(after);
+    QRect changed = area & QRect(0, 0, after.getWidth(), after.getHeight());
+    if (changed.isEmpty())
+        return *this;
+
+    // pixels outside the edit are as they were, so the edges of the rectangle only move if the edit reached them
+    bool reachesEdge = !opaque.isEmpty() && changed.intersects(opaque) && !opaque.adjusted(1, 1, -1, -1).contains(changed);
+    if (reachesEdge)
+        return measure(after);
+    FrameBounds inside = measure(after, changed);
+    FrameBounds result;
+    result.coveredPixels = coveredPixels - measure(before, changed).coveredPixels + inside.coveredPixels;
+    result.opaque = opaque | inside.opaque;
+    return result;
+}
+
+double FrameBounds::coverage(QSize frameSize) const {
+    qint64 pixels = qint64(frameSize.width()) * frameSize.height();
+    return pixels > 0 ? double(coveredPixels) / pixels : 0;
+}
+
+QRect FrameBounds::unite(const std::vector<FrameBounds> &frames) {
+    QRect box;
+    for (const FrameBounds &bounds : frames)
+        box |= bounds.opaque;
+    return box;
+}
+
+QJsonObject FrameBounds::collisionBoxes(const std::vector<FrameBounds> &frames, QSize frameSize) {
+    QJsonArray boxes;
+    for (const FrameBounds &bounds : frames) {
+        QJsonObject box = rectToJson(bounds.opaque);
+        box["coverage"] = bounds.coverage(frameSize);
+        boxes.append(box);
+    }
+    QJsonObject document;
+    document["width"] = frameSize.width();
+    document["height"] = frameSize.height();
+    document["union"] = rectToJson(unite(frames));
+    document["frames"] = boxes;
+    return document;
+}
+
+std::optional<FrameBounds> FrameBoundsCache::find(quint64 revision) const {
+    if (const FrameBounds *bounds = cache.object(revision))
+        return *bounds;
+    return std::nullopt;
+}
+
+void FrameBoundsCache::insert(quint64 revision, const FrameBounds &bounds) {
+    cache.insert(revision, new FrameBounds(bounds));
+}
+
+FrameBounds FrameBoundsCache::boundsOf(const Frame &frame) {
+    if (std::optional<FrameBounds> bounds = find(frame.getRevision()))
+        return *bounds;
+    FrameBounds bounds = FrameBounds::measure(frame);
+    insert(frame.getRevision(), bounds);
+    return bounds;
+}
+
+void FrameBoundsCache::frameEdited(const Frame &before, const Frame &after, const QRect &area) {
+    if (before.getRevision() == after.getRevision())
+        return;
+    if (std::optional<FrameBounds> bounds = find(before.getRevision()))
+        insert(after.getRevision(), bounds->updated(before, after, area));
+}
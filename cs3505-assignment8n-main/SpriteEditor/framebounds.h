@@ -0,0 +1,82 @@
+#ifndef FRAMEBOUNDS_H
+#define FRAMEBOUNDS_H
+
+#include "frame.h"
+#include <QCache>
+#include <QJsonObject>
+#include <QRect>
+#include <QSize>
+#include <optional>
+#include <vector>
+/*
+ * frame bounds are the part of a frame that is actually drawn on: the smallest rectangle around its pixels
+ * that are not fully transparent, and how many of those pixels there are. they are what auto crop, trimmed
+ * exports and the collision boxes saved next to a sprite are worked out from. each row is scanned several
+ * pixels at a time, and after an edit only the pixels it changed are scanned again unless the edit reached
+ * an edge of the rectangle, where it may have taken away the pixels holding that edge in place.
+ */
+struct FrameBounds
+{
+    QRect opaque;             // the smallest rectangle around every pixel that is not fully transparent, empty if there are none
+    qint64 coveredPixels = 0; // how many pixels are not fully transparent
+
+    /// @brief measures a whole frame. safe to call from any thread
+    static FrameBounds measure(const Frame &frame);
+
+    /// @brief measures only the pixels of a frame inside a rectangle
+    /// @param area the pixels to look at, clipped to the frame
+    static FrameBounds measure(const Frame &frame, const QRect &area);
+
+    /// @brief works out the bounds of a frame after an edit from its bounds before it
+    /// @param before the frame these bounds were measured on
+    /// @param after the frame after the edit
+    /// @param area every pixel the edit changed
+    FrameBounds updated(const Frame &before, const Frame &after, const QRect &area) const;
+
+    /// @brief gets the share of a frame's pixels that are not fully transparent, between 0 and 1
+    /// @param frameSize the size of the frame the bounds were measured on
+    double coverage(QSize frameSize) const;
+
+    /// @brief gets the smallest rectangle holding the opaque rectangle of every frame, empty if every frame is
+    static QRect unite(const std::vector<FrameBounds> &frames);
+
+    /// @brief describes the bounds of every frame of a sprite as JSON, the collision boxes a game reads
+    /// @param frames the bounds of each frame, in order
+    /// @param frameSize the size of the sprite's frames
+    static QJsonObject collisionBoxes(const std::vector<FrameBounds> &frames, QSize frameSize);
+};
+
+/*
+ * the frame bounds cache keeps the bounds of the frames measured lately by their revision. a revision names
+ * one version of a frame's pixels, so the bounds never go stale and follow a frame wherever it is moved or
+ * copied, and undoing an edit brings the bounds of the frame before it back. only the least recently used
+ * are dropped once it is full.
+ */
+class FrameBoundsCache
+{
+public:
+    /// The most frames the cache keeps the bounds of
+    static constexpr int kMaxFrames = 4096;
+
+    /// @brief finds the bounds of a frame if they have been measured
+    /// @param revision the revision of the frame's pixels, so the frame itself does not have to be read
+    std::optional<FrameBounds> find(quint64 revision) const;
+
+    /// @brief keeps the bounds measured for a frame
+    /// @param revision the revision of the frame's pixels
+    void insert(quint64 revision, const FrameBounds &bounds);
+
+    /// @brief gets the bounds of a frame, measuring it if they have not been
+    FrameBounds boundsOf(const Frame &frame);
+
+    /// @brief works out the bounds of an edited frame from the frame before, if those are kept. Otherwise
+    /// they are left to be measured the next time they are asked for
+    /// @param before the frame before the edit
+    /// @param after the frame after it
+    /// @param area every pixel the edit changed
+    void frameEdited(const Frame &before, const Frame &after, const QRect &area);
+private:
+    QCache<quint64, FrameBounds> cache{kMaxFrames};
+};
+
+#endif // FRAMEBOUNDS_H
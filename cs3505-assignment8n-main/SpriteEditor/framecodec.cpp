@@ -0,0 +1,194 @@
+#include "framecodec.h"
+#include <cstring>
+
+namespace {
+
+const char kKeyframe = 'K';
+const char kDeltaFrame = 'D';
+
+void appendVarint(QByteArray &out, quint32 value) {
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const uchar *&cursor, const uchar *end, quint32 &value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && cursor < end; shift += 7) {
+        uchar byte = *cursor++;
+        value |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void appendPixel(QByteArray &out, QRgb pixel) {
+    out.append(char(pixel & 0xFF));
+    out.append(char((pixel >> 8) & 0xFF));
+    out.append(char((pixel >> 16) & 0xFF));
+    out.append(char((pixel >> 24) & 0xFF));
+}
+
+QRgb readPixel(const uchar *bytes) {
+    return QRgb(bytes[0]) | (QRgb(bytes[1]) << 8) | (QRgb(bytes[2]) << 16) | (QRgb(bytes[3]) << 24);
+}
+
+/// writes the pixels as runs and literal stretches. Each starts with a varint holding its length minus one,
+/// shifted up a bit, with the low bit set for a run. A run is followed by one pixel, a literal by all of them
+void appendRunLengthEncoded(QByteArray &out, const std::vector<QRgb> &pixels) {
+    size_t index = 0;
+    while (index < pixels.size()) {
+        size_t run = 1;
+        while (index + run < pixels.size() && pixels[index + run] == pixels[index])
+            run++;
+        if (run >= 3) {
+            appendVarint(out, quint32(((run - 1) << 1) | 1));
+            appendPixel(out, pixels[index]);
+            index += run;
+            continue;
+        }
+
+        // stretch the literal until the next run worth encoding starts
+        size_t start = index;
+        while (index < pixels.size() &&
+               !(index + 2 < pixels.size() && pixels[index] == pixels[index + 1] && pixels[index] == pixels[index + 2]))
+            index++;
+        appendVarint(out, quint32((index - start - 1) << 1));
+        for (size_t literal = start; literal < index; literal++)
+            appendPixel(out, pixels[literal]);
+    }
+}
+
+bool readRunLengthEncoded(const uchar *cursor, const uchar *end, std::vector<QRgb> &pixels) {
+    size_t filled = 0;
+    while (filled < pixels.size()) {
+        quint32 header;
+        if (!readVarint(cursor, end, header))
+            return false;
+        size_t count = size_t(header >> 1) + 1;
+        if (count > pixels.size() - filled)
+            return false;
+
+        if (header & 1) {
+            if (end - cursor < 4)
+                return false;
+            std::fill(pixels.begin() + filled, pixels.begin() + filled + count, readPixel(cursor));
+            cursor += 4;
+        }
+        else {
+            if (size_t(end - cursor) < count * 4)
+                return false;
+            for (size_t literal = 0; literal < count; literal++, cursor += 4)
+                pixels[filled + literal] = readPixel(cursor);
+        }
+        filled += count;
+    }
+    return cursor == end;
+}
+
+}
+
+QByteArray FrameCodec::encode(const Frame &frame, const Frame *previous) {
+    const int width = frame.getWidth();
+    const int height = frame.getHeight();
+    const bool keyframe = !previous || previous->getWidth() != width || previous->getHeight() != height;
+    const int tilesAcross = (width + kTileSize - 1) / kTileSize;
+    const int tilesDown = (height + kTileSize - 1) / kTileSize;
+
+    const QRgb *pixels = frame.constPixels();
+    const QRgb *before = keyframe ? nullptr : previous->constPixels();
+
+    QByteArray tileBitmap((tilesAcross * tilesDown + 7) / 8, 0);
+    std::vector<QRgb> tilePixels;
+    tilePixels.reserve(keyframe ? width * height : 0);
+    for (int tileY = 0; tileY < tilesDown; tileY++) {
+        for (int tileX = 0; tileX < tilesAcross; tileX++) {
+            int left = tileX * kTileSize;
+            int top = tileY * kTileSize;
+            int tileWidth = std::min(kTileSize, width - left);
+            int tileHeight = std::min(kTileSize, height - top);
+
+            bool changed = keyframe;
+            for (int y = top; !changed && y < top + tileHeight; y++)
+                changed = std::memcmp(pixels + y * width + left, before + y * width + left, tileWidth * sizeof(QRgb)) != 0;
+            if (!changed)
+                continue;
+
+            int tile = tileY * tilesAcross + tileX;
+            tileBitmap[tile / 8] = char(tileBitmap[tile / 8] | (1 << (tile % 8)));
+            for (int y = top; y < top + tileHeight; y++)
+                tilePixels.insert(tilePixels.end(), pixels + y * width + left, pixels + y * width + left + tileWidth);
+        }
+    }
+
+    QByteArray encoded;
+    encoded.append(keyframe ? kKeyframe : kDeltaFrame);
+    if (!keyframe)
+        encoded.append(tileBitmap);
+    appendRunLengthEncoded(encoded, tilePixels);
+    return encoded;
+}
+
+Frame FrameCodec::decode(const QByteArray &data, int width, int height, const Frame *previous, bool *ok) {
+    if (ok)
+        *ok = false;
+    if (data.isEmpty() || width <= 0 || height <= 0)
+        return Frame(width, height);
+
+    const bool keyframe = data[0] == kKeyframe;
+    if (!keyframe && (data[0] != kDeltaFrame || !previous || previous->getWidth() != width || previous->getHeight() != height))
+        return Frame(width, height);
+
+    const int tilesAcross = (width + kTileSize - 1) / kTileSize;
+    const int tilesDown = (height + kTileSize - 1) / kTileSize;
+    const uchar *cursor = reinterpret_cast<const uchar*>(data.constData()) + 1;
+    const uchar *end = reinterpret_cast<const uchar*>(data.constData()) + data.size();
+
+    const uchar *tileBitmap = cursor;
+    if (!keyframe) {
+        cursor += (tilesAcross * tilesDown + 7) / 8;
+        if (cursor > end)
+            return Frame(width, height);
+    }
+    auto tileChanged = [&](int tile) { return keyframe || (tileBitmap[tile / 8] >> (tile % 8)) & 1; };
+
+    // work out how many pixels the changed tiles hold so the runs can be unpacked in one go
+    size_t storedPixels = 0;
+    for (int tile = 0; tile < tilesAcross * tilesDown; tile++)
+        if (tileChanged(tile))
+            storedPixels += size_t(std::min(kTileSize, width - (tile % tilesAcross) * kTileSize)) *
+                            std::min(kTileSize, height - (tile / tilesAcross) * kTileSize);
+
+    std::vector<QRgb> tilePixels(storedPixels);
+    if (!readRunLengthEncoded(cursor, end, tilePixels))
+        return Frame(width, height);
+
+    Frame::Buffer pixels;
+    if (keyframe)
+        pixels.resize(width * height);
+    else
+        pixels.assign(previous->constPixels(), previous->constPixels() + width * height);
+
+    const QRgb *source = tilePixels.data();
+    for (int tile = 0; tile < tilesAcross * tilesDown; tile++) {
+        if (!tileChanged(tile))
+            continue;
+        int left = (tile % tilesAcross) * kTileSize;
+        int top = (tile / tilesAcross) * kTileSize;
+        int tileWidth = std::min(kTileSize, width - left);
+        int tileHeight = std::min(kTileSize, height - top);
+        for (int y = top; y < top + tileHeight; y++, source += tileWidth)
+            std::memcpy(pixels.data() + y * width + left, source, tileWidth * sizeof(QRgb));
+    }
+
+    if (ok)
+        *ok = true;
+    return Frame(width, height, std::move(pixels));
+}
+
+bool FrameCodec::isKeyframe(const QByteArray &data) {
+    return !data.isEmpty() && data[0] == kKeyframe;
+}
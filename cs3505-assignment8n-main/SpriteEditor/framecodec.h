@@ -0,0 +1,36 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include "frame.h"
+#include <QByteArray>
+/*
+ * the frame codec packs a frame into a small binary blob for saving. A keyframe stores every pixel,
+ * a delta frame stores a bitmap of the 8x8 tiles that changed since the previous frame plus the pixels
+ * of only those tiles. Either way the stored pixels are run length encoded, which suits pixel art well.
+ */
+class FrameCodec
+{
+public:
+    /// Side length of the tiles a delta frame is split into
+    static constexpr int kTileSize = 8;
+
+    /// @brief encodes a frame
+    /// @param frame the frame to encode
+    /// @param previous the frame shown before it, or nullptr to write a keyframe
+    /// @return the encoded bytes
+    static QByteArray encode(const Frame &frame, const Frame *previous);
+
+    /// @brief decodes a frame written by encode
+    /// @param data the encoded bytes
+    /// @param width the width of the frame
+    /// @param height the height of the frame
+    /// @param previous the same previous frame it was encoded against, ignored for keyframes
+    /// @param ok set to false if the data is damaged or a delta frame has no previous frame
+    /// @return the decoded frame, or a blank frame if it could not be decoded
+    static Frame decode(const QByteArray &data, int width, int height, const Frame *previous, bool *ok = nullptr);
+
+    /// @brief tells if encoded data is a keyframe, which decodes without a previous frame
+    static bool isKeyframe(const QByteArray &data);
+};
+
+#endif // FRAMECODEC_H
@@ -0,0 +1,94 @@
+#include "framehandle.h"
+#include "palette.h"
+#include "spritearchive.h"
+#include <algorithm>
+
+FrameHandle::FrameHandle(const Frame &frame) : frame(frame), revision(frame.getRevision()) {}
+
+FrameHandle::FrameHandle(const IndexedFrame &frame, const QList<QRgb> &colorTable, quint64 key)
+    : indexed(frame), colors(colorTable), revision(key) {}
+
+FrameHandle::FrameHandle(std::shared_ptr<SpriteArchive> archive, int archiveIndex, quint64 key)
+    : archive(std::move(archive)), archiveIndex(archiveIndex), revision(key) {}
+
+QImage FrameHandle::toImage() const {
+    if (frame)
+        return frame->toImage();
+    if (indexed)
+        return Palette::toImage(*indexed, colors);
+    if (archive)
+        return archive->peekFrame(archiveIndex).toImage(); // the archive is locked while the frame is decoded
+    return QImage();
+}
+
+FrameTable::FrameTable(std::vector<FrameHandle> handles) : count(handles.size()) {
+    for (size_t first = 0; first < handles.size(); first += kBlockSize) {
+        auto last = handles.begin() + std::min(first + kBlockSize, handles.size());
+        blocks.push_back(std::make_shared<const Block>(std::make_move_iterator(handles.begin() + first),
+                                                       std::make_move_iterator(last)));
+    }
+    restart();
+}
+
+const FrameHandle& FrameTable::operator[](int index) const {
+    Q_ASSERT(0 <= index && index < count);
+    auto [block, offset] = locate(index);
+    return (*blocks[block])[offset];
+}
+
+void FrameTable::set(int index, FrameHandle handle) {
+    auto [block, offset] = locate(index);
+    auto copy = std::make_shared<Block>(*blocks[block]);
+    (*copy)[offset] = std::move(handle);
+    blocks[block] = std::move(copy);
+}
+
+void FrameTable::insert(int index, FrameHandle handle) {
+    Q_ASSERT(0 <= index && index <= count);
+    if (blocks.empty()) {
+        blocks.push_back(std::make_shared<const Block>(1, std::move(handle)));
+        count = 1;
+        restart();
+        return;
+    }
+    // a handle past the end goes on the end of the last block
+    auto [block, offset] = index == count ? std::make_pair(int(blocks.size()) - 1, index - starts.back()) : locate(index);
+    auto copy = std::make_shared<Block>(*blocks[block]);
+    copy->insert(copy->begin() + offset, std::move(handle));
+    if ((int)copy->size() >= 2 * kBlockSize) {
+        auto back = std::make_shared<const Block>(copy->begin() + kBlockSize, copy->end());
+        copy->resize(kBlockSize);
+        blocks.insert(blocks.begin() + block + 1, std::move(back));
+    }
+    blocks[block] = std::move(copy);
+    count++;
+    restart();
+}
+
+void FrameTable::erase(int index) {
+    Q_ASSERT(0 <= index && index < count);
+    auto [block, offset] = locate(index);
+    if (blocks[block]->size() == 1)
+        blocks.erase(blocks.begin() + block);
+    else {
+        auto copy = std::make_shared<Block>(*blocks[block]);
+        copy->erase(copy->begin() + offset);
+        blocks[block] = std::move(copy);
+    }
+    count--;
+    restart();
+}
+
+std::pair<int, int> FrameTable::locate(int index) const {
+    int block = std::upper_bound(starts.begin(), starts.end(), index) - starts.begin() - 1;
+    return {block, index - starts[block]};
+}
+
+void FrameTable::restart() {
+    starts.resize(blocks.size());
+    int start = 0;
+    for (size_t block = 0; block < blocks.size(); block++) {
+        starts[block] = start;
+        start += blocks[block]->size();
+    }
+}
@@ -0,0 +1,105 @@
+#ifndef FRAMEHANDLE_H
+#define FRAMEHANDLE_H
+
+#include "frame.h"
+#include <QImage>
+#include <QList>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+class SpriteArchive;
+/*
+ * a frame handle stands in for one frame of a snapshot without holding an image of it. it shares whatever the
+ * sprite keeps the frame in, its full color pixels, its palette indices and the palette's colors, or only
+ * where it sits in an archive, and the image is made from that when a view asks for it. the sprite never
+ * writes to pixels something else still shares, so a handle never changes once made and any thread can make
+ * images from it without locking.
+ * every handle has a key that changes whenever the frame's pixels do, so views can tell when what they made
+ * from an older handle is out of date without making the image again.
+ */
+class FrameHandle
+{
+public:
+    /// @brief makes a handle for no frame, with a key of 0
+    FrameHandle() = default;
+
+    /// @brief makes a handle sharing the pixels of a full color frame, keyed by its revision
+    explicit FrameHandle(const Frame &frame);
+
+    /// @brief makes a handle sharing the indices of an indexed frame and the colors they pick from
+    /// @param key the revision of the pixels the indices stand for
+    FrameHandle(const IndexedFrame &frame, const QList<QRgb> &colorTable, quint64 key);
+
+    /// @brief makes a handle on a frame that is only read from an archive when its image is wanted
+    /// @param archiveIndex the frame's place in the archive
+    /// @param key the revision of the pixels stored there
+    FrameHandle(std::shared_ptr<SpriteArchive> archive, int archiveIndex, quint64 key);
+
+    /// @brief gets the stamp of the frame's pixels, the same for any two handles on the same pixels
+    quint64 key() const { return revision; }
+
+    bool isNull() const { return revision == 0; }
+
+    /// @brief tells if making the image reads the frame from its archive. that waits on the archive's lock
+    /// while whole delta chains are decoded, so the ui thread hands these handles to a worker
+    bool isArchived() const { return archive && !frame && !indexed; }
+
+    /// @brief makes an image of the frame, reading it from its archive if that is where it is. safe to call
+    /// from any thread
+    QImage toImage() const;
+private:
+    std::optional<Frame> frame;          // the full color pixels, for a frame the sprite holds in full color
+    std::optional<IndexedFrame> indexed; // the indices, for a frame of an indexed sprite
+    QList<QRgb> colors;                  // the palette's colors when the handle was made, for indexed
+    std::shared_ptr<SpriteArchive> archive; // the archive a frame held nowhere else is read from
+    int archiveIndex = -1;
+    quint64 revision = 0;
+};
+
+/*
+ * a frame table is the list of frame handles a snapshot holds, one per frame in order. it is kept in blocks
+ * of handles that tables share with each other, and changing a table copies only the block the change lands
+ * in. the editor changes its table as frames change and every snapshot takes a copy of it, so publishing
+ * after a stroke copies a list of blocks rather than a handle for every frame of a long sprite.
+ */
+class FrameTable
+{
+public:
+    /// About how many handles a block holds, a block splits in two once it holds twice this
+    static constexpr int kBlockSize = 64;
+
+    FrameTable() = default;
+
+    /// @brief makes a table of handles in order
+    explicit FrameTable(std::vector<FrameHandle> handles);
+
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    const FrameHandle& operator[](int index) const;
+
+    /// @brief replaces the handle of one frame
+    void set(int index, FrameHandle handle);
+
+    /// @brief puts in the handle of a new frame, moving the ones from index on back one
+    void insert(int index, FrameHandle handle);
+
+    /// @brief takes out the handle of a frame, moving the ones after it forward one
+    void erase(int index);
+private:
+    using Block = std::vector<FrameHandle>;
+
+    std::vector<std::shared_ptr<const Block>> blocks; // the handles, in order, shared with other tables
+    std::vector<int> starts;                          // the index of the first handle of each block
+    int count = 0;
+
+    /// @brief finds the block a handle is in and where it is in that block
+    std::pair<int, int> locate(int index) const;
+
+    /// @brief works out where every block starts again after blocks were added or taken out
+    void restart();
+};
+
+#endif // FRAMEHANDLE_H
@@ -0,0 +1,199 @@
+#include "frameoperation.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+int halveRoundingDown(int value) {
+    return value >= 0 ? value / 2 : -((1 - value) / 2);
+}
+
+/// The order ordered dithering lights up a 4x4 block in, each threshold is a sixteenth of the spread
+const int kBayerMatrix[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+int nudgeChannel(int channel, int offset) {
+    return std::clamp(channel + offset, 0, 255);
+}
+
+}
+
+FrameOperation FrameOperation::replaceColor(QRgb from, QRgb to) {
+    QHash<QRgb, QRgb> palette;
+    palette.insert(from, to);
+    return remapPalette(palette);
+}
+
+FrameOperation FrameOperation::remapPalette(const QHash<QRgb, QRgb> &palette) {
+    FrameOperation operation;
+    operation.kind = Kind::RemapPalette;
+    operation.palette = palette;
+    return operation;
+}
+
+FrameOperation FrameOperation::shift(int x, int y) {
+    FrameOperation operation;
+    operation.kind = Kind::Shift;
+    operation.shiftX = x;
+    operation.shiftY = y;
+    return operation;
+}
+
+FrameOperation FrameOperation::flipHorizontal() {
+    FrameOperation operation;
+    operation.kind = Kind::FlipHorizontal;
+    return operation;
+}
+
+FrameOperation FrameOperation::flipVertical() {
+    FrameOperation operation;
+    operation.kind = Kind::FlipVertical;
+    return operation;
+}
+
+FrameOperation FrameOperation::rotate90(bool clockwise) {
+    FrameOperation operation;
+    operation.kind = Kind::Rotate90;
+    operation.clockwise = clockwise;
+    return operation;
+}
+
+FrameOperation FrameOperation::clear() {
+    FrameOperation operation;
+    operation.kind = Kind::Clear;
+    return operation;
+}
+
+FrameOperation FrameOperation::filter(const FilterPipeline &filters) {
+    FrameOperation operation;
+    operation.kind = Kind::Filter;
+    operation.filters = filters;
+    return operation;
+}
+
+FrameOperation FrameOperation::transformFrames(const FrameTransform &transform) {
+    FrameOperation operation;
+    operation.kind = Kind::Transform;
+    operation.transform = transform;
+    return operation;
+}
+
+FrameOperation FrameOperation::quantize(std::shared_ptr<const ColorQuantizer> quantizer, bool dither) {
+    FrameOperation operation;
+    operation.kind = Kind::Quantize;
+    // the palette colors are about this far apart along each channel, so nudges up to it reach a neighbour
+    if (dither)
+        operation.ditherSpread = int(256 / std::cbrt(double(quantizer->getPalette().size())));
+    operation.quantizer = std::move(quantizer);
+    return operation;
+}
+
+Frame FrameOperation::apply(const Frame &frame) const {
+    const int width = frame.getWidth();
+    const int height = frame.getHeight();
+    if (width <= 0 || height <= 0)
+        return frame;
+    // remapping a palette is a filter too, and the pipeline looks colors up faster than a QHash
+    if (kind == Kind::RemapPalette)
+        return FilterPipeline().remapPalette(palette).apply(frame);
+    if (kind == Kind::Filter)
+        return filters.apply(frame);
+    if (kind == Kind::Transform)
+        return transform.changesSize() ? frame : transform.apply(frame);
+    if (kind == Kind::Shift) {
+        // wrap the offsets into the frame once, then the frame is cut where the shift wraps it around and the
+        // four pieces are copied over whole rows at a time
+        int offsetX = ((shiftX % width) + width) % width;
+        int offsetY = ((shiftY % height) + height) % height;
+        Frame shifted(width, height);
+        shifted.blit(frame, QRect(0, 0, width - offsetX, height - offsetY), QPoint(offsetX, offsetY));
+        shifted.blit(frame, QRect(width - offsetX, 0, offsetX, height - offsetY), QPoint(0, offsetY));
+        shifted.blit(frame, QRect(0, height - offsetY, width - offsetX, offsetY), QPoint(offsetX, 0));
+        shifted.blit(frame, QRect(width - offsetX, height - offsetY, offsetX, offsetY), QPoint(0, 0));
+        return shifted;
+    }
+    const QRgb *source = frame.constPixels();
+    Frame::Buffer pixels(width * height, qRgba(0, 0, 0, 0));
+
+    switch (kind) {
+    case Kind::RemapPalette:
+    case Kind::Filter:
+    case Kind::Transform:
+    case Kind::Shift:
+        break;
+    case Kind::FlipHorizontal:
+        for (int y = 0; y < height; y++)
+            for (int x = 0; x < width; x++)
+                pixels[y * width + x] = source[y * width + width - 1 - x];
+        break;
+    case Kind::FlipVertical:
+        for (int y = 0; y < height; y++)
+            std::copy(source + (height - 1 - y) * width, source + (height - y) * width, pixels.begin() + y * width);
+        break;
+    case Kind::Rotate90:
+        // each pixel looks up where it came from, measured from the center in half pixels so the center is
+        // whole. when width and height differ by an odd amount the pixels land half way, and round down
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int relativeX = 2 * x + 1 - width;
+                int relativeY = 2 * y + 1 - height;
+                int sourceX = halveRoundingDown((clockwise ? relativeY : -relativeY) + width - 1);
+                int sourceY = halveRoundingDown((clockwise ? -relativeX : relativeX) + height - 1);
+                if (0 <= sourceX && sourceX < width && 0 <= sourceY && sourceY < height)
+                    pixels[y * width + x] = source[sourceY * width + sourceX];
+            }
+        }
+        break;
+    case Kind::Clear:
+        break;
+    case Kind::Quantize: {
+        const std::vector<QRgb> &colors = quantizer->getPalette();
+        // neighbouring pixels usually nudge to the same color, so the last lookup is often the answer
+        QRgb lastColor = 0;
+        QRgb lastMatch = 0;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                QRgb color = source[y * width + x];
+                if (!ColorQuantizer::isOpaque(color))
+                    continue;
+                if (ditherSpread > 0) {
+                    int offset = (2 * kBayerMatrix[y & 3][x & 3] - 15) * ditherSpread / 32;
+                    color = qRgb(nudgeChannel(qRed(color), offset), nudgeChannel(qGreen(color), offset),
+                                 nudgeChannel(qBlue(color), offset));
+                }
+                color |= 0xFF000000;
+                if (color != lastColor || lastMatch == 0) {
+                    lastColor = color;
+                    lastMatch = colors[quantizer->indexOf(color)] | 0xFF000000;
+                }
+                pixels[y * width + x] = lastMatch;
+            }
+        }
+        break;
+    }
+    }
+    return Frame(width, height, std::move(pixels));
+}
+
+QString FrameOperation::name() const {
+    switch (kind) {
+    case Kind::RemapPalette:
+        return palette.size() == 1 ? "Replace Color" : "Remap Palette";
+    case Kind::Shift:
+        return "Shift";
+    case Kind::FlipHorizontal:
+        return "Flip Horizontally";
+    case Kind::FlipVertical:
+        return "Flip Vertically";
+    case Kind::Rotate90:
+        return clockwise ? "Rotate Clockwise" : "Rotate Counterclockwise";
+    case Kind::Clear:
+        return "Clear";
+    case Kind::Filter:
+        return filters.name();
+    case Kind::Transform:
+        return transform.name();
+    case Kind::Quantize:
+        return ditherSpread > 0 ? "Reduce Colors (Dithered)" : "Reduce Colors";
+    }
+    return QString();
+}
@@ -0,0 +1,81 @@
+#ifndef FRAMEOPERATION_H
+#define FRAMEOPERATION_H
+
+#include "filterpipeline.h"
+#include "frame.h"
+#include "frametransform.h"
+#include "quantizer.h"
+#include <QHash>
+#include <QString>
+#include <memory>
+/*
+ * a frame operation is a whole frame change, like flipping or recoloring, that can be run on many frames
+ * at once. it only describes the change, so it can be sent to the editor's thread and then applied to
+ * every frame in parallel: apply never changes the frame it is given and builds a new one instead.
+ */
+struct FrameOperation
+{
+    /// The kinds of change an operation can make
+    enum class Kind {
+        RemapPalette,   // swaps colors for other colors, replacing a single color is a palette of one
+        Shift,          // moves the pixels, wrapping them around the edges
+        FlipHorizontal, // mirrors the frame left to right
+        FlipVertical,   // mirrors the frame top to bottom
+        Rotate90,       // turns the frame a quarter turn about its center
+        Clear,          // makes every pixel transparent
+        Filter,         // runs a filter pipeline over the frame
+        Transform,      // moves the pixels with a frame transform that keeps the frame's size
+        Quantize        // snaps every pixel to the closest color of a reduced palette
+    };
+
+    Kind kind = Kind::Clear;
+    QHash<QRgb, QRgb> palette; // for RemapPalette, the color each listed color becomes
+    int shiftX = 0;            // for Shift, how far right the pixels move
+    int shiftY = 0;            // for Shift, how far down the pixels move
+    bool clockwise = true;     // for Rotate90, which way the frame turns
+    FilterPipeline filters;    // for Filter, the filters to run
+    FrameTransform transform;  // for Transform, where each pixel comes from
+    std::shared_ptr<const ColorQuantizer> quantizer; // for Quantize, the reduced palette shared by every frame
+    int ditherSpread = 0;      // for Quantize, how far ordered dithering nudges a channel, 0 for no dithering
+
+    /// @brief makes an operation that paints every pixel of one color with another
+    static FrameOperation replaceColor(QRgb from, QRgb to);
+
+    /// @brief makes an operation that swaps each color in a palette for the color it maps to
+    static FrameOperation remapPalette(const QHash<QRgb, QRgb> &palette);
+
+    /// @brief makes an operation that moves the pixels, the ones pushed off one edge come back on the other
+    static FrameOperation shift(int x, int y);
+
+    static FrameOperation flipHorizontal();
+    static FrameOperation flipVertical();
+
+    /// @brief makes an operation that turns the frame a quarter turn. frames that are not square keep their
+    /// size, so the corners that turn out of the frame are cut off and the uncovered ones left transparent
+    static FrameOperation rotate90(bool clockwise);
+
+    static FrameOperation clear();
+
+    /// @brief makes an operation that runs a filter pipeline, like the one previewed in the filters dialog
+    static FrameOperation filter(const FilterPipeline &filters);
+
+    /// @brief makes an operation that runs a frame transform, like rotating by any angle. transforms that
+    /// change the size of the frames have to change the whole sprite at once, so the editor resizes instead
+    static FrameOperation transformFrames(const FrameTransform &transform);
+
+    /// @brief makes an operation that redraws the frame with only the colors of a reduced palette. pixels
+    /// that are at least half opaque become fully opaque and the rest fully transparent
+    /// @param quantizer the palette, built from the colors of every frame that will be changed
+    /// @param dither true to mix neighbouring palette colors in a fixed 4x4 pattern for the colors in between
+    static FrameOperation quantize(std::shared_ptr<const ColorQuantizer> quantizer, bool dither);
+
+    /// @brief builds the frame this operation turns a frame into. safe to call from any thread
+    /// @param frame the frame to change, it is left as it is
+    /// @return the changed frame
+    Frame apply(const Frame &frame) const;
+
+    /// @brief gets a short name for the operation, used to label it in the undo history
+    QString name() const;
+};
+
+#endif // FRAMEOPERATION_H
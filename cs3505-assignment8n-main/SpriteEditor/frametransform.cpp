@@ -0,0 +1,103 @@
+#include "frametransform.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// @brief copies one row of the result out of the source, indices holds a source position or -1 per pixel
+void gatherRow(const QRgb *source, const qint32 *indices, QRgb *output, int width) {
+    int x = 0;
+#if defined(__AVX2__)
+    // the lanes that would read a transparent pixel are masked off and keep the zero they start as
+    const __m256i outside = _mm256_set1_epi32(-1);
+    for (; x + 8 <= width; x += 8) {
+        __m256i positions = _mm256_loadu_si256((const __m256i*)(indices + x));
+        __m256i inside = _mm256_cmpgt_epi32(positions, outside);
+        __m256i pixels = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)source, positions, inside, 4);
+        _mm256_storeu_si256((__m256i*)(output + x), pixels);
+    }
+#endif
+    for (; x < width; x++)
+        output[x] = indices[x] >= 0 ? source[indices[x]] : qRgba(0, 0, 0, 0);
+}
+
+}
+
+FrameTransform::FrameTransform() : sourceIndices(std::make_shared<std::vector<qint32>>()) {}
+
+FrameTransform::FrameTransform(int sourceWidth, int sourceHeight, int width, int height, const QString &label,
+                               std::vector<qint32> sourceIndices)
+    : sourceWidth(sourceWidth), sourceHeight(sourceHeight), width(width), height(height), label(label),
+      sourceIndices(std::make_shared<std::vector<qint32>>(std::move(sourceIndices))) {}
+
+FrameTransform FrameTransform::scale(int width, int height, double scaleX, double scaleY) {
+    int newWidth = std::max(1, (int)std::lround(width * scaleX));
+    int newHeight = std::max(1, (int)std::lround(height * scaleY));
+
+    // each result pixel takes the source pixel under its center. with whole numbers this is exact, so
+    // scaling by an integer repeats every pixel the same number of times
+    std::vector<qint32> columns(newWidth);
+    for (int x = 0; x < newWidth; x++)
+        columns[x] = qint32((qint64(2 * x + 1) * width) / (2 * qint64(newWidth)));
+    std::vector<qint32> indices(qint64(newWidth) * newHeight);
+    for (int y = 0; y < newHeight; y++) {
+        qint32 rowStart = qint32((qint64(2 * y + 1) * height) / (2 * qint64(newHeight))) * width;
+        for (int x = 0; x < newWidth; x++)
+            indices[y * newWidth + x] = rowStart + columns[x];
+    }
+    return FrameTransform(width, height, newWidth, newHeight, "Scale", std::move(indices));
+}
+
+FrameTransform FrameTransform::rotate(int width, int height, double degrees) {
+    const double angle = degrees * kPi / 180.0;
+    const double c = std::cos(angle);
+    const double s = std::sin(angle);
+    const double centerX = width / 2.0;
+    const double centerY = height / 2.0;
+
+    // each result pixel turns its center back the other way to find the source pixel it lands in. the
+    // small nudge keeps quarter turns, where cos and sin are not quite 0, from landing a pixel short
+    std::vector<qint32> indices(qint64(width) * height, -1);
+    for (int y = 0; y < height; y++) {
+        double relativeY = y + 0.5 - centerY;
+        for (int x = 0; x < width; x++) {
+            double relativeX = x + 0.5 - centerX;
+            int sourceX = (int)std::floor(c * relativeX + s * relativeY + centerX + 1e-9);
+            int sourceY = (int)std::floor(-s * relativeX + c * relativeY + centerY + 1e-9);
+            if (0 <= sourceX && sourceX < width && 0 <= sourceY && sourceY < height)
+                indices[y * width + x] = sourceY * width + sourceX;
+        }
+    }
+    return FrameTransform(width, height, width, height, "Rotate", std::move(indices));
+}
+
+FrameTransform FrameTransform::resizeCanvas(int width, int height, int newWidth, int newHeight, int offsetX, int offsetY) {
+    newWidth = std::max(1, newWidth);
+    newHeight = std::max(1, newHeight);
+    std::vector<qint32> indices(qint64(newWidth) * newHeight, -1);
+    for (int y = 0; y < newHeight; y++) {
+        int sourceY = y - offsetY;
+        if (sourceY < 0 || sourceY >= height)
+            continue;
+        for (int x = std::max(0, offsetX); x < std::min(newWidth, width + offsetX); x++)
+            indices[y * newWidth + x] = sourceY * width + x - offsetX;
+    }
+    bool crops = newWidth < width || newHeight < height;
+    return FrameTransform(width, height, newWidth, newHeight, crops ? "Crop Canvas" : "Resize Canvas", std::move(indices));
+}
+
+Frame FrameTransform::apply(const Frame &frame) const {
+    if (frame.getWidth() != sourceWidth || frame.getHeight() != sourceHeight || sourceIndices->empty())
+        return frame;
+
+    Frame::Buffer pixels(qint64(width) * height);
+    const QRgb *source = frame.constPixels();
+    for (int y = 0; y < height; y++)
+        gatherRow(source, sourceIndices->data() + qint64(y) * width, pixels.data() + qint64(y) * width, width);
+    return Frame(width, height, std::move(pixels));
+}
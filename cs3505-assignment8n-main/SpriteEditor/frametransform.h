@@ -0,0 +1,68 @@
+#ifndef FRAMETRANSFORM_H
+#define FRAMETRANSFORM_H
+
+#include "frame.h"
+#include <QString>
+#include <memory>
+#include <vector>
+/*
+ * a frame transform moves pixels around without blending them, like scaling, rotating or resizing the
+ * canvas. it works out once where every pixel of the result comes from, as a table of positions in the
+ * source frame, and then builds each frame by looking its pixels up row by row. every frame of a sprite is
+ * the same size, so one table serves the whole sprite, and applying it is safe from any thread.
+ */
+class FrameTransform
+{
+public:
+    /// @brief makes a transform that leaves frames as they are
+    FrameTransform();
+
+    /// @brief makes a transform that scales frames up or down, sampling the nearest pixel
+    /// @param width the width of the frames it is applied to
+    /// @param height the height of the frames it is applied to
+    /// @param scaleX how much wider the frames become, 2 doubles every pixel
+    /// @param scaleY how much taller the frames become
+    static FrameTransform scale(int width, int height, double scaleX, double scaleY);
+
+    /// @brief makes a transform that turns frames about their center by any angle, sampling the nearest
+    /// pixel. the frames keep their size, so the corners that turn out of the frame are cut off
+    /// @param degrees how far to turn the frames clockwise
+    static FrameTransform rotate(int width, int height, double degrees);
+
+    /// @brief makes a transform that grows or crops the canvas without scaling the pixels
+    /// @param newWidth the width of the new canvas
+    /// @param newHeight the height of the new canvas
+    /// @param offsetX where the left edge of the old frame lands on the new canvas, negative to crop it
+    /// @param offsetY where the top edge of the old frame lands on the new canvas, negative to crop it
+    static FrameTransform resizeCanvas(int width, int height, int newWidth, int newHeight, int offsetX, int offsetY);
+
+    int getSourceWidth() const { return sourceWidth; }
+    int getSourceHeight() const { return sourceHeight; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    /// @brief tells if the frames come out a different size than they go in
+    bool changesSize() const { return width != sourceWidth || height != sourceHeight; }
+
+    /// @brief builds the transformed frame
+    /// @param frame the frame to transform, it must be the size the transform was made for
+    /// @return the transformed frame, or the frame as it was if it is a different size
+    Frame apply(const Frame &frame) const;
+
+    /// @brief gets a short name for the transform, used to label it in the undo history
+    QString name() const { return label; }
+private:
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    int width = 0;
+    int height = 0;
+    QString label;
+    // for each pixel of the result, row by row, the position of its source pixel or -1 for a transparent
+    // one. shared, so copies of the transform sent between threads do not copy the table
+    std::shared_ptr<const std::vector<qint32>> sourceIndices;
+
+    FrameTransform(int sourceWidth, int sourceHeight, int width, int height, const QString &label,
+                   std::vector<qint32> sourceIndices);
+};
+
+#endif // FRAMETRANSFORM_H
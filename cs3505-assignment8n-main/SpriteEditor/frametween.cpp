@@ -0,0 +1,142 @@
+#include "frametween.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// The order ordered dithering lights up a 4x4 block in, each threshold is a sixteenth of the way
+const int kBayerMatrix[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+
+/// mixes two colors, weight out of 256 of the second. the colors are mixed premultiplied, so a pixel fading
+/// in from transparent keeps its own color instead of darkening toward the transparent pixel's black
+QRgb mix(QRgb from, QRgb to, int weight) {
+    if (from == to)
+        return from;
+    QRgb a = qPremultiply(from);
+    QRgb b = qPremultiply(to);
+    auto channel = [weight](int first, int second) { return (first * (256 - weight) + second * weight + 128) >> 8; };
+    return qUnpremultiply(qRgba(channel(qRed(a), qRed(b)), channel(qGreen(a), qGreen(b)),
+                                channel(qBlue(a), qBlue(b)), channel(qAlpha(a), qAlpha(b))));
+}
+
+}
+
+FrameTween FrameTween::dissolve() {
+    return FrameTween();
+}
+
+FrameTween FrameTween::crossFade() {
+    FrameTween tween;
+    tween.kind = Kind::CrossFade;
+    return tween;
+}
+
+FrameTween FrameTween::motion(const SelectionMask &selection, QPoint offset, double degrees) {
+    FrameTween tween;
+    tween.kind = Kind::Motion;
+    tween.selection = selection;
+    tween.offset = offset;
+    tween.degrees = degrees;
+    return tween;
+}
+
+Frame FrameTween::apply(const Frame &first, const Frame &last, double progress) const {
+    int width = first.getWidth();
+    int height = first.getHeight();
+    if (last.getWidth() != width || last.getHeight() != height)
+        return first;
+
+    if (kind == Kind::Dissolve) {
+        // a pixel switches to the last frame once the tween is past its threshold, so each one switches once
+        // and the pattern fills in evenly
+        Frame result = first;
+        result.editRows(0, height - 1, [&](int y, PixelSpan<QRgb> row) {
+            PixelSpan<const QRgb> lastRow = last.row(y);
+            for (int x = 0; x < width; x++)
+                if ((kBayerMatrix[y & 3][x & 3] + 0.5) / 16 < progress)
+                    row[x] = lastRow[x];
+        });
+        return result;
+    }
+    if (kind == Kind::CrossFade) {
+        int weight = std::clamp(int(std::lround(progress * 256)), 0, 256);
+        Frame result = first;
+        result.editRows(0, height - 1, [&](int y, PixelSpan<QRgb> row) {
+            PixelSpan<const QRgb> lastRow = last.row(y);
+            for (int x = 0; x < width; x++)
+                row[x] = mix(row[x], lastRow[x], weight);
+        });
+        return result;
+    }
+
+    // the pixels that move are lifted out, and each pixel they could land on turns its center back to find the
+    // pixel it came from, the way rotating a whole frame does
+    SelectionMask moving = selection.isEmpty() ? SelectionMask::rectangle(width, height, QRect(0, 0, width, height))
+                                               : selection;
+    QRect bounds = moving.bounds();
+    Frame result = first;
+    moving.clearPixels(result);
+    if (bounds.isEmpty())
+        return result;
+
+    double angle = degrees * progress * kPi / 180.0;
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    double centerX = bounds.left() + bounds.width() / 2.0;
+    double centerY = bounds.top() + bounds.height() / 2.0;
+    double moveX = offset.x() * progress;
+    double moveY = offset.y() * progress;
+
+    // only the pixels the moved bounds can cover are looked at
+    double left = width;
+    double top = height;
+    double right = 0;
+    double bottom = 0;
+    for (QPointF corner : {QPointF(bounds.left(), bounds.top()), QPointF(bounds.right() + 1, bounds.top()),
+                           QPointF(bounds.left(), bounds.bottom() + 1), QPointF(bounds.right() + 1, bounds.bottom() + 1)}) {
+        double relativeX = corner.x() - centerX;
+        double relativeY = corner.y() - centerY;
+        double x = c * relativeX - s * relativeY + centerX + moveX;
+        double y = s * relativeX + c * relativeY + centerY + moveY;
+        left = std::min(left, x);
+        top = std::min(top, y);
+        right = std::max(right, x);
+        bottom = std::max(bottom, y);
+    }
+    int firstX = std::max(0, int(std::floor(left)));
+    int lastX = std::min(width - 1, int(std::ceil(right)));
+    int firstY = std::max(0, int(std::floor(top)));
+    int lastY = std::min(height - 1, int(std::ceil(bottom)));
+    if (firstX > lastX || firstY > lastY)
+        return result;
+
+    result.editRows(firstY, lastY, [&](int y, PixelSpan<QRgb> row) {
+        double relativeY = y + 0.5 - centerY - moveY;
+        for (int x = firstX; x <= lastX; x++) {
+            double relativeX = x + 0.5 - centerX - moveX;
+            // the small nudge keeps quarter turns, where cos and sin are not quite 0, from landing a pixel short
+            int sourceX = (int)std::floor(c * relativeX + s * relativeY + centerX + 1e-9);
+            int sourceY = (int)std::floor(-s * relativeX + c * relativeY + centerY + 1e-9);
+            if (!moving.contains(sourceX, sourceY))
+                continue;
+            QRgb pixel = first.row(sourceY)[sourceX];
+            if (qAlpha(pixel) != 0)
+                row[x] = pixel; // moved pixels go over the rest of the frame, their transparent ones let it show
+        }
+    });
+    return result;
+}
+
+QString FrameTween::name() const {
+    switch (kind) {
+    case Kind::Dissolve:
+        return "Tween Frames (Dissolve)";
+    case Kind::CrossFade:
+        return "Tween Frames (Cross-Fade)";
+    case Kind::Motion:
+        return "Tween Frames (Motion)";
+    }
+    return QString();
+}
@@ -0,0 +1,48 @@
+#ifndef FRAMETWEEN_H
+#define FRAMETWEEN_H
+
+#include "frame.h"
+#include "selectionmask.h"
+#include <QPoint>
+#include <QString>
+/*
+ * a frame tween builds the frames in between two key frames, so an animator does not have to copy and nudge
+ * every one of them by hand. like a frame operation it only describes the change, so it can be sent to the
+ * editor's thread, and apply builds each in-between frame on its own, so they can all be built in parallel.
+ */
+struct FrameTween
+{
+    /// The ways the in-between frames can be built
+    enum class Kind {
+        Dissolve,  // more and more of the last frame's pixels show through in a fixed 4x4 pattern, for pixel art
+        CrossFade, // every pixel's color moves smoothly from the first frame's to the last frame's
+        Motion     // the selected pixels of the first frame move and turn a step at a time
+    };
+
+    Kind kind = Kind::Dissolve;
+    SelectionMask selection; // for Motion, the pixels of the first frame that move, empty to move the whole frame
+    QPoint offset;           // for Motion, how far the pixels have moved by the last frame
+    double degrees = 0;      // for Motion, how far the pixels have turned clockwise about their center by the last frame
+
+    static FrameTween dissolve();
+    static FrameTween crossFade();
+
+    /// @brief makes a tween that moves pixels of the first frame. the pixels are lifted out of the first frame,
+    /// leaving it transparent where they were, and drawn back moved and turned a fraction of the way
+    /// @param selection the pixels that move, or an empty mask to move the whole frame
+    /// @param offset how far they move by the last frame
+    /// @param degrees how far they turn clockwise by the last frame
+    static FrameTween motion(const SelectionMask &selection, QPoint offset, double degrees);
+
+    /// @brief builds one in-between frame. safe to call from any thread
+    /// @param first the key frame the tween starts from
+    /// @param last the key frame it ends at, the same size as the first
+    /// @param progress how far from the first frame to the last one, between 0 and 1
+    /// @return the in-between frame
+    Frame apply(const Frame &first, const Frame &last, double progress) const;
+
+    /// @brief gets a short name for the tween, used to label it in the undo history
+    QString name() const;
+};
+
+#endif // FRAMETWEEN_H
@@ -7,16 +7,68 @@
 
 
 #include "mainwindow.h"
+#include "collabrelay.h"
+#include "editjournal.h"
+#include "startuptimer.h"
+#include "workspace.h"
 #include <QApplication>
 #include <QColor>
+#include <QCoreApplication>
+#include <QMessageBox>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
 /// @reviewed by tj
 int main(int argc, char *argv[])
 {
+    // --relay <address> runs just the relay of a collaboration session, with no window, for editors to join
+    if (argc == 3 && std::strcmp(argv[1], "--relay") == 0) {
+        QCoreApplication relayApp(argc, argv);
+        CollabRelay relay;
+        if (!relay.listen(QString::fromLocal8Bit(argv[2])))
+            return 1;
+        return relayApp.exec();
+    }
+
+    // each step up to the canvas being painted is timed, and the times are shown in the status bar
+    StartupTimer::instance().start();
     QApplication a(argc, argv);
-    Editor editor(10, 10);
+    StartupTimer::instance().mark("application");
+
+    // anything left in a document's journal folder was written by a session that crashed before it could clean
+    // up. each folder is claimed by a journal first, so the folders of an editor still running are left alone
+    QString journalDirectory = EditJournal::defaultDirectory();
+    std::vector<std::pair<QString, std::unique_ptr<EditJournal>>> crashed;
+    for (const QString &directory : EditJournal::documentDirectories(journalDirectory)) {
+        auto journal = std::make_unique<EditJournal>(directory);
+        if (journal->isEnabled() && EditJournal::hasRecoverableWork(directory))
+            crashed.emplace_back(directory, std::move(journal));
+    }
+    // a recovered sprite keeps recording into the journal it was rebuilt from, the rest are deleted with theirs
+    std::vector<std::pair<Sprite*, EditJournal*>> recovered;
+    if (!crashed.empty()) {
+        QMessageBox::StandardButton answer = QMessageBox::question(
+            nullptr, "Recover Sprite", "The sprite editor did not close properly last time. Recover the unsaved sprites?");
+        for (auto &[directory, journal] : crashed) {
+            Sprite* sprite = answer == QMessageBox::Yes ? EditJournal::recover(directory) : nullptr;
+            if (sprite)
+                recovered.emplace_back(sprite, journal.release());
+        }
+        crashed.clear();
+    }
+    StartupTimer::instance().mark("recovery check");
+
+    // the documents do all the pixel work on their own thread so the window never waits on them
+    Workspace workspace(journalDirectory);
+    for (auto [sprite, journal] : recovered)
+        workspace.openDocument(sprite->getWidth(), sprite->getHeight(), sprite, journal);
+    if (recovered.empty())
+        workspace.openDocument(10, 10);
+    StartupTimer::instance().mark("documents");
 
-    QWidget widget;
-    MainWindow w(editor);
+    MainWindow w(workspace);
     w.show();
+    StartupTimer::instance().mark("window");
     return a.exec();
 }
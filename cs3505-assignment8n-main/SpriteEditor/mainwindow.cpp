@@ -7,28 +7,92 @@
 #include "editor.h"
 #include "canvas.h"
 #include "preview.h"
+#include "filterdialog.h"
+#include "memorybudget.h"
+#include "bufferpool.h"
+#include "workspace.h"
+#include "startuptimer.h"
 #include <QObject>
 #include <QApplication>
 #include <QPixmap>
 #include <qinputdialog.h>
 #include <QMessageBox>
 #include <QMutex>
+#include <QFileInfo>
+#include <QSignalBlocker>
+#include <QActionGroup>
+#include <QScrollBar>
+#include <QTimer>
+#include <QSettings>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+/// The memory one frame button's thumbnail takes
+const qint64 kThumbnailBytes = 75 * 75 * 4;
+
+/// How often the memory use in the status bar is brought up to date, in milliseconds
+const int kMemoryViewInterval = 1000;
+
+/// How long the startup times stay in the status bar, in milliseconds
+const int kStartupMessageTimeout = 10000;
+
+/// Where the last sprite saved or loaded is remembered
+const char *kLastSpriteKey = "lastSprite";
+
+/// @brief gets the editor's settings, named here so they do not depend on the application's name
+QSettings editorSettings() {
+    return QSettings("SpriteEditor", "SpriteEditor");
+}
+
+/// @brief gets the image the canvas shows for a snapshot, the current frame unless something floats over it
+const QImage& canvasImage(const SpriteSnapshot &snapshot) {
+    return snapshot.canvasBase.isNull() ? snapshot.currentImage : snapshot.canvasBase;
+}
+
+}
 /// @reviewed by will black
-MainWindow::MainWindow(Editor &editor, QWidget *parent)
+MainWindow::MainWindow(Workspace &workspace, QWidget *parent)
     : QMainWindow(parent)
-    , ui(new Ui::MainWindow) {
+    , ui(new Ui::MainWindow)
+    , workspace(workspace)
+    , editor(workspace.getActive()) {
     ui->setupUi(this);
-    setupTools(ui, editor);
-    setupAnimationPreview(ui, editor);
-    setupColorPicker(ui, editor);
-    setupCanvas(ui, editor);
-    setupActions(ui, editor);
-    setupFrameSelection(ui,editor);
+    color = QColorConstants::Black;
+    currentFrame = 0;
+    // the preview's timer and the memory view wait until the canvas has been painted, see finishStartup
+    setupTools(ui);
+    setupColorPicker(ui);
+    setupActions(ui);
+    setupFrameSelection(ui);
+    setupDocuments(ui);
+    ui->canvas->installEventFilter(this);
 
     update();
-    currentFrame = 0;
-    insertFrameButton(0);
-    frameClicked(0);
+}
+
+bool MainWindow::eventFilter(QObject *watched, QEvent *event) {
+    // the canvas paints once before the document's first snapshot has arrived, which is not the sprite yet
+    if (watched == ui->canvas && event->type() == QEvent::Paint && shownVersion != 0) {
+        ui->canvas->removeEventFilter(this);
+        StartupTimer::instance().mark("first paint");
+        QTimer::singleShot(0, this, &MainWindow::finishStartup);
+    }
+    return QMainWindow::eventFilter(watched, event);
+}
+
+void MainWindow::finishStartup() {
+    setupAnimationPreview(ui);
+    setupMemoryView(ui);
+    StartupTimer &timer = StartupTimer::instance();
+    if (timer.isFinished())
+        return;
+    timer.finish("panels");
+    ui->statusbar->showMessage(timer.summary(), kStartupMessageTimeout);
 }
 
 MainWindow::~MainWindow() {
@@ -52,96 +116,295 @@ void MainWindow::createNewSprite(QString stringSize) {
         QMessageBox::critical(nullptr, "Error", "please enter a valid input, valid inputs are 0-64");
         return;
     }
-    QHBoxLayout* layout = qobject_cast<QHBoxLayout*>(ui->framesScrollArea->widget()->layout());
-    for(auto buttonToRemove : frameButtons){
-        layout->removeWidget(buttonToRemove);
-        delete buttonToRemove;
-    }
-    frameButtons.clear();
-    currentFrame = 0;
-    insertFrameButton(0);
-    emit createNewSpriteSignal(size, size);
-    frameClicked(0);
-
-    ui->animationPreview->resetPreview();
+    openDocument("Untitled", size, size);
 }
 
 void MainWindow::saveSprite() {
-    QString filename = QFileDialog::getSaveFileName();
+    QString spriteFilter = "Sprite (*.ssp)";
+    QString archiveFilter = "Sprite archive, opens large animations quickly (*.ssb)";
+    QString selectedFilter;
+    QString filename = QFileDialog::getSaveFileName(this, "Save Sprite", QString(), spriteFilter + ";;" + archiveFilter, &selectedFilter);
+    if (selectedFilter == archiveFilter && QFileInfo(filename).suffix().isEmpty())
+        filename += ".ssb";
+    if (!filename.isEmpty()) {
+        ui->documentTabs->setTabText(ui->documentTabs->currentIndex(), QFileInfo(filename).fileName());
+        rememberLastSprite(filename);
+    }
     emit saveSpriteSignal(filename);
 }
 
 void MainWindow::loadSprite() {
-    QString filepath = QFileDialog::getOpenFileName();
-    if(!filepath.endsWith(".ssp")){
+    QString filepath = QFileDialog::getOpenFileName(this, "Load Sprite", QString(), "Sprites (*.ssp *.ssb)");
+    if(!filepath.endsWith(".ssp") && !filepath.endsWith(".ssb")){
         QMessageBox::critical(nullptr, "Error", "Incorrect file type.");
         return;
     }
-    if(!filepath.isEmpty()){
-        QHBoxLayout* layout = (QHBoxLayout*)(ui->framesScrollArea->widget()->layout());
-        for(auto buttonToRemove : frameButtons){
-            layout->removeWidget(buttonToRemove);
-            delete buttonToRemove;
-        }
-        frameButtons.clear();
-        currentFrame = 0;
-        emit loadSpiteSignal(filepath);
-        frameClicked(0);
-    }
+    // every sprite opens in its own tab, leaving the ones already open as they are
+    openDocument(QFileInfo(filepath).fileName());
+    rememberLastSprite(filepath);
+    emit loadSpiteSignal(filepath);
+}
 
-    QHBoxLayout* layout = (QHBoxLayout*)(ui->framesScrollArea->widget()->layout());
-    for(auto buttonToRemove : frameButtons) {
-        layout->removeWidget(buttonToRemove);
-        delete buttonToRemove;
+void MainWindow::reopenLastSprite() {
+    QString filepath = editorSettings().value(kLastSpriteKey).toString();
+    if (!QFileInfo::exists(filepath)) {
+        QMessageBox::critical(nullptr, "Error", "The last sprite could not be found.");
+        return;
     }
-    frameButtons.clear();
-    currentFrame = 0;
+    // the editor shows the first frame as soon as it is read and makes the images of the rest after
+    openDocument(QFileInfo(filepath).fileName());
     emit loadSpiteSignal(filepath);
-    frameClicked(0);
 }
 
-void MainWindow::addFrame() {
-    QPushButton* newFrameButton = new QPushButton( ui->framesScrollArea);
-    newFrameButton->setFixedSize(75, 75);
-    newFrameButton->setStyleSheet("QPushButton {background-color: rgb(224,224,224);}");
+void MainWindow::rememberLastSprite(const QString &filepath) {
+    editorSettings().setValue(kLastSpriteKey, QFileInfo(filepath).absoluteFilePath());
+    ui->actionReopenLast->setEnabled(true);
+}
 
-    QHBoxLayout* layout = (QHBoxLayout*)ui->framesScrollArea->widget()->layout();
-    layout->addWidget(newFrameButton, Qt::AlignLeft);
+void MainWindow::exportAnimation() {
+    QString gifFilter = "Animated GIF (*.gif)";
+    QString perFrameGifFilter = "Animated GIF, palette per frame (*.gif)";
+    QString pngFilter = "Animated PNG (*.png *.apng)";
+    QString selectedFilter;
+    QString filepath = QFileDialog::getSaveFileName(this, "Export Animation", QString(),
+                                                    gifFilter + ";;" + perFrameGifFilter + ";;" + pngFilter, &selectedFilter);
+    if (filepath.isEmpty())
+        return;
 
-    frameButtons.push_back(newFrameButton);
+    if (QFileInfo(filepath).suffix().isEmpty())
+        filepath += selectedFilter == pngFilter ? ".png" : ".gif";
+    emit exportAnimationSignal(filepath, ui->fpsSlider->value(), selectedFilter == perFrameGifFilter);
+}
 
-    emit frameAdded();
+void MainWindow::setMemoryLimit() {
+    bool ok = false;
+    int megabytes = QInputDialog::getInt(this, "Memory Limit", "Memory for the sprite, undo history and caches, in MB",
+                                         int(MemoryBudget::instance().getBudget() / (1024 * 1024)), 32, 65536, 32, &ok);
+    if (ok)
+        emit memoryLimitSignal(qint64(megabytes) * 1024 * 1024);
+}
 
-    int index = frameButtons.size() - 1;
+void MainWindow::hostSession() {
+    bool ok = false;
+    QString address = QInputDialog::getText(this, "Host Session",
+                                            "Local socket name, or host:port for a TCP port on this machine",
+                                            QLineEdit::Normal, "sprite-editor", &ok);
+    if (!ok || address.isEmpty())
+        return;
+    if (!workspace.hostSession(address)) {
+        QMessageBox::critical(nullptr, "Error", QString("Could not host a session at %1.").arg(address));
+        return;
+    }
+    // the sprite in front is the one shared, since the first site to join shares its sprite
+    emit joinSessionSignal(address);
+}
 
-    // Connect the button click signal to the dynamically created slot
-    connect(newFrameButton, &QPushButton::clicked, [this, index]() { frameClicked(index); });
-    layout->setAlignment(Qt::AlignLeft);
-    frameClicked(index);
+void MainWindow::joinSession() {
+    bool ok = false;
+    QString address = QInputDialog::getText(this, "Join Session",
+                                            "Local socket name, or host:port for a TCP port on this machine",
+                                            QLineEdit::Normal, "sprite-editor", &ok);
+    if (!ok || address.isEmpty())
+        return;
+    // the session's sprite replaces the document's, so it gets a tab of its own
+    openDocument(address);
+    emit joinSessionSignal(address);
+}
+
+void MainWindow::replaceColor() {
+    QColor from = QColorDialog::getColor(color, this, "Color To Replace With The Paint Color", QColorDialog::ShowAlphaChannel);
+    if (from.isValid())
+        emit frameOperationSignal(FrameOperation::replaceColor(from.rgba(), color.rgba()), {});
+}
+
+void MainWindow::reduceColors() {
+    bool ok = false;
+    int colorCount = QInputDialog::getInt(this, "Reduce Colors", "Colors to keep", 16, 2, 256, 1, &ok);
+    if (!ok)
+        return;
+    QStringList ditherModes = {"No Dithering", "Ordered Dithering"};
+    QString ditherMode = QInputDialog::getItem(this, "Reduce Colors", "Colors in between", ditherModes, 0, false, &ok);
+    if (ok)
+        emit reduceColorsSignal(colorCount, ditherMode == ditherModes[1]);
+}
+
+void MainWindow::changePaletteColor() {
+    QColor to = QColorDialog::getColor(color, this, "New Color For The Paint Color", QColorDialog::ShowAlphaChannel);
+    if (to.isValid())
+        emit paletteColorSignal(color.rgba(), to.rgba());
+}
+
+void MainWindow::shiftFrames() {
+    bool ok = false;
+    int x = QInputDialog::getInt(this, "Shift All Frames", "Pixels to the right, negative for left", 1, -4096, 4096, 1, &ok);
+    if (!ok)
+        return;
+    int y = QInputDialog::getInt(this, "Shift All Frames", "Pixels down, negative for up", 0, -4096, 4096, 1, &ok);
+    if (ok)
+        emit frameOperationSignal(FrameOperation::shift(x, y), {});
+}
+
+void MainWindow::tweenFrames() {
+    std::shared_ptr<const SpriteSnapshot> snapshot = editor->currentSnapshot();
+    if (!snapshot)
+        return;
+    int frameCount = snapshot->frames.size();
+    if (frameCount < 2) {
+        QMessageBox::critical(nullptr, "Error", "Tweening needs two frames, add another frame first.");
+        return;
+    }
+    // the frames are numbered from 1 here, as on the frame buttons
+    bool ok = false;
+    int first = QInputDialog::getInt(this, "Tween Frames", "From frame", snapshot->currentFrame + 1, 1, frameCount, 1, &ok);
+    if (!ok)
+        return;
+    int last = QInputDialog::getInt(this, "Tween Frames", "To frame", first < frameCount ? first + 1 : first - 1, 1,
+                                    frameCount, 1, &ok);
+    if (!ok || last == first)
+        return;
+    int between = std::abs(last - first) - 1;
+    if (between > 0) {
+        QMessageBox::StandardButton answer = QMessageBox::question(this, "Tween Frames",
+            QString("The %1 frames between frames %2 and %3 will be replaced by the tween. Continue?")
+                .arg(between).arg(std::min(first, last)).arg(std::max(first, last)));
+        if (answer != QMessageBox::Yes)
+            return;
+    }
+    int count = QInputDialog::getInt(this, "Tween Frames", "Frames in between", 4, 1, 1000, 1, &ok);
+    if (!ok)
+        return;
+    const QStringList kinds = {"Dissolve, dithered for pixel art", "Cross-fade", "Move the selection"};
+    QString kind = QInputDialog::getItem(this, "Tween Frames", "Tween", kinds, 0, false, &ok);
+    if (!ok)
+        return;
+
+    FrameTween tween = FrameTween::dissolve();
+    if (kind == kinds[1])
+        tween = FrameTween::crossFade();
+    else if (kind == kinds[2]) {
+        // the editor moves the selected pixels, or the whole frame when nothing is selected
+        int x = QInputDialog::getInt(this, "Tween Frames", "Pixels moved right by the last frame, negative for left",
+                                     0, -4096, 4096, 1, &ok);
+        if (!ok)
+            return;
+        int y = QInputDialog::getInt(this, "Tween Frames", "Pixels moved down by the last frame, negative for up",
+                                     0, -4096, 4096, 1, &ok);
+        if (!ok)
+            return;
+        double degrees = QInputDialog::getDouble(this, "Tween Frames", "Degrees turned clockwise by the last frame",
+                                                 0, -3600, 3600, 1, &ok);
+        if (!ok)
+            return;
+        tween = FrameTween::motion(SelectionMask(), QPoint(x, y), degrees);
+    }
+    emit tweenFramesSignal(first - 1, last - 1, count, tween);
+}
+
+void MainWindow::rotateByAngle() {
+    std::shared_ptr<const SpriteSnapshot> snapshot = editor->currentSnapshot();
+    if (!snapshot)
+        return; // the document was just brought to the front and has not shown its frames yet
+    bool ok = false;
+    double degrees = QInputDialog::getDouble(this, "Rotate All Frames", "Degrees clockwise", 45, -360, 360, 1, &ok);
+    if (ok)
+        emit frameOperationSignal(FrameOperation::transformFrames(FrameTransform::rotate(snapshot->width, snapshot->height, degrees)), {});
+}
+
+void MainWindow::scaleSprite() {
+    std::shared_ptr<const SpriteSnapshot> snapshot = editor->currentSnapshot();
+    if (!snapshot)
+        return; // the document was just brought to the front and has not shown its frames yet
+    bool ok = false;
+    double percent = QInputDialog::getDouble(this, "Scale Sprite", "Percent of the current size", 200, 1, 10000, 1, &ok);
+    if (ok)
+        emit resizeSpriteSignal(FrameTransform::scale(snapshot->width, snapshot->height, percent / 100, percent / 100));
 }
 
-void MainWindow::insertFrameButton(int frameButtonNum){
+void MainWindow::resizeCanvas() {
+    std::shared_ptr<const SpriteSnapshot> snapshot = editor->currentSnapshot();
+    if (!snapshot)
+        return; // the document was just brought to the front and has not shown its frames yet
+    bool ok = false;
+    int width = QInputDialog::getInt(this, "Resize Canvas", "New width, smaller crops", snapshot->width, 1, 4096, 1, &ok);
+    if (!ok)
+        return;
+    int height = QInputDialog::getInt(this, "Resize Canvas", "New height, smaller crops", snapshot->height, 1, 4096, 1, &ok);
+    if (!ok)
+        return;
+    // the frames stay centered on the new canvas
+    emit resizeSpriteSignal(FrameTransform::resizeCanvas(snapshot->width, snapshot->height, width, height,
+                                                         (width - snapshot->width) / 2, (height - snapshot->height) / 2));
+}
+
+void MainWindow::openFilters() {
+    FilterDialog dialog(color, this);
+    connect(&dialog, &FilterDialog::pipelineChanged, this, &MainWindow::previewFilters);
+    bool accepted = dialog.exec() == QDialog::Accepted;
+    previewFilters(FilterPipeline());
+
+    FilterPipeline filters = dialog.pipeline();
+    if (!accepted || filters.isEmpty())
+        return;
+    std::vector<int> frameIndices;
+    if (!dialog.appliesToAllFrames())
+        frameIndices.push_back(currentFrame);
+    emit frameOperationSignal(FrameOperation::filter(filters), frameIndices);
+}
+
+void MainWindow::previewFilters(const FilterPipeline &filters) {
+    previewedFilters = filters;
+    std::shared_ptr<const SpriteSnapshot> snapshot = editor->currentSnapshot();
+    if (snapshot && snapshot->currentFrame < (int)snapshot->frames.size())
+        ui->canvas->setImage(previewedFilters.apply(canvasImage(*snapshot)));
+}
+
+void MainWindow::importImageSequence() {
+    QString folderPath = QFileDialog::getExistingDirectory(this, "Import PNG Sequence");
+    if (folderPath.isEmpty())
+        return;
+
+    openDocument(QFileInfo(folderPath).fileName());
+    emit importImageSequenceSignal(folderPath);
+}
+
+void MainWindow::importSpriteSheet() {
+    QString filepath = QFileDialog::getOpenFileName(this, "Import Sprite Sheet", QString(), "Images (*.png *.bmp *.gif *.jpg)");
+    if (filepath.isEmpty())
+        return;
+
+    bool ok = false;
+    int cellWidth = QInputDialog::getInt(this, "Import Sprite Sheet", "Frame width in pixels", 16, 1, 4096, 1, &ok);
+    if (!ok)
+        return;
+    int cellHeight = QInputDialog::getInt(this, "Import Sprite Sheet", "Frame height in pixels", cellWidth, 1, 4096, 1, &ok);
+    if (!ok)
+        return;
+
+    openDocument(QFileInfo(filepath).fileName());
+    emit importSpriteSheetSignal(filepath, cellWidth, cellHeight);
+}
+
+void MainWindow::addFrame() {
+    emit frameAdded();
+}
+
+QPushButton* MainWindow::createFrameButton(int frameButtonNum) {
     QPushButton* newFrameButton = new QPushButton(ui->framesScrollArea);
     newFrameButton->setFixedSize(75, 75);
-    newFrameButton->setStyleSheet("QPushButton {background-color: rgb(240,240,240);}");
+    newFrameButton->setIconSize(QSize(75, 75));
+    newFrameButton->setStyleSheet("QPushButton {background-color: rgb(224,224,224);}");
 
     QHBoxLayout* layout = (QHBoxLayout*)(ui->framesScrollArea->widget()->layout());
     layout->addWidget(newFrameButton, Qt::AlignLeft);
-
-    frameButtons.push_back(newFrameButton);
+    layout->setAlignment(Qt::AlignLeft);
 
     // Connect the button click signal to the dynamically created slot
     connect(newFrameButton, &QPushButton::clicked, [this, frameButtonNum]() { frameClicked(frameButtonNum); });
-    layout->setAlignment(Qt::AlignLeft);
+    return newFrameButton;
 }
 
 void MainWindow::frameClicked(int frameNum) {
-    auto previousButton = frameButtons.at(currentFrame);
-    currentFrame = frameNum;
-    auto currentButton = frameButtons.at(currentFrame);
-    previousButton->setStyleSheet("QPushButton {background-color: rgb(224,224,224);}"); // make the previous button appear to be un-selected
-    currentButton->setStyleSheet("QPushButton {background-color: rgb(160,160,160);}");
-    emit frameSelected(currentFrame);
+    emit frameSelected(frameNum);
 }
 
 void MainWindow::deleteFrame() {
@@ -149,204 +412,400 @@ void MainWindow::deleteFrame() {
     if (frameButtons.size() <= 1)
         return;
 
-    if (currentFrame < 0 || currentFrame >= frameButtons.size())
-        return;
-
     emit frameDeleted(currentFrame);
+}
 
-    QPushButton* currentFrameButton = frameButtons.at(currentFrame);
-    QHBoxLayout* layout = (QHBoxLayout*)(ui->framesScrollArea->widget()->layout());
-
-    layout->removeWidget(currentFrameButton); // remove the button from the view
-    delete currentFrameButton;
-
-    frameButtons.erase(frameButtons.begin() + currentFrame); // remove the button from the list of buttons;
-
+void MainWindow::cloneFrame() {
+    if(frameButtons.size() == 0)
+        return;
 
-    for (int i = currentFrame; i < frameButtons.size(); i++) {
-        frameButtons[i]->disconnect(frameButtons[i], 0, 0, 0);
+    emit frameCloned();
+}
 
-        // Connect the button click signal to the dynamically created slot
-        connect(frameButtons[i], &QPushButton::clicked, [this, i]() { frameClicked(i); });
+void MainWindow::showSnapshot() {
+    std::shared_ptr<const SpriteSnapshot> snapshot = editor->currentSnapshot();
+    // snapshots are read when their signal arrives, so a later one may already have been shown
+    if (!snapshot || snapshot->version <= shownVersion)
+        return;
+    shownVersion = snapshot->version;
+
+    // add or remove buttons at the end until there is one per frame
+    int frameCount = snapshot->frames.size();
+    while ((int)frameButtons.size() < frameCount) {
+        frameButtons.push_back(createFrameButton(frameButtons.size()));
+        thumbnailKeys.push_back(0);
+        thumbnailShown.push_back(0);
     }
-
-    if(currentFrame  >= frameButtons.size())
-        currentFrame--;
-
-    QPushButton* newSelectedButton = frameButtons.at(currentFrame);
-    newSelectedButton->setStyleSheet(QString("QPushButton {background-color: rgb(160,160,160);} QPushButton:pressed {background-color: rgb(160,160,160);}"));
-    emit frameSelected(currentFrame);
+    while ((int)frameButtons.size() > frameCount) {
+        ui->framesScrollArea->widget()->layout()->removeWidget(frameButtons.back());
+        delete frameButtons.back();
+        frameButtons.pop_back();
+        thumbnailKeys.pop_back();
+        thumbnailShown.pop_back();
+    }
+    shownSnapshot = snapshot;
+    updateThumbnails();
+
+    if (currentFrame < frameCount)
+        frameButtons[currentFrame]->setStyleSheet("QPushButton {background-color: rgb(224,224,224);}"); // make the previous button appear to be un-selected
+    currentFrame = snapshot->currentFrame;
+    frameButtons[currentFrame]->setStyleSheet("QPushButton {background-color: rgb(160,160,160);}");
+
+    // follow the sprite's mode without sending it back, it changes when a sprite is loaded or indexing fails
+    QSignalBlocker blocker(ui->actionIndexedColor);
+    ui->actionIndexedColor->setChecked(snapshot->indexed);
+    ui->actionChangePaletteColor->setEnabled(snapshot->indexed);
+
+    // the frame under a floating selection or shape being dragged stays the same, so only the overlay is redrawn
+    const QImage& canvas = canvasImage(*snapshot);
+    if (canvas.cacheKey() != shownCanvasKey) {
+        // a stroke or an edit from another site only redraws the pixels it changed, if the canvas shows what it changed
+        bool partial = snapshot->changedFrom != 0 && snapshot->changedFrom == shownCanvasKey &&
+                       previewedFilters.isEmpty();
+        shownCanvasKey = canvas.cacheKey();
+        if (partial)
+            ui->canvas->updatePixels(canvas, snapshot->changedPixels);
+        else
+            ui->canvas->setImage(previewedFilters.apply(canvas));
+    }
+    ui->canvas->setOverlay(snapshot->overlay, snapshot->overlayPosition, snapshot->selectionBounds);
+    ui->animationPreview->showSnapshot(snapshot);
 }
 
-void MainWindow::cloneFrame() {
-    if(frameButtons.size() == 0)
+void MainWindow::updateThumbnails() {
+    if (!shownSnapshot)
         return;
+    qint64 limit = MemoryBudget::instance().share(MemoryUse::Thumbnails);
+    int drawn = std::count_if(thumbnailKeys.begin(), thumbnailKeys.end(), [](quint64 key) { return key != 0; });
+    quint64 now = ++thumbnailClock;
+
+    // only the frames on screen whose handle changed since they were last drawn are made into images
+    std::vector<int> offScreen;
+    std::vector<std::pair<int, FrameHandle>> archived;
+    for (int i = 0; i < (int)frameButtons.size(); i++) {
+        bool onScreen = !frameButtons[i]->visibleRegion().isEmpty();
+        if (!onScreen) {
+            if (thumbnailKeys[i] != 0)
+                offScreen.push_back(i);
+            continue;
+        }
+        thumbnailShown[i] = now;
+        const FrameHandle& frame = shownSnapshot->frames[i];
+        if (thumbnailKeys[i] == frame.key())
+            continue;
+        drawn += thumbnailKeys[i] == 0;
+        thumbnailKeys[i] = frame.key();
+        if (i != shownSnapshot->currentFrame && frame.isArchived()) {
+            frameButtons[i]->setIcon(QIcon()); // blank rather than another frame's until the worker is done
+            archived.emplace_back(i, frame);
+            continue;
+        }
+        QImage image = i == shownSnapshot->currentFrame ? shownSnapshot->currentImage : frame.toImage();
+        frameButtons[i]->setIcon(QPixmap::fromImage(image.scaled(75, 75)));
+    }
+    if (!archived.empty())
+        readThumbnails(std::move(archived));
+
+    // the buttons on screen always keep theirs, the ones scrolled away from longest give theirs up first
+    std::sort(offScreen.begin(), offScreen.end(),
+              [this](int first, int second) { return thumbnailShown[first] < thumbnailShown[second]; });
+    for (int i : offScreen) {
+        if (drawn * kThumbnailBytes <= limit)
+            break;
+        frameButtons[i]->setIcon(QIcon());
+        thumbnailKeys[i] = 0;
+        drawn--;
+    }
+    thumbnailReport.set(drawn * kThumbnailBytes);
+}
 
-    QPushButton* newFrameButton = new QPushButton(ui->framesScrollArea);
-    newFrameButton->setFixedSize(75, 75);
-    newFrameButton->setStyleSheet(QString("QPushButton {background-color: rgb(224,224,224);}"));
+void MainWindow::readThumbnails(std::vector<std::pair<int, FrameHandle>> frames) {
+    // reading waits on the archive while other threads decode from it, which the ui thread never does
+    auto *watcher = new QFutureWatcher<std::vector<Thumbnail>>(this);
+    connect(watcher, &QFutureWatcher<std::vector<Thumbnail>>::finished, this, [this, watcher]() {
+        for (const Thumbnail &thumbnail : watcher->result())
+            if (thumbnail.index < (int)thumbnailKeys.size() && thumbnailKeys[thumbnail.index] == thumbnail.key)
+                frameButtons[thumbnail.index]->setIcon(QPixmap::fromImage(thumbnail.image));
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run([frames = std::move(frames)]() {
+        std::vector<Thumbnail> thumbnails;
+        for (const auto &[index, frame] : frames)
+            thumbnails.push_back(Thumbnail{index, frame.key(), frame.toImage().scaled(75, 75)});
+        return thumbnails;
+    }));
+}
 
-    QHBoxLayout* layout = (QHBoxLayout*)(ui->framesScrollArea->widget()->layout());
-    layout->insertWidget(currentFrame + 1, newFrameButton);
-    frameButtons.insert(frameButtons.begin() + currentFrame + 1, newFrameButton);
+void MainWindow::showMemoryUse() {
+    auto megabytes = [](qint64 bytes) { return QString::number(double(bytes) / (1024 * 1024), 'f', 1); };
+    poolReport.set(BufferPool::instance().getRetainedBytes()); // the pool has no owner to report it, so it is read here
+    MemoryBudget::Usage usage = MemoryBudget::instance().getUsage();
+    memoryLabel->setText(QString("Memory %1 / %2 MB").arg(megabytes(usage.total())).arg(megabytes(usage.budget)));
 
-    for (int i = currentFrame + 1; i < frameButtons.size(); i++) {
-        frameButtons[i]->disconnect(frameButtons[i], 0, 0, 0);
+    QStringList parts;
+    for (int use = 0; use < MemoryBudget::kUseCount; use++)
+        parts.append(QString("%1: %2 MB").arg(MemoryBudget::name(MemoryUse(use))).arg(megabytes(usage.bytes[use])));
+    memoryLabel->setToolTip(parts.join("\n"));
+}
 
-        // Connect the button click signal to the dynamically created slot
-        connect(frameButtons[i], &QPushButton::clicked, [this, i]() { frameClicked(i); });
-    }
+void MainWindow::openDocument(const QString &title, int width, int height) {
+    workspace.openDocument(width, height);
+    QSignalBlocker blocker(ui->documentTabs);
+    ui->documentTabs->setCurrentIndex(ui->documentTabs->addTab(title));
+}
 
-    emit frameCloned();
+void MainWindow::switchDocument(int index) {
+    const std::vector<Editor*> &documents = workspace.getDocuments();
+    if (0 <= index && index < (int)documents.size())
+        workspace.activate(documents[index]);
+}
 
-    frameClicked(currentFrame + 1);
+void MainWindow::closeDocument(int index) {
+    // closing the window's only document isn't allowed
+    const std::vector<Editor*> &documents = workspace.getDocuments();
+    if (documents.size() <= 1 || index < 0 || index >= (int)documents.size())
+        return;
+    QSignalBlocker blocker(ui->documentTabs);
+    ui->documentTabs->removeTab(index);
+    workspace.closeDocument(documents[index]);
 }
 
-void MainWindow::receiveFrameButtonImage(QImage image, int index){
-    image = image.scaled(75, 75);
-    frameButtons[index]->setIconSize(QSize(75, 75));
-    frameButtons[index]->setIcon(QPixmap::fromImage(image));
+void MainWindow::showDocument(Editor *document) {
+    editor = document;
+    connectEditor(*document);
+
+    // the document's snapshots count up on their own, so whatever it publishes next is shown
+    shownVersion = 0;
+    shownCanvasKey = 0;
+    shownSnapshot.reset();
+    const std::vector<Editor*> &documents = workspace.getDocuments();
+    int index = std::find(documents.begin(), documents.end(), document) - documents.begin();
+    QSignalBlocker blocker(ui->documentTabs);
+    if (index < ui->documentTabs->count())
+        ui->documentTabs->setCurrentIndex(index);
+    showSnapshot();
+}
+
+void MainWindow::showColor(const QColor &newColor) {
+    color = newColor; // remembered for the frame operations that paint
+    // Sets the background color using a QColorDialog
+    QPalette pal = ui->colorPicker->palette();
+    pal.setBrush(QPalette::AlternateBase, newColor);
+    ui->colorPicker->setPalette(pal);
+    ui->colorPicker->setBackgroundRole(QPalette::AlternateBase);
 }
 
 // ---------------------------------------------- SETUP REALM! ---------------------------------------------- //
 
-void MainWindow::setupTools(Ui::MainWindow *ui, Editor &editor) {
-    editor.setActiveTool(ToolType::Pen);
+void MainWindow::setupTools(Ui::MainWindow *ui) {
     ui->penTool->setDefault(true);
 
-    QMainWindow::connect(ui->penTool, &QPushButton::clicked,
-                         &editor,
-                        [&editor, ui]() {
-                            editor.setActiveTool(ToolType::Pen);
-                            ui->penTool->setDefault(true);
-                            ui->eraserTool->setDefault(false);
-                            ui->fillTool->setDefault(false);
-                            ui->eyeDropperTool->setDefault(false);
-                        });
-    QMainWindow::connect(ui->eraserTool, &QPushButton::clicked,
-                         &editor,
-                        [&editor, ui]() {
-                            editor.setActiveTool(ToolType::Eraser);
-                            ui->penTool->setDefault(false);
-                            ui->eraserTool->setDefault(true);
-                            ui->fillTool->setDefault(false);
-                            ui->eyeDropperTool->setDefault(false);
-                        });
-    QMainWindow::connect(ui->fillTool, &QPushButton::clicked,
-                         &editor,
-                        [&editor, ui]() {
-                            editor.setActiveTool(ToolType::Fill);
-                            ui->penTool->setDefault(false);
-                            ui->eraserTool->setDefault(false);
-                            ui->fillTool->setDefault(true);
-                            ui->eyeDropperTool->setDefault(false);
-                        });
-    QMainWindow::connect(ui->eyeDropperTool, &QPushButton::clicked,
-                         &editor,
-                        [&editor, ui]() {
-                            editor.setActiveTool(ToolType::EyeDropper);
-                            ui->penTool->setDefault(false);
-                            ui->eraserTool->setDefault(false);
-                            ui->fillTool->setDefault(false);
-                            ui->eyeDropperTool->setDefault(true);
-                        });
+    // each button picks its tool and is the only one left highlighted
+    const QList<QPair<QPushButton*, ToolType>> toolButtons = {
+        {ui->penTool, ToolType::Pen},
+        {ui->eraserTool, ToolType::Eraser},
+        {ui->fillTool, ToolType::Fill},
+        {ui->eyeDropperTool, ToolType::EyeDropper},
+        {ui->selectTool, ToolType::RectangleSelect},
+        {ui->lassoTool, ToolType::LassoSelect},
+        {ui->wandTool, ToolType::MagicWand},
+        {ui->moveTool, ToolType::Move},
+        {ui->lineTool, ToolType::Line},
+        {ui->rectangleTool, ToolType::Rectangle},
+        {ui->filledRectangleTool, ToolType::FilledRectangle},
+        {ui->ellipseTool, ToolType::Ellipse},
+    };
+    for (const auto &[button, tool] : toolButtons) {
+        QMainWindow::connect(button, &QPushButton::clicked,
+                             this,
+                            [this, toolButtons, button = button, tool = tool]() {
+                                MainWindow::tool = tool; // remembered for the documents opened later
+                                emit toolSelected(tool);
+                                for (const auto &other : toolButtons)
+                                    other.first->setDefault(other.first == button);
+                            });
+    }
 }
 
-void MainWindow::setupAnimationPreview(Ui::MainWindow *ui, Editor &editor) {
+void MainWindow::setupAnimationPreview(Ui::MainWindow *ui) {
 
     Preview *animPrev = ui->animationPreview;
 
-    QMainWindow::connect(&editor, &Editor::frameUpdated,
-                         animPrev,
-                        [animPrev, this](QImage &image) {
-                             animPrev->receiveFrame(image, currentFrame);
-                        });
-
     QMainWindow::connect(ui->fpsSlider, &QSlider::valueChanged,
                          animPrev, &Preview::fpsChanged);
 
-    QMainWindow::connect(this, &MainWindow::frameDeleted,
-                         animPrev, &Preview::deleteFrame);
-
-    QMainWindow::connect(this, &MainWindow::frameAdded,
-                         animPrev, &Preview::addEmptyFrame);
-
-    QMainWindow::connect(&editor, &Editor::addClonedImageToPreview,
-                         animPrev, &Preview::addClonedImageToPreview);
-
     QMainWindow::connect(ui->actualSizeButton, &QCheckBox::stateChanged,
-                         &editor,
-                        [animPrev, &editor](bool actualSize) {
-                            animPrev->setDisplayActualSize(actualSize);
-                            editor.getFrames();
-                        });
-
-    QMainWindow::connect(&editor, &Editor::sendFrames,
-                         animPrev, &Preview::loadNewFrames);
+                         animPrev, &Preview::setDisplayActualSize);
 
     animPrev->startPreview(ui->fpsSlider->value());
 }
 
-void MainWindow::setupFrameSelection(Ui::MainWindow *ui, Editor &editor) {
+void MainWindow::setupFrameSelection(Ui::MainWindow *ui) {
     QMainWindow::connect(ui->addFrame, &QPushButton::clicked,
                          this, &MainWindow::addFrame);
     QMainWindow::connect(ui->deleteFrame, &QPushButton::clicked,
                          this, &MainWindow::deleteFrame);
     QMainWindow::connect(ui->cloneFrame, &QPushButton::clicked,
                          this, &MainWindow::cloneFrame);
-
-    QMainWindow::connect(this, &MainWindow::frameSelected,
-                         &editor, &Editor::updateCurrentFrame);
-    QMainWindow::connect(this, &MainWindow::frameAdded,
-                         &editor, &Editor::addEmptyFrame);
-    QMainWindow::connect(this, &MainWindow::frameDeleted,
-                         &editor, &Editor::removeFrameSlot);
-
-    QMainWindow::connect(this, &MainWindow::frameCloned,
-                         &editor, &Editor::duplicateFrame);
-    QMainWindow::connect(&editor, &Editor::sendFrameButtonImage,
-                         this, &MainWindow::receiveFrameButtonImage);
-
 }
 
-void MainWindow::setupActions(Ui::MainWindow *ui, Editor &editor) {
+void MainWindow::setupActions(Ui::MainWindow *ui) {
     connect(ui->actionNew, &QAction::triggered, this, &MainWindow::newSprite);
     connect(ui->actionSave, &QAction::triggered, this, &MainWindow::saveSprite);
     connect(ui->actionLoad, &QAction::triggered, this, &MainWindow::loadSprite);
-
-    connect(this,&MainWindow::createNewSpriteSignal, &editor, &Editor::createNewSpriteSlot);
-    connect(this,&MainWindow::saveSpriteSignal, &editor, &Editor::saveSlot);
-    connect(this,&MainWindow::loadSpiteSignal, &editor, &Editor::loadSlot);
-
-    connect(&editor, &Editor::insertFrameButton, this, &MainWindow::insertFrameButton);
+    connect(ui->actionReopenLast, &QAction::triggered, this, &MainWindow::reopenLastSprite);
+    ui->actionReopenLast->setEnabled(editorSettings().contains(kLastSpriteKey));
+    connect(ui->actionExportAnimation, &QAction::triggered, this, &MainWindow::exportAnimation);
+    connect(ui->actionImportImageSequence, &QAction::triggered, this, &MainWindow::importImageSequence);
+    connect(ui->actionImportSpriteSheet, &QAction::triggered, this, &MainWindow::importSpriteSheet);
+
+    connect(ui->actionMemoryLimit, &QAction::triggered, this, &MainWindow::setMemoryLimit);
+    connect(this,&MainWindow::memoryLimitSignal, &workspace, &Workspace::setMemoryBudget);
+    connect(ui->actionHostSession, &QAction::triggered, this, &MainWindow::hostSession);
+    connect(ui->actionJoinSession, &QAction::triggered, this, &MainWindow::joinSession);
+
+    // the symmetry modes are checked one at a time, like radio buttons
+    QActionGroup *symmetryGroup = new QActionGroup(this);
+    const QList<QPair<QAction*, SymmetryMode>> symmetryActions = {
+        {ui->actionSymmetryNone, SymmetryMode::None},
+        {ui->actionSymmetryHorizontal, SymmetryMode::Horizontal},
+        {ui->actionSymmetryVertical, SymmetryMode::Vertical},
+        {ui->actionSymmetryBoth, SymmetryMode::Both},
+        {ui->actionSymmetryRadial, SymmetryMode::Radial},
+    };
+    for (const auto &[action, mode] : symmetryActions) {
+        symmetryGroup->addAction(action);
+        connect(action, &QAction::triggered, this, [this, mode = mode]() {
+            symmetry = mode; // remembered for the documents opened later
+            emit symmetrySignal(mode);
+        });
+    }
+    connect(ui->actionWrapAround, &QAction::toggled, ui->canvas, &Canvas::setTiled);
+    connect(ui->actionReplaceColor, &QAction::triggered, this, &MainWindow::replaceColor);
+    connect(ui->actionShiftFrames, &QAction::triggered, this, &MainWindow::shiftFrames);
+    connect(ui->actionFilters, &QAction::triggered, this, &MainWindow::openFilters);
+    connect(ui->actionRotateByAngle, &QAction::triggered, this, &MainWindow::rotateByAngle);
+    connect(ui->actionScaleSprite, &QAction::triggered, this, &MainWindow::scaleSprite);
+    connect(ui->actionTweenFrames, &QAction::triggered, this, &MainWindow::tweenFrames);
+    connect(ui->actionResizeCanvas, &QAction::triggered, this, &MainWindow::resizeCanvas);
+    connect(ui->actionReduceColors, &QAction::triggered, this, &MainWindow::reduceColors);
+    connect(ui->actionIndexedColor, &QAction::toggled, this, &MainWindow::indexedColorSignal);
+    connect(ui->actionChangePaletteColor, &QAction::triggered, this, &MainWindow::changePaletteColor);
+    connect(ui->actionFlipHorizontal, &QAction::triggered, this,
+            [this]() { emit frameOperationSignal(FrameOperation::flipHorizontal(), {}); });
+    connect(ui->actionFlipVertical, &QAction::triggered, this,
+            [this]() { emit frameOperationSignal(FrameOperation::flipVertical(), {}); });
+    connect(ui->actionRotateClockwise, &QAction::triggered, this,
+            [this]() { emit frameOperationSignal(FrameOperation::rotate90(true), {}); });
+    connect(ui->actionRotateCounterclockwise, &QAction::triggered, this,
+            [this]() { emit frameOperationSignal(FrameOperation::rotate90(false), {}); });
+    connect(ui->actionClearFrames, &QAction::triggered, this,
+            [this]() { emit frameOperationSignal(FrameOperation::clear(), {}); });
 }
 
-void MainWindow::setupColorPicker(Ui::MainWindow *ui, Editor &editor) {
+void MainWindow::setupColorPicker(Ui::MainWindow *ui) {
     QPushButton *colorPicker = ui->colorPicker;
 
     QMainWindow::connect(colorPicker, &QPushButton::clicked,
-                         &editor,
-                        [&editor]() {
+                         this,
+                        [this]() {
                             // Sets the paint color using a QColorDialog
-                            editor.setColor(QColorDialog::getColor(Qt::GlobalColor::white, nullptr, QString(), QColorDialog::ShowAlphaChannel));
-                        });
-    QMainWindow::connect(&editor, &Editor::colorChanged,
-                         colorPicker,
-                        [colorPicker](const QColor &newColor) {
-                            // Sets the background color using a QColorDialog
-                            QPalette pal = colorPicker->palette();
-                            pal.setBrush(QPalette::AlternateBase, newColor);
-                            colorPicker->setPalette(pal);
-                            colorPicker->setBackgroundRole(QPalette::AlternateBase);
+                            QColor color = QColorDialog::getColor(Qt::GlobalColor::white, nullptr, QString(), QColorDialog::ShowAlphaChannel);
+                            if (color.isValid())
+                                emit colorSelected(color);
                         });
+}
 
-    editor.setColor(QColorConstants::Black);
+void MainWindow::setupMemoryView(Ui::MainWindow *ui) {
+    memoryLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(memoryLabel);
+    QTimer *memoryTimer = new QTimer(this);
+    connect(memoryTimer, &QTimer::timeout, this, &MainWindow::showMemoryUse);
+    memoryTimer->start(kMemoryViewInterval);
+    showMemoryUse();
+
+    // thumbnails dropped to stay in budget are drawn again as their buttons scroll back into view
+    connect(ui->framesScrollArea->horizontalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::updateThumbnails);
 }
 
-void MainWindow::setupCanvas(Ui::MainWindow *ui, Editor &editor) {
+void MainWindow::setupDocuments(Ui::MainWindow *ui) {
+    ui->documentTabs->setTabsClosable(true);
+    ui->documentTabs->setExpanding(false);
+    ui->documentTabs->setDocumentMode(true);
+    for (size_t i = 0; i < workspace.getDocuments().size(); i++)
+        ui->documentTabs->addTab("Untitled");
+
+    connect(ui->documentTabs, &QTabBar::currentChanged, this, &MainWindow::switchDocument);
+    connect(ui->documentTabs, &QTabBar::tabCloseRequested, this, &MainWindow::closeDocument);
+    connect(ui->actionCloseDocument, &QAction::triggered, this,
+            [this, ui]() { closeDocument(ui->documentTabs->currentIndex()); });
+    connect(&workspace, &Workspace::activeChanged, this, &MainWindow::showDocument);
+    showDocument(editor);
+}
 
-    QMainWindow::connect(&editor, &Editor::frameUpdated,
-                         ui->canvas, &Canvas::setImage);
-    QMainWindow::connect(ui->canvas, &Canvas::mouseAction,
-                         &editor, &Editor::editFrame);
+void MainWindow::connectEditor(Editor &editor) {
+    for (const QMetaObject::Connection &connection : editorConnections)
+        disconnect(connection);
+
+    // only the document in front hears from the window, and only it is heard
+    editorConnections = {
+        connect(this, &MainWindow::toolSelected, &editor, &Editor::setActiveTool),
+        connect(this, &MainWindow::colorSelected, &editor, &Editor::setColor),
+        connect(this, &MainWindow::symmetrySignal, &editor, &Editor::setSymmetry),
+        connect(ui->actionWrapAround, &QAction::toggled, &editor, &Editor::setWrapAround),
+        connect(ui->canvas, &Canvas::mouseAction, &editor, &Editor::editFrame),
+
+        connect(this, &MainWindow::frameSelected, &editor, &Editor::updateCurrentFrame),
+        connect(this, &MainWindow::frameAdded, &editor, &Editor::addEmptyFrame),
+        connect(this, &MainWindow::frameDeleted, &editor, &Editor::removeFrameSlot),
+        connect(this, &MainWindow::frameCloned, &editor, &Editor::duplicateFrame),
+
+        connect(this, &MainWindow::saveSpriteSignal, &editor, &Editor::saveSlot),
+        connect(ui->actionCompactArchive, &QAction::triggered, &editor, &Editor::compactArchiveSlot),
+        connect(ui->actionCompressSavedFrames, &QAction::toggled, &editor, &Editor::setSaveCompression),
+        connect(this, &MainWindow::loadSpiteSignal, &editor, &Editor::loadSlot),
+        connect(this, &MainWindow::exportAnimationSignal, &editor, &Editor::exportSlot),
+        connect(ui->actionTrimExports, &QAction::toggled, &editor, &Editor::setExportTrim),
+        connect(this, &MainWindow::importImageSequenceSignal, &editor, &Editor::importImageSequenceSlot),
+        connect(this, &MainWindow::importSpriteSheetSignal, &editor, &Editor::importSpriteSheetSlot),
+
+        connect(ui->actionUndo, &QAction::triggered, &editor, &Editor::undo),
+        connect(ui->actionRedo, &QAction::triggered, &editor, &Editor::redo),
+        connect(ui->actionCut, &QAction::triggered, &editor, &Editor::cutSelection),
+        connect(ui->actionCopy, &QAction::triggered, &editor, &Editor::copySelection),
+        connect(ui->actionPaste, &QAction::triggered, &editor, &Editor::pasteSelection),
+        connect(ui->actionDeleteSelection, &QAction::triggered, &editor, &Editor::deleteSelection),
+        connect(ui->actionSelectAll, &QAction::triggered, &editor, &Editor::selectAll),
+        connect(ui->actionDeselect, &QAction::triggered, &editor, &Editor::deselect),
+        connect(ui->actionCopyFrame, &QAction::triggered, &editor, &Editor::copyFrame),
+        connect(ui->actionPasteFrame, &QAction::triggered, &editor, &Editor::pasteFrame),
+
+        connect(this, &MainWindow::frameOperationSignal, &editor, &Editor::applyFrameOperation),
+        connect(this, &MainWindow::tweenFramesSignal, &editor, &Editor::tweenFrames),
+        connect(this, &MainWindow::resizeSpriteSignal, &editor, &Editor::resizeSprite),
+        connect(ui->actionAutoCrop, &QAction::triggered, &editor, &Editor::autoCrop),
+        connect(this, &MainWindow::reduceColorsSignal, &editor, &Editor::reduceColors),
+        connect(this, &MainWindow::indexedColorSignal, &editor, &Editor::setIndexedColor),
+        connect(this, &MainWindow::paletteColorSignal, &editor, &Editor::replacePaletteColor),
+
+        connect(this, &MainWindow::joinSessionSignal, &editor, &Editor::joinSession),
+        connect(ui->actionLeaveSession, &QAction::triggered, &editor, &Editor::leaveSession),
+
+        connect(&editor, &Editor::snapshotPublished, this, &MainWindow::showSnapshot),
+        connect(&editor, &Editor::colorChanged, this, &MainWindow::showColor),
+        connect(&editor, &Editor::sendStatusMessage, this, [this](QString message) { ui->statusbar->showMessage(message); }),
+    };
+
+    // a document brought to the front draws the way the window is set up to, whatever it did before
+    emit toolSelected(tool);
+    emit colorSelected(color);
+    emit symmetrySignal(symmetry);
+    bool wrapAround = ui->actionWrapAround->isChecked();
+    bool compress = ui->actionCompressSavedFrames->isChecked();
+    bool trim = ui->actionTrimExports->isChecked();
+    QMetaObject::invokeMethod(&editor, [&editor, wrapAround, compress, trim]() {
+        editor.setWrapAround(wrapAround);
+        editor.setSaveCompression(compress);
+        editor.setExportTrim(trim);
+    });
 }
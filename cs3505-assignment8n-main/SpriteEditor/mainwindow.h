@@ -6,13 +6,20 @@
 #include <QPushButton>
 #include <QImage>
 #include "editor.h"
+#include "spritesnapshot.h"
+#include "memorybudget.h"
 #include <qinputdialog.h>
 #include <QMutex>
+
+class Workspace;
 /*
  * main window class provides functionality for dispaly features of the main window.
  * the mainwindow class includes frame selections, frame additions, frame deletions, frame clones, loading
  * and saving sprites, creating new sprites. the main window also has the ability to select pixles on a canvas
  * according to the selected tool and color, pen (this includes dragging), erase, eyedroper tool and fill tool.
+ * every open sprite gets a tab, and the window only talks to the one in front, so switching tabs moves its
+ * connections over to the newly picked document. only what the canvas needs to be edited is set up before the
+ * window is first painted, the preview and memory view are set up right after.
  * @authors: Noah Campbell, Will Black, Tanner Bergstrom, Tj Hess and Kevin Christiansen
  * @ version 3/31/2024
  */
@@ -24,7 +31,7 @@ class MainWindow : public QMainWindow
 {
     Q_OBJECT
     public:
-        MainWindow(Editor &editor, QWidget *parent = nullptr);
+        MainWindow(Workspace &workspace, QWidget *parent = nullptr);
         ~MainWindow();
 
         QFileDialog fileDialog;
@@ -33,8 +40,27 @@ class MainWindow : public QMainWindow
 
         std::vector<QPushButton*> frameButtons;
 
+        std::vector<quint64> thumbnailKeys; // key of the frame handle each frame button's thumbnail was made from, 0 for none
+
+        std::vector<quint64> thumbnailShown; // when each frame button was last on screen, for dropping the least recent
+
+        /// A frame button's thumbnail made by a worker, from a frame read from the sprite's archive
+        struct Thumbnail {
+            int index = 0;   // the frame button it is for
+            quint64 key = 0; // the key of the frame handle it was made from
+            QImage image;
+        };
+
         int currentFrame;
     signals:
+        /// @brief tells the editor which tool the user picked
+        /// @param the tool to use
+        void toolSelected(ToolType tool);
+
+        /// @brief tells the editor which color the user picked
+        /// @param the color to paint with
+        void colorSelected(const QColor &color);
+
         /// @brief sends the signal that the frame button has been pushed
         void frameAdded();
 
@@ -52,11 +78,6 @@ class MainWindow : public QMainWindow
         /// @param the frames actual size in height
         void updatePreviewFrame(int frameRate, bool showPreviewActualSize, int actualSizeWidth, int actualSizeHeight);
 
-        /// @brief the signal to create a new sprite sent to the editor
-        /// @param the new sprites width
-        /// @param the new sprties height
-        void createNewSpriteSignal(int width,int height);
-
         /// @brief The signal to save the current sprite to the said filename
         /// @brief the specified filename
         void saveSpriteSignal(QString filename);
@@ -65,6 +86,64 @@ class MainWindow : public QMainWindow
         /// @param the file path to load from
         void loadSpiteSignal(QString filepath);
 
+        /// @brief the signal to change how much memory frames read from an archive may use
+        /// @param the memory limit in bytes
+        void memoryLimitSignal(qint64 bytes);
+
+        /// @brief the signal to export the sprite as an animation to the said file path
+        /// @param the file path to export to
+        /// @param the frame rate the animation plays at
+        /// @param true if each GIF frame should get its own palette
+        void exportAnimationSignal(QString filepath, int frameRate, bool perFramePalette);
+
+        /// @brief the signal to build a new sprite from a folder of png images
+        /// @param the folder to import
+        void importImageSequenceSignal(QString folderPath);
+
+        /// @brief the signal to build a new sprite by slicing a sprite sheet
+        /// @param the sprite sheet to import
+        /// @param the width of a frame on the sheet
+        /// @param the height of a frame on the sheet
+        void importSpriteSheetSignal(QString filepath, int cellWidth, int cellHeight);
+
+        /// @brief the signal to change every frame at once with an operation
+        /// @param the operation to apply
+        /// @param the frames to apply it to, empty for all of them
+        void frameOperationSignal(FrameOperation operation, std::vector<int> frameIndices);
+
+        /// @brief the signal to build frames in between two key frames
+        /// @param one key frame
+        /// @param the other key frame
+        /// @param how many frames to put in between
+        /// @param how to build them
+        void tweenFramesSignal(int firstFrame, int lastFrame, int count, FrameTween tween);
+
+        /// @brief the signal to scale the sprite or resize its canvas
+        /// @param the transform to apply to every frame
+        void resizeSpriteSignal(FrameTransform transform);
+
+        /// @brief the signal to reduce the sprite to a few colors
+        /// @param the most colors to keep
+        /// @param true to dither the colors in between
+        void reduceColorsSignal(int colorCount, bool dither);
+
+        /// @brief the signal to switch the sprite between indexed and full color
+        /// @param true to store the frames as palette indices
+        void indexedColorSignal(bool indexed);
+
+        /// @brief the signal to change a color of the sprite's palette
+        /// @param the palette color to change
+        /// @param the color to change it to
+        void paletteColorSignal(QRgb from, QRgb to);
+
+        /// @brief the signal to change the copies the drawing tools make
+        /// @param the symmetry to draw with
+        void symmetrySignal(SymmetryMode mode);
+
+        /// @brief the signal to join a collaboration session with the document in front
+        /// @param the relay's local socket name, or host:port on the loopback address
+        void joinSessionSignal(QString address);
+
         /// @brief the signal to update the editor that a frame has been deleted
         /// @param the index of the frame
         void frameDeleted(int frameIndex);
@@ -82,6 +161,61 @@ class MainWindow : public QMainWindow
         /// @brief the slot that catches the event of load sprite being pushed
         void loadSprite();
 
+        /// @brief the slot that catches the event of reopen last being pushed, loads the last sprite saved or
+        /// loaded into a new tab
+        void reopenLastSprite();
+
+        /// @brief the slot that catches the event of memory limit being pushed
+        void setMemoryLimit();
+
+        /// @brief the slot that catches the event of export animation being pushed
+        void exportAnimation();
+
+        /// @brief the slot that catches the event of import png sequence being pushed
+        void importImageSequence();
+
+        /// @brief the slot that catches the event of import sprite sheet being pushed
+        void importSpriteSheet();
+
+        /// @brief the slot that catches the event of host session being pushed, starts a relay and joins it
+        void hostSession();
+
+        /// @brief the slot that catches the event of join session being pushed, joins in a new tab
+        void joinSession();
+
+        /// @brief the slot that catches the event of replace color being pushed
+        void replaceColor();
+
+        /// @brief the slot that catches the event of shift frames being pushed
+        void shiftFrames();
+
+        /// @brief the slot that catches the event of tween frames being pushed, asks for the key frames and the kind
+        /// of tween
+        void tweenFrames();
+
+        /// @brief the slot that catches the event of reduce colors being pushed
+        void reduceColors();
+
+        /// @brief the slot that catches the event of change paint color in palette being pushed
+        void changePaletteColor();
+
+        /// @brief the slot that catches the event of rotate by angle being pushed
+        void rotateByAngle();
+
+        /// @brief the slot that catches the event of scale sprite being pushed
+        void scaleSprite();
+
+        /// @brief the slot that catches the event of resize canvas being pushed
+        void resizeCanvas();
+
+        /// @brief the slot that catches the event of filters being pushed, previews the filters until the
+        /// dialog closes
+        void openFilters();
+
+        /// @brief shows the current frame on the canvas with filters run over it, without changing the sprite
+        /// @param the filters to preview, empty to show the frame as it is
+        void previewFilters(const FilterPipeline &filters);
+
         /// @brief the slot that catches the event of add frame button being pushed
         void addFrame();
 
@@ -90,54 +224,116 @@ class MainWindow : public QMainWindow
 
         /// @brief the slot that catches the event of delete frame button being pushed
         void deleteFrame();
+
+        /// @brief brings the document of a tab to the front when the tab is picked
+        /// @param the index of the tab
+        void switchDocument(int index);
+
+        /// @brief closes the document of a tab, unless it is the only one open
+        /// @param the index of the tab
+        void closeDocument(int index);
+
+        /// @brief moves the window's connections over to the document now in front and shows it
+        /// @param the document in front
+        void showDocument(Editor *document);
+
+        /// @brief shows the color the editor is painting with on the color picker
+        /// @param the color
+        void showColor(const QColor &newColor);
     private:
         Ui::MainWindow *ui;
+        Workspace &workspace; // every open document
+        Editor *editor; // the document in front, only read through its snapshots, everything else goes through signals
+        std::vector<QMetaObject::Connection> editorConnections; // the window's connections to the document in front
+        SymmetryMode symmetry = SymmetryMode::None; // the symmetry the window last picked, for documents brought to the front
+        MemoryReport thumbnailReport{MemoryUse::Thumbnails}; // memory the frame buttons' thumbnails take
+        MemoryReport poolReport{MemoryUse::BufferPool}; // memory the buffer pool keeps for reuse
+        quint64 shownVersion = 0; // version of the last snapshot shown
+        std::shared_ptr<const SpriteSnapshot> shownSnapshot; // the last snapshot shown, for drawing thumbnails scrolled to
+        quint64 thumbnailClock = 0; // counts thumbnail updates, the timestamp in thumbnailShown
+        QLabel *memoryLabel = nullptr; // the memory in use, shown at the end of the status bar, once it is set up
+        qint64 shownCanvasKey = 0; // cache key of the image the canvas shows
         QInputDialog inputDialog; // this is the custom dialog box that appears when the user presses new sprite
         ToolType tool = ToolType::Pen;
+        FilterPipeline previewedFilters; // filters the canvas shows over the current frame while choosing them
+
+        /// @brief creates a frame button at the end of the frame strip
+        /// @param the index of the frame the button selects
+        /// @return the new button
+        QPushButton* createFrameButton(int frameButtonNum);
 
         /// @brief sets up connection methods for the tools.
         /// @param mainWindow
-        /// @param editor
-        void setupTools(Ui::MainWindow *ui, Editor &editor);
+        void setupTools(Ui::MainWindow *ui);
 
         /// @brief sets up connection methods for the animationPreiew.
         /// @param mainWindow
-        /// @param editor
-        void setupAnimationPreview(Ui::MainWindow *ui, Editor &editor);
+        void setupAnimationPreview(Ui::MainWindow *ui);
 
         /// @brief sets up connection methods for the frameSelection.
         /// @param mainWindow
-        /// @param editor
-        void setupFrameSelection(Ui::MainWindow *ui, Editor &editor);
+        void setupFrameSelection(Ui::MainWindow *ui);
 
         /// @brief sets up connection methods for the colorPicker.
         /// @param mainWindow
-        /// @param editor
-        void setupColorPicker(Ui::MainWindow *ui, Editor &editor);
+        void setupColorPicker(Ui::MainWindow *ui);
 
         /// @brief sets up main window.
         /// @param mainWindow
-        /// @param editor
-        void setupActions(Ui::MainWindow *ui, Editor &editor);
+        void setupActions(Ui::MainWindow *ui);
+
+        /// @brief sets up the tabs of the open documents and shows the one in front
+        /// @param mainWindow
+        void setupDocuments(Ui::MainWindow *ui);
+
+        /// @brief connects the window to a document, dropping its connections to the one before, and hands
+        /// it the tool, color and drawing options picked in the window
+        /// @param the document
+        void connectEditor(Editor &editor);
+
+        /// @brief opens a new document in a tab of its own and brings it to the front
+        /// @param the name on the tab
+        /// @param the sprite's width
+        /// @param the sprite's height
+        void openDocument(const QString &title, int width = 10, int height = 10);
 
-        /// @brief sets up canvas and its connections
+        /// @brief sets up the memory use shown in the status bar, which keeps itself up to date
         /// @param mainWindow
-        /// @param editor
-        void setupCanvas(Ui::MainWindow *ui, Editor &editor);
+        void setupMemoryView(Ui::MainWindow *ui);
+
+        /// @brief sets up the panels the canvas can be edited without, once the window has been painted, and
+        /// shows how long starting up took
+        void finishStartup();
+
+        /// @brief remembers a sprite file for reopen last
+        /// @param the path of the file
+        void rememberLastSprite(const QString &filepath);
+
+        /// @brief draws the thumbnails of the frame buttons on screen that are out of date. only those frames are
+        /// made into images, the buttons off screen keep what they were last drawn with while the thumbnails fit
+        /// their share of the memory budget, past that the ones off screen longest lose theirs until they are
+        /// scrolled back to. frames read from the sprite's archive are made by a worker, their buttons stay blank
+        /// until it is done
+        void updateThumbnails();
+
+        /// @brief starts a worker making the thumbnails of frames read from the sprite's archive, and puts each on
+        /// its button when it is done unless the button has moved on to another frame since
+        /// @param frames the frame buttons and the handles of their frames
+        void readThumbnails(std::vector<std::pair<int, FrameHandle>> frames);
+
+        /// @brief shows the memory in use against the budget, with every part of it in the tooltip
+        void showMemoryUse();
+    protected:
+        /// @brief watches for the canvas being painted with the first sprite shown, to finish starting up
+        bool eventFilter(QObject *watched, QEvent *event) override;
     public slots:
         /// @brief the slot that catchs the event of the create new sprite button being pushed
         /// @param new sprites height
         /// @param new sprites width
         void createNewSprite(QString size);
 
-        /// @brief inserts the frame in the horizontal layout for display at the given index
-        /// @param the index to place the button at
-        void insertFrameButton(int frameButtonNum);
-
-        /// @brief the slot to recive and display the corisponding frame to the frame button
-        /// @param the image/frame to display
-        /// @param the button index to place the image on
-        void receiveFrameButtonImage(QImage image, int index);
+        /// @brief reads the editor's latest snapshot and brings the frame buttons, canvas and preview up to date
+        void showSnapshot();
 
         /// @brief send handles the event of a frame button being clicked
         /// @param the index of the frame on the horizontal layout
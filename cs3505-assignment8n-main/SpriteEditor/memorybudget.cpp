@@ -0,0 +1,63 @@
+#include "memorybudget.h"
+
+qint64 MemoryBudget::Usage::total() const {
+    qint64 sum = 0;
+    for (qint64 used : bytes)
+        sum += used;
+    return sum;
+}
+
+MemoryBudget& MemoryBudget::instance() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+QString MemoryBudget::name(MemoryUse use) {
+    switch (use) {
+    case MemoryUse::SpriteFrames:
+        return "Frames";
+    case MemoryUse::IndexedFrames:
+        return "Indexed frames";
+    case MemoryUse::UndoHistory:
+        return "Undo history";
+    case MemoryUse::FrameImages:
+        return "Frame images";
+    case MemoryUse::Canvas:
+        return "Canvas";
+    case MemoryUse::Preview:
+        return "Preview";
+    case MemoryUse::Thumbnails:
+        return "Thumbnails";
+    case MemoryUse::BufferPool:
+        return "Free buffers";
+    }
+    return QString();
+}
+
+MemoryBudget::Usage MemoryBudget::getUsage() const {
+    Usage usage;
+    for (int use = 0; use < kUseCount; use++)
+        usage.bytes[use] = usedBytes[use];
+    usage.budget = budget;
+    return usage;
+}
+
+qint64 MemoryBudget::share(MemoryUse use) const {
+    // the shares add up to the whole budget. the frame images take half of what the buffer pool kept on its own,
+    // the rest match the caps each cache had on its own with the defaults
+    switch (use) {
+    case MemoryUse::SpriteFrames:
+        return budget / 2;
+    case MemoryUse::UndoHistory:
+        return budget / 4;
+    case MemoryUse::FrameImages:
+    case MemoryUse::Preview:
+    case MemoryUse::Thumbnails:
+    case MemoryUse::BufferPool:
+        return budget / 16;
+    case MemoryUse::IndexedFrames: // the only copy of an indexed sprite's frames, so there is nothing to drop
+    case MemoryUse::Canvas:        // only ever the one frame on screen
+        return 0;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QString>
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+
+/// The parts of the editor that hold on to pixel memory
+enum class MemoryUse {
+    SpriteFrames = 0,  // full color frames of the sprite held in memory
+    IndexedFrames = 1, // frames of an indexed sprite held as palette indices
+    UndoHistory = 2,   // frames only the undo and redo history still holds
+    FrameImages = 3,   // the current frame's image and the images of the frames shown before it
+    Canvas = 4,        // the frame, overlay and tiles the canvas is showing
+    Preview = 5,       // frames the animation preview has scaled to its size
+    Thumbnails = 6,    // the frame buttons' thumbnails
+    BufferPool = 7     // freed pixel buffers the pool keeps for reuse
+};
+
+/*
+ * the memory budget keeps a running tally of how much memory each part of the editor is using and one cap
+ * for all of them together. each part reports its own total through a MemoryReport whenever it changes, from
+ * whatever thread it runs on, and anything can ask for the tally. the parts that are caches, the decoded frames, undo history,
+ * frame images, preview, thumbnails and the buffer pool, each get a fixed share of the cap and drop their least
+ * recently used entries to stay inside it, so a long editing session levels off instead of growing without end.
+ */
+class MemoryBudget
+{
+public:
+    /// Number of different memory uses
+    static constexpr int kUseCount = 8;
+
+    /// The cap on memory when nothing else is set
+    static constexpr qint64 kDefaultBudget = 512 * 1024 * 1024;
+
+    /// The memory each use was taking when the tally was read
+    struct Usage {
+        std::array<qint64, kUseCount> bytes = {}; // indexed by MemoryUse
+        qint64 budget = 0;                        // the cap they all share
+
+        qint64 operator[](MemoryUse use) const { return bytes[int(use)]; }
+
+        /// @brief adds up every use
+        qint64 total() const;
+    };
+
+    /// @brief gets the budget every part of the editor reports to
+    static MemoryBudget& instance();
+
+    /// @brief gets the name of a use, for showing the tally
+    static QString name(MemoryUse use);
+
+    /// @brief reads the whole tally at once
+    Usage getUsage() const;
+
+    /// @brief gets the cap on all memory uses together
+    qint64 getBudget() const { return budget; }
+
+    /// @brief sets the cap on all memory uses together. Caches only shrink to their new share the next time
+    /// they add something, or when told to right away
+    void setBudget(qint64 bytes) { budget = bytes; }
+
+    /// @brief gets how much of the cap a cache may fill before it drops its least recently used entries
+    /// @param use the cache, a use that is not a cache gets no share
+    qint64 share(MemoryUse use) const;
+private:
+    friend class MemoryReport;
+
+    std::array<std::atomic<qint64>, kUseCount> usedBytes = {};
+    std::atomic<qint64> budget{kDefaultBudget};
+
+    MemoryBudget() = default;
+
+    /// @brief adds to the memory a use is taking up, or takes away from it if bytes is negative
+    void add(MemoryUse use, qint64 bytes) { usedBytes[int(use)] += bytes; }
+};
+
+/*
+ * a memory report is one owner's part of a memory use. every open document reports its own frames and undo
+ * history, so the tally for a use is the sum of every report on it. an owner keeps its report as a member,
+ * sets it to everything it holds whenever that changes, and the report takes itself out of the tally when
+ * the owner goes away.
+ */
+class MemoryReport
+{
+public:
+    explicit MemoryReport(MemoryUse use) : use(use) {}
+    ~MemoryReport() { set(0); }
+    MemoryReport(const MemoryReport&) = delete;
+    MemoryReport& operator=(const MemoryReport&) = delete;
+
+    /// @brief records how much memory the owner is taking up for its use now
+    /// @param bytes everything it holds, not the change since it last reported
+    void set(qint64 bytes) {
+        MemoryBudget::instance().add(use, bytes - reported);
+        reported = bytes;
+    }
+private:
+    MemoryUse use;
+    qint64 reported = 0;
+};
+
+#endif // MEMORYBUDGET_H
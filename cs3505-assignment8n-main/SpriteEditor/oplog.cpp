@@ -0,0 +1,197 @@
+#include "oplog.h"
+#include "byteorder.h"
+#include <QHostAddress>
+
+namespace {
+
+/// The largest message accepted, anything bigger is taken to be garbage on the socket
+const quint32 kMaxMessageSize = 512 * 1024 * 1024;
+
+/// Reads a body field by field, failing once anything runs past the end
+class BodyReader {
+public:
+    BodyReader(const QByteArray &data, qsizetype position) : data(data), position(position) {}
+
+    bool ok() const { return good; }
+
+    quint32 read32() {
+        if (!has(4))
+            return 0;
+        position += 4;
+        return readLittleEndian32(data, position - 4);
+    }
+
+    quint64 read64() {
+        if (!has(8))
+            return 0;
+        position += 8;
+        return readLittleEndian64(data, position - 8);
+    }
+
+    QByteArray readBytes(qsizetype count) {
+        if (!has(count))
+            return QByteArray();
+        position += count;
+        return data.mid(position - count, count);
+    }
+
+    QByteArray readRest() { return readBytes(data.size() - position); }
+private:
+    const QByteArray &data;
+    qsizetype position;
+    bool good = true;
+
+    bool has(qsizetype count) {
+        good = good && count >= 0 && position + count <= data.size();
+        return good;
+    }
+};
+
+}
+
+QByteArray OpLog::encode(const Op &op) {
+    QByteArray message;
+    appendLittleEndian32(message, 0); // the length, filled in once the body is written
+    message.append(char(op.kind));
+    appendLittleEndian64(message, op.sequence);
+    appendLittleEndian32(message, op.site);
+    appendLittleEndian32(message, op.localId);
+
+    switch (op.kind) {
+    case Kind::Welcome:
+        message.append(char(op.emptyLog));
+        break;
+    case Kind::Snapshot:
+    case Kind::Checkpoint:
+        appendLittleEndian64(message, op.base);
+        appendLittleEndian32(message, op.size.width());
+        appendLittleEndian32(message, op.size.height());
+        appendLittleEndian32(message, op.frameIds.size());
+        for (size_t index = 0; index < op.frameIds.size(); index++) {
+            appendLittleEndian64(message, op.frameIds[index]);
+            appendLittleEndian32(message, op.frames[index].size());
+            message.append(op.frames[index]);
+        }
+        break;
+    case Kind::CheckpointWanted:
+        break;
+    case Kind::FrameChanged:
+        appendLittleEndian64(message, op.frame);
+        appendLittleEndian32(message, op.area.x());
+        appendLittleEndian32(message, op.area.y());
+        appendLittleEndian32(message, op.area.width());
+        appendLittleEndian32(message, op.area.height());
+        message.append(op.pixels);
+        break;
+    case Kind::FrameInserted:
+        appendLittleEndian64(message, op.frame);
+        appendLittleEndian64(message, op.after);
+        message.append(op.pixels);
+        break;
+    case Kind::FrameErased:
+        appendLittleEndian64(message, op.frame);
+        break;
+    }
+
+    quint32 length = message.size() - 4;
+    for (int byte = 0; byte < 4; byte++)
+        message[byte] = char((length >> (8 * byte)) & 0xFF);
+    return message;
+}
+
+bool OpLog::takeMessage(QByteArray &buffer, QByteArray &message) {
+    if (buffer.size() < 4)
+        return false;
+    quint32 length = readLittleEndian32(buffer, 0);
+    if (length > kMaxMessageSize || length + 4 < quint32(kHeaderSize)) {
+        // nothing after a bad length can be trusted to line up with a message
+        message.clear();
+        buffer.clear();
+        return true;
+    }
+    if (buffer.size() < 4 + qsizetype(length))
+        return false;
+    message = buffer.left(4 + length);
+    buffer.remove(0, 4 + length);
+    return true;
+}
+
+bool OpLog::decode(const QByteArray &message, Op &op) {
+    if (message.size() < kHeaderSize || readLittleEndian32(message, 0) > kMaxMessageSize)
+        return false;
+    op = Op();
+    op.kind = kindOf(message);
+    op.sequence = readLittleEndian64(message, kSequenceOffset);
+    op.site = readLittleEndian32(message, kSiteOffset);
+    op.localId = readLittleEndian32(message, kSiteOffset + 4);
+
+    BodyReader body(message, kHeaderSize);
+    switch (op.kind) {
+    case Kind::Welcome:
+        op.emptyLog = body.readBytes(1) == QByteArray(1, char(1));
+        break;
+    case Kind::Snapshot:
+    case Kind::Checkpoint: {
+        op.base = body.read64();
+        int width = qint32(body.read32());
+        int height = qint32(body.read32());
+        op.size = QSize(width, height);
+        quint32 count = body.read32();
+        if (!body.ok() || width <= 0 || height <= 0 || count == 0 || count > quint32(message.size()))
+            return false;
+        for (quint32 index = 0; index < count && body.ok(); index++) {
+            op.frameIds.push_back(body.read64());
+            op.frames.push_back(body.readBytes(body.read32()));
+        }
+        break;
+    }
+    case Kind::CheckpointWanted:
+        break;
+    case Kind::FrameChanged: {
+        op.frame = body.read64();
+        int x = qint32(body.read32());
+        int y = qint32(body.read32());
+        int width = qint32(body.read32());
+        int height = qint32(body.read32());
+        op.area = QRect(x, y, width, height);
+        op.pixels = body.readRest();
+        if (op.area.isEmpty())
+            return false;
+        break;
+    }
+    case Kind::FrameInserted:
+        op.frame = body.read64();
+        op.after = body.read64();
+        op.pixels = body.readRest();
+        break;
+    case Kind::FrameErased:
+        op.frame = body.read64();
+        break;
+    default:
+        return false;
+    }
+    return body.ok();
+}
+
+quint64 OpLog::sequenceOf(const QByteArray &message) {
+    return readLittleEndian64(message, kSequenceOffset);
+}
+
+void OpLog::stamp(QByteArray &message, quint64 sequence, quint32 site) {
+    for (int byte = 0; byte < 8; byte++)
+        message[kSequenceOffset + byte] = char((sequence >> (8 * byte)) & 0xFF);
+    for (int byte = 0; byte < 4; byte++)
+        message[kSiteOffset + byte] = char((site >> (8 * byte)) & 0xFF);
+}
+
+quint64 OpLog::checkpointBase(const QByteArray &message) {
+    return message.size() >= kHeaderSize + 8 ? readLittleEndian64(message, kHeaderSize) : 0;
+}
+
+bool OpLog::readTcpAddress(const QString &address, QHostAddress &host, quint16 &port) {
+    QString hostName = address.section(':', 0, -2);
+    host = hostName.isEmpty() ? QHostAddress(QHostAddress::LocalHost) : QHostAddress(hostName);
+    bool ok = false;
+    port = address.section(':', -1).toUShort(&ok);
+    return ok && host.isLoopback();
+}
@@ -0,0 +1,95 @@
+#ifndef OPLOG_H
+#define OPLOG_H
+
+#include <QByteArray>
+#include <QRect>
+#include <QSize>
+#include <QString>
+#include <QtGlobal>
+#include <vector>
+
+class QHostAddress;
+/*
+ * the op log is the binary form of the edits a collaboration session trades through its relay. every
+ * message is a small header, its length, kind, sequence number, the site that made it and that site's own
+ * count of its messages, then a body that depends on the kind. frames are named by ids that never change
+ * instead of by their place in the sprite, so an edit still lands on the right frame when frames are added
+ * or removed by someone else at the same time. pixels travel run length encoded with the frame codec.
+ * the relay only ever reads and stamps the header, so it passes the bodies along without decoding them.
+ */
+class OpLog
+{
+public:
+    /// What a message does
+    enum class Kind : char {
+        Welcome = 'W',           // from the relay to a site that just connected, carrying its site id
+        Snapshot = 'S',          // the whole sprite, replacing whatever the sites had
+        Checkpoint = 'K',        // the whole sprite as of a sequence number, kept by the relay for sites that join later
+        CheckpointWanted = 'R',  // from the relay, asking a site for a checkpoint once the log has grown long
+        FrameChanged = 'F',      // a rectangle of a frame's pixels was replaced
+        FrameInserted = 'I',     // a frame was added after another one
+        FrameErased = 'E'        // a frame was removed
+    };
+
+    /// Bytes before the body of every message
+    static constexpr int kHeaderSize = 21; // length, kind, sequence, site, local id
+
+    /// Where the sequence number sits in a message, for the relay to stamp it
+    static constexpr int kSequenceOffset = 5;
+
+    /// Where the id of the site that sent a message sits, which the relay stamps too so no site can pass as another
+    static constexpr int kSiteOffset = 13;
+
+    /// One decoded message
+    struct Op {
+        Kind kind = Kind::FrameChanged;
+        quint64 sequence = 0;      // the order the relay put it in, counted up from 1, 0 until it is stamped
+        quint32 site = 0;          // the site that made it
+        quint32 localId = 0;       // counts the site's own messages, so it can tell its own when they come back
+        quint64 frame = 0;         // the frame a change, insert or erase is for
+        quint64 after = 0;         // for an insert, the frame it goes after, 0 for the front
+        QRect area;                // for a change, the pixels replaced
+        QByteArray pixels;         // the encoded pixels of a change's area or of an inserted frame
+        bool emptyLog = false;     // for a welcome, true if nothing has been logged yet, so the site should share its sprite
+        quint64 base = 0;          // for a checkpoint, the last sequence number it includes
+        QSize size;                // for a snapshot or checkpoint, the size of the sprite
+        std::vector<quint64> frameIds; // for a snapshot or checkpoint, every frame's id in order
+        std::vector<QByteArray> frames; // for a snapshot or checkpoint, every frame encoded, as deltas of the one before
+    };
+
+    /// @brief encodes a message, header and all, ready to write to a socket
+    static QByteArray encode(const Op &op);
+
+    /// @brief takes the next whole message off the front of what has been read from a socket
+    /// @param buffer the bytes read so far, the message is removed from its front
+    /// @param message set to the message's bytes, or emptied if the buffer holds garbage, which is dropped
+    /// @return false if the buffer does not hold a whole message yet
+    static bool takeMessage(QByteArray &buffer, QByteArray &message);
+
+    /// @brief decodes a message taken with takeMessage
+    /// @param message the message's bytes
+    /// @param op set to the decoded message
+    /// @return false if the message is damaged
+    static bool decode(const QByteArray &message, Op &op);
+
+    /// @brief reads the kind of a message without decoding it
+    static Kind kindOf(const QByteArray &message) { return Kind(message[4]); }
+
+    /// @brief reads the sequence number stamped on a message without decoding it
+    static quint64 sequenceOf(const QByteArray &message);
+
+    /// @brief stamps the relay's sequence number and the site that sent it into a message in place
+    static void stamp(QByteArray &message, quint64 sequence, quint32 site);
+
+    /// @brief reads the sequence number a checkpoint includes up to without decoding the rest
+    static quint64 checkpointBase(const QByteArray &message);
+
+    /// @brief tells if an address names a TCP port, like 127.0.0.1:4100 or :4100, rather than a local socket
+    static bool isTcpAddress(const QString &address) { return address.contains(':'); }
+
+    /// @brief reads the host and port of a TCP address, a missing host meaning the loopback address
+    /// @return false if the port is missing or the host is not on this machine, sessions never leave it
+    static bool readTcpAddress(const QString &address, QHostAddress &host, quint16 &port);
+};
+
+#endif // OPLOG_H
@@ -0,0 +1,108 @@
+#include "palette.h"
+#include <cstring>
+
+namespace {
+
+/// @brief turns a run of pixels of any format into ARGB colors. it is built once per format, so the loop
+/// never checks which format it is reading
+template<typename Format>
+void expandPixels(const typename Format::Pixel *pixels, QRgb *output, qsizetype count, const QRgb *lookup) {
+    for (qsizetype index = 0; index < count; index++)
+        output[index] = Format::toRgba(pixels[index], lookup);
+}
+
+}
+
+Palette::Palette() {
+    colors.append(qRgba(0, 0, 0, 0));
+    entries.insert(qRgba(0, 0, 0, 0), 0);
+}
+
+Palette::Palette(const QList<QRgb> &colorTable) : Palette() {
+    for (int index = 1; index < colorTable.size() && index < kMaxColors; index++) {
+        colors.append(colorTable[index]);
+        if (qAlpha(colorTable[index]) != 0 && !entries.contains(colorTable[index]))
+            entries.insert(colorTable[index], index);
+    }
+}
+
+int Palette::indexOf(QRgb color) const {
+    if (qAlpha(color) == 0)
+        return 0;
+    return entries.value(color, -1);
+}
+
+int Palette::addColor(QRgb color) {
+    int index = indexOf(color);
+    if (index >= 0)
+        return index;
+    if (colors.size() >= kMaxColors)
+        return -1;
+    colors.append(color);
+    entries.insert(color, colors.size() - 1);
+    return colors.size() - 1;
+}
+
+bool Palette::setColor(int index, QRgb color) {
+    if (index <= 0 || index >= colors.size())
+        return false;
+
+    // keep the lookup pointing at the first entry of each color, another entry may still hold the old one
+    QRgb old = colors[index];
+    colors[index] = color;
+    if (entries.value(old, -1) == index) {
+        entries.remove(old);
+        for (int other = 1; other < colors.size(); other++)
+            if (colors[other] == old) {
+                entries.insert(old, other);
+                break;
+            }
+    }
+    if (qAlpha(color) != 0 && entries.value(color, kMaxColors) > index)
+        entries.insert(color, index);
+    return true;
+}
+
+std::optional<IndexedFrame> Palette::indexFrame(const Frame &frame) {
+    const qsizetype count = qsizetype(frame.getWidth()) * frame.getHeight();
+    const QRgb *pixels = frame.constPixels();
+    IndexedFrame::Buffer indices(count);
+
+    // pixel art is drawn in runs of one color, so the last lookup is usually the answer
+    QRgb lastColor = 0;
+    int lastIndex = 0;
+    bool hasLast = false;
+    for (qsizetype position = 0; position < count; position++) {
+        if (!hasLast || pixels[position] != lastColor) {
+            lastColor = pixels[position];
+            lastIndex = addColor(lastColor);
+            hasLast = true;
+            if (lastIndex < 0)
+                return std::nullopt;
+        }
+        indices[position] = quint8(lastIndex);
+    }
+    return IndexedFrame(frame.getWidth(), frame.getHeight(), std::move(indices));
+}
+
+Frame Palette::expandFrame(const IndexedFrame &frame) const {
+    const qsizetype count = qsizetype(frame.getWidth()) * frame.getHeight();
+    // a frame read from a file may use entries past the end, so they look up transparent instead
+    QRgb lookup[kMaxColors] = {};
+    std::memcpy(lookup, colors.constData(), colors.size() * sizeof(QRgb));
+
+    Frame::Buffer pixels(count);
+    expandPixels<Indexed8Format>(frame.constPixels(), pixels.data(), count, lookup);
+    return Frame(frame.getWidth(), frame.getHeight(), std::move(pixels));
+}
+
+QImage Palette::toImage(const IndexedFrame &frame, const QList<QRgb> &colorTable) {
+    QImage image(frame.getWidth(), frame.getHeight(), QImage::Format_Indexed8);
+    QList<QRgb> table = colorTable;
+    while (table.size() < kMaxColors)
+        table.append(qRgba(0, 0, 0, 0));
+    image.setColorTable(table);
+    for (int y = 0; y < frame.getHeight(); y++)
+        std::memcpy(image.scanLine(y), frame.row(y).data(), frame.getWidth());
+    return image;
+}
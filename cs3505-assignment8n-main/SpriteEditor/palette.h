@@ -0,0 +1,67 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+#include "frame.h"
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <optional>
+/*
+ * a palette is the list of at most 256 colors an indexed sprite is drawn with. the sprite owns it and its
+ * frames only store which entry each pixel uses, so changing an entry recolors every frame at once. the
+ * frames are turned back into colors through the palette only when they are shown or drawn on.
+ * entry 0 is always fully transparent, and every fully transparent pixel uses it.
+ */
+class Palette
+{
+public:
+    /// The most colors a palette can hold, the most an 8 bit index can pick from
+    static constexpr int kMaxColors = 256;
+
+    /// @brief makes a palette holding only the transparent entry
+    Palette();
+
+    /// @brief rebuilds a saved palette, keeping every color at the entry it was saved at
+    /// @param colorTable the colors of the palette in order, entries past 256 are dropped
+    explicit Palette(const QList<QRgb> &colorTable);
+
+    int size() const { return colors.size(); }
+    QRgb color(int index) const { return colors[index]; }
+
+    /// @brief gets the colors in order, in the form QImage takes as an indexed image's color table
+    const QList<QRgb>& colorTable() const { return colors; }
+
+    /// @brief finds the entry holding a color
+    /// @return the entry, or -1 if the color is not in the palette
+    int indexOf(QRgb color) const;
+
+    /// @brief finds the entry holding a color, adding it at the end if it is not there yet
+    /// @return the entry, or -1 if the color is new and the palette is full
+    int addColor(QRgb color);
+
+    /// @brief changes the color of an entry. entry 0 stays transparent and cannot be changed
+    /// @return true if the entry was changed
+    bool setColor(int index, QRgb color);
+
+    /// @brief turns a full color frame into palette indices, adding the colors it uses that are missing
+    /// @param frame the frame to index
+    /// @return the indexed frame, or nothing if the frame needs more colors than the palette has room for,
+    /// in which case the colors that did fit were still added
+    std::optional<IndexedFrame> indexFrame(const Frame &frame);
+
+    /// @brief turns an indexed frame back into full colors, looking every pixel up in the palette
+    Frame expandFrame(const IndexedFrame &frame) const;
+
+    /// @brief makes an indexed image of a frame with the palette as its color table. it takes a quarter of
+    /// the memory of a full color image and is drawn through the palette when it is shown
+    QImage toImage(const IndexedFrame &frame) const { return toImage(frame, colors); }
+
+    /// @brief makes an indexed image of a frame with a color table kept from a palette, for threads that
+    /// only have the colors the palette had when the frame was handed to them
+    static QImage toImage(const IndexedFrame &frame, const QList<QRgb> &colorTable);
+private:
+    QList<QRgb> colors;         // the color of every entry in order
+    QHash<QRgb, int> entries;   // the first entry holding each color
+};
+
+#endif // PALETTE_H
@@ -0,0 +1,36 @@
+#ifndef PIXELFORMAT_H
+#define PIXELFORMAT_H
+
+#include <QColor>
+#include <QtGlobal>
+/*
+ * the pixel formats a frame can store its pixels in. frames and the palette kernels take the format as a template
+ * parameter, so each is built once per format and the inner loops never check which format they are in. the
+ * tools only ever draw on full color frames, an indexed sprite keeps a few frames in full color to draw on.
+ * every format turns its pixels into ARGB through a lookup table, which for an indexed frame is the palette
+ * and for a full color frame is not needed at all.
+ */
+
+/// Every pixel is a full 32 bit ARGB color
+struct Rgba32Format {
+    using Pixel = QRgb;
+
+    /// The pixel a new frame is filled with
+    static constexpr Pixel kTransparent = 0;
+
+    /// @brief gets the ARGB color of a pixel, full color pixels are their own color
+    static QRgb toRgba(Pixel pixel, const QRgb *) { return pixel; }
+};
+
+/// Every pixel is an 8 bit index into a palette of at most 256 colors owned by the sprite
+struct Indexed8Format {
+    using Pixel = quint8;
+
+    /// The pixel a new frame is filled with, palette entry 0 is always transparent
+    static constexpr Pixel kTransparent = 0;
+
+    /// @brief gets the ARGB color of a pixel by looking it up in the palette
+    static QRgb toRgba(Pixel pixel, const QRgb *palette) { return palette[pixel]; }
+};
+
+#endif // PIXELFORMAT_H
@@ -1,88 +1,192 @@
 #include "preview.h"
 #include <QSignalBlocker>
 #include <QTimer>
-/// @reviewed by tj hess
-Preview::Preview(QWidget *parent) : QLabel(parent) {
-    QPixmap pixmap;
-    frames.push_back(pixmap);
-    currentPreview = 0;
-    displayActualSize = false;
-}
+#include <QtConcurrent>
+#include <utility>
 
-void Preview::receiveFrame(const QImage &image, int frameIndex) {
-    QPixmap pixmap = displayActualSize ? QPixmap::fromImage(image) : QPixmap::fromImage(image.scaled(this->size(), Qt::KeepAspectRatio));
+namespace {
 
-    const QSignalBlocker blocker(this);
-    frames.at(frameIndex) = pixmap;
+/// scales a frame the way the preview shows it, an invalid size leaving it at its actual size
+QImage scaleForPreview(const QImage &image, QSize size) {
+    return size.isValid() ? image.scaled(size, Qt::KeepAspectRatio) : image;
 }
 
-void Preview::resetPreviewFrames() {
-    const QSignalBlocker blocker(this);
-    frames.clear();
+} // namespace
+
+/// @reviewed by tj hess
+Preview::Preview(QWidget *parent) : QLabel(parent) {
     currentPreview = 0;
+    displayActualSize = false;
+    connect(&prefetchWatcher, &QFutureWatcher<std::vector<StreamedFrame>>::finished, this, &Preview::takePrefetched);
+    connect(&readWatcher, &QFutureWatcher<std::vector<StreamedFrame>>::finished, this, &Preview::takeRead);
 }
 
-void Preview::deleteFrame(int frameIndex) {
-    if (frameIndex < 0 || (int)frames.size() <= frameIndex)
-        throw std::out_of_range("Index is out of range. Thrown from the Preview class.");
-    const QSignalBlocker blocker(this);
-    frames.erase(frames.begin() + frameIndex);
-    currentPreview = 0;
+void Preview::showSnapshot(std::shared_ptr<const SpriteSnapshot> snapshot) {
+    Preview::snapshot = snapshot;
 }
 
 void Preview::loopPreview() {
-    if (currentPreview == ((int)frames.size() - 1))
-        currentPreview = 0;
-    else
-        currentPreview++;
-
-    setPixmap(frames.at(currentPreview));
+    // the snapshot never changes underneath us, so it is read without any locking
+    if (snapshot && !snapshot->frames.empty()) {
+        if (currentPreview >= ((int)snapshot->frames.size() - 1))
+            currentPreview = 0;
+        else
+            currentPreview++;
+
+        // a frame still being read from the archive leaves the last one up until it is ready
+        QPixmap frame = shouldStream() ? streamedFrame(currentPreview) : scaledFrame(currentPreview);
+        if (!frame.isNull())
+            setPixmap(frame);
+    }
 
     int millisecondsPerFrame = 1000 / frameRate;
     QTimer::singleShot(millisecondsPerFrame, this, [this]{this->loopPreview();});
 }
 
-void Preview::startPreview(int frameRate) {
-    this->frameRate = frameRate;
-    int millisecondsPerFrame = 1000 / frameRate;
-    QTimer::singleShot(millisecondsPerFrame, this, [this]{this->loopPreview();});
-}
+QPixmap Preview::scaledFrame(int index) {
+    const FrameHandle &frame = snapshot->frames[index];
+    QSize size = targetSize();
+    if (size != scaledSize) {
+        scaledFrames.clear();
+        scaledSize = size;
+    }
+    stream.clear(); // only kept while streaming
+    scaledFrames.setMaxCost(MemoryBudget::instance().share(MemoryUse::Preview));
+    if (QPixmap *scaled = scaledFrames.object(frame.key()))
+        return *scaled;
+    if (frame.isArchived()) {
+        readArchivedFrames(index);
+        return QPixmap();
+    }
 
-void Preview::fpsChanged(int frameRate) {
-    const QSignalBlocker blocker(this);
-    this->frameRate = frameRate;
+    // an edited frame gets a new key, so its old scaled copy is never shown again and ages out
+    QPixmap scaled = QPixmap::fromImage(scaleForPreview(frame.toImage(), size));
+    qsizetype bytes = qsizetype(scaled.width()) * scaled.height() * scaled.depth() / 8;
+    scaledFrames.insert(frame.key(), new QPixmap(scaled), bytes);
+    reportMemoryUse();
+    return scaled;
 }
 
-void Preview::addEmptyFrame() {
-    frames.push_back(QPixmap());
+bool Preview::shouldStream() const {
+    QSize size = targetSize().isValid() ? targetSize() : QSize(snapshot->width, snapshot->height);
+    // kept frames keep the aspect ratio, so this is the most one could take
+    qint64 frameBytes = qint64(size.width()) * size.height() * 4;
+    return frameBytes * qint64(snapshot->frames.size()) > MemoryBudget::instance().share(MemoryUse::Preview);
 }
 
-void Preview::loadNewFrames(std::vector<QImage> &images) {
-    const QSignalBlocker blocker(this);
-    resetPreviewFrames();
-    if (displayActualSize) {
-        for (const QImage &image : images){
-            frames.push_back(QPixmap::fromImage(image));
-        }
+QPixmap Preview::streamedFrame(int index) {
+    if (!scaledFrames.isEmpty())
+        scaledFrames.clear(); // streaming keeps nothing once it has been shown
+    if (targetSize() != scaledSize) {
+        stream.clear();
+        scaledSize = targetSize();
     }
-    else{
-        for (const QImage &image : images){
-            frames.push_back(QPixmap::fromImage(image.scaled(size(), Qt::KeepAspectRatio)));
-        }
+
+    // the frames before this one were shown already, or the worker fell behind and they were skipped
+    while (!stream.empty() && stream.front().index != index)
+        stream.pop_front();
+    const FrameHandle &frame = snapshot->frames[index];
+    QImage scaled;
+    bool waiting = false;
+    if (!stream.empty() && stream.front().key == frame.key())
+        scaled = std::move(stream.front().scaled);
+    else if (!frame.isArchived())
+        scaled = scaleForPreview(frame.toImage(), scaledSize); // edited or not ready yet, so scaled here this once
+    else
+        waiting = true; // reading it here would hold up the ui thread, so the worker gets to it
+    if (!stream.empty())
+        stream.pop_front();
+    if (stream.empty() && !prefetchWatcher.isRunning())
+        prefetchNext = waiting ? index : index + 1; // start again from the playhead rather than behind it
+    prefetch();
+    reportMemoryUse();
+    return waiting ? QPixmap() : QPixmap::fromImage(scaled);
+}
+
+void Preview::prefetch() {
+    int frameCount = snapshot->frames.size();
+    int room = kStreamAhead - (int)stream.size();
+    if (prefetchWatcher.isRunning() || room < kStreamBatch || frameCount == 0)
+        return;
+    std::vector<int> indices;
+    for (int i = 0; i < kStreamBatch; i++)
+        indices.push_back((prefetchNext + i) % frameCount); // the preview loops, so the frames after the last are the first
+    prefetchNext = (prefetchNext + kStreamBatch) % frameCount;
+    prefetchSize = scaledSize;
+
+    // the worker only gets the handles of its batch, not the snapshot, and makes each frame's image from its
+    // handle as it gets to it. the full size image is dropped as soon as it is scaled, so all it ever holds
+    // is one frame and the scaled ones it has made
+    std::vector<std::pair<int, FrameHandle>> batch;
+    for (int index : indices)
+        batch.emplace_back(index, snapshot->frames[index]);
+    prefetchWatcher.setFuture(QtConcurrent::run([batch = std::move(batch), size = prefetchSize]() {
+        std::vector<StreamedFrame> frames;
+        for (const auto &[index, frame] : batch)
+            frames.push_back(StreamedFrame{index, frame.key(), scaleForPreview(frame.toImage(), size)});
+        return frames;
+    }));
+}
+
+void Preview::takePrefetched() {
+    std::vector<StreamedFrame> frames = prefetchWatcher.result();
+    if (prefetchSize != scaledSize)
+        return; // scaled for a size the preview has been resized from since, the next frame shown starts over
+    for (StreamedFrame &frame : frames)
+        stream.push_back(std::move(frame));
+    reportMemoryUse();
+    if (snapshot && shouldStream())
+        prefetch();
+}
+
+void Preview::readArchivedFrames(int index) {
+    if (readWatcher.isRunning())
+        return;
+    // a batch of the frames coming up, so the first time round the loop waits on a read once per batch
+    int frameCount = snapshot->frames.size();
+    std::vector<std::pair<int, FrameHandle>> batch;
+    for (int i = 0; i < frameCount && (int)batch.size() < kStreamBatch; i++) {
+        const FrameHandle &frame = snapshot->frames[(index + i) % frameCount];
+        if (frame.isArchived() && !scaledFrames.contains(frame.key()))
+            batch.emplace_back((index + i) % frameCount, frame);
     }
+    readSize = scaledSize;
+    readWatcher.setFuture(QtConcurrent::run([batch = std::move(batch), size = readSize]() {
+        std::vector<StreamedFrame> frames;
+        for (const auto &[index, frame] : batch)
+            frames.push_back(StreamedFrame{index, frame.key(), scaleForPreview(frame.toImage(), size)});
+        return frames;
+    }));
+}
 
+void Preview::takeRead() {
+    std::vector<StreamedFrame> frames = readWatcher.result();
+    if (readSize != scaledSize)
+        return; // scaled for a size the preview has been resized from since
+    for (StreamedFrame &frame : frames) {
+        QPixmap scaled = QPixmap::fromImage(frame.scaled);
+        qsizetype bytes = qsizetype(scaled.width()) * scaled.height() * scaled.depth() / 8;
+        scaledFrames.insert(frame.key, new QPixmap(scaled), bytes);
+    }
+    reportMemoryUse();
 }
 
-void Preview::addClonedImageToPreview(QImage image, int clonedImageIndex) {
-    QPixmap pixmap = displayActualSize ? QPixmap::fromImage(image) : QPixmap::fromImage(image.scaled(this->size(), Qt::KeepAspectRatio));
+void Preview::reportMemoryUse() {
+    qint64 bytes = scaledFrames.totalCost();
+    for (const StreamedFrame &frame : stream)
+        bytes += frame.scaled.sizeInBytes();
+    memoryReport.set(bytes);
+}
 
-    const QSignalBlocker blocker(this);
-    frames.insert(frames.begin() + clonedImageIndex, pixmap);
+void Preview::startPreview(int frameRate) {
+    this->frameRate = frameRate;
+    int millisecondsPerFrame = 1000 / frameRate;
+    QTimer::singleShot(millisecondsPerFrame, this, [this]{this->loopPreview();});
 }
 
-void Preview::resetPreview() {
-    resetPreviewFrames();
-    frames.push_back(QPixmap());
+void Preview::fpsChanged(int frameRate) {
+    const QSignalBlocker blocker(this);
+    this->frameRate = frameRate;
 }
 
 void Preview::setDisplayActualSize(bool displayActualSize) {
@@ -6,9 +6,23 @@
 #include <QWidget>
 #include <QPixmap>
 #include <QImage>
+#include <QCache>
+#include <QFutureWatcher>
+#include <deque>
+#include <memory>
+#include <vector>
+#include "spritesnapshot.h"
+#include "memorybudget.h"
 /*
  * the preview class is responsible for cycling throught the frames at the provided fps and
- * displaying it to the main window.
+ * displaying it to the main window. it plays the frames of the latest snapshot the editor published.
+ * frames it has already scaled are kept for the next time round the loop, dropping the least recently
+ * shown once they take more than the preview's share of the memory budget. frames that have to be read from
+ * the sprite's archive are always made by a worker, and the last frame shown stays up until they are ready.
+ * an animation too long for every frame to fit in that share is streamed instead. a worker thread makes the
+ * images of the next few frames ahead of the one showing from their handles, reading them from the sprite's
+ * archive if that is where they are, and scales them into a short queue. each frame is dropped once it has been
+ * shown, so the preview takes the same memory however long the animation is and never scales on the ui thread.
  * @authors: Noah Campbell, Will Black, Tanner Bergstrom, Tj Hess and Kevin Christiansen
  * @ version 3/31/2024
  * @ reviewd by tj hess
@@ -22,26 +36,92 @@ class Preview : public QLabel
         Preview(QWidget *parent = nullptr);
     private:
         /// Holds the frames of the current sprite
-        std::vector<QPixmap> frames;
+        std::shared_ptr<const SpriteSnapshot> snapshot;
+
+        /// How many scaled frames streaming keeps ready ahead of the one showing
+        static constexpr int kStreamAhead = 16;
+
+        /// How many frames the worker scales at a time while streaming, once there is room for them
+        static constexpr int kStreamBatch = 8;
+
+        /// A frame scaled ahead of time for streaming
+        struct StreamedFrame {
+            int index = 0;     // the frame's place in the animation
+            quint64 key = 0;   // the key of the frame handle it was scaled from
+            QImage scaled;     // the frame scaled for showing
+        };
 
         /// Keeps track of the frame that is currently being displayed in the preview
         int currentPreview;
         int frameRate;
         bool displayActualSize;
 
-        /// @brief Resets the frames in the preview when a new sprite is created or an old
-        /// sprite is loaded.
-        void resetPreviewFrames();
-    public slots:
-        /// @brief Receives an updated frame from the Editor and updates the frames that the Preview
-        /// holds to include the new frame
-        /// @param pixmap The pixmap of the updated frame
-        /// @param frameIndex The index of the updated frame
-        void receiveFrame(const QImage &image, int frameIndex);
+        /// Frames already scaled for showing, by the key of the frame's handle, costed in bytes
+        QCache<quint64, QPixmap> scaledFrames;
+
+        /// The size the frames in scaledFrames were scaled to
+        QSize scaledSize;
+
+        /// The frames scaled ahead of the one showing while streaming, in the order they play
+        std::deque<StreamedFrame> stream;
+
+        /// The worker scaling the next batch of frames to stream
+        QFutureWatcher<std::vector<StreamedFrame>> prefetchWatcher;
+
+        /// The frame the next batch to stream starts at
+        int prefetchNext = 0;
+
+        /// The size the batch the worker is on is being scaled to
+        QSize prefetchSize;
+
+        /// The worker reading frames from the sprite's archive to keep in scaledFrames
+        QFutureWatcher<std::vector<StreamedFrame>> readWatcher;
+
+        /// The size the frames the reading worker is on are being scaled to
+        QSize readSize;
+
+        /// The memory scaledFrames holds, as the memory budget sees it
+        MemoryReport memoryReport{MemoryUse::Preview};
 
-        /// @brief Deletes the frame at frameIndex
-        /// @param the index of the frame to delete
-        void deleteFrame(int frameIndex);
+        /// @brief Gets a frame scaled for showing, making its image and scaling it only if it was not scaled already
+        /// @param index The frame to show
+        /// @return The scaled frame, or a null pixmap while a worker reads it from the archive
+        QPixmap scaledFrame(int index);
+
+        /// @brief Starts a worker reading the archived frames from one on that are not scaled yet, unless it is
+        /// busy already
+        /// @param index The first frame to read
+        void readArchivedFrames(int index);
+
+        /// @brief Keeps the frames the reading worker finished for showing
+        void takeRead();
+
+        /// @brief Tells if every frame of the animation scaled would take more than the preview's share of the
+        /// memory budget, so the frames are streamed instead of kept
+        bool shouldStream() const;
+
+        /// @brief Gets a frame from the stream and drops the frames before it, scaling it on the spot if the
+        /// worker has not got to it yet and it does not have to be read from the archive
+        /// @param index The frame to show
+        /// @return The scaled frame, or a null pixmap until the worker has it
+        QPixmap streamedFrame(int index);
+
+        /// @brief Starts the worker on the next frames to stream, if there is room for a batch and it is not
+        /// busy already
+        void prefetch();
+
+        /// @brief Takes the batch the worker finished into the stream
+        void takePrefetched();
+
+        /// @brief Gets the size frames are scaled to, an invalid size to show them at their actual size
+        QSize targetSize() const { return displayActualSize ? QSize() : size(); }
+
+        /// @brief Tells the memory budget how much the scaled frames take
+        void reportMemoryUse();
+    public slots:
+        /// @brief Switches to playing the frames of a newer snapshot
+        /// @param snapshot The snapshot the editor published
+        void showSnapshot(std::shared_ptr<const SpriteSnapshot> snapshot);
 
         /// @brief Displays the preview by looping through each frame
         /// @param frameRate The number of different frames to display each second
@@ -54,20 +134,6 @@ class Preview : public QLabel
         /// @param frameRate The number of different frames to display each second
         void startPreview(int frameRate);
 
-        /// @brief this loads the next frame in the cycle to be displayed
-        /// @param the QImage to dispaly
-        void loadNewFrames(std::vector<QImage> &images);
-        /// @brief this will add and empty frame the the preview to
-        /// sync up the sprite when a new sprte is created
-        void addEmptyFrame();
-
-        /// @brief this method is responsible for adding the cloned image to the sequence of frames
-        /// @param the image to clone
-        /// @param the index to insert the cloned image
-        void addClonedImageToPreview(QImage image, int clonedImageIndex);
-
-        /// @brief a full reset of the preview for loding new sprites
-        void resetPreview();
         /// @brief a event that cactchs and handles the actuaalSize button being pushed
         /// @param the bool that says if it was pushed or not
         void setDisplayActualSize(bool displayActualSize);
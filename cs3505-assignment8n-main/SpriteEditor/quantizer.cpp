@@ -0,0 +1,180 @@
+#include "quantizer.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+const int kOctreeDepth = 8; // one tree level for each bit of a color channel
+}
+
+ColorQuantizer::ColorQuantizer(const QHash<QRgb, quint32> &histogram, int maxColors) {
+    maxColors = std::max(1, maxColors);
+
+    // every internal node is remembered by its depth so the deepest ones can be reduced first
+    std::vector<int> levels[kOctreeDepth];
+    nodes.emplace_back();
+    levels[0].push_back(0);
+
+    for (auto it = histogram.constBegin(); it != histogram.constEnd(); ++it)
+        insert(it.key(), it.value(), levels);
+
+    for (int level = kOctreeDepth - 1; level >= 0 && leafCount > maxColors; level--) {
+        std::vector<int> &candidates = levels[level];
+        // merging the least used nodes first keeps the most detail where the pixels are
+        std::sort(candidates.begin(), candidates.end(),
+                  [this](int first, int second) { return nodes[first].count < nodes[second].count; });
+        for (int nodeIndex : candidates) {
+            if (leafCount <= maxColors)
+                break;
+            merge(nodeIndex);
+        }
+    }
+
+    // walk the tree and hand out palette slots to the leaves that are left
+    std::vector<int> pending = {0};
+    while (!pending.empty()) {
+        Node &node = nodes[pending.back()];
+        pending.pop_back();
+        if (node.leaf) {
+            node.paletteIndex = palette.size();
+            palette.push_back(qRgb(node.red / node.count, node.green / node.count, node.blue / node.count));
+            continue;
+        }
+        for (int child : node.children)
+            if (child >= 0)
+                pending.push_back(child);
+    }
+
+    if (palette.empty())
+        palette.push_back(qRgb(0, 0, 0));
+}
+
+void ColorQuantizer::insert(QRgb color, quint32 weight, std::vector<int> *levels) {
+    int nodeIndex = 0;
+    for (int level = 0; level < kOctreeDepth; level++) {
+        nodes[nodeIndex].count += weight;
+
+        int slot = childSlot(color, level);
+        int child = nodes[nodeIndex].children[slot];
+        if (child < 0) {
+            child = nodes.size();
+            nodes.emplace_back(); // may move the nodes, so only index into the vector after this
+            nodes[nodeIndex].children[slot] = child;
+            if (level + 1 < kOctreeDepth)
+                levels[level + 1].push_back(child);
+            else {
+                nodes[child].leaf = true;
+                leafCount++;
+            }
+        }
+        nodeIndex = child;
+    }
+
+    Node &leaf = nodes[nodeIndex];
+    leaf.red += quint64(qRed(color)) * weight;
+    leaf.green += quint64(qGreen(color)) * weight;
+    leaf.blue += quint64(qBlue(color)) * weight;
+    leaf.count += weight;
+}
+
+void ColorQuantizer::merge(int nodeIndex) {
+    Node &node = nodes[nodeIndex];
+    int mergedChildren = 0;
+    for (int &child : node.children) {
+        if (child < 0)
+            continue;
+        // the deeper levels are reduced first so every child here is already a leaf
+        node.red += nodes[child].red;
+        node.green += nodes[child].green;
+        node.blue += nodes[child].blue;
+        child = -1;
+        mergedChildren++;
+    }
+    node.leaf = true;
+    leafCount -= mergedChildren - 1;
+}
+
+int ColorQuantizer::indexOf(QRgb color) const {
+    int nodeIndex = 0;
+    for (int level = 0; !nodes[nodeIndex].leaf; level++) {
+        int child = nodes[nodeIndex].children[childSlot(color, level)];
+        if (child < 0)
+            return nearestIndex(color);
+        nodeIndex = child;
+    }
+    return nodes[nodeIndex].paletteIndex;
+}
+
+int ColorQuantizer::nearestIndex(QRgb color) const {
+    int bestIndex = 0;
+    int bestDistance = std::numeric_limits<int>::max();
+    for (int index = 0; index < (int)palette.size(); index++) {
+        int red = qRed(palette[index]) - qRed(color);
+        int green = qGreen(palette[index]) - qGreen(color);
+        int blue = qBlue(palette[index]) - qBlue(color);
+        int distance = red * red + green * green + blue * blue;
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            bestIndex = index;
+        }
+    }
+    return bestIndex;
+}
+
+int ColorQuantizer::childSlot(QRgb color, int level) {
+    int shift = 7 - level;
+    return (((qRed(color) >> shift) & 1) << 2) | (((qGreen(color) >> shift) & 1) << 1) | ((qBlue(color) >> shift) & 1);
+}
+
+void ColorQuantizer::accumulateHistogram(const QImage &image, const QRect &region, QHash<QRgb, quint32> &histogram) {
+    for (int y = region.top(); y <= region.bottom(); y++) {
+        const QRgb *row = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for (int x = region.left(); x <= region.right(); x++)
+            if (isOpaque(row[x]))
+                histogram[row[x] | 0xFF000000]++;
+    }
+}
+
+ColorHistogram::ColorHistogram() : bins(1 << 15) {}
+
+void ColorHistogram::add(const Frame &frame) {
+    const QRgb *pixels = frame.constPixels();
+    const qsizetype count = qsizetype(frame.getWidth()) * frame.getHeight();
+    // pixel art is drawn in runs of one color, so each run is counted at once
+    qsizetype position = 0;
+    while (position < count) {
+        QRgb color = pixels[position];
+        qsizetype runEnd = position + 1;
+        while (runEnd < count && pixels[runEnd] == color)
+            runEnd++;
+        if (ColorQuantizer::isOpaque(color)) {
+            quint64 run = runEnd - position;
+            Bin &bin = bins[((qRed(color) >> 3) << 10) | ((qGreen(color) >> 3) << 5) | (qBlue(color) >> 3)];
+            bin.red += qRed(color) * run;
+            bin.green += qGreen(color) * run;
+            bin.blue += qBlue(color) * run;
+            bin.count += run;
+        }
+        position = runEnd;
+    }
+}
+
+void ColorHistogram::add(const ColorHistogram &other) {
+    for (size_t index = 0; index < bins.size(); index++) {
+        bins[index].red += other.bins[index].red;
+        bins[index].green += other.bins[index].green;
+        bins[index].blue += other.bins[index].blue;
+        bins[index].count += other.bins[index].count;
+    }
+}
+
+QHash<QRgb, quint32> ColorHistogram::colors() const {
+    QHash<QRgb, quint32> histogram;
+    for (const Bin &bin : bins) {
+        if (bin.count == 0)
+            continue;
+        QRgb average = qRgb(bin.red / bin.count, bin.green / bin.count, bin.blue / bin.count);
+        // the counts are only weights, so one too large for the quantizer is capped rather than wrapped
+        histogram[average] += quint32(std::min<quint64>(bin.count, std::numeric_limits<quint32>::max() / 2));
+    }
+    return histogram;
+}
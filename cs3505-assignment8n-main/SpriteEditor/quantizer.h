@@ -0,0 +1,101 @@
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+#include "frame.h"
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <vector>
+/*
+ * the quantizer class reduces a histogram of colors down to a small palette using an octree.
+ * once built it is read only, so many threads can map pixels to palette indices at the same time.
+ * only opaque colors are quantized, transparency is left to the caller.
+ */
+class ColorQuantizer
+{
+public:
+    /// @brief builds a palette of at most maxColors colors from a color histogram
+    /// @param histogram maps each opaque color to the number of pixels using it
+    /// @param maxColors the largest number of colors the palette may hold
+    ColorQuantizer(const QHash<QRgb, quint32> &histogram, int maxColors);
+
+    /// @brief gets the palette that was built, it always holds at least one color
+    /// @return the palette colors as opaque QRgb values
+    const std::vector<QRgb>& getPalette() const { return palette; }
+
+    /// @brief finds the palette entry that represents a color
+    /// @param color the color to look up, its alpha is ignored
+    /// @return the index of the color in the palette
+    int indexOf(QRgb color) const;
+
+    /// @brief counts the opaque pixels of an image region into a histogram.
+    /// pixels with an alpha under half are treated as transparent and skipped
+    /// @param image the ARGB32 image to read
+    /// @param region the part of the image to count
+    /// @param histogram the histogram to add to
+    static void accumulateHistogram(const QImage &image, const QRect &region, QHash<QRgb, quint32> &histogram);
+
+    /// @brief tells if a pixel is drawn or treated as transparent when quantized
+    static bool isOpaque(QRgb color) { return qAlpha(color) >= 128; }
+private:
+    struct Node {
+        quint64 red = 0;
+        quint64 green = 0;
+        quint64 blue = 0;
+        quint64 count = 0;
+        int children[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+        bool leaf = false;
+        int paletteIndex = -1;
+    };
+
+    std::vector<Node> nodes; // the octree, node 0 is the root
+    std::vector<QRgb> palette; // the colors of the reduced leaves
+    int leafCount = 0;
+
+    /// @brief adds weight pixels of color to the tree
+    void insert(QRgb color, quint32 weight, std::vector<int> *levels);
+
+    /// @brief folds all the children of a node back into it
+    void merge(int nodeIndex);
+
+    /// @brief finds the closest palette color by distance, used for colors not in the tree
+    int nearestIndex(QRgb color) const;
+
+    /// @brief gets which child a color belongs to at a depth in the tree
+    static int childSlot(QRgb color, int level);
+};
+
+/*
+ * a color histogram counts the opaque pixels of many frames in bins of 5 bits per channel. a photo-like
+ * animation can use millions of colors, and a flat table of bins is far quicker to fill than a hash and
+ * gives the octree at most 32768 colors to sort through. each bin also sums the exact colors counted into
+ * it, so the palette is still built from their true average. every thread fills a histogram of its own and
+ * they are added together at the end.
+ */
+class ColorHistogram
+{
+public:
+    /// @brief makes an empty histogram
+    ColorHistogram();
+
+    /// @brief counts the opaque pixels of a frame, skipping the ones the quantizer treats as transparent
+    void add(const Frame &frame);
+
+    /// @brief adds the counts of another histogram to this one
+    void add(const ColorHistogram &other);
+
+    /// @brief gets the average color of every bin that was used and how many pixels went into it, the
+    /// histogram the quantizer is built from
+    QHash<QRgb, quint32> colors() const;
+private:
+    struct Bin {
+        quint64 red = 0;
+        quint64 green = 0;
+        quint64 blue = 0;
+        quint64 count = 0;
+    };
+
+    std::vector<Bin> bins; // one bin for every 5 bit red, green and blue
+};
+
+#endif // QUANTIZER_H
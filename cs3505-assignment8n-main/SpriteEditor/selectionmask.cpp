@@ -0,0 +1,179 @@
+#include "selectionmask.h"
+#include <cmath>
+#include <stack>
+
+namespace {
+
+/// @brief makes a word with bits first through last set
+quint64 bitRange(int first, int last) {
+    quint64 upTo = last >= 63 ? ~quint64(0) : (quint64(1) << (last + 1)) - 1;
+    return upTo & ~((quint64(1) << first) - 1);
+}
+
+}
+
+SelectionMask::SelectionMask() : SelectionMask(0, 0) {}
+
+SelectionMask::SelectionMask(int width, int height)
+    : width(std::max(0, width)), height(std::max(0, height)), wordsPerRow((this->width + 63) / 64),
+      words(size_t(wordsPerRow) * this->height, 0) {}
+
+SelectionMask SelectionMask::rectangle(int width, int height, const QRect &area) {
+    SelectionMask mask(width, height);
+    QRect clipped = area.normalized().intersected(QRect(0, 0, width, height));
+    for (int y = clipped.top(); y <= clipped.bottom(); y++)
+        mask.selectSpan(y, clipped.left(), clipped.right());
+    return mask;
+}
+
+SelectionMask SelectionMask::lasso(int width, int height, const QPolygon &outline) {
+    SelectionMask mask(width, height);
+    if (outline.size() < 3)
+        return mask;
+
+    // each row is crossed by the outline's edges at its pixel centers, and the pixels between every
+    // second pair of crossings are inside
+    std::vector<double> crossings;
+    for (int y = 0; y < height; y++) {
+        double centerY = y + 0.5;
+        crossings.clear();
+        for (int index = 0; index < outline.size(); index++) {
+            QPointF from = QPointF(outline[index]) + QPointF(0.5, 0.5);
+            QPointF to = QPointF(outline[(index + 1) % outline.size()]) + QPointF(0.5, 0.5);
+            if ((from.y() <= centerY) == (to.y() <= centerY))
+                continue; // the edge does not cross this row
+            crossings.push_back(from.x() + (centerY - from.y()) * (to.x() - from.x()) / (to.y() - from.y()));
+        }
+        std::sort(crossings.begin(), crossings.end());
+        for (size_t index = 0; index + 1 < crossings.size(); index += 2) {
+            int first = std::max(0, int(std::ceil(crossings[index] - 0.5)));
+            int last = std::min(width - 1, int(std::floor(crossings[index + 1] - 0.5)));
+            if (first <= last)
+                mask.selectSpan(y, first, last);
+        }
+    }
+    return mask;
+}
+
+SelectionMask SelectionMask::magicWand(const Frame &frame, QPoint seed) {
+    const int width = frame.getWidth();
+    const int height = frame.getHeight();
+    SelectionMask mask(width, height);
+    if (!QRect(0, 0, width, height).contains(seed))
+        return mask;
+    const QRgb color = frame.row(seed.y())[seed.x()];
+    auto matches = [&](int x, int y) { return frame.row(y)[x] == color && !mask.contains(x, y); };
+
+    // every point on the stack starts a span still to be grown out to the left and right
+    std::stack<QPoint> seeds;
+    seeds.push(seed);
+    while (!seeds.empty()) {
+        QPoint point = seeds.top();
+        seeds.pop();
+        if (!matches(point.x(), point.y()))
+            continue;
+        int first = point.x();
+        int last = point.x();
+        while (first > 0 && matches(first - 1, point.y()))
+            first--;
+        while (last < width - 1 && matches(last + 1, point.y()))
+            last++;
+        mask.selectSpan(point.y(), first, last);
+
+        // the rows above and below only need one seed for each run of matching pixels along the span
+        for (int y : {point.y() - 1, point.y() + 1}) {
+            if (y < 0 || y >= height)
+                continue;
+            bool inRun = false;
+            for (int x = first; x <= last; x++) {
+                bool match = matches(x, y);
+                if (match && !inRun)
+                    seeds.push(QPoint(x, y));
+                inRun = match;
+            }
+        }
+    }
+    return mask;
+}
+
+bool SelectionMask::isEmpty() const {
+    return std::all_of(words.begin(), words.end(), [](quint64 bits) { return bits == 0; });
+}
+
+QRect SelectionMask::bounds() const {
+    QRect area;
+    forEachSpan([&area](int y, int first, int last) { area = area.united(QRect(first, y, last - first + 1, 1)); });
+    return area;
+}
+
+bool SelectionMask::contains(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return false;
+    return (word(x, y) >> (x % 64)) & 1;
+}
+
+void SelectionMask::selectSpan(int y, int firstX, int lastX) {
+    firstX = std::max(firstX, 0);
+    lastX = std::min(lastX, width - 1);
+    if (y < 0 || y >= height || firstX > lastX)
+        return;
+    for (int wordIndex = firstX / 64; wordIndex <= lastX / 64; wordIndex++) {
+        int first = std::max(firstX - wordIndex * 64, 0);
+        int last = std::min(lastX - wordIndex * 64, 63);
+        word(wordIndex * 64, y) |= bitRange(first, last);
+    }
+}
+
+SelectionMask SelectionMask::cropped(const QRect &area) const {
+    SelectionMask result(area.width(), area.height());
+    forEachSpan([&](int y, int first, int last) {
+        result.selectSpan(y - area.top(), first - area.left(), last - area.left());
+    });
+    return result;
+}
+
+SelectionMask SelectionMask::placed(QPoint position, int frameWidth, int frameHeight) const {
+    SelectionMask result(frameWidth, frameHeight);
+    forEachSpan([&](int y, int first, int last) {
+        result.selectSpan(y + position.y(), first + position.x(), last + position.x());
+    });
+    return result;
+}
+
+Frame SelectionMask::copyPixels(const Frame &frame) const {
+    QRect area = bounds();
+    Frame::Buffer pixels(size_t(area.width()) * area.height(), qRgba(0, 0, 0, 0));
+    forEachSpan([&](int y, int first, int last) {
+        auto row = frame.row(y);
+        std::copy(row.begin() + first, row.begin() + last + 1,
+                  pixels.begin() + size_t(y - area.top()) * area.width() + (first - area.left()));
+    });
+    return Frame(area.width(), area.height(), std::move(pixels));
+}
+
+void SelectionMask::clearPixels(Frame &frame) const {
+    forEachSpan([&frame](int y, int first, int last) { frame.fillSpan(y, first, last, qRgba(0, 0, 0, 0)); });
+}
+
+void SelectionMask::pastePixels(const Frame &layer, QPoint position, Frame &frame) const {
+    forEachSpan([&](int y, int first, int last) {
+        int frameY = y + position.y();
+        if (frameY < 0 || frameY >= frame.getHeight())
+            return;
+        // clip the run to the frame once, then copy it across in one go
+        first = std::max(first, -position.x());
+        last = std::min(last, frame.getWidth() - 1 - position.x());
+        frame.copySpan(frameY, first + position.x(), layer.row(y).data() + first, last - first + 1);
+    });
+}
+
+QImage SelectionMask::toImage(QRgb color) const {
+    QRect area = bounds();
+    QImage image(area.size(), QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+    forEachSpan([&](int y, int first, int last) {
+        QRgb *row = reinterpret_cast<QRgb*>(image.scanLine(y - area.top()));
+        std::fill(row + first - area.left(), row + last - area.left() + 1, color);
+    });
+    return image;
+}
@@ -0,0 +1,121 @@
+#ifndef SELECTIONMASK_H
+#define SELECTIONMASK_H
+
+#include "frame.h"
+#include <QImage>
+#include <QPoint>
+#include <QPolygon>
+#include <QRect>
+#include <algorithm>
+#include <vector>
+/*
+ * a selection mask marks which pixels of a frame are selected, one bit per pixel packed 64 to a word.
+ * a selection of a whole frame is 32 times smaller than the frame itself, and the empty words around a
+ * small selection are skipped 64 pixels at a time. masks are made by the rectangle, lasso and magic wand
+ * tools, and move pixels between frames and the floating layer the editor drags them around in.
+ */
+class SelectionMask
+{
+public:
+    /// @brief makes an empty mask with no size
+    SelectionMask();
+
+    /// @brief makes a mask of a frame's size with nothing selected
+    SelectionMask(int width, int height);
+
+    /// @brief selects a rectangle, clipped to the mask
+    static SelectionMask rectangle(int width, int height, const QRect &area);
+
+    /// @brief selects every pixel whose center is inside a closed outline, the way the lasso draws it.
+    /// an outline that crosses itself leaves the parts it wraps twice unselected
+    /// @param outline the corners of the outline in pixel coordinates, the last is joined back to the first
+    static SelectionMask lasso(int width, int height, const QPolygon &outline);
+
+    /// @brief selects the pixels of one color that are connected to a starting pixel, left, right, up or down.
+    /// it grows a whole row span at a time, so large areas take one step per span rather than per pixel
+    /// @param frame the frame to pick the area from
+    /// @param seed the pixel that was clicked on
+    static SelectionMask magicWand(const Frame &frame, QPoint seed);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    /// @brief checks if no pixel is selected
+    bool isEmpty() const;
+
+    /// @brief gets the smallest rectangle holding every selected pixel, empty when nothing is selected
+    QRect bounds() const;
+
+    /// @brief checks if a pixel is selected, pixels outside of the mask never are
+    bool contains(int x, int y) const;
+
+    /// @brief selects a run of pixels on one row, a word at a time
+    /// @param y the row
+    /// @param firstX the first pixel of the run
+    /// @param lastX the last pixel of the run, inclusive
+    void selectSpan(int y, int firstX, int lastX);
+
+    /// @brief calls a function with every run of selected pixels, as its row, first and last x
+    template<typename Function>
+    void forEachSpan(Function function) const;
+
+    /// @brief makes a mask of just the part of this one inside an area, the size of the area
+    SelectionMask cropped(const QRect &area) const;
+
+    /// @brief makes a mask of a frame's size with this mask placed at a position on it, clipped to the frame
+    SelectionMask placed(QPoint position, int frameWidth, int frameHeight) const;
+
+    /// @brief copies the selected pixels of a frame out into a frame the size of bounds(), with the
+    /// pixels around them transparent
+    Frame copyPixels(const Frame &frame) const;
+
+    /// @brief makes every selected pixel of a frame transparent
+    void clearPixels(Frame &frame) const;
+
+    /// @brief writes the pixels this mask selects out of a floating layer onto a frame
+    /// @param layer the floating pixels, the same size as this mask
+    /// @param position where the layer's top left corner sits on the frame
+    /// @param frame the frame to write to, pixels off its edges are dropped
+    void pastePixels(const Frame &layer, QPoint position, Frame &frame) const;
+
+    /// @brief draws the selected pixels in one color over a transparent image the size of bounds(),
+    /// used to tint the selection on the canvas
+    QImage toImage(QRgb color) const;
+private:
+    int width;
+    int height;
+    int wordsPerRow;            // each row starts on a new word, so rows can be walked on their own
+    std::vector<quint64> words; // bit x % 64 of word x / 64 on a row is set if pixel x is selected
+
+    quint64& word(int x, int y) { return words[size_t(y) * wordsPerRow + x / 64]; }
+    quint64 word(int x, int y) const { return words[size_t(y) * wordsPerRow + x / 64]; }
+};
+
+template<typename Function>
+void SelectionMask::forEachSpan(Function function) const {
+    for (int y = 0; y < height; y++) {
+        int x = 0;
+        while (x < width) {
+            quint64 bits = word(x, y) >> (x % 64);
+            if (bits == 0) {
+                x = (x / 64 + 1) * 64; // nothing selected in the rest of this word
+                continue;
+            }
+            while (!(bits & 1)) {
+                bits >>= 1;
+                x++;
+            }
+            int first = x;
+            while (x < width && contains(x, y)) {
+                if (x % 64 == 0 && word(x, y) == ~quint64(0))
+                    x += 64; // a whole word selected
+                else
+                    x++;
+            }
+            x = std::min(x, width);
+            function(y, first, x - 1);
+        }
+    }
+}
+
+#endif // SELECTIONMASK_H
@@ -1,68 +1,461 @@
 #include "sprite.h"
+#include "framecodec.h"
+#include "spritearchive.h"
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QJsonDocument>
 #include <algorithm>
+#include <cstring>
 /// @reviewed by tanner
 Sprite::Sprite(int width, int height) : width(width), height(height) {
     if (width <= 0 || height <= 0) {
         width = 0;
         height = 0;
     }
-    frames.push_back(Frame(width, height)); // Create the initial frame
+    Frame frame(width, height); // Create the initial frame
+    pushFrame(frame);
 }
 
 Sprite::Sprite(QJsonObject& spriteObj) {
     width = spriteObj["width"].toInt();
     height = spriteObj["height"].toInt();
+    if (spriteObj.contains("palette")) {
+        QList<QRgb> colorTable;
+        for (const QJsonValue& colorVal : spriteObj["palette"].toArray())
+            colorTable.append(QRgb(colorVal.toInteger()));
+        palette = Palette(colorTable);
+    }
 
     QJsonArray framesArray = spriteObj["frames"].toArray();
     for (const QJsonValue& frameVal : framesArray) {
         QJsonObject frameObj = frameVal.toObject();
+        // repeated frames are saved as a reference to the first frame with the same pixels
+        int original = frameObj["duplicateOf"].toInt(-1);
+        if (0 <= original && original < (int)frames.size()) {
+            if (frames[original]->frame)
+                pushFrame(*frames[original]->frame);
+            else
+                pushIndexedFrame(*frames[original]->indexed);
+            continue;
+        }
+        if (palette && frameObj.contains("indices")) {
+            QByteArray indices = QByteArray::fromBase64(frameObj["indices"].toString().toLatin1());
+            IndexedFrame::Buffer pixels(indices.begin(), indices.end());
+            pushIndexedFrame(IndexedFrame(width, height, std::move(pixels)));
+            continue;
+        }
+        // delta frames are stored against the frame before them, which has already been read
+        if (frameObj.contains("encoded")) {
+            QByteArray encoded = QByteArray::fromBase64(frameObj["encoded"].toString().toLatin1());
+            Frame frame = FrameCodec::decode(encoded, width, height, frames.empty() ? nullptr : &residentFrame(frames.size() - 1));
+            pushFrame(frame);
+            continue;
+        }
         Frame frame(width, height, frameObj);
 
-        frames.push_back(frame);
+        pushFrame(frame);
+    }
+    internFrames();
+}
+
+Sprite::Sprite(int width, int height, std::vector<Frame> frames) : width(width), height(height) {
+    for (Frame& frame : frames)
+        pushFrame(frame);
+    if (Sprite::frames.empty()) {
+        Frame frame(width, height);
+        pushFrame(frame);
+    }
+}
+
+Sprite::Sprite(std::shared_ptr<SpriteArchive> archive)
+    : archive(archive), width(archive->getWidth()), height(archive->getHeight()) {
+    frames.reserve(archive->getFrameCount());
+    for (int index = 0; index < archive->getFrameCount(); index++) {
+        frames.push_back(makePooled<FrameSlot>());
+        frames.back()->archiveIndex = index;
+        frames.back()->archivedRevision = Frame::newRevision(); // stands for the pixels until they are read
     }
 }
 
-Sprite::Sprite(const Sprite& other) : frames(other.frames), width(other.width), height(other.height) {}
+Sprite::Sprite(const Sprite& other)
+    : archive(other.archive), memoryBudget(other.memoryBudget), palette(other.palette),
+      residentFrames(other.residentFrames),
+      useClock(other.useClock), width(other.width), height(other.height) {
+    frames.reserve(other.frames.size());
+    for (const PooledPtr<FrameSlot>& slot : other.frames)
+        frames.push_back(makePooled<FrameSlot>(*slot));
+}
 
 Sprite& Sprite::operator=(Sprite other) {
     std::swap(width, other.width);
     std::swap(height, other.height);
     std::swap(frames, other.frames);
+    std::swap(archive, other.archive);
+    std::swap(memoryBudget, other.memoryBudget);
+    std::swap(palette, other.palette);
+    std::swap(residentFrames, other.residentFrames);
+    std::swap(useClock, other.useClock);
     return *this;
 }
 
 Sprite::~Sprite() {}
 
 Frame& Sprite::getFrame(int index) {
-    return frames[index];
+    return residentFrame(index);
+}
+
+Frame& Sprite::residentFrame(int index) const {
+    FrameSlot& slot = *frames[index];
+    slot.lastUsed = ++useClock;
+    if (!slot.frame) {
+        // expanding the indices is quicker than reading the archive, and they may hold edits it does not have
+        if (slot.indexed) {
+            slot.frame = palette->expandFrame(*slot.indexed);
+            slot.indexedRevision = slot.frame->getRevision();
+        }
+        else
+            slot.frame = archive->readFrame(slot.archiveIndex);
+        slot.archivedRevision = slot.frame->getRevision();
+        residentFrames++;
+        evictFrames(index);
+    }
+    return *slot.frame;
+}
+
+bool Sprite::isSaved(const FrameSlot& slot) const {
+    return slot.archiveIndex >= 0 && (!slot.frame || slot.frame->getRevision() == slot.archivedRevision);
+}
+
+bool Sprite::isEvictable(const FrameSlot& slot) const {
+    return slot.frame && (isSaved(slot) || isIndexedCurrent(slot));
+}
+
+bool Sprite::isIndexedCurrent(const FrameSlot& slot) const {
+    return slot.indexed && slot.frame && slot.frame->getRevision() == slot.indexedRevision;
+}
+
+bool Sprite::syncIndexed(FrameSlot& slot) const {
+    std::optional<IndexedFrame> indexed = palette->indexFrame(*slot.frame);
+    if (!indexed)
+        return false;
+    slot.indexed = std::move(indexed);
+    slot.indexedRevision = slot.frame->getRevision();
+    return true;
+}
+
+void Sprite::attachArchive(std::shared_ptr<SpriteArchive> saved) {
+    archive = saved;
+    for (int index = 0; index < (int)frames.size(); index++) {
+        FrameSlot& slot = *frames[index];
+        slot.archiveIndex = index;
+        if (slot.frame)
+            slot.archivedRevision = slot.frame->getRevision();
+    }
+    evictFrames(-1);
+}
+
+int Sprite::savedArchiveIndex(int index) const {
+    return isSaved(*frames[index]) ? frames[index]->archiveIndex : -1;
+}
+
+int Sprite::getUnsavedFrameCount() const {
+    return std::count_if(frames.begin(), frames.end(),
+                         [this](const PooledPtr<FrameSlot>& slot) { return !isSaved(*slot); });
+}
+
+void Sprite::evictFrames(int keep) const {
+    qint64 frameBytes = qint64(width) * height * sizeof(QRgb);
+    qint64 budget = palette ? std::min(memoryBudget, kIndexedWorkingFrames * frameBytes) : memoryBudget;
+    if (qint64(residentFrames) * frameBytes <= budget)
+        return;
+
+    // drop down to three quarters of the budget so the next few reads do not each have to evict
+    std::vector<int> candidates;
+    for (int index = 0; index < (int)frames.size(); index++)
+        if (index != keep && frames[index]->frame && (palette || isEvictable(*frames[index])))
+            candidates.push_back(index);
+    std::sort(candidates.begin(), candidates.end(),
+              [this](int first, int second) { return frames[first]->lastUsed < frames[second]->lastUsed; });
+    for (int index : candidates) {
+        if (qint64(residentFrames) * frameBytes <= budget * 3 / 4)
+            break;
+        FrameSlot& slot = *frames[index];
+        // an indexed sprite folds edited frames back into indices, stale indices must not outlive the frame
+        if (palette && !isIndexedCurrent(slot) && !syncIndexed(slot)) {
+            if (!isSaved(slot))
+                continue;
+            slot.indexed.reset();
+        }
+        // once dropped, the indices are the only copy of an edit the archive does not have
+        if (!isSaved(slot))
+            slot.archiveIndex = -1;
+        slot.frame.reset();
+        residentFrames--;
+    }
+}
+
+void Sprite::prefetchFrames(int first, int count) {
+    if (!archive)
+        return;
+    std::vector<int> archiveIndices;
+    for (int index = std::max(0, first); index < std::min(first + count, (int)frames.size()); index++)
+        if (!frames[index]->frame && !frames[index]->indexed)
+            archiveIndices.push_back(frames[index]->archiveIndex);
+    archive->prefetch(archiveIndices);
+}
+
+void Sprite::setMemoryBudget(qint64 bytes) {
+    memoryBudget = bytes;
+    evictFrames(-1);
 }
 
 void Sprite::insertFrame(Frame& frame, int index) {
-    frames.insert(frames.begin() + index, frame);
+    PooledPtr<FrameSlot> slot = makePooled<FrameSlot>();
+    slot->frame = frame;
+    slot->lastUsed = ++useClock;
+    frames.insert(frames.begin() + index, std::move(slot));
+    residentFrames++;
+}
+
+void Sprite::replaceFrame(Frame& frame, int index) {
+    FrameSlot& slot = *frames[index];
+    if (!slot.frame)
+        residentFrames++;
+    slot.frame = frame;
+    slot.lastUsed = ++useClock;
+    evictFrames(index);
+}
+
+void Sprite::resize(int newWidth, int newHeight, std::vector<Frame> resized) {
+    width = newWidth;
+    height = newHeight;
+    // the frames in the archive are the old size, so none of them can be read back from it until it is saved
+    for (int index = 0; index < (int)frames.size() && index < (int)resized.size(); index++) {
+        FrameSlot& slot = *frames[index];
+        if (!slot.frame)
+            residentFrames++;
+        slot.frame = resized[index];
+        slot.lastUsed = ++useClock;
+    }
+    evictFrames(-1);
 }
 
 void Sprite::pushFrame(Frame& frame) {
-    frames.push_back(frame);
+    insertFrame(frame, frames.size());
+}
+
+void Sprite::pushIndexedFrame(const IndexedFrame& frame) {
+    PooledPtr<FrameSlot> slot = makePooled<FrameSlot>();
+    slot->indexed = frame;
+    slot->lastUsed = ++useClock;
+    frames.push_back(std::move(slot));
 }
 
 void Sprite::eraseFrame(int index) {
+    if (frames[index]->frame)
+        residentFrames--;
     frames.erase(frames.begin() + index);
 }
 
 void Sprite::setPixelColor(int frameIndex, QColor color, int pixelX, int pixelY) {
-    frames[frameIndex].setPixelColor(pixelX, pixelY, color);
+    getFrame(frameIndex).setPixelColor(pixelX, pixelY, color);
 }
 
 QColor Sprite::getPixelColor(int frameIndex, int pixelX, int pixelY) {
-    return frames[frameIndex].getPixelColor(pixelX, pixelY);
+    return getFrame(frameIndex).getPixelColor(pixelX, pixelY);
+}
+
+int Sprite::findEarlierDuplicate(int index, QHash<quint64, std::vector<int>>& framesByHash) const {
+    // a copy stays valid while reading the candidates drops other frames from memory
+    Frame frame = residentFrame(index);
+    std::vector<int>& candidates = framesByHash[frame.getContentHash()];
+    for (int candidate : candidates)
+        if (residentFrame(candidate).hasSamePixels(frame))
+            return candidate;
+    candidates.push_back(index);
+    return -1;
 }
 
-QString Sprite::toJson() const {
+int Sprite::internFrames() {
+    int sharedFrames = 0;
+    QHash<quint64, std::vector<int>> framesByHash;
+    for (int index = 0; index < (int)frames.size(); index++) {
+        if (!frames[index]->frame)
+            continue; // frames still in the archive take no memory to share
+        int original = findEarlierDuplicate(index, framesByHash);
+        if (original >= 0 && !frames[index]->frame->sharesPixelsWith(*frames[original]->frame)) {
+            frames[index]->frame->sharePixelsWith(*frames[original]->frame);
+            sharedFrames++;
+        }
+    }
+    return sharedFrames;
+}
+
+Sprite::FrameSharing Sprite::getFrameSharing() const {
+    FrameSharing sharing;
+    sharing.frameCount = frames.size();
+    sharing.residentFrames = residentFrames;
+    qint64 frameBytes = qint64(width) * height * sizeof(QRgb);
+    sharing.bytesUnshared = frameBytes * residentFrames;
+
+    QHash<quint64, std::vector<int>> framesByHash;
+    QHash<quint64, std::vector<int>> buffersByHash; // one frame for each distinct buffer seen
+    for (int index = 0; index < (int)frames.size(); index++) {
+        if (!frames[index]->frame)
+            continue;
+        if (findEarlierDuplicate(index, framesByHash) < 0)
+            sharing.uniqueFrames++;
+
+        const Frame& frame = *frames[index]->frame;
+        std::vector<int>& buffers = buffersByHash[frame.getContentHash()];
+        bool seenBuffer = std::any_of(buffers.begin(), buffers.end(),
+                                      [&](int other) { return frames[other]->frame->sharesPixelsWith(frame); });
+        if (!seenBuffer) {
+            buffers.push_back(index);
+            sharing.pixelBuffers++;
+        }
+    }
+    sharing.bytesUsed = frameBytes * sharing.pixelBuffers;
+    for (const PooledPtr<FrameSlot>& slot : frames)
+        if (slot->indexed)
+            sharing.bytesIndexed += qint64(width) * height;
+    return sharing;
+}
+
+qint64 Sprite::getIndexedBytes() const {
+    if (!palette)
+        return 0;
+    qint64 indexedFrames = std::count_if(frames.begin(), frames.end(),
+                                         [](const PooledPtr<FrameSlot>& slot) { return bool(slot->indexed); });
+    return indexedFrames * width * height;
+}
+
+bool Sprite::convertToIndexed() {
+    if (palette)
+        return true;
+
+    // build the palette on the side, so a sprite with too many colors is left untouched
+    Palette colors;
+    std::vector<IndexedFrame> indexed;
+    indexed.reserve(frames.size());
+    for (int index = 0; index < (int)frames.size(); index++) {
+        std::optional<IndexedFrame> frame = colors.indexFrame(residentFrame(index));
+        if (!frame)
+            return false;
+        indexed.push_back(std::move(*frame));
+    }
+
+    palette = colors;
+    for (int index = 0; index < (int)frames.size(); index++) {
+        FrameSlot& slot = *frames[index];
+        slot.indexed = std::move(indexed[index]);
+        slot.indexedRevision = slot.frame ? slot.frame->getRevision() : 0;
+    }
+    evictFrames(-1);
+    return true;
+}
+
+void Sprite::convertToFullColor() {
+    if (!palette)
+        return;
+    for (const PooledPtr<FrameSlot>& handle : frames) {
+        FrameSlot& slot = *handle;
+        if (!slot.frame && slot.indexed) {
+            slot.frame = palette->expandFrame(*slot.indexed);
+            slot.archivedRevision = slot.frame->getRevision();
+            residentFrames++;
+        }
+        slot.indexed.reset();
+    }
+    palette.reset();
+    evictFrames(-1);
+}
+
+bool Sprite::setPaletteColor(int index, QRgb color) {
+    if (!palette || index <= 0 || index >= palette->size())
+        return false;
+
+    // fold the frames being drawn on back into indices first, so they take on the new color as well
+    for (const PooledPtr<FrameSlot>& handle : frames) {
+        FrameSlot& slot = *handle;
+        if (!slot.frame || (!isIndexedCurrent(slot) && !syncIndexed(slot)))
+            continue; // a frame with too many colors to index keeps its own
+        // once dropped, the indices are the only copy of an edit the archive does not have
+        if (!isSaved(slot))
+            slot.archiveIndex = -1;
+        slot.frame.reset();
+        residentFrames--;
+    }
+    palette->setColor(index, color);
+
+    // the frames using the entry now look different from what the archive holds for them
+    qsizetype count = qsizetype(width) * height;
+    for (const PooledPtr<FrameSlot>& slot : frames) {
+        if (slot->indexed && !slot->frame && std::memchr(slot->indexed->constPixels(), index, count)) {
+            slot->archiveIndex = -1;
+            slot->indexed->takeRevision();
+        }
+    }
+    return true;
+}
+
+QImage Sprite::frameImage(int index) const {
+    const FrameSlot& slot = *frames[index];
+    if (palette && slot.indexed && (!slot.frame || isIndexedCurrent(slot)))
+        return palette->toImage(*slot.indexed);
+    return residentFrame(index).toImage();
+}
+
+FrameHandle Sprite::frameHandle(int index) const {
+    FrameSlot& slot = *frames[index];
+    if (palette && (isIndexedCurrent(slot) || (slot.frame && syncIndexed(slot))))
+        return FrameHandle(*slot.indexed, palette->colorTable(), slot.indexedRevision);
+    if (palette && slot.indexed && !slot.frame)
+        return FrameHandle(*slot.indexed, palette->colorTable(), slot.indexed->getRevision());
+    if (isSaved(slot))
+        return FrameHandle(archive, slot.archiveIndex, slot.archivedRevision);
+    return FrameHandle(*slot.frame);
+}
+
+quint64 Sprite::getFrameRevision(int index) const {
+    const FrameSlot& slot = *frames[index];
+    if (slot.frame)
+        return slot.frame->getRevision();
+    return slot.indexed ? slot.indexed->getRevision() : slot.archivedRevision;
+}
+
+QString Sprite::toJson(bool deltaFrames, int keyframeInterval) const {
     QJsonArray framesArray;
-    for (const Frame& frame : frames) {
+    QHash<quint64, std::vector<int>> framesByHash;
+    for (int index = 0; index < (int)frames.size(); index++) {
+        int original = findEarlierDuplicate(index, framesByHash);
+        if (original >= 0) {
+            QJsonObject duplicateObj;
+            duplicateObj["duplicateOf"] = original;
+            framesArray.append(duplicateObj);
+            continue;
+        }
+        // an indexed frame is a quarter of the size before any encoding, so it is stored as its indices
+        FrameSlot& slot = *frames[index];
+        if (palette && (slot.frame ? isIndexedCurrent(slot) || syncIndexed(slot) : bool(slot.indexed))) {
+            const IndexedFrame& indexed = *slot.indexed;
+            QByteArray indices(reinterpret_cast<const char*>(indexed.constPixels()), qsizetype(width) * height);
+            QJsonObject indexedObj;
+            indexedObj["indices"] = QString::fromLatin1(indices.toBase64());
+            framesArray.append(indexedObj);
+            continue;
+        }
+        Frame frame = residentFrame(index);
+        if (deltaFrames) {
+            bool keyframe = index == 0 || keyframeInterval <= 0 || index % keyframeInterval == 0;
+            std::optional<Frame> previous;
+            if (!keyframe)
+                previous = residentFrame(index - 1);
+            QJsonObject encodedObj;
+            encodedObj["encoded"] = QString::fromLatin1(FrameCodec::encode(frame, previous ? &*previous : nullptr).toBase64());
+            framesArray.append(encodedObj);
+            continue;
+        }
         QJsonDocument frameDoc = QJsonDocument::fromJson(frame.toJson().toUtf8());
         framesArray.append(frameDoc.object());
     }
@@ -71,6 +464,15 @@ QString Sprite::toJson() const {
     spriteObj["width"] = width;
     spriteObj["height"] = height;
     spriteObj["frames"] = framesArray;
+    if (palette) {
+        // written after the frames, which can add the colors of frames edited since they were last indexed
+        QJsonArray paletteArray;
+        for (QRgb color : palette->colorTable())
+            paletteArray.append(qint64(color));
+        spriteObj["palette"] = paletteArray;
+    }
+    if (deltaFrames)
+        spriteObj["keyframeInterval"] = keyframeInterval;
     QJsonDocument doc(spriteObj);
     return doc.toJson(QJsonDocument::Compact); // Use Compact for a more condensed JSON string
 }
@@ -2,8 +2,15 @@
 #define SPRITE_H
 
 #include "frame.h"
+#include "framehandle.h"
+#include "palette.h"
 #include <QString>
 #include <QJsonObject>
+#include <QHash>
+#include <memory>
+#include <optional>
+
+class SpriteArchive;
 /*
  * Sprite class represents an animation sprite, managing a collection of frames,
  * with functionalities for frame manipulation and JSON serialization.
@@ -16,12 +23,42 @@
 class Sprite
 {
     public:
+        /// How much pixel data the frames of the sprite share with each other
+        struct FrameSharing {
+            int frameCount = 0;   // number of frames in the sprite
+            int uniqueFrames = 0; // number of frames with pixels no earlier frame has
+            int pixelBuffers = 0; // number of pixel buffers actually held in memory
+            qint64 bytesUsed = 0;     // memory taken by the pixel buffers
+            qint64 bytesUnshared = 0; // memory the frames would take if each had its own buffer
+            int residentFrames = 0;   // number of frames held in memory, the rest are still in the archive
+            qint64 bytesIndexed = 0;  // memory taken by frames stored as palette indices
+        };
+
+        /// Number of frames between keyframes when saving delta frames
+        static constexpr int kDefaultKeyframeInterval = 16;
+
+        /// Default memory cap for frames read from an archive
+        static constexpr qint64 kDefaultMemoryBudget = 256 * 1024 * 1024;
+
+        /// Most frames an indexed sprite keeps in full color for drawing on, the rest are only kept as indices
+        static constexpr int kIndexedWorkingFrames = 8;
+
         /// @brief Width and Height constructor for Sprite objects
         Sprite(int width, int height);
 
         /// @brief Json constructor
         Sprite(QJsonObject& spriteObj);
 
+        /// @brief Builds a sprite out of frames that were already made, like imported images
+        /// @param frames The frames of the sprite, all of them width by height
+        Sprite(int width, int height, std::vector<Frame> frames);
+
+        /// @brief Opens a sprite on an archive without reading any frames. Each frame is read the first
+        /// time getFrame asks for it, and the least recently used unedited frames are dropped again
+        /// once they take up more than the memory budget.
+        /// @param archive The archive the frames come from.
+        Sprite(std::shared_ptr<SpriteArchive> archive);
+
         /// @brief Copy constructor for Sprite objects
         Sprite(const Sprite& other);
 
@@ -31,14 +68,46 @@ class Sprite
         /// @brief Destructor for Sprite objects
         ~Sprite();
 
-        /// @brief Retrieves a reference to a specific frame by index.
+        /// @brief Retrieves a reference to a specific frame by index, reading it from the archive if needed.
+        /// Inserting or erasing other frames leaves it in place, but for a sprite opened on an archive the
+        /// reference is only safe to use until getFrame is called again.
         /// @param index The index of the frame to retrieve.
         /// @return Reference to the Frame object at the specified index.
         Frame& getFrame(int index);
 
+        /// @brief Starts reading frames from the archive in the background so getFrame has them ready,
+        /// used ahead of playing frames back in order. Does nothing if the sprite has no archive.
+        /// @param first The first frame that will be needed.
+        /// @param count How many frames after it will be needed.
+        void prefetchFrames(int first, int count);
+
+        /// @brief Sets how much memory the frames read from the archive may take up. Edited and new frames
+        /// are never dropped, so they can take the sprite past the budget.
+        /// @param bytes The memory cap in bytes.
+        void setMemoryBudget(qint64 bytes);
+
+        /// @brief Gets the archive the sprite's frames are read from, or nullptr if every frame is in memory.
+        std::shared_ptr<SpriteArchive> getArchive() const { return archive; }
+
+        /// @brief Points the sprite at an archive that was just saved from it, so unedited frames can be
+        /// dropped from memory and the next save only has to write the frames edited after this.
+        /// @param saved An archive holding exactly the current frames, in order.
+        void attachArchive(std::shared_ptr<SpriteArchive> saved);
+
+        /// @brief Finds where a frame is stored in the sprite's archive, if it has not changed since.
+        /// @param index The frame to look up.
+        /// @return The frame's entry in the archive, or -1 if the frame was edited or never saved there.
+        int savedArchiveIndex(int index) const;
+
+        /// @brief Counts the frames that were edited or added since the sprite was last saved to its archive.
+        int getUnsavedFrameCount() const;
+
         /// @brief Serializes the sprite data to JSON format.
+        /// @param deltaFrames True to store each frame as the tiles that changed since the frame before it,
+        /// with a full keyframe every keyframeInterval frames, instead of writing every pixel out.
+        /// @param keyframeInterval How many frames apart the keyframes are when deltaFrames is on.
         /// @return A QString containing the JSON representation of the sprite.
-        QString toJson() const;
+        QString toJson(bool deltaFrames = false, int keyframeInterval = kDefaultKeyframeInterval) const;
 
         /// @brief Sets the current color
         /// @param Color to set the current color to
@@ -58,6 +127,17 @@ class Sprite
         /// @param index
         void insertFrame(Frame& frame, int index);
 
+        /// @brief Replaces the pixels of a frame, without reading the old ones in from the archive.
+        /// @param frame The new frame, copied into the sprite.
+        /// @param index The frame to replace.
+        void replaceFrame(Frame& frame, int index);
+
+        /// @brief Changes the size of the sprite, replacing every frame with one of the new size.
+        /// @param newWidth The new width of the sprite.
+        /// @param newHeight The new height of the sprite.
+        /// @param resized The new frames, newWidth by newHeight, one for each frame of the sprite in order.
+        void resize(int newWidth, int newHeight, std::vector<Frame> resized);
+
         /// @brief Adds a new frame to the sprite, copying the provided frame.
         /// @param frame The frame to add to the sprite.
         void pushFrame(Frame& frame);
@@ -74,9 +154,117 @@ class Sprite
 
         /// @brief Gets the current frame count of the sprite
         int getFrameCount() { return frames.size(); }
+
+        /// @brief Makes every group of identical frames in memory use one shared pixel buffer.
+        /// A shared frame gets its own copy again the first time it is edited.
+        /// @return The number of frames that were switched over to a shared buffer
+        int internFrames();
+
+        /// @brief Measures how many frames in memory are duplicates and how much memory sharing saves
+        FrameSharing getFrameSharing() const;
+
+        /// @brief Gets the memory the full color frames held in memory take, counting shared ones once each.
+        /// Quick enough to ask after every change, unlike getFrameSharing.
+        qint64 getResidentBytes() const { return qint64(residentFrames) * width * height * sizeof(QRgb); }
+
+        /// @brief Gets the memory the frames stored as palette indices take.
+        qint64 getIndexedBytes() const;
+
+        /// @brief Switches the sprite to storing its frames as 8 bit indices into a palette of at most 256
+        /// colors. getFrame still returns full color frames to draw on, expanded from the indices when asked
+        /// for, and only the few most recently used are kept that way.
+        /// @return False if the frames use more than 256 colors, in which case the sprite is left as it was.
+        bool convertToIndexed();
+
+        /// @brief Switches the sprite back to storing every frame in full color, dropping its palette.
+        void convertToFullColor();
+
+        /// @brief Checks if the frames are stored as palette indices
+        bool isIndexed() const { return palette.has_value(); }
+
+        /// @brief Gets the palette of an indexed sprite, or nullptr if the sprite is in full color
+        const Palette* getPalette() const { return palette ? &*palette : nullptr; }
+
+        /// @brief Changes a color of the palette, recoloring every frame that uses it at once.
+        /// @param index The palette entry to change, entry 0 is always transparent.
+        /// @param color The new color of the entry.
+        /// @return False if the sprite is not indexed or there is no such entry.
+        bool setPaletteColor(int index, QRgb color);
+
+        /// @brief Makes an image of a frame to show. A frame of an indexed sprite that is not being drawn on
+        /// becomes an indexed image, a quarter the size of a full color one.
+        /// @param index The frame to show.
+        QImage frameImage(int index) const;
+
+        /// @brief Makes a handle on a frame for a snapshot, sharing what the sprite already keeps the frame in
+        /// rather than making an image of it. A frame that is saved in the archive is only handed out as its
+        /// place there, and an edited frame of an indexed sprite is indexed again first, so a handle never
+        /// keeps full colors the sprite would drop.
+        /// @param index The frame to hand out.
+        FrameHandle frameHandle(int index) const;
+
+        /// @brief Gets the revision of a frame's pixels without reading the frame in, the same as the key of
+        /// its handle. A frame in memory has its own revision, the others the one their indices or archive
+        /// entry were stamped with.
+        /// @param index The frame to look up.
+        quint64 getFrameRevision(int index) const;
     private:
-        // Holds the Frames that make up the Sprite
-        std::vector<Frame> frames;
+        /// A frame of the sprite, which may still be sitting unread in the archive
+        struct FrameSlot {
+            std::optional<Frame> frame; // the pixels, empty while the frame is only in the archive
+            int archiveIndex = -1;      // the frame's place in the archive, -1 for frames made in memory
+            quint64 archivedRevision = 0; // revision of the frame as read or saved, a different one means it was edited
+            quint64 lastUsed = 0;       // when getFrame last returned the frame, for dropping the least recent
+            std::optional<IndexedFrame> indexed; // the frame as palette indices, only in an indexed sprite
+            quint64 indexedRevision = 0; // revision of the full color frame the indices were made from
+        };
+
+        /// @brief Gets a frame, reading it from the archive and dropping older frames if needed.
+        /// Const because reading frames in does not change the sprite's contents.
+        Frame& residentFrame(int index) const;
+
+        /// @brief Checks if a frame still has the pixels stored at its place in the archive.
+        bool isSaved(const FrameSlot& slot) const;
+
+        /// @brief Checks if a frame can be dropped from memory and read back from the archive later.
+        bool isEvictable(const FrameSlot& slot) const;
+
+        /// @brief Checks if a frame in memory still has the pixels its palette indices were made from.
+        bool isIndexedCurrent(const FrameSlot& slot) const;
+
+        /// @brief Stores a frame in memory as palette indices again, adding any new colors to the palette.
+        /// @return False if the palette has no room for the frame's colors, which leaves the indices as they were.
+        bool syncIndexed(FrameSlot& slot) const;
+
+        /// @brief Adds a frame that is only stored as palette indices to the end of the sprite.
+        void pushIndexedFrame(const IndexedFrame& frame);
+
+        /// @brief Drops the least recently used unedited frames until the frames fit the budget again.
+        /// In an indexed sprite edited frames are dropped too, once they are stored as indices again.
+        /// @param keep A frame that must stay in memory, the one just read in.
+        void evictFrames(int keep) const;
+
+        /// @brief Looks for an earlier frame with the same pixels as the frame at index. Frames with new
+        /// pixels are added to framesByHash so later frames can find them.
+        /// @param index The frame to look up
+        /// @param framesByHash The first frame seen with each content hash, built up by calling this in order
+        /// @return The index of the earlier frame, or -1 if the pixels have not been seen yet
+        int findEarlierDuplicate(int index, QHash<quint64, std::vector<int>>& framesByHash) const;
+
+        // Holds the Frames that make up the Sprite, frames are read in on first use even by const methods.
+        // Each slot lives in pool memory behind a handle, so inserting or erasing a frame only moves handles
+        // and a slot never moves while the sprite has it
+        mutable std::vector<PooledPtr<FrameSlot>> frames;
+        // The file frames are read from, or nullptr if every frame is in memory
+        std::shared_ptr<SpriteArchive> archive;
+        // Memory the frames read from the archive may take up
+        qint64 memoryBudget = kDefaultMemoryBudget;
+        // The colors of an indexed sprite, colors are added as frames dropped from memory are indexed
+        mutable std::optional<Palette> palette;
+        // Number of frames held in memory
+        mutable int residentFrames = 0;
+        // Counts getFrame calls, the timestamp used to find the least recently used frames
+        mutable quint64 useClock = 0;
         // Width of the Sprite
         int width;
         // Height of the Sprite
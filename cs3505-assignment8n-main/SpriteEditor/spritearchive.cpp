@@ -0,0 +1,348 @@
+#include "spritearchive.h"
+#include "byteorder.h"
+#include "framecodec.h"
+#include "sprite.h"
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtConcurrent>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kHeaderMagic[] = "SSB1";
+const char kFooterMagic[] = "SSBF";
+const quint32 kVersion = 1;
+const int kHeaderSize = 16; // magic, version, width, height
+const int kFooterSize = 24; // index offset, index size, index checksum, magic
+const int kEntrySize = 17;  // offset, size, kind, reference
+
+/// builds the footer that points at an index written at indexOffset
+QByteArray footerBytes(qint64 indexOffset, const QByteArray &index) {
+    QByteArray footer;
+    appendLittleEndian64(footer, indexOffset);
+    appendLittleEndian32(footer, index.size());
+    appendLittleEndian64(footer, SpriteArchive::checksum(index));
+    footer.append(kFooterMagic);
+    return footer;
+}
+
+}
+
+quint64 SpriteArchive::checksum(const QByteArray &data) {
+    // FNV-1a, stable across platforms and Qt versions unlike qHash, so it can be stored in files
+    quint64 hash = 14695981039346656037ULL;
+    for (char byte : data) {
+        hash ^= uchar(byte);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+SpriteArchive::SpriteArchive(const QString &filepath) : file(filepath) {}
+
+std::shared_ptr<SpriteArchive> SpriteArchive::open(const QString &filepath) {
+    std::shared_ptr<SpriteArchive> archive(new SpriteArchive(filepath));
+    if (!archive->readIndex())
+        return nullptr;
+    return archive;
+}
+
+bool SpriteArchive::readIndex() {
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    qint64 fileSize = file.size();
+    if (fileSize < kHeaderSize + kFooterSize)
+        return false;
+
+    QByteArray header = file.read(kHeaderSize);
+    if (header.size() != kHeaderSize || !header.startsWith(kHeaderMagic) || readLittleEndian32(header, 4) != kVersion)
+        return false;
+    width = readLittleEndian32(header, 8);
+    height = readLittleEndian32(header, 12);
+    if (width <= 0 || height <= 0)
+        return false;
+
+    if (readIndexAt(fileSize - kFooterSize))
+        return true;
+
+    // an append was cut off, so walk back through the file to the last footer that is whole
+    const qint64 chunkSize = 64 * 1024;
+    for (qint64 chunkEnd = fileSize; chunkEnd > kHeaderSize; chunkEnd -= chunkSize - kFooterSize) {
+        qint64 chunkStart = std::max<qint64>(kHeaderSize, chunkEnd - chunkSize);
+        file.seek(chunkStart);
+        QByteArray chunk = file.read(chunkEnd - chunkStart);
+        for (qsizetype magic = chunk.lastIndexOf(kFooterMagic); magic >= kFooterSize - 4;
+             magic = chunk.lastIndexOf(kFooterMagic, magic - 1)) {
+            if (readIndexAt(chunkStart + magic - (kFooterSize - 4)))
+                return true;
+        }
+        if (chunkStart == kHeaderSize)
+            break;
+    }
+    return false;
+}
+
+bool SpriteArchive::readIndexAt(qint64 footerPosition) {
+    file.seek(footerPosition);
+    QByteArray footer = file.read(kFooterSize);
+    if (footer.size() != kFooterSize || footer.mid(20) != QByteArray(kFooterMagic))
+        return false;
+    qint64 indexOffset = readLittleEndian64(footer, 0);
+    quint32 indexSize = readLittleEndian32(footer, 8);
+    if (indexOffset < kHeaderSize || indexOffset + indexSize > footerPosition)
+        return false;
+
+    file.seek(indexOffset);
+    QByteArray index = file.read(indexSize);
+    if (index.size() != qsizetype(indexSize) || checksum(index) != readLittleEndian64(footer, 12))
+        return false;
+    quint32 count = readLittleEndian32(index, 0);
+    if (count == 0 || indexSize != 4 + quint64(count) * kEntrySize)
+        return false;
+
+    std::vector<Entry> indexEntries(count);
+    for (quint32 frameIndex = 0; frameIndex < count; frameIndex++) {
+        int position = 4 + frameIndex * kEntrySize;
+        Entry &entry = indexEntries[frameIndex];
+        entry.offset = readLittleEndian64(index, position);
+        entry.size = readLittleEndian32(index, position + 8);
+        entry.kind = EntryKind(index[position + 12]);
+        entry.reference = qint32(readLittleEndian32(index, position + 13));
+
+        bool valid = false;
+        switch (entry.kind) {
+        case EntryKind::Delta:
+            // deltas written before appending existed leave the reference out, they are always against the frame before
+            if (entry.reference < 0)
+                entry.reference = frameIndex - 1;
+            [[fallthrough]];
+        case EntryKind::Keyframe:
+            valid = entry.offset >= kHeaderSize && entry.offset + entry.size <= indexOffset &&
+                    (entry.kind == EntryKind::Keyframe || (0 <= entry.reference && entry.reference < int(frameIndex)));
+            break;
+        case EntryKind::Reference:
+            valid = 0 <= entry.reference && entry.reference < int(frameIndex) &&
+                    indexEntries[entry.reference].kind != EntryKind::Reference;
+            break;
+        }
+        if (!valid)
+            return false;
+    }
+    entries = std::move(indexEntries);
+    return true;
+}
+
+QByteArray SpriteArchive::indexBytes(const std::vector<Entry> &entries) {
+    QByteArray index;
+    appendLittleEndian32(index, entries.size());
+    for (const Entry &entry : entries) {
+        appendLittleEndian64(index, entry.kind == EntryKind::Reference ? 0 : entry.offset);
+        appendLittleEndian32(index, entry.size);
+        index.append(char(entry.kind));
+        appendLittleEndian32(index, quint32(entry.reference));
+    }
+    return index;
+}
+
+bool SpriteArchive::syncToDisk(QFile &file) {
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+bool SpriteArchive::write(const QString &filepath, Sprite &sprite, int keyframeInterval) {
+    QSaveFile out(filepath);
+    if (!out.open(QIODevice::WriteOnly))
+        return false;
+
+    QByteArray header(kHeaderMagic);
+    appendLittleEndian32(header, kVersion);
+    appendLittleEndian32(header, sprite.getWidth());
+    appendLittleEndian32(header, sprite.getHeight());
+    out.write(header);
+
+    qint64 offset = header.size();
+    std::vector<Entry> written(sprite.getFrameCount());
+    QHash<quint64, std::vector<int>> uniqueFramesByHash;
+    std::optional<Frame> previous;
+    std::vector<int> chainLength(sprite.getFrameCount(), 0); // deltas decoded to read each frame
+    for (int frameIndex = 0; frameIndex < sprite.getFrameCount(); frameIndex++) {
+        // copies share pixels, and holding one keeps it valid while the sprite reads other frames
+        Frame frame = sprite.getFrame(frameIndex);
+        Entry &entry = written[frameIndex];
+
+        std::vector<int> &candidates = uniqueFramesByHash[frame.getContentHash()];
+        for (int candidate : candidates) {
+            if (sprite.getFrame(candidate).hasSamePixels(frame)) {
+                entry.kind = EntryKind::Reference;
+                entry.reference = candidate;
+                chainLength[frameIndex] = chainLength[candidate]; // reading it decodes whatever its frame does
+                break;
+            }
+        }
+
+        if (entry.kind != EntryKind::Reference) {
+            candidates.push_back(frameIndex);
+            bool keyframe = !previous || chainLength[frameIndex - 1] + 1 >= keyframeInterval;
+            QByteArray encoded = FrameCodec::encode(frame, keyframe ? nullptr : &*previous);
+            if (out.write(encoded) != encoded.size())
+                return false;
+            entry.offset = offset;
+            entry.size = encoded.size();
+            entry.kind = keyframe ? EntryKind::Keyframe : EntryKind::Delta;
+            entry.reference = keyframe ? -1 : frameIndex - 1;
+            chainLength[frameIndex] = keyframe ? 0 : chainLength[frameIndex - 1] + 1;
+            offset += entry.size;
+        }
+        previous = frame;
+    }
+
+    QByteArray index = indexBytes(written);
+    out.write(index);
+    out.write(footerBytes(offset, index));
+    return out.commit();
+}
+
+std::shared_ptr<SpriteArchive> SpriteArchive::append(Sprite &sprite, int keyframeInterval) {
+    QFile out(file.fileName());
+    if (sprite.getWidth() != width || sprite.getHeight() != height || !out.open(QIODevice::WriteOnly | QIODevice::Append))
+        return nullptr;
+    qint64 offset = out.size();
+
+    // the index is only ever replaced by this thread, so it can be read here without the mutex
+    std::vector<Entry> written(sprite.getFrameCount());
+    std::vector<int> chainLength(sprite.getFrameCount(), 0); // deltas decoded to read each frame
+    QHash<int, int> frameOfEntry; // where each entry that is kept ended up in the new index
+    for (int frameIndex = 0; frameIndex < sprite.getFrameCount(); frameIndex++) {
+        Entry &entry = written[frameIndex];
+
+        // an unedited frame keeps its data, as long as whatever it was stored against is still in the sprite.
+        // every unedited frame has the pixels of its old entry, so later frames can use it as their base
+        int archived = sprite.savedArchiveIndex(frameIndex);
+        bool kept = false;
+        if (0 <= archived && archived < (int)entries.size()) {
+            const Entry &saved = entries[archived];
+            auto base = frameOfEntry.constFind(saved.reference);
+            if (saved.kind == EntryKind::Keyframe) {
+                entry = saved;
+                kept = true;
+            }
+            else if (base != frameOfEntry.constEnd() &&
+                     (saved.kind == EntryKind::Reference || chainLength[base.value()] + 1 < keyframeInterval)) {
+                entry = saved;
+                entry.reference = base.value();
+                chainLength[frameIndex] = chainLength[base.value()] + (saved.kind == EntryKind::Delta ? 1 : 0);
+                kept = true;
+            }
+            if (!frameOfEntry.contains(archived))
+                frameOfEntry.insert(archived, frameIndex);
+        }
+        if (kept)
+            continue;
+
+        Frame frame = sprite.getFrame(frameIndex);
+        bool keyframe = frameIndex == 0 || chainLength[frameIndex - 1] + 1 >= keyframeInterval;
+        std::optional<Frame> previous;
+        if (!keyframe)
+            previous = sprite.getFrame(frameIndex - 1);
+        QByteArray encoded = FrameCodec::encode(frame, previous ? &*previous : nullptr);
+        if (out.write(encoded) != encoded.size())
+            return nullptr;
+        entry.offset = offset;
+        entry.size = encoded.size();
+        entry.kind = keyframe ? EntryKind::Keyframe : EntryKind::Delta;
+        entry.reference = keyframe ? -1 : frameIndex - 1;
+        chainLength[frameIndex] = keyframe ? 0 : chainLength[frameIndex - 1] + 1;
+        offset += entry.size;
+    }
+
+    // the footer goes in only once everything it points at is on the disk, so a crash at any point
+    // leaves either the old footer or the new one as the last whole footer in the file
+    QByteArray index = indexBytes(written);
+    if (out.write(index) != index.size() || !syncToDisk(out))
+        return nullptr;
+    QByteArray footer = footerBytes(offset, index);
+    if (out.write(footer) != footer.size() || !syncToDisk(out))
+        return nullptr;
+    out.close();
+    return open(file.fileName());
+}
+
+Frame SpriteArchive::readFrame(int index) {
+    QMutexLocker locker(&mutex);
+    if (index < 0 || index >= (int)entries.size())
+        return Frame(width, height);
+
+    // the caller keeps the frame from here on, so the prefetched copy is no longer needed
+    auto prefetchedFrame = prefetched.find(index);
+    if (prefetchedFrame != prefetched.end()) {
+        Frame frame = prefetchedFrame.value();
+        prefetched.erase(prefetchedFrame);
+        return frame;
+    }
+    return decodeLocked(index);
+}
+
+Frame SpriteArchive::peekFrame(int index) {
+    QMutexLocker locker(&mutex);
+    if (index < 0 || index >= (int)entries.size())
+        return Frame(width, height);
+    return decodeLocked(index);
+}
+
+Frame SpriteArchive::decodeLocked(int index) {
+    if (lastIndex == index)
+        return *lastFrame;
+    auto prefetchedFrame = prefetched.constFind(index);
+    if (prefetchedFrame != prefetched.constEnd())
+        return prefetchedFrame.value();
+
+    const Entry &entry = entries[index];
+    if (entry.kind == EntryKind::Reference)
+        return decodeLocked(entry.reference);
+
+    std::optional<Frame> base;
+    if (entry.kind == EntryKind::Delta)
+        base = decodeLocked(entry.reference);
+    file.seek(entry.offset);
+    Frame frame = FrameCodec::decode(file.read(entry.size), width, height, base ? &*base : nullptr);
+
+    lastIndex = index;
+    lastFrame = frame;
+    return frame;
+}
+
+void SpriteArchive::prefetch(const std::vector<int> &indices) {
+    int generation;
+    {
+        QMutexLocker locker(&mutex);
+        QHash<int, Frame> kept;
+        for (int index : indices) {
+            auto prefetchedFrame = prefetched.constFind(index);
+            if (prefetchedFrame != prefetched.constEnd())
+                kept.insert(index, prefetchedFrame.value());
+        }
+        prefetched.swap(kept);
+        generation = ++prefetchGeneration;
+    }
+
+    std::shared_ptr<SpriteArchive> self = shared_from_this(); // keeps the archive open until the task ends
+    prefetchTask = QtConcurrent::run([self, indices, generation]() {
+        for (int index : indices) {
+            QMutexLocker locker(&self->mutex);
+            if (self->prefetchGeneration != generation)
+                return; // a newer prefetch replaced this one
+            if (index < 0 || index >= (int)self->entries.size() || self->prefetched.contains(index))
+                continue;
+            self->prefetched.insert(index, self->decodeLocked(index));
+        }
+    });
+}
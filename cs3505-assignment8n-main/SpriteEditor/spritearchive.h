@@ -0,0 +1,120 @@
+#ifndef SPRITEARCHIVE_H
+#define SPRITEARCHIVE_H
+
+#include "frame.h"
+#include <QFile>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <memory>
+#include <optional>
+#include <vector>
+
+class Sprite;
+/*
+ * the sprite archive is a binary sprite file (.ssb) that can be opened without reading its frames.
+ * the frames are written one after another with the frame codec, followed by an index of where each
+ * one starts and a footer pointing at the index, so opening a file only reads the index and any frame
+ * can be read on its own later. a frame is either a keyframe, a delta against an earlier frame, or a
+ * reference to an earlier frame with the same pixels.
+ * saving again appends only the frames that changed, then a new index and footer. the old index is left
+ * in place, so a crash partway through an append leaves the file as it was last saved, and rewriting the
+ * whole file with write compacts it again.
+ * reading is thread safe, so upcoming frames can be decoded in the background while the editor works.
+ */
+class SpriteArchive : public std::enable_shared_from_this<SpriteArchive>
+{
+public:
+    /// @brief opens an archive and reads its index
+    /// @param filepath the .ssb file to open
+    /// @return the archive, or nullptr if the file is missing or not a sprite archive
+    static std::shared_ptr<SpriteArchive> open(const QString &filepath);
+
+    /// @brief writes a whole sprite to an archive, replacing the file only once everything is written
+    /// @param filepath the .ssb file to write
+    /// @param sprite the sprite to write, frames it has not read yet are read as they are needed
+    /// @param keyframeInterval how many frames apart the keyframes are, at most this many frames are
+    /// decoded to read any one frame
+    /// @return true if the file was written
+    static bool write(const QString &filepath, Sprite &sprite, int keyframeInterval);
+
+    /// @brief saves a sprite that was opened from this archive by appending the frames edited since it was
+    /// last saved, followed by a new index. unchanged frames keep pointing at the data already in the file.
+    /// this archive stays valid and keeps reading the frames as they were, so copies of the sprite still work
+    /// @param sprite the sprite to save, its unedited frames must have been read from this archive
+    /// @param keyframeInterval the most deltas that may have to be decoded to read any one frame
+    /// @return the archive opened on the new index, or nullptr if the save failed and the file is unchanged
+    std::shared_ptr<SpriteArchive> append(Sprite &sprite, int keyframeInterval);
+
+    /// @brief computes a checksum that stays the same on every platform, for checking data read back from files
+    static quint64 checksum(const QByteArray &data);
+
+    /// @brief flushes a file and waits until the operating system has put what was written on the disk
+    static bool syncToDisk(QFile &file);
+
+    QString getFilePath() const { return file.fileName(); }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getFrameCount() const { return entries.size(); }
+
+    /// @brief reads and decodes one frame, using a prefetched copy if there is one
+    /// @param index the frame's position in the archive
+    /// @return the frame, or a blank frame if its data is damaged
+    Frame readFrame(int index);
+
+    /// @brief reads and decodes one frame for a view, leaving any prefetched copy for the reader it was
+    /// prefetched for
+    /// @param index the frame's position in the archive
+    /// @return the frame, or a blank frame if its data is damaged
+    Frame peekFrame(int index);
+
+    /// @brief starts decoding frames on a background thread so reading them later is instant.
+    /// frames prefetched by an earlier call that are not in this list are dropped
+    /// @param indices the positions of the frames in the archive, in the order they will be needed
+    void prefetch(const std::vector<int> &indices);
+private:
+    /// How a frame is stored
+    enum class EntryKind : char {
+        Keyframe = 'K',  // every pixel of the frame
+        Delta = 'D',     // the tiles that changed since an earlier frame
+        Reference = 'R'  // nothing, the frame has the same pixels as an earlier frame
+    };
+
+    /// Where a frame is stored in the file
+    struct Entry {
+        qint64 offset = 0;    // byte position of the encoded frame
+        quint32 size = 0;     // byte length of the encoded frame
+        EntryKind kind = EntryKind::Keyframe;
+        int reference = -1;   // the frame a Reference entry repeats or a Delta entry was encoded against
+    };
+
+    QFile file;
+    QMutex mutex; // guards the file position and the decoded frames below
+    int width = 0;
+    int height = 0;
+    std::vector<Entry> entries;
+
+    int lastIndex = -1;             // the most recently decoded frame, the base of the next delta
+    std::optional<Frame> lastFrame;
+    QHash<int, Frame> prefetched;   // frames decoded ahead of time by prefetch
+    int prefetchGeneration = 0;     // bumped by each prefetch so an older, unfinished one stops early
+    QFuture<void> prefetchTask;
+
+    SpriteArchive(const QString &filepath);
+
+    /// @brief reads the header, footer and index, returns false if the file is not a valid archive.
+    /// if the last footer is damaged, such as by a crash during an append, the footer before it is used
+    bool readIndex();
+
+    /// @brief reads the index that the footer at a position points to
+    bool readIndexAt(qint64 footerPosition);
+
+    /// @brief turns entries into the bytes of an index
+    static QByteArray indexBytes(const std::vector<Entry> &entries);
+
+    /// @brief decodes a frame and any frames its delta depends on, the mutex must be held
+    Frame decodeLocked(int index);
+};
+
+#endif // SPRITEARCHIVE_H
@@ -0,0 +1,105 @@
+#include "spriteimporter.h"
+#include <QCollator>
+#include <QDir>
+#include <QHash>
+#include <QImageReader>
+#include <QtConcurrent>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+struct DecodedFrame {
+    Frame frame = Frame(0, 0);
+    bool valid = false;
+};
+
+}
+
+Sprite* SpriteImporter::importImageSequence(const QStringList &filepaths) {
+    // only the header of the first readable image is needed to know the sprite size
+    QSize size;
+    for (const QString &filepath : filepaths) {
+        size = QImageReader(filepath).size();
+        if (size.isValid())
+            break;
+    }
+    if (!size.isValid() || size.isEmpty())
+        return nullptr;
+
+    std::vector<Frame> frames = decodeFrames(filepaths.size(), size.width(), size.height(),
+                                             [&filepaths](int index) { return QImage(filepaths.at(index)); });
+    if (frames.empty())
+        return nullptr;
+    return new Sprite(size.width(), size.height(), std::move(frames));
+}
+
+QStringList SpriteImporter::listImageSequence(const QString &folderPath) {
+    QDir folder(folderPath);
+    QStringList names = folder.entryList(QStringList() << "*.png", QDir::Files);
+
+    QCollator collator;
+    collator.setNumericMode(true);
+    std::sort(names.begin(), names.end(), collator);
+
+    QStringList filepaths;
+    for (const QString &name : names)
+        filepaths.append(folder.absoluteFilePath(name));
+    return filepaths;
+}
+
+Sprite* SpriteImporter::importSpriteSheet(const QString &filepath, int cellWidth, int cellHeight) {
+    QImage sheet(filepath);
+    if (sheet.isNull() || cellWidth <= 0 || cellHeight <= 0)
+        return nullptr;
+
+    int columns = sheet.width() / cellWidth;
+    int rows = sheet.height() / cellHeight;
+    if (columns == 0 || rows == 0)
+        return nullptr;
+
+    // convert once up front so every cell copy is a plain memory copy on the worker threads
+    sheet = sheet.convertToFormat(QImage::Format_ARGB32);
+    std::vector<Frame> frames = decodeFrames(columns * rows, cellWidth, cellHeight, [&](int index) {
+        return sheet.copy((index % columns) * cellWidth, (index / columns) * cellHeight, cellWidth, cellHeight);
+    });
+    return new Sprite(cellWidth, cellHeight, std::move(frames));
+}
+
+std::vector<Frame> SpriteImporter::decodeFrames(int frameCount, int width, int height,
+                                                const std::function<QImage(int)> &decodeImage) {
+    std::vector<int> frameIndices(frameCount);
+    std::iota(frameIndices.begin(), frameIndices.end(), 0);
+
+    QList<DecodedFrame> decoded = QtConcurrent::blockingMapped<QList<DecodedFrame>>(frameIndices, [&](int index) {
+        DecodedFrame result;
+        QImage image = decodeImage(index);
+        if (image.isNull())
+            return result;
+
+        image = image.convertToFormat(QImage::Format_ARGB32);
+        if (image.width() != width || image.height() != height)
+            image = image.copy(0, 0, width, height); // anything outside the image comes back transparent
+        result.frame = Frame(image);
+        result.valid = true;
+        return result;
+    });
+
+    // frames with the same hash are compared in full, and real duplicates drop their own buffer
+    std::vector<Frame> frames;
+    frames.reserve(decoded.size());
+    QHash<quint64, std::vector<int>> framesByHash;
+    for (const DecodedFrame &result : decoded) {
+        if (!result.valid)
+            continue;
+        frames.push_back(result.frame);
+        std::vector<int> &candidates = framesByHash[result.frame.getContentHash()];
+        auto match = std::find_if(candidates.begin(), candidates.end(),
+                                  [&frames](int index) { return frames[index].hasSamePixels(frames.back()); });
+        if (match != candidates.end())
+            frames.back().sharePixelsWith(frames[*match]);
+        else
+            candidates.push_back(frames.size() - 1);
+    }
+    return frames;
+}
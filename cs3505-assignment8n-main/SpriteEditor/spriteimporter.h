@@ -0,0 +1,47 @@
+#ifndef SPRITEIMPORTER_H
+#define SPRITEIMPORTER_H
+
+#include "sprite.h"
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <functional>
+/*
+ * the sprite importer builds a new sprite out of ordinary image files, either one image per frame
+ * or one sprite sheet cut up into a grid of frames. Images are decoded and sliced on the global thread
+ * pool and frames that come out identical share one pixel buffer.
+ */
+class SpriteImporter
+{
+public:
+    /// @brief makes a frame out of every image, in the order given. The first image decides the sprite size,
+    /// other images are cropped or padded with transparency to fit it.
+    /// @param filepaths the image files to read
+    /// @return the new sprite, or nullptr if no image could be read. The caller owns it.
+    static Sprite* importImageSequence(const QStringList &filepaths);
+
+    /// @brief lists the png files in a folder ordered the way people number them, so frame2 comes before frame10
+    /// @param folderPath the folder to look in
+    /// @return the full paths of the png files
+    static QStringList listImageSequence(const QString &folderPath);
+
+    /// @brief cuts a sprite sheet into cells of the given size, read left to right then top to bottom.
+    /// Cells that are left over on the right and bottom edges are skipped.
+    /// @param filepath the sprite sheet image to read
+    /// @param cellWidth the width of one frame on the sheet
+    /// @param cellHeight the height of one frame on the sheet
+    /// @return the new sprite, or nullptr if the sheet could not be read. The caller owns it.
+    static Sprite* importSpriteSheet(const QString &filepath, int cellWidth, int cellHeight);
+private:
+    /// @brief decodes frames in parallel and lets the duplicate frames share pixels
+    /// @param frameCount the number of images to decode
+    /// @param width the width of the sprite
+    /// @param height the height of the sprite
+    /// @param decodeImage returns the image for a frame index, or a null image if it could not be read.
+    /// it is called from pool threads
+    /// @return the frames that were read, in order
+    static std::vector<Frame> decodeFrames(int frameCount, int width, int height,
+                                           const std::function<QImage(int)> &decodeImage);
+};
+
+#endif // SPRITEIMPORTER_H
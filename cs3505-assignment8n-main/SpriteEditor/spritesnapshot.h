@@ -0,0 +1,34 @@
+#ifndef SPRITESNAPSHOT_H
+#define SPRITESNAPSHOT_H
+
+#include "framehandle.h"
+#include <QImage>
+#include <QPoint>
+#include <QRect>
+#include <QtGlobal>
+/*
+ * a sprite snapshot is a read only picture of the sprite that the editor publishes after every change.
+ * the editor works on its own thread, so the canvas, preview and frame buttons never look at the sprite
+ * itself, only at the latest snapshot. a snapshot is never changed once published, so any thread can
+ * read one without locking. only the current frame comes as an image, the others are handles that share the
+ * sprite's own pixels and are made into images by whichever view shows them.
+ */
+struct SpriteSnapshot {
+    quint64 version = 0;        // counts up with every published change
+    int width = 0;              // width of the sprite
+    int height = 0;             // height of the sprite
+    int currentFrame = 0;       // the frame being edited
+    bool indexed = false;       // true if the sprite stores its frames as palette indices
+    FrameTable frames;          // a handle on every frame of the sprite, in order
+    QImage currentImage;        // the current frame, made ahead so the canvas never waits on it
+    QImage canvasBase;          // the current frame as the canvas shows it, null to show the frame itself.
+                                // a floating selection leaves a hole here that the frame does not have yet
+    QImage overlay;             // pixels drawn over the canvas that are not part of the frame yet,
+                                // like a floating selection or the tint of the selected pixels
+    QPoint overlayPosition;     // where the overlay's top left corner sits on the frame
+    QRect selectionBounds;      // the outline drawn around the selection, empty when nothing is selected
+    QRect changedPixels;        // the pixels of the current frame that changed since the image with the cache key
+    qint64 changedFrom = 0;     // changedFrom, so a view showing that image only redraws them. 0 if unknown
+};
+
+#endif // SPRITESNAPSHOT_H
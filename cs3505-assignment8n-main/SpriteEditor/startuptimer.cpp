@@ -0,0 +1,38 @@
+#include "startuptimer.h"
+#include <QStringList>
+
+StartupTimer& StartupTimer::instance() {
+    static StartupTimer timer;
+    return timer;
+}
+
+void StartupTimer::start() {
+    timer.start();
+    lastMark = 0;
+    finished = false;
+    phases.clear();
+}
+
+void StartupTimer::mark(const QString &name) {
+    if (finished || !timer.isValid())
+        return;
+    qint64 now = timer.elapsed();
+    phases.push_back(Phase{name, now - lastMark});
+    lastMark = now;
+}
+
+void StartupTimer::finish(const QString &name) {
+    mark(name);
+    finished = true;
+}
+
+qint64 StartupTimer::total() const {
+    return lastMark;
+}
+
+QString StartupTimer::summary() const {
+    QStringList parts;
+    for (const Phase &phase : phases)
+        parts.append(QString("%1 %2 ms").arg(phase.name).arg(phase.milliseconds));
+    return QString("Started in %1 ms (%2)").arg(total()).arg(parts.join(", "));
+}
@@ -0,0 +1,57 @@
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QtGlobal>
+#include <vector>
+
+/*
+ * the startup timer measures how long each step of starting up takes, from main being entered until every
+ * panel is ready. each step is marked as it finishes, and the time since the mark before is put down to it.
+ * it is only used from the window's thread while the editor starts, so it needs no locking.
+ */
+class StartupTimer
+{
+public:
+    /// One step of starting up and how long it took
+    struct Phase {
+        QString name;
+        qint64 milliseconds = 0;
+    };
+
+    /// @brief gets the timer started when main is entered
+    static StartupTimer& instance();
+
+    /// @brief starts timing, the first step is measured from here
+    void start();
+
+    /// @brief marks the end of a step, ignored once startup is finished
+    /// @param name what the step did
+    void mark(const QString &name);
+
+    /// @brief marks the last step and stops taking marks
+    /// @param name what the last step did
+    void finish(const QString &name);
+
+    /// @brief gets every step marked so far, in order
+    const std::vector<Phase>& getPhases() const { return phases; }
+
+    /// @brief gets the time from starting until the last mark
+    qint64 total() const;
+
+    /// @brief tells whether the last step has been marked
+    bool isFinished() const { return finished; }
+
+    /// @brief lists every step with its time, for the status bar
+    QString summary() const;
+private:
+    QElapsedTimer timer;
+    qint64 lastMark = 0;
+    bool finished = false;
+    std::vector<Phase> phases;
+
+    StartupTimer() = default;
+};
+
+#endif // STARTUPTIMER_H
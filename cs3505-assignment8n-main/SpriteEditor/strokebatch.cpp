@@ -0,0 +1,106 @@
+#include "strokebatch.h"
+#include <algorithm>
+
+namespace {
+
+/// @brief the remainder of a division that is never negative, so -1 wraps to the last pixel
+int wrapped(int value, int size) {
+    int remainder = value % size;
+    return remainder < 0 ? remainder + size : remainder;
+}
+
+}
+
+StrokeBatch::StrokeBatch(int width, int height, SymmetryMode symmetry, bool wrap)
+    : width(width), height(height), symmetry(symmetry), wrap(wrap) {}
+
+void StrokeBatch::addSpan(int y, int firstX, int lastX) {
+    if (firstX <= lastX)
+        spans.push_back({y, firstX, lastX});
+}
+
+QRect StrokeBatch::finish() {
+    std::vector<Span> placed;
+    for (const Span &span : spans)
+        placeSpan(span, placed);
+
+    std::vector<Span> copies;
+    copies.reserve(placed.size() * 4);
+    for (const Span &span : placed)
+        addCopies(span, copies);
+
+    // copies and strokes that cross themselves overlap, sorting lets each row be merged in one sweep
+    std::sort(copies.begin(), copies.end(), [](const Span &first, const Span &second) {
+        return first.y != second.y ? first.y < second.y : first.first < second.first;
+    });
+    spans.clear();
+    QRect bounds;
+    for (const Span &span : copies) {
+        if (!spans.empty() && spans.back().y == span.y && span.first <= spans.back().last + 1)
+            spans.back().last = std::max(spans.back().last, span.last);
+        else
+            spans.push_back(span);
+        bounds = bounds.united(QRect(span.first, span.y, span.last - span.first + 1, 1));
+    }
+    return bounds;
+}
+
+void StrokeBatch::placeSpan(const Span &span, std::vector<Span> &placed) const {
+    if (width <= 0 || height <= 0)
+        return;
+    if (!wrap) {
+        if (span.y < 0 || span.y >= height)
+            return;
+        int first = std::max(span.first, 0);
+        int last = std::min(span.last, width - 1);
+        if (first <= last)
+            placed.push_back({span.y, first, last});
+        return;
+    }
+
+    int y = wrapped(span.y, height);
+    if (span.last - span.first + 1 >= width) {
+        placed.push_back({y, 0, width - 1}); // long enough to wrap all the way around the row
+        return;
+    }
+    int first = wrapped(span.first, width);
+    int last = first + (span.last - span.first);
+    if (last < width) {
+        placed.push_back({y, first, last});
+        return;
+    }
+    placed.push_back({y, first, width - 1});
+    placed.push_back({y, 0, last - width});
+}
+
+void StrokeBatch::addCopies(const Span &span, std::vector<Span> &copies) const {
+    copies.push_back(span);
+    Span acrossX = {span.y, width - 1 - span.last, width - 1 - span.first};
+    Span acrossY = {height - 1 - span.y, span.first, span.last};
+    Span halfTurn = {height - 1 - span.y, acrossX.first, acrossX.last};
+    switch (symmetry) {
+    case SymmetryMode::None:
+        break;
+    case SymmetryMode::Horizontal:
+        copies.push_back(acrossX);
+        break;
+    case SymmetryMode::Vertical:
+        copies.push_back(acrossY);
+        break;
+    case SymmetryMode::Both:
+        copies.push_back(acrossX);
+        copies.push_back(acrossY);
+        copies.push_back(halfTurn);
+        break;
+    case SymmetryMode::Radial:
+        copies.push_back(halfTurn);
+        if (width != height)
+            break;
+        // a quarter turn stands a run on its end, so it lands one pixel on each of the rows it crosses
+        for (int x = span.first; x <= span.last; x++) {
+            copies.push_back({x, width - 1 - span.y, width - 1 - span.y});
+            copies.push_back({width - 1 - x, span.y, span.y});
+        }
+        break;
+    }
+}
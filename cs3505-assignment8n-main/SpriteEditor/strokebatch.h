@@ -0,0 +1,80 @@
+#ifndef STROKEBATCH_H
+#define STROKEBATCH_H
+
+#include "frame.h"
+#include <QRect>
+#include <vector>
+
+/// The copies a drawing tool makes of every pixel it draws
+enum class SymmetryMode {
+    None = 0,       // only the pixels drawn
+    Horizontal = 1, // mirrored left to right across the middle of the frame
+    Vertical = 2,   // mirrored top to bottom across the middle of the frame
+    Both = 3,       // mirrored both ways, four copies in all
+    Radial = 4      // turned about the middle of the frame, in quarter turns on square frames and half turns otherwise
+};
+
+/*
+ * a stroke batch gathers the pixels one segment of a stroke or one shape draws as runs along rows, then
+ * writes them and all of their symmetry copies onto a frame in a single pass. the runs are wrapped around
+ * the edges of the frame for tiling, or clipped to it, and overlapping runs are merged, so each pixel is
+ * written once however many copies land on it. finishing the batch gives the one rectangle it changes.
+ */
+class StrokeBatch
+{
+public:
+    /// @brief one run of pixels along a row, first and last inclusive
+    struct Span {
+        int y;
+        int first;
+        int last;
+    };
+
+    /// @brief makes an empty batch for frames of a size
+    /// @param width the frame width
+    /// @param height the frame height
+    /// @param symmetry the copies to make of every pixel
+    /// @param wrap true to wrap pixels off one edge around to the other, false to drop them
+    StrokeBatch(int width, int height, SymmetryMode symmetry = SymmetryMode::None, bool wrap = false);
+
+    /// @brief adds one pixel, it may be off the frame
+    void addPixel(int x, int y) { addSpan(y, x, x); }
+
+    /// @brief adds a run of pixels on one row, it may be partly or wholly off the frame
+    void addSpan(int y, int firstX, int lastX);
+
+    /// @brief wraps or clips every run to the frame, adds the symmetry copies and merges the runs that overlap.
+    /// nothing more can be added afterwards
+    /// @return the smallest rectangle holding every pixel the batch writes, empty if it writes none
+    QRect finish();
+
+    /// @brief gets the runs to write, sorted by row then x, only filled in once the batch is finished
+    const std::vector<Span>& getSpans() const { return spans; }
+
+    /// @brief writes every run of a finished batch onto a frame
+    /// @param frame the frame to draw on
+    /// @param pixel the value to write, a color or a palette index
+    /// @param offset moved by this much first, for drawing into a frame that only covers part of the sprite
+    template<typename Format>
+    void apply(BasicFrame<Format> &frame, typename Format::Pixel pixel, QPoint offset = QPoint()) const;
+private:
+    int width;
+    int height;
+    SymmetryMode symmetry;
+    bool wrap;
+    std::vector<Span> spans;
+
+    /// @brief wraps or clips one run onto the frame, splitting it where it crosses an edge
+    void placeSpan(const Span &span, std::vector<Span> &placed) const;
+
+    /// @brief adds the symmetry copies of one run that is already on the frame
+    void addCopies(const Span &span, std::vector<Span> &copies) const;
+};
+
+template<typename Format>
+void StrokeBatch::apply(BasicFrame<Format> &frame, typename Format::Pixel pixel, QPoint offset) const {
+    for (const Span &span : spans)
+        frame.fillSpan(span.y + offset.y(), span.first + offset.x(), span.last + offset.x(), pixel);
+}
+
+#endif // STROKEBATCH_H
@@ -1,6 +1,7 @@
 #include "tool.h"
 #include "frame.h"
 #include <stack>
+#include <cstdlib>
 /// @reviewed by tanner
 void Tool::pen(const QPoint &pixelPos, const QColor &penColor, Frame &subjectFrame) {
     subjectFrame.setPixelColor(pixelPos.x(), pixelPos.y(), penColor);
@@ -9,37 +10,140 @@ void Tool::eraser(const QPoint &pixelPos, Frame &subjectFrame) {
     subjectFrame.setPixelColor(pixelPos.x(), pixelPos.y(), QColor(Qt::transparent));
 }
 
+namespace {
+
+/// @brief walks a line from one point to another with bresenham's integer midpoint steps
+template<typename Plot>
+void plotLine(QPoint from, QPoint to, Plot plot) {
+    int x = from.x();
+    int y = from.y();
+    int deltaX = std::abs(to.x() - x);
+    int deltaY = -std::abs(to.y() - y);
+    int stepX = x < to.x() ? 1 : -1;
+    int stepY = y < to.y() ? 1 : -1;
+    int error = deltaX + deltaY; // how far the midpoint of the next step is off the true line
+    while (true) {
+        plot(x, y);
+        if (x == to.x() && y == to.y())
+            return;
+        int doubled = 2 * error;
+        if (doubled >= deltaY) {
+            error += deltaY;
+            x += stepX;
+        }
+        if (doubled <= deltaX) {
+            error += deltaX;
+            y += stepY;
+        }
+    }
+}
+
+/// @brief walks the ellipse inside a rectangle one quadrant step at a time with the integer midpoint
+/// method, so rectangles an even number of pixels across get an ellipse that is symmetric as well.
+/// plot is called with the left and right pixel of the ellipse on a row, often more than once per row
+template<typename Plot>
+void plotEllipse(const QRect &bounds, Plot plot) {
+    qint64 width = bounds.width() - 1;
+    qint64 height = bounds.height() - 1;
+    qint64 oddHeight = height & 1;
+    // the error terms grow with the square of the size, so they are kept in 64 bits
+    qint64 stepX = 4 * (1 - width) * height * height;
+    qint64 stepY = 4 * (oddHeight + 1) * width * width;
+    qint64 error = stepX + stepY + oddHeight * width * width;
+    qint64 growX = 8 * height * height;
+    qint64 growY = 8 * width * width;
+
+    int left = bounds.left();
+    int right = bounds.right();
+    int lower = bounds.top() + (height + 1) / 2;
+    int upper = lower - oddHeight;
+    do {
+        plot(upper, left, right);
+        plot(lower, left, right);
+        qint64 doubled = 2 * error;
+        if (doubled <= stepY) {
+            lower++;
+            upper--;
+            error += stepY += growY;
+        }
+        if (doubled >= stepX || 2 * error > stepY) {
+            left++;
+            right--;
+            error += stepX += growX;
+        }
+    } while (left <= right);
+
+    // very flat ellipses end before reaching their top and bottom rows, which are finished straight up
+    while (lower - upper <= height) {
+        plot(lower++, left - 1, right + 1);
+        plot(upper--, left - 1, right + 1);
+    }
+}
+
+}
+
+void Tool::line(const QPoint &from, const QPoint &to, StrokeBatch &stroke) {
+    plotLine(from, to, [&](int x, int y) { stroke.addPixel(x, y); });
+}
+
+void Tool::rectangle(const QPoint &from, const QPoint &to, bool filled, StrokeBatch &stroke) {
+    QRect bounds = QRect(from, to).normalized();
+    for (int y = bounds.top(); y <= bounds.bottom(); y++) {
+        bool edgeRow = y == bounds.top() || y == bounds.bottom();
+        if (filled || edgeRow)
+            stroke.addSpan(y, bounds.left(), bounds.right());
+        else {
+            stroke.addPixel(bounds.left(), y);
+            stroke.addPixel(bounds.right(), y);
+        }
+    }
+}
+
+void Tool::ellipse(const QPoint &from, const QPoint &to, StrokeBatch &stroke) {
+    plotEllipse(QRect(from, to).normalized(), [&](int y, int left, int right) {
+        stroke.addPixel(left, y);
+        stroke.addPixel(right, y);
+    });
+}
+
 QColor Tool::eyeDropper(const QPoint &pixelPos, const Frame &subjectFrame) {
     return subjectFrame.getPixelColor(pixelPos.x(), pixelPos.y());
 }
 
 void Tool::fill(const QPoint &pixelPos, const QColor &fillColor, Frame &subjectFrame) {
-    // recursivly run fill untill there are no pixls near "fill pixle" that have already been set to a color
-    int pixelX = pixelPos.x();
-    int pixelY = pixelPos.y();
-
-    QColor initialColor = subjectFrame.getPixelColor(pixelX, pixelY);
-    if (initialColor == fillColor) return;
+    // the tools always draw on full color frames, an indexed sprite hands them its working copies
+    const QRgb fillPixel = fillColor.rgba();
+    // fill whole runs of the starting pixel's value along each row, and seed the rows above and below
+    const int width = subjectFrame.getWidth();
+    const int height = subjectFrame.getHeight();
+    QRgb initialPixel = subjectFrame.getPixel(pixelPos.x(), pixelPos.y());
+    if (initialPixel == fillPixel) return;
 
     std::stack<QPoint> points;
     points.push(pixelPos);
 
     while (!points.empty()) {
-        pixelX = points.top().x();
-        pixelY = points.top().y();
+        QPoint point = points.top();
         points.pop();
 
-        if (subjectFrame.getPixelColor(pixelX, pixelY) == initialColor)
-            subjectFrame.setPixelColor(pixelX, pixelY, fillColor);
-        else continue;
-
-        // Left case
-        if (pixelX > 0) points.push(QPoint(pixelX - 1, pixelY));
-        // Top case
-        if (pixelY > 0) points.push(QPoint(pixelX, pixelY - 1));
-        // Right case
-        if (pixelX < subjectFrame.getWidth() - 1) points.push(QPoint(pixelX + 1, pixelY));
-        // Bottom case
-        if (pixelY < subjectFrame.getWidth() - 1) points.push(QPoint(pixelX, pixelY + 1));
+        auto row = subjectFrame.row(point.y());
+        if (row[point.x()] != initialPixel) continue;
+        int first = point.x();
+        int last = point.x();
+        while (first > 0 && row[first - 1] == initialPixel) first--;
+        while (last < width - 1 && row[last + 1] == initialPixel) last++;
+        subjectFrame.fillSpan(point.y(), first, last, fillPixel); // may detach, so the row is not read again
+
+        // one seed is enough for each run of unfilled pixels touching the span from above or below
+        for (int neighbourY : {point.y() - 1, point.y() + 1}) {
+            if (neighbourY < 0 || neighbourY >= height) continue;
+            auto neighbour = subjectFrame.row(neighbourY);
+            bool inRun = false;
+            for (int x = first; x <= last; x++) {
+                bool matches = neighbour[x] == initialPixel;
+                if (matches && !inRun) points.push(QPoint(x, neighbourY));
+                inRun = matches;
+            }
+        }
     }
 }
@@ -4,9 +4,10 @@
 #include <QObject>
 #include <QWidget>
 #include "frame.h"
+#include "strokebatch.h"
 /*
  * the tool class is the static class for editing frames simply and effectivly
- * it has 4 diffrent tools for frame alterations and editor alterations
+ * it has the pen, eraser, fill, eye dropper and the shape tools for frame alterations and editor alterations
  * @authors: Noah Campbell, Will Black, Tanner Bergstrom, Tj Hess and Kevin Christiansen
  * @ version 3/31/2024
  *
@@ -37,6 +38,26 @@ public:
     /// @param the color to alter the frame to
     /// @param the frame to alter
     static void fill(const QPoint &pixelPos, const QColor &fillColor, Frame &subjectFrame);
+
+    /// @brief the line tool adds a one pixel wide line between two points to a stroke batch
+    /// @param the point the line starts at in pixle cords
+    /// @param the point the line ends at in pixle cords
+    /// @param the batch to add the line to, it is drawn in one go when the batch is applied
+    static void line(const QPoint &from, const QPoint &to, StrokeBatch &stroke);
+
+    /// @brief the rectangle tool adds the rectangle with two points as opposite corners to a stroke batch
+    /// @param one corner in pixle cords
+    /// @param the opposite corner in pixle cords
+    /// @param true to fill the inside as well as the outline
+    /// @param the batch to add the rectangle to
+    static void rectangle(const QPoint &from, const QPoint &to, bool filled, StrokeBatch &stroke);
+
+    /// @brief the ellipse tool adds the ellipse that fits inside the rectangle with two points as opposite
+    /// corners to a stroke batch
+    /// @param one corner in pixle cords
+    /// @param the opposite corner in pixle cords
+    /// @param the batch to add the ellipse to
+    static void ellipse(const QPoint &from, const QPoint &to, StrokeBatch &stroke);
 };
 
 #endif // TOOL_H
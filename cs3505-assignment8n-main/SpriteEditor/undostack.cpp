@@ -0,0 +1,70 @@
+#include "undostack.h"
+
+qint64 UndoStack::bytesOf(const Transaction &transaction, bool after) {
+    qint64 bytes = 0;
+    for (const FrameChange &change : transaction.changes) {
+        const std::optional<Frame> &frame = after ? change.after : change.before;
+        if (frame)
+            bytes += qint64(frame->getWidth()) * frame->getHeight() * sizeof(QRgb);
+    }
+    return bytes;
+}
+
+void UndoStack::push(Transaction transaction, bool mergeStroke) {
+    for (const Transaction &undone : redoable)
+        bytesHeld -= bytesOf(undone, true);
+    redoable.clear();
+    if (transaction.changes.empty())
+        return;
+
+    if (mergeStroke && !undoable.empty()) {
+        Transaction &last = undoable.back();
+        bool sameFrame = last.changes.size() == 1 && transaction.changes.size() == 1 &&
+                         last.changes[0].kind == FrameChange::Kind::Replaced &&
+                         transaction.changes[0].kind == FrameChange::Kind::Replaced &&
+                         last.changes[0].index == transaction.changes[0].index;
+        if (sameFrame && last.name == transaction.name) {
+            last.changes[0].after = transaction.changes[0].after;
+            last.selectedAfter = transaction.selectedAfter;
+            return;
+        }
+    }
+
+    bytesHeld += bytesOf(transaction, false);
+    undoable.push_back(std::move(transaction));
+    trim();
+}
+
+UndoStack::Transaction UndoStack::takeUndo() {
+    Transaction transaction = std::move(undoable.back());
+    undoable.pop_back();
+    bytesHeld += bytesOf(transaction, true) - bytesOf(transaction, false);
+    redoable.push_back(transaction);
+    return transaction;
+}
+
+UndoStack::Transaction UndoStack::takeRedo() {
+    Transaction transaction = std::move(redoable.back());
+    redoable.pop_back();
+    bytesHeld += bytesOf(transaction, false) - bytesOf(transaction, true);
+    undoable.push_back(transaction);
+    return transaction;
+}
+
+void UndoStack::clear() {
+    undoable.clear();
+    redoable.clear();
+    bytesHeld = 0;
+}
+
+void UndoStack::setMemoryLimit(qint64 bytes) {
+    memoryLimit = bytes;
+    trim();
+}
+
+void UndoStack::trim() {
+    while ((int)undoable.size() > kMaxTransactions || (bytesHeld > memoryLimit && undoable.size() > 1)) {
+        bytesHeld -= bytesOf(undoable.front(), false);
+        undoable.pop_front();
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef UNDOSTACK_H
+#define UNDOSTACK_H
+
+#include "frame.h"
+#include <QSize>
+#include <QString>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <vector>
+/*
+ * the undo stack remembers the changes made to the sprite so they can be undone and redone. every change
+ * is a transaction holding the frames as they were before and after, so a change to a thousand frames
+ * undoes in one step. the frames share their pixels with the sprite until one side is edited, so keeping
+ * them costs little for frames that were not changed. what the history alone keeps alive is the frames as
+ * they were before each change that can be undone and after each one that can be redone, and once those take
+ * more than its memory limit the oldest changes are forgotten, like they are past kMaxTransactions.
+ */
+class UndoStack
+{
+public:
+    /// The most transactions kept, the oldest ones are forgotten past this
+    static constexpr int kMaxTransactions = 100;
+
+    /// One frame changing within a transaction
+    struct FrameChange {
+        enum class Kind {
+            Replaced, // the frame's pixels changed
+            Inserted, // the frame was added
+            Erased    // the frame was removed
+        };
+        Kind kind = Kind::Replaced;
+        int index = 0;               // where the frame is, for an insert where it ends up
+        std::optional<Frame> before; // the frame before, empty for an insert
+        std::optional<Frame> after;  // the frame after, empty for an erase
+    };
+
+    /// Changes that are undone and redone together
+    struct Transaction {
+        QString name;                    // what the user did, like "Pen" or "Flip Horizontally"
+        std::vector<FrameChange> changes; // in the order they were made
+        int selectedBefore = 0;          // the frame that was selected before the change
+        int selectedAfter = 0;           // the frame that was selected after the change
+        QSize sizeBefore;                // for a change that resized the sprite, its size before, and then
+        QSize sizeAfter;                 // every frame is a Replaced change in order
+    };
+
+    /// @brief adds a transaction that was just done, forgetting anything that could be redone
+    /// @param transaction the changes made
+    /// @param mergeStroke true to fold the transaction into the last one when both only change the same
+    /// frame and have the same name, so a whole pen stroke undoes at once
+    void push(Transaction transaction, bool mergeStroke = false);
+
+    bool canUndo() const { return !undoable.empty(); }
+    bool canRedo() const { return !redoable.empty(); }
+
+    /// @brief takes the last transaction done so its changes can be reversed, it moves to the redo list
+    Transaction takeUndo();
+
+    /// @brief takes the last transaction undone so its changes can be made again, it moves to the undo list
+    Transaction takeRedo();
+
+    /// @brief forgets every transaction, used when a different sprite is opened
+    void clear();
+
+    /// @brief sets how much memory the frames only the history holds may take, forgetting the oldest changes
+    /// until they fit. The last change is always kept so it can still be undone
+    void setMemoryLimit(qint64 bytes);
+
+    /// @brief gets the memory taken by the frames only the history holds, the ones the sprite no longer has
+    qint64 getBytesHeld() const { return bytesHeld; }
+private:
+    std::deque<Transaction> undoable; // oldest first
+    std::vector<Transaction> redoable; // most recently undone last
+    qint64 memoryLimit = std::numeric_limits<qint64>::max(); // most memory bytesHeld may reach
+    qint64 bytesHeld = 0; // memory of the before frames of undoable and the after frames of redoable
+
+    /// @brief measures the frames one side of a transaction holds
+    /// @param after true for the frames after the change, false for the ones before it
+    static qint64 bytesOf(const Transaction &transaction, bool after);
+
+    /// @brief forgets the oldest changes until the history fits its limits again
+    void trim();
+};
+
+#endif // UNDOSTACK_H
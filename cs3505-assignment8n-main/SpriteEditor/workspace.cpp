@@ -0,0 +1,112 @@
+#include "workspace.h"
+#include "collabrelay.h"
+#include "editjournal.h"
+#include "memorybudget.h"
+#include <algorithm>
+
+Workspace::Workspace(const QString &journalDirectory) : journalDirectory(journalDirectory) {
+    // the editors do all the pixel work on their own thread so the window never waits on them
+    editorThread.setObjectName("editor");
+    editorThread.start();
+}
+
+Workspace::~Workspace() {
+    editorThread.quit();
+    editorThread.wait();
+    for (Editor *document : documents)
+        delete document;
+    stopRelay();
+    relayThread.quit();
+    relayThread.wait();
+}
+
+Editor* Workspace::openDocument(int width, int height, Sprite *sprite, EditJournal *journal) {
+    Editor *document = new Editor(width, height);
+    if (sprite)
+        document->replaceSprite(sprite);
+    document->shareClipboard(clipboard);
+    // the document records into the same journal for as long as it is open, so it is snapshotted once here
+    // rather than every time it comes to the front
+    if (!journal && !journalDirectory.isEmpty())
+        journal = EditJournal::forNewDocument(journalDirectory).release();
+    if (journal) {
+        document->setJournal(journal);
+        journals[document].reset(journal);
+    }
+    document->moveToThread(&editorThread);
+    documents.push_back(document);
+    activate(document);
+    return document;
+}
+
+void Workspace::closeDocument(Editor *document) {
+    auto found = std::find(documents.begin(), documents.end(), document);
+    if (found == documents.end() || documents.size() <= 1)
+        return;
+    int index = found - documents.begin();
+    documents.erase(found);
+    // the journal finishes writing what the document queued, then deletes its files along with its folder
+    auto journal = journals.find(document);
+    if (journal != journals.end()) {
+        QMetaObject::invokeMethod(document, [document, closing = journal->second.release()]() {
+            document->setJournal(nullptr);
+            delete closing;
+        });
+        journals.erase(journal);
+    }
+    if (document == active) {
+        active = nullptr;
+        activate(documents[std::min(index, (int)documents.size() - 1)]);
+    }
+    else
+        updateDocuments();
+    // anything already queued for it runs first, then it is deleted on its own thread
+    document->deleteLater();
+}
+
+void Workspace::activate(Editor *document) {
+    if (document == active)
+        return;
+    active = document;
+    emit activeChanged(document);
+    updateDocuments();
+}
+
+bool Workspace::hostSession(const QString &address) {
+    if (!relayThread.isRunning()) {
+        relayThread.setObjectName("relay");
+        relayThread.start();
+    }
+    stopRelay(); // the old relay lets go of its address first, in case the new one takes the same
+    relay = new CollabRelay();
+    relay->moveToThread(&relayThread);
+    // its sockets belong to its thread, so it has to start listening there
+    bool listening = false;
+    QMetaObject::invokeMethod(relay, [relay = relay, address]() { return relay->listen(address); },
+                              Qt::BlockingQueuedConnection, &listening);
+    if (!listening)
+        stopRelay();
+    return listening;
+}
+
+void Workspace::stopRelay() {
+    if (!relay)
+        return;
+    QMetaObject::invokeMethod(relay, [relay = relay]() { delete relay; }, Qt::BlockingQueuedConnection);
+    relay = nullptr;
+}
+
+void Workspace::setMemoryBudget(qint64 bytes) {
+    MemoryBudget::instance().setBudget(bytes);
+    updateDocuments();
+}
+
+void Workspace::updateDocuments() {
+    int backgroundDocuments = documents.size() - 1;
+    for (Editor *document : documents) {
+        bool inFront = document == active;
+        QMetaObject::invokeMethod(document, [document, inFront, backgroundDocuments]() {
+            document->setActive(inFront, backgroundDocuments);
+        });
+    }
+}
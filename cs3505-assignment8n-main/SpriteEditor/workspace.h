@@ -0,0 +1,85 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include "editor.h"
+#include <QObject>
+#include <QThread>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class CollabRelay;
+class EditJournal;
+/*
+ * the workspace holds every open document. each document is its own editor with its own sprite, undo history
+ * and selection, and all of their editors run on one editor thread, so they share a clipboard without locking
+ * and frames copied between them share their pixels. only the document in front keeps images of its frames,
+ * the rest keep just their frames, and every document fits into its part of the one memory budget.
+ * every document records into a crash journal of its own, so switching documents keeps all of them safe. the
+ * workspace can also host the relay of a collaboration session on a thread of its own, so the relay keeps
+ * passing edits on while the editors are busy.
+ */
+class Workspace : public QObject
+{
+    Q_OBJECT
+public:
+    /// @brief starts the editor thread, with no documents open yet
+    /// @param journalDirectory the folder each document's crash journal gets a folder in, or empty for none
+    Workspace(const QString &journalDirectory = QString());
+
+    /// @brief stops the editor thread once it has finished what it was doing, then closes every document
+    ~Workspace();
+
+    /// @brief opens a new document and brings it to the front
+    /// @param width the width of its empty sprite
+    /// @param height the height of its empty sprite
+    /// @param sprite a sprite to edit instead of an empty one, the document takes ownership of it
+    /// @param journal a journal to record into instead of a new one, such as the one a recovered sprite was
+    /// rebuilt from. The document takes ownership of it
+    /// @return the new document's editor
+    Editor* openDocument(int width, int height, Sprite *sprite = nullptr, EditJournal *journal = nullptr);
+
+    /// @brief closes a document, bringing the one after it to the front if it was in front. The last
+    /// document open cannot be closed
+    void closeDocument(Editor *document);
+
+    /// @brief brings a document to the front, the view should only send commands to the one in front
+    void activate(Editor *document);
+
+    /// @brief gets the editor of the document in front
+    Editor* getActive() const { return active; }
+
+    /// @brief gets the editor of every open document, in the order they were opened
+    const std::vector<Editor*>& getDocuments() const { return documents; }
+
+    /// @brief starts a relay for a collaboration session, which documents here or in other windows can join.
+    /// Only one is hosted at a time, hosting again replaces it
+    /// @param address a local socket name, or host:port for a TCP port on the loopback address
+    /// @return false if the relay could not listen there
+    bool hostSession(const QString &address);
+public slots:
+    /// @brief sets the memory budget every document and cache shares, and fits each document into its part
+    /// @param bytes the memory cap in bytes
+    void setMemoryBudget(qint64 bytes);
+signals:
+    /// @brief tells the view a different document is in front, sent before the document is told so the view
+    /// can connect to it before it publishes
+    void activeChanged(Editor *document);
+private:
+    QThread editorThread;
+    QThread relayThread;
+    CollabRelay *relay = nullptr;
+    std::vector<Editor*> documents;
+    Editor *active = nullptr;
+    QString journalDirectory;
+    std::unordered_map<Editor*, std::unique_ptr<EditJournal>> journals; // the crash journal of each document
+    std::shared_ptr<Editor::Clipboard> clipboard = std::make_shared<Editor::Clipboard>();
+
+    /// @brief tells every document whether it is in front and how many others share the budget with it
+    void updateDocuments();
+
+    /// @brief closes the hosted relay on its own thread, dropping every site connected to it
+    void stopRelay();
+};
+
+#endif // WORKSPACE_H